@@ -0,0 +1,188 @@
+/*
+    * affinity.c
+    * Implementation of the per-role CPU affinity of the server threads.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include "affinity.h"
+
+typedef struct {
+    int count;             // CPUs de la lista; 0 es sin afinidad
+    int cpus[CPU_SETSIZE]; // En el orden de la opción, para repartir los workers
+    cpu_set_t set;
+} affinity_t;
+
+static affinity_t roles[AFFINITY_ROLES];
+static __thread cpu_set_t saved_set;  // Máscara del thread antes de affinity_enter
+static __thread bool saved;
+
+static const char *role_names[AFFINITY_ROLES] = {
+    "workers", "io", "timer", "logger"
+};
+
+const char *affinity_role_name(affinity_role_t role) {
+    return role >= 0 && role < AFFINITY_ROLES ? role_names[role] : "unknown";
+}
+
+/*
+Funcion que configura los CPUs de un rol a partir de una opción de línea de comandos.
+Parametros:
+    * const char *spec: "<rol>=<cpus>", con los CPUs como lista de números y rangos, por ejemplo "workers=0-7,16-23"
+Retornos:
+    * int: 0 para exito y -1 si el rol o la lista no son válidos
+*/
+int affinity_parse(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return -1;
+    for (int role = 0; role < AFFINITY_ROLES; role++) {
+        if (strlen(role_names[role]) != (size_t)(eq - spec) || strncmp(spec, role_names[role], eq - spec) != 0) continue;
+        affinity_t parsed = { .count = 0 };
+        CPU_ZERO(&parsed.set);
+        const char *p = eq + 1;
+        while (1) {
+            char *end;
+            long first = strtol(p, &end, 10);
+            long last = first;
+            if (end == p) return -1;
+            if (*end == '-') {
+                p = end + 1;
+                last = strtol(p, &end, 10);
+                if (end == p) return -1;
+            }
+            if (first < 0 || last < first || last >= CPU_SETSIZE) return -1;
+            for (long cpu = first; cpu <= last; cpu++) {
+                if (CPU_ISSET(cpu, &parsed.set)) continue;
+                CPU_SET(cpu, &parsed.set);
+                parsed.cpus[parsed.count++] = cpu;
+            }
+            if (*end == '\0') break;
+            if (*end != ',') return -1;
+            p = end + 1;
+        }
+        roles[role] = parsed;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+Funcion que indica cuántos CPUs tiene un rol (0 si no se configuró).
+*/
+int affinity_cpus(affinity_role_t role) {
+    return roles[role].count;
+}
+
+/*
+Funcion que busca un CPU de un rol en el que el proceso no puede correr (no existe, está apagado o fuera de su
+cpuset); el kernel rechaza una máscara sin ningún CPU válido, pero con alguno la acepta y el resto no se nota.
+Retornos:
+    * int: el primer CPU que no está disponible, -1 si todos lo están
+*/
+int affinity_unavailable(affinity_role_t role) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+    for (int i = 0; i < roles[role].count; i++) {
+        if (!CPU_ISSET(roles[role].cpus[i], &allowed)) return roles[role].cpus[i];
+    }
+    return -1;
+}
+
+/*
+Funcion que fija el thread que la llama a los CPUs de su rol. Con un índice queda en un solo CPU de la lista
+(el worker i en el CPU i, dando la vuelta si hay más workers que CPUs); sin él puede correr en cualquiera de ellos.
+Parametros:
+    * affinity_role_t role: rol del thread
+    * int index: posición del thread dentro del rol, -1 para usar toda la lista
+Retornos:
+    * int: 0 para exito (también si el rol no tiene CPUs) y -1 si el kernel rechazó la máscara
+*/
+int affinity_pin(affinity_role_t role, int index) {
+    const affinity_t *a = &roles[role];
+    if (a->count == 0) return 0;
+    cpu_set_t one;
+    const cpu_set_t *set = &a->set;
+    if (index >= 0) {
+        CPU_ZERO(&one);
+        CPU_SET(a->cpus[index % a->count], &one);
+        set = &one;
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), set) == 0 ? 0 : -1;
+}
+
+/*
+Funcion que fija el thread que la llama a un rol mientras crea los threads de otro módulo, que heredan la máscara.
+Se deshace con affinity_leave; no se anida.
+Retornos:
+    * bool: true si cambió la máscara (el rol tiene CPUs)
+*/
+bool affinity_enter(affinity_role_t role) {
+    if (roles[role].count == 0) return false;
+    saved = pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &saved_set) == 0;
+    return affinity_pin(role, -1) == 0;
+}
+
+void affinity_leave(void) {
+    if (!saved) return;
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &saved_set);
+    saved = false;
+}
+
+/*
+Funcion que busca el nodo NUMA de un CPU en sysfs.
+Retornos:
+    * int: el nodo, -1 si el sistema no lo expone
+*/
+static int cpu_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+    int node = -1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+/*
+Funcion que describe los CPUs de un rol y los nodos NUMA que abarcan, para el log de arranque.
+Parametros:
+    * char *out: destino, por ejemplo "0-3,8 (node 0)"; vacío si el rol no tiene CPUs
+*/
+void affinity_describe(affinity_role_t role, char *out, size_t size) {
+    const affinity_t *a = &roles[role];
+    size_t used = 0;
+    out[0] = '\0';
+    for (int i = 0; i < a->count && used < size; i++) {
+        int last = i;
+        while (last + 1 < a->count && a->cpus[last + 1] == a->cpus[last] + 1) last++;
+        if (last == i) {
+            used += snprintf(out + used, size - used, "%s%d", i ? "," : "", a->cpus[i]);
+        } else {
+            used += snprintf(out + used, size - used, "%s%d-%d", i ? "," : "", a->cpus[i], a->cpus[last]);
+        }
+        i = last;
+    }
+    bool seen[CPU_SETSIZE] = {false};
+    const char *label = " (node ";
+    for (int i = 0; i < a->count && used < size; i++) {
+        int node = cpu_node(a->cpus[i]);
+        if (node < 0 || node >= CPU_SETSIZE || seen[node]) continue;
+        seen[node] = true;
+        used += snprintf(out + used, size - used, "%s%d", label, node);
+        label = ",";
+    }
+    if (label[0] == ',' && used < size) snprintf(out + used, size - used, ")");
+}
@@ -0,0 +1,34 @@
+/*
+    * affinity.h
+    * CPU affinity of the server threads by role (--affinity <role>=<cpus>), so on a multi-socket host each group of
+    * threads stays on chosen cores and the memory it touches first comes from their NUMA node.
+    * Each thread pins itself when it starts; threads created inside other modules (output lanes, capture, metrics,
+    * federation) inherit the mask of the thread that starts them, which pins itself to their role around that call.
+    * A role without CPUs leaves its threads where the kernel puts them.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    AFFINITY_WORKERS = 0,  // Workers de las corrutinas (uno por CPU de la lista), o los threads de los handlers
+    AFFINITY_IO,           // Aceptan conexiones, vacían las colas de salida, enlaces de la federación y traspasos
+    AFFINITY_TIMER,        // Inactividad y ventana de coalescencia
+    AFFINITY_LOGGER,       // Captura, snapshots y el endpoint de métricas
+    AFFINITY_ROLES
+} affinity_role_t;
+
+const char *affinity_role_name(affinity_role_t role);
+int affinity_parse(const char *spec);
+int affinity_cpus(affinity_role_t role);
+int affinity_unavailable(affinity_role_t role);
+int affinity_pin(affinity_role_t role, int index);
+bool affinity_enter(affinity_role_t role);
+void affinity_leave(void);
+void affinity_describe(affinity_role_t role, char *out, size_t size);
+
+#endif
@@ -0,0 +1,705 @@
+/*
+    * bench.c
+    * Microbenchmarks for the server hot paths: request decoding, response encoding, the username lookup
+    * and the broadcast fan-out. The server functions are linked in directly (server.c built with SERVER_NO_MAIN)
+    * and every simulated client is one end of an in-process socketpair drained by a background thread.
+    * The pool cases run GET_USERS and broadcasts from several coroutines at once through the work-stealing pool, the
+    * way the server offloads them, with output lanes on every socket, to show how they scale across the workers.
+    * With -v it instead checks the native codec against the generated protobuf-c code on random messages.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "chat.pb-c.h"
+#include "codec.h"
+#include "frame.h"
+#include "coro.h"
+#include "lanes.h"
+#include "server.h"
+#include "transport.h"
+
+#define MIN_RUN_NS 200000000ull
+#define DEFAULT_SIZES "10,100,1000,10000"
+#define VERIFY_CASES 200000
+#define BATCH_SIZE 100
+#define POOL_ROUNDS 16  // Solicitudes que hace cada corrutina por iteración de los casos del pool
+
+typedef struct {
+    int n_clients;
+    int n_pairs;
+    int server_ends[MAX_CLIENTS];
+    int peers[MAX_CLIENTS];
+    int epfd;
+    volatile bool running;
+    pthread_t drain_thread;
+} bench_env_t;
+
+static const char *output_format = "csv";
+static bool first_row = true;
+static int pool_workers = 0;  // Workers del pool de corrutinas; 0 si no se pudo iniciar
+
+// Solicitudes pesadas que hacen las corrutinas de los casos del pool
+typedef enum {
+    POOL_USER_LIST,
+    POOL_BROADCAST
+} pool_op_t;
+
+typedef struct {
+    pool_op_t op;
+    client_t *cli;
+    lanes_held_t held;
+    pthread_mutex_t *lock;
+    pthread_cond_t *done;
+    int *pending;
+} pool_request_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Thread que lee y descarta todo lo que el servidor escribe a los clientes simulados
+static void *drain_main(void *arg) {
+    bench_env_t *env = (bench_env_t *)arg;
+    struct epoll_event events[256];
+    uint8_t sink[65536];
+
+    while (env->running) {
+        int n = epoll_wait(env->epfd, events, 256, 10);
+        for (int i = 0; i < n; i++) {
+            while (recv(events[i].data.fd, sink, sizeof(sink), MSG_DONTWAIT) > 0) {
+            }
+        }
+    }
+    return NULL;
+}
+
+static void raise_fd_limit(int needed) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)needed) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/*
+Funcion que llena clients[] con n clientes conectados a socketpairs locales.
+Si el límite de descriptores no alcanza, los clientes restantes comparten los socketpairs ya creados
+(cada cliente sigue costando un send por mensaje, que es lo que se mide).
+Retornos:
+    * int: 0 para exito y -1 si no se pudo crear ningún socketpair
+*/
+static int env_setup(bench_env_t *env, int n) {
+    env->n_clients = n;
+    env->epfd = epoll_create1(0);
+    for (int i = 0; i < n; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+            if (i == 0) {
+                perror("socketpair");
+                env->n_clients = 0;
+                return -1;
+            }
+            fprintf(stderr, "bench: file descriptor limit reached, %d clients share %d socketpairs\n", n, i);
+            break;
+        }
+        int size = 1 << 20;
+        setsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        setsockopt(pair[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        fcntl(pair[1], F_SETFL, fcntl(pair[1], F_GETFL) | O_NONBLOCK);
+        env->server_ends[i] = pair[0];
+        env->peers[i] = pair[1];
+        env->n_pairs = i + 1;
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = pair[1] };
+        epoll_ctl(env->epfd, EPOLL_CTL_ADD, pair[1], &ev);
+    }
+
+    for (int i = 0; i < n; i++) {
+        client_t *cli = calloc(1, sizeof(client_t));
+        cli->sockfd = env->server_ends[i % env->n_pairs];
+        cli->uid = uid++;
+        cli->status = ACTIVO;
+        cli->last_active = time(NULL);
+        cli->address.sin_family = AF_INET;
+        cli->address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        snprintf(cli->name, sizeof(cli->name), "user%d", i);
+        clients[i] = cli;
+    }
+    env->running = true;
+    pthread_create(&env->drain_thread, NULL, drain_main, env);
+    return 0;
+}
+
+static void env_teardown(bench_env_t *env) {
+    env->running = false;
+    pthread_join(env->drain_thread, NULL);
+    for (int i = 0; i < env->n_pairs; i++) {
+        close(env->server_ends[i]);
+        close(env->peers[i]);
+    }
+    for (int i = 0; i < env->n_clients; i++) {
+        frame_out_free(&clients[i]->coalesced);
+        free(clients[i]);
+        clients[i] = NULL;
+    }
+    close(env->epfd);
+}
+
+static void report(const char *name, int n_clients, uint64_t iterations, uint64_t elapsed, uint64_t units) {
+    double ns_per_op = (double)elapsed / iterations;
+    double ops_per_s = iterations * 1e9 / elapsed;
+    double ns_per_unit = units ? (double)elapsed / (iterations * units) : 0;
+    if (strcmp(output_format, "json") == 0) {
+        printf("%s\n  {\"benchmark\": \"%s\", \"codec\": \"%s\", \"clients\": %d, \"iterations\": %llu, \"ns_per_op\": %.1f, \"ops_per_s\": %.1f, \"ns_per_recipient\": %.1f}",
+               first_row ? "[" : ",", name, codec_kind_name(server_codec), n_clients, (unsigned long long)iterations, ns_per_op, ops_per_s, ns_per_unit);
+    } else {
+        if (first_row) printf("benchmark,codec,clients,iterations,ns_per_op,ops_per_s,ns_per_recipient\n");
+        printf("%s,%s,%d,%llu,%.1f,%.1f,%.1f\n", name, codec_kind_name(server_codec), n_clients, (unsigned long long)iterations, ns_per_op, ops_per_s, ns_per_unit);
+    }
+    first_row = false;
+    fflush(stdout);
+}
+
+/*
+Macro que repite el cuerpo duplicando las iteraciones hasta superar MIN_RUN_NS y reporta el resultado.
+*/
+#define RUN_BENCH(name, n_clients, units, body)                         \
+    do {                                                                \
+        uint64_t iterations = 1, elapsed = 0;                           \
+        while (1) {                                                     \
+            uint64_t start = now_ns();                                  \
+            for (uint64_t it = 0; it < iterations; it++) { body; }      \
+            elapsed = now_ns() - start;                                 \
+            if (elapsed >= MIN_RUN_NS || iterations >= (1ull << 30)) break; \
+            iterations *= 2;                                            \
+        }                                                               \
+        report(name, n_clients, iterations, elapsed, units);           \
+    } while (0)
+
+static void bench_codec(void) {
+    char content[65];
+    memset(content, 'x', 64);
+    content[64] = '\0';
+
+    // Request de broadcast tal como lo envía el cliente
+    Chat__Request request = CHAT__REQUEST__INIT;
+    Chat__SendMessageRequest send_message = CHAT__SEND_MESSAGE_REQUEST__INIT;
+    send_message.content = content;
+    request.operation = CHAT__OPERATION__SEND_MESSAGE;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MESSAGE;
+    request.send_message = &send_message;
+    size_t request_len = chat__request__get_packed_size(&request);
+    uint8_t *request_buf = malloc(request_len);
+    chat__request__pack(&request, request_buf);
+
+    RUN_BENCH("request_unpack", 0, 0, {
+        Chat__Request *req = chat__request__unpack(NULL, request_len, request_buf);
+        chat__request__free_unpacked(req, NULL);
+    });
+    RUN_BENCH("request_decode_native", 0, 0, {
+        codec_send_message_t decoded;
+        codec_decode_send_message(request_buf, request_len, &decoded);
+        __asm__ volatile("" : : "r"(&decoded) : "memory");
+    });
+
+    Chat__IncomingMessageResponse msg = CHAT__INCOMING_MESSAGE_RESPONSE__INIT;
+    msg.sender = "user0";
+    msg.content = content;
+    msg.type = CHAT__MESSAGE_TYPE__BROADCAST;
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = CHAT__OPERATION__INCOMING_MESSAGE;
+    response.status_code = CHAT__STATUS_CODE__OK;
+    response.result_case = CHAT__RESPONSE__RESULT_INCOMING_MESSAGE;
+    response.incoming_message = &msg;
+
+    RUN_BENCH("incoming_message_pack", 0, 0, {
+        size_t len = chat__response__get_packed_size(&response);
+        uint8_t *buf = malloc(len);
+        chat__response__pack(&response, buf);
+        free(buf);
+    });
+
+    codec_incoming_message_t native = {
+        .status_code = CHAT__STATUS_CODE__OK,
+        .sender = codec_str("user0"),
+        .content = codec_str(content),
+        .type = CHAT__MESSAGE_TYPE__BROADCAST
+    };
+    RUN_BENCH("incoming_message_encode_native", 0, 0, {
+        uint8_t buf[PACK_STACK_SIZE];
+        codec_encode_incoming_message(&native, buf);
+        __asm__ volatile("" : : "r"(buf) : "memory");
+    });
+
+    free(request_buf);
+}
+
+// Escribe sin bloquear en un socket del bench, como write_connection en el servidor
+static ssize_t bench_write(int sockfd, const uint8_t *header, const uint8_t *data, size_t len) {
+    struct iovec iov[2];
+    int n_iov = 0;
+    if (header) iov[n_iov++] = (struct iovec){ .iov_base = (void *)header, .iov_len = FRAME_HEADER_SIZE };
+    iov[n_iov++] = (struct iovec){ .iov_base = (void *)data, .iov_len = len };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = n_iov };
+    while (1) {
+        ssize_t sent = sendmsg(sockfd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent >= 0) return sent;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+// Tarea del pool: arma la salida de una solicitud, igual que process_offloaded en el servidor
+static void pool_task(void *arg) {
+    pool_request_t *request = (pool_request_t *)arg;
+    static const char content[] = "pool broadcast from the bench, sixty-four bytes of content here";
+    lanes_hold(&request->held);
+    if (request->op == POOL_USER_LIST) {
+        send_user_list(request->cli->sockfd, NULL);
+    } else {
+        broadcast_message(request->cli->name, codec_str(content));
+    }
+    lanes_hold(NULL);
+}
+
+// Corrutina que hace POOL_ROUNDS solicitudes por el pool y escribe lo que quedó retenido, como handle_client
+static void pool_requester(void *arg) {
+    pool_request_t *request = (pool_request_t *)arg;
+    for (int i = 0; i < POOL_ROUNDS; i++) {
+        coro_run_task(&pool_task, request);
+        lanes_release(&request->held);
+    }
+    pthread_mutex_lock(request->lock);
+    if (--*request->pending == 0) pthread_cond_signal(request->done);
+    pthread_mutex_unlock(request->lock);
+}
+
+/*
+Funcion que lanza una corrutina por solicitante y espera a que todas terminen sus POOL_ROUNDS solicitudes.
+Si no se pudo crear una corrutina, ese solicitante corre en este thread (coro_run_task ejecuta la tarea ahí mismo).
+*/
+static void pool_round(pool_request_t *requests, int requesters) {
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+    int pending = requesters;
+    for (int i = 0; i < requesters; i++) {
+        requests[i].lock = &lock;
+        requests[i].done = &done;
+        requests[i].pending = &pending;
+    }
+    for (int i = 0; i < requesters; i++) {
+        if (!coro_spawn(&pool_requester, &requests[i])) pool_requester(&requests[i]);
+    }
+    pthread_mutex_lock(&lock);
+    while (pending > 0) pthread_cond_wait(&done, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+Funcion que mide GET_USERS y broadcasts hechos a la vez por 1, 2, 4... corrutinas (hasta el doble de workers),
+cada una desde su cliente. Los sockets tienen colas de salida como en el servidor, así que las tareas solo encolan o
+escriben sin bloquear y el fan-out no se serializa en el socket. Con el registro bloqueado solo para copiar a quién
+va, las solicitudes de varias corrutinas deberían repartirse entre los workers: ns_per_recipient debería bajar
+al crecer las corrutinas mientras no pasen de los workers.
+*/
+static void bench_pool(bench_env_t *env, int n) {
+    if (pool_workers == 0) return;
+    for (int i = 0; i < env->n_pairs; i++) lanes_create(env->server_ends[i], &bench_write);
+    int max_requesters = 2 * pool_workers < n ? 2 * pool_workers : n;
+    pool_request_t *requests = calloc(max_requesters, sizeof(pool_request_t));
+    char name[64];
+    for (int requesters = 1; requesters <= max_requesters; requesters *= 2) {
+        for (int i = 0; i < requesters; i++) requests[i].cli = clients[i];
+        for (int i = 0; i < requesters; i++) requests[i].op = POOL_USER_LIST;
+        snprintf(name, sizeof(name), "pool_send_user_list_x%d", requesters);
+        RUN_BENCH(name, n, (uint64_t)requesters * POOL_ROUNDS * n, {
+            pool_round(requests, requesters);
+        });
+        for (int i = 0; i < requesters; i++) requests[i].op = POOL_BROADCAST;
+        snprintf(name, sizeof(name), "pool_broadcast_x%d", requesters);
+        RUN_BENCH(name, n, (uint64_t)requesters * POOL_ROUNDS * (n > 1 ? n - 1 : 1), {
+            pool_round(requests, requesters);
+        });
+    }
+    free(requests);
+    for (int i = 0; i < env->n_pairs; i++) lanes_close(env->server_ends[i]);
+}
+
+static void bench_clients(int n) {
+    bench_env_t *env = calloc(1, sizeof(bench_env_t));
+    if (env_setup(env, n) != 0) {
+        close(env->epfd);
+        free(env);
+        return;
+    }
+
+    // Lista de usuarios empaquetada igual que en send_user_list
+    Chat__User *user_storage = malloc(n * sizeof(Chat__User));
+    Chat__User **users = malloc(n * sizeof(Chat__User *));
+    char (*names)[64] = malloc(n * sizeof(*names));
+    for (int i = 0; i < n; i++) {
+        chat__user__init(&user_storage[i]);
+        snprintf(names[i], sizeof(names[i]), "%s@127.0.0.1", clients[i]->name);
+        user_storage[i].username = names[i];
+        users[i] = &user_storage[i];
+    }
+    Chat__UserListResponse user_list = CHAT__USER_LIST_RESPONSE__INIT;
+    user_list.n_users = n;
+    user_list.users = users;
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = CHAT__OPERATION__GET_USERS;
+    response.status_code = CHAT__STATUS_CODE__OK;
+    response.result_case = CHAT__RESPONSE__RESULT_USER_LIST;
+    response.user_list = &user_list;
+
+    RUN_BENCH("user_list_pack", n, n, {
+        size_t len = chat__response__get_packed_size(&response);
+        uint8_t *buf = malloc(len);
+        chat__response__pack(&response, buf);
+        free(buf);
+    });
+
+    char last_name[32];
+    snprintf(last_name, sizeof(last_name), "user%d", n - 1);
+    RUN_BENCH("username_lookup_hit_last", n, 0, {
+        username_exists(last_name);
+    });
+    RUN_BENCH("username_lookup_miss", n, 0, {
+        username_exists("nobody");
+    });
+
+    RUN_BENCH("send_user_list", n, n, {
+        send_user_list(clients[0]->sockfd, NULL);
+    });
+
+    char content[65];
+    memset(content, 'x', 64);
+    content[64] = '\0';
+    RUN_BENCH("broadcast_message", n, n > 1 ? n - 1 : 1, {
+        broadcast_message(clients[0]->name, codec_str(content));
+    });
+
+    // BATCH_SIZE broadcasts seguidos: un send por destinatario y mensaje contra uno por destinatario con la ventana
+    RUN_BENCH("broadcast_x100", n, BATCH_SIZE * (n > 1 ? n - 1 : 1), {
+        for (int i = 0; i < BATCH_SIZE; i++) broadcast_message(clients[0]->name, codec_str(content));
+    });
+    coalesce_window_us = 1;
+    RUN_BENCH("broadcast_x100_coalesced", n, BATCH_SIZE * (n > 1 ? n - 1 : 1), {
+        for (int i = 0; i < BATCH_SIZE; i++) broadcast_message(clients[0]->name, codec_str(content));
+        flush_coalesced_broadcasts();
+    });
+    coalesce_window_us = 0;
+
+    // BATCH_SIZE mensajes directos: uno por solicitud contra un solo SEND_MESSAGE_BATCH o SEND_MESSAGE_MULTICAST
+    codec_send_message_t batch[BATCH_SIZE];
+    codec_str_t group[BATCH_SIZE];
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        batch[i].recipient = codec_str(clients[(i * 7919) % n]->name);
+        batch[i].content = codec_str(content);
+        group[i] = batch[i].recipient;
+    }
+    RUN_BENCH("direct_message_x100", n, BATCH_SIZE, {
+        for (int i = 0; i < BATCH_SIZE; i++) send_direct_message_to_client(clients[0], batch[i].recipient, batch[i].content);
+    });
+    RUN_BENCH("send_message_batch_100", n, BATCH_SIZE, {
+        send_message_batch(clients[0], batch, BATCH_SIZE);
+    });
+    RUN_BENCH("send_multicast_100", n, BATCH_SIZE, {
+        send_multicast_message(clients[0], group, BATCH_SIZE, codec_str(content));
+    });
+
+    bench_pool(env, n);
+
+    free(names);
+    free(users);
+    free(user_storage);
+    env_teardown(env);
+    free(env);
+}
+
+static void random_string(char *out, size_t len) {
+    // Sin '\0' interno: protobuf-c empaqueta los strings con strlen
+    for (size_t i = 0; i < len; i++) out[i] = (char)(1 + rand() % 255);
+    out[len] = '\0';
+}
+
+static size_t random_length(void) {
+    switch (rand() % 4) {
+        case 0: return 0;
+        case 1: return rand() % 16;
+        case 2: return 100 + rand() % 60;  // Alrededor del límite de un varint de 1 byte
+        default: return rand() % 20000;
+    }
+}
+
+static bool same_view(codec_str_t view, const char *s) {
+    return codec_str_equals(view, s ? s : "");
+}
+
+/*
+Funcion que compara el resultado del codec nativo con protobuf-c para un Request cualquiera (válido o no).
+Si el codec nativo lo acepta, protobuf-c debe decodificar lo mismo; si lo rechaza, no debe ser un SEND_MESSAGE válido.
+*/
+static bool verify_request_bytes(const uint8_t *buf, size_t len) {
+    codec_send_message_t native;
+    bool accepted = codec_decode_send_message(buf, len, &native);
+    Chat__Request *req = chat__request__unpack(NULL, len, buf);
+    bool expected = req && req->operation == CHAT__OPERATION__SEND_MESSAGE && req->payload_case == CHAT__REQUEST__PAYLOAD_SEND_MESSAGE;
+    bool ok = accepted == expected;
+    // protobuf-c corta los strings en el primer '\0', por eso se compara solo hasta ahí
+    if (ok && accepted) {
+        ok = strncmp(native.recipient.data, req->send_message->recipient, native.recipient.len) == 0 &&
+             strncmp(native.content.data, req->send_message->content, native.content.len) == 0;
+    }
+    chat__request__free_unpacked(req, NULL);
+    return ok;
+}
+
+/*
+Funcion que valida el codec nativo contra el código generado por protobuf-c.
+Retornos:
+    * int: cantidad de casos que no coinciden
+*/
+static int verify_codec(void) {
+    static char recipient[20001], content[20001], sender[20001];
+    static uint8_t native_buf[1 << 18], generated_buf[1 << 18], stamped_buf[1 << 18];
+    static const int status_codes[] = { 0, 200, 400, 500 };
+    int failures = 0;
+    srand(1);
+
+    for (int i = 0; i < VERIFY_CASES && failures < 10; i++) {
+        random_string(recipient, random_length());
+        random_string(content, random_length());
+        random_string(sender, random_length() % 32);
+
+        // SendMessageRequest: mismos bytes y decodificación del mensaje generado
+        codec_send_message_t send = { codec_str(recipient), codec_str(content) };
+        Chat__SendMessageRequest generated_send = CHAT__SEND_MESSAGE_REQUEST__INIT;
+        generated_send.recipient = recipient;
+        generated_send.content = content;
+        Chat__Request request = CHAT__REQUEST__INIT;
+        request.operation = CHAT__OPERATION__SEND_MESSAGE;
+        request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MESSAGE;
+        request.send_message = &generated_send;
+
+        size_t native_len = codec_encode_send_message(&send, native_buf);
+        size_t generated_len = chat__request__pack(&request, generated_buf);
+        codec_send_message_t decoded;
+        if (native_len != codec_send_message_size(&send) || native_len != generated_len ||
+            memcmp(native_buf, generated_buf, native_len) != 0 ||
+            !codec_decode_send_message(generated_buf, generated_len, &decoded) ||
+            !same_view(decoded.recipient, recipient) || !same_view(decoded.content, content)) {
+            fprintf(stderr, "verify: send_message case %d differs (recipient %zu bytes, content %zu bytes)\n", i, strlen(recipient), strlen(content));
+            failures++;
+        }
+
+        // Prefijos y bytes alterados: ambos codecs deben estar de acuerdo
+        size_t cut = generated_len ? rand() % generated_len : 0;
+        if (!verify_request_bytes(generated_buf, cut)) {
+            fprintf(stderr, "verify: truncated request case %d differs (%zu of %zu bytes)\n", i, cut, generated_len);
+            failures++;
+        }
+        memcpy(native_buf, generated_buf, generated_len);
+        if (generated_len) native_buf[rand() % generated_len] = (uint8_t)rand();
+        if (!verify_request_bytes(native_buf, generated_len)) {
+            fprintf(stderr, "verify: corrupted request case %d differs\n", i);
+            failures++;
+        }
+
+        // SendMessageBatchRequest con broadcasts y directos mezclados
+        codec_send_message_t batch[4] = { send, { codec_str(""), codec_str(content) }, { codec_str(sender), codec_str("") }, send };
+        size_t batch_count = rand() % 5;
+        Chat__SendMessageRequest generated_items[4];
+        Chat__SendMessageRequest *generated_ptrs[4];
+        for (size_t b = 0; b < batch_count && b < 4; b++) {
+            chat__send_message_request__init(&generated_items[b]);
+            generated_items[b].recipient = (char *)batch[b].recipient.data;
+            generated_items[b].content = (char *)batch[b].content.data;
+            generated_ptrs[b] = &generated_items[b];
+        }
+        if (batch_count > 4) batch_count = 4;
+        Chat__SendMessageBatchRequest generated_batch = CHAT__SEND_MESSAGE_BATCH_REQUEST__INIT;
+        generated_batch.n_messages = batch_count;
+        generated_batch.messages = generated_ptrs;
+        Chat__Request batch_request = CHAT__REQUEST__INIT;
+        batch_request.operation = CHAT__OPERATION__SEND_MESSAGE_BATCH;
+        batch_request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MESSAGE_BATCH;
+        batch_request.send_message_batch = &generated_batch;
+
+        native_len = codec_encode_send_message_batch(batch, batch_count, native_buf);
+        generated_len = chat__request__pack(&batch_request, generated_buf);
+        codec_send_message_t batch_decoded[4];
+        size_t decoded_count = 0;
+        bool batch_ok = native_len == codec_send_message_batch_size(batch, batch_count) && native_len == generated_len &&
+                        memcmp(native_buf, generated_buf, native_len) == 0 &&
+                        codec_decode_send_message_batch(generated_buf, generated_len, batch_decoded, 4, &decoded_count) &&
+                        decoded_count == batch_count && !codec_decode_send_message(generated_buf, generated_len, &decoded);
+        for (size_t b = 0; batch_ok && b < batch_count; b++) {
+            batch_ok = same_view(batch_decoded[b].recipient, generated_items[b].recipient) &&
+                       same_view(batch_decoded[b].content, generated_items[b].content);
+        }
+        if (!batch_ok) {
+            fprintf(stderr, "verify: send_message_batch case %d differs (%zu messages)\n", i, batch_count);
+            failures++;
+        }
+
+        // Otras operaciones quedan para protobuf-c
+        Chat__UserListRequest get_users = CHAT__USER_LIST_REQUEST__INIT;
+        get_users.username = recipient;
+        Chat__Request other = CHAT__REQUEST__INIT;
+        other.operation = CHAT__OPERATION__GET_USERS;
+        other.payload_case = CHAT__REQUEST__PAYLOAD_GET_USERS;
+        other.get_users = &get_users;
+        generated_len = chat__request__pack(&other, generated_buf);
+        if (codec_decode_send_message(generated_buf, generated_len, &decoded)) {
+            fprintf(stderr, "verify: get_users case %d decoded as send_message\n", i);
+            failures++;
+        }
+
+        // IncomingMessageResponse
+        codec_incoming_message_t incoming = {
+            .status_code = status_codes[rand() % 4],
+            .sender = codec_str(sender),
+            .content = codec_str(content),
+            .type = rand() % 2,
+            .sequence = rand() % 2 ? ((uint64_t)rand() << 20) ^ rand() : 0
+        };
+        Chat__IncomingMessageResponse generated_incoming = CHAT__INCOMING_MESSAGE_RESPONSE__INIT;
+        generated_incoming.sender = sender;
+        generated_incoming.content = content;
+        generated_incoming.type = incoming.type;
+        Chat__Response response = CHAT__RESPONSE__INIT;
+        response.operation = CHAT__OPERATION__INCOMING_MESSAGE;
+        response.status_code = incoming.status_code;
+        response.result_case = CHAT__RESPONSE__RESULT_INCOMING_MESSAGE;
+        response.incoming_message = &generated_incoming;
+        response.sequence = incoming.sequence;
+
+        native_len = codec_encode_incoming_message(&incoming, native_buf);
+        generated_len = chat__response__pack(&response, generated_buf);
+        // El servidor numera un mensaje ya empaquetado agregándole el campo sequence al final
+        codec_incoming_message_t unnumbered = incoming;
+        unnumbered.sequence = 0;
+        size_t stamped_len = codec_encode_incoming_message(&unnumbered, stamped_buf);
+        stamped_len += codec_encode_sequence(incoming.sequence, stamped_buf + stamped_len);
+        codec_incoming_message_t incoming_decoded;
+        if (native_len != codec_incoming_message_size(&incoming) || native_len != generated_len ||
+            memcmp(native_buf, generated_buf, native_len) != 0 ||
+            stamped_len != native_len || memcmp(stamped_buf, native_buf, native_len) != 0 ||
+            !codec_decode_incoming_message(generated_buf, generated_len, &incoming_decoded) ||
+            incoming_decoded.status_code != incoming.status_code || incoming_decoded.type != incoming.type ||
+            incoming_decoded.sequence != incoming.sequence ||
+            !same_view(incoming_decoded.sender, sender) || !same_view(incoming_decoded.content, content)) {
+            fprintf(stderr, "verify: incoming_message case %d differs (sender %zu bytes, content %zu bytes)\n", i, strlen(sender), strlen(content));
+            failures++;
+        }
+
+        // NodeBatch de la federación: dos elementos concatenados deben ser el mismo NodeBatch que arma protobuf-c
+        codec_node_event_t events[2] = {
+            { .type = rand() % 8, .node_id = rand() % 3 ? (uint32_t)rand() : 0, .username = codec_str(recipient),
+              .status = rand() % 3, .sender = codec_str(sender), .content = codec_str(content),
+              .client_port = rand() % 2 ? (uint32_t)rand() : 0, .session_token = codec_str(recipient),
+              .next_sequence = incoming.sequence, .replay_first = rand() % 2 ? (uint64_t)rand() : 0,
+              .replay = codec_str(content) },
+            { .type = CHAT__NODE_EVENT_TYPE__NODE_USER_LEFT, .username = codec_str(sender) }
+        };
+        Chat__NodeEvent generated_events[2];
+        Chat__NodeEvent *generated_event_ptrs[2] = { &generated_events[0], &generated_events[1] };
+        for (int e = 0; e < 2; e++) {
+            chat__node_event__init(&generated_events[e]);
+            generated_events[e].type = events[e].type;
+            generated_events[e].node_id = events[e].node_id;
+            generated_events[e].username = (char *)events[e].username.data;
+            generated_events[e].status = events[e].status;
+            generated_events[e].sender = (char *)events[e].sender.data;
+            generated_events[e].content = (char *)events[e].content.data;
+            generated_events[e].client_port = events[e].client_port;
+            generated_events[e].session_token = (char *)events[e].session_token.data;
+            generated_events[e].next_sequence = events[e].next_sequence;
+            generated_events[e].replay_first = events[e].replay_first;
+            generated_events[e].replay.data = (uint8_t *)events[e].replay.data;
+            generated_events[e].replay.len = events[e].replay.len;
+        }
+        Chat__NodeBatch node_batch = CHAT__NODE_BATCH__INIT;
+        node_batch.n_events = 2;
+        node_batch.events = generated_event_ptrs;
+        native_len = codec_encode_node_batch_entry(&events[0], native_buf);
+        native_len += codec_encode_node_batch_entry(&events[1], native_buf + native_len);
+        generated_len = chat__node_batch__pack(&node_batch, generated_buf);
+        if (native_len != codec_node_batch_entry_size(&events[0]) + codec_node_batch_entry_size(&events[1]) ||
+            native_len != generated_len || memcmp(native_buf, generated_buf, native_len) != 0) {
+            fprintf(stderr, "verify: node_batch case %d differs (content %zu bytes)\n", i, strlen(content));
+            failures++;
+        }
+    }
+
+    if (failures == 0) {
+        printf("verify: %d random cases, native codec matches protobuf-c\n", VERIFY_CASES);
+    }
+    return failures;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-c sizes] [-o csv|json] [-k native|protobuf-c] [-w workers] [-v]\n", prog);
+    fprintf(stderr, "  -c <list>  comma separated client counts (default %s, max %d)\n", DEFAULT_SIZES, MAX_CLIENTS);
+    fprintf(stderr, "  -o <fmt>   output format: csv or json (default csv)\n");
+    fprintf(stderr, "  -k <codec> codec used by the server functions (default native)\n");
+    fprintf(stderr, "  -w <n>     workers of the coroutine pool for the pool cases, 0 to skip them (default: CPUs)\n");
+    fprintf(stderr, "  -v         check the native codec against protobuf-c and exit\n");
+}
+
+int main(int argc, char *argv[]) {
+    char sizes[256];
+    snprintf(sizes, sizeof(sizes), "%s", DEFAULT_SIZES);
+
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "c:o:k:w:v")) != -1) {
+        switch (opt) {
+            case 'c': snprintf(sizes, sizeof(sizes), "%s", optarg); break;
+            case 'w': workers = atoi(optarg); break;
+            case 'o': output_format = optarg; break;
+            case 'k':
+                if (codec_kind_parse(optarg, &server_codec) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'v': return verify_codec() == 0 ? 0 : 1;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    raise_fd_limit(2 * MAX_CLIENTS + 64);
+    if (workers > CORO_MAX_WORKERS) workers = CORO_MAX_WORKERS;
+    if (workers > 0 && lanes_start(transport_fd_limit(FD_TABLE_MAX)) == 0 && coro_start(workers) == 0) pool_workers = coro_workers();
+    bench_codec();
+
+    for (char *token = strtok(sizes, ","); token; token = strtok(NULL, ",")) {
+        int n = atoi(token);
+        if (n < 1 || n > MAX_CLIENTS) {
+            fprintf(stderr, "bench: %d clients exceeds MAX_CLIENTS=%d (rebuild with -DMAX_CLIENTS), skipping\n", n, MAX_CLIENTS);
+            continue;
+        }
+        bench_clients(n);
+    }
+
+    if (strcmp(output_format, "json") == 0 && !first_row) printf("\n]\n");
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+    * capture.c
+    * Buffered writer of the traffic capture and mmap reader used by the replay tool.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "capture.h"
+
+static int capture_fd = -1;
+static uint64_t capture_started;
+static uint8_t *pending;  // Registros que todavía no se escriben (protegido por capture_mutex)
+static size_t pending_len;
+static bool write_failed = false;
+static atomic_uint_fast32_t last_conn = 0;
+static pthread_mutex_t capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Debe llamarse con capture_mutex bloqueado
+static void flush_locked(void) {
+    if (pending_len == 0) return;
+    if (!write_failed && write_all(capture_fd, pending, pending_len) != 0) {
+        // Disco lleno o similar: la captura se corta pero el servidor sigue atendiendo
+        write_failed = true;
+        fprintf(stderr, "capture: write failed (%s), capture stopped\n", strerror(errno));
+    }
+    pending_len = 0;
+}
+
+static void *capture_flusher(void *arg) {
+    (void)arg;
+    while (1) {
+        usleep(CAPTURE_FLUSH_MS * 1000);
+        capture_flush();
+    }
+    return NULL;
+}
+
+/*
+Funcion que crea el archivo de captura (lo reemplaza si existe) y el thread que lo escribe periódicamente.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo crear el archivo
+*/
+int capture_start(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    capture_header_t header = {
+        .magic = CAPTURE_MAGIC,
+        .version = CAPTURE_VERSION,
+        .started_at = time(NULL)
+    };
+    pending = malloc(CAPTURE_BUFFER_BYTES);
+    if (!pending || write_all(fd, (const uint8_t *)&header, sizeof(header)) != 0) {
+        free(pending);
+        close(fd);
+        return -1;
+    }
+    capture_started = now_ns();
+    capture_fd = fd;
+    pthread_t tid;
+    pthread_create(&tid, NULL, &capture_flusher, NULL);
+    pthread_detach(tid);
+    return 0;
+}
+
+uint32_t capture_new_conn(void) {
+    return atomic_fetch_add(&last_conn, 1) + 1;
+}
+
+static void append(uint32_t conn_id, uint32_t len, const uint8_t *payload, size_t payload_len) {
+    pthread_mutex_lock(&capture_mutex);
+    // El tiempo se toma con el lock para que los registros queden ordenados en el archivo
+    capture_record_t record = { .time_ns = now_ns() - capture_started, .conn_id = conn_id, .len = len };
+    if (pending_len + sizeof(record) + payload_len > CAPTURE_BUFFER_BYTES) flush_locked();
+    if (sizeof(record) + payload_len > CAPTURE_BUFFER_BYTES) {
+        // Un frame más grande que el buffer va directo al archivo
+        if (!write_failed && (write_all(capture_fd, (const uint8_t *)&record, sizeof(record)) != 0 ||
+                              write_all(capture_fd, payload, payload_len) != 0)) {
+            write_failed = true;
+        }
+    } else {
+        memcpy(pending + pending_len, &record, sizeof(record));
+        if (payload_len > 0) memcpy(pending + pending_len + sizeof(record), payload, payload_len);
+        pending_len += sizeof(record) + payload_len;
+    }
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+/*
+Funcion que agrega a la captura un frame recibido.
+Parametros:
+    * uint32_t conn_id: id de la conexión (de capture_new_conn)
+    * const uint8_t *payload: Chat__Request empaquetado, sin el header del frame
+*/
+void capture_request(uint32_t conn_id, const uint8_t *payload, size_t len) {
+    if (capture_fd < 0) return;
+    append(conn_id, len, payload, len);
+}
+
+void capture_close(uint32_t conn_id) {
+    if (capture_fd < 0) return;
+    append(conn_id, CAPTURE_CLOSE, NULL, 0);
+}
+
+void capture_flush(void) {
+    if (capture_fd < 0) return;
+    pthread_mutex_lock(&capture_mutex);
+    flush_locked();
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+/*
+Funcion que abre una captura con mmap y la recorre una vez para validarla y contar conexiones y registros.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo abrir o no es válida (errno EPROTO)
+*/
+int capture_map_open(const char *path, capture_map_t *map) {
+    memset(map, 0, sizeof(*map));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(capture_header_t)) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    map->data = data;
+    map->map_len = map->len = st.st_size;
+    const capture_header_t *header = data;
+    bool valid = header->magic == CAPTURE_MAGIC && header->version == CAPTURE_VERSION;
+
+    // Un registro cortado al final (el servidor terminó a mitad de una escritura) se ignora
+    map->offset = sizeof(capture_header_t);
+    capture_record_t record;
+    const uint8_t *payload;
+    while (valid && capture_map_next(map, &record, &payload)) {
+        if (record.conn_id > map->max_conn_id) map->max_conn_id = record.conn_id;
+        map->duration_ns = record.time_ns;
+        map->records++;
+    }
+    map->len = map->offset;
+    map->offset = sizeof(capture_header_t);
+    if (!valid) {
+        capture_map_close(map);
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+Funcion que avanza al siguiente registro de la captura.
+Retornos:
+    * bool: false al final de la captura
+*/
+bool capture_map_next(capture_map_t *map, capture_record_t *record, const uint8_t **payload) {
+    if (map->len - map->offset < sizeof(capture_record_t)) return false;
+    capture_record_t next;
+    memcpy(&next, map->data + map->offset, sizeof(next));
+    size_t payload_len = next.len == CAPTURE_CLOSE ? 0 : next.len;
+    if (map->len - map->offset - sizeof(capture_record_t) < payload_len) return false;
+    *record = next;
+    *payload = map->data + map->offset + sizeof(capture_record_t);
+    map->offset += sizeof(capture_record_t) + payload_len;
+    return true;
+}
+
+void capture_map_close(capture_map_t *map) {
+    if (map->data) munmap((void *)map->data, map->map_len);
+    memset(map, 0, sizeof(*map));
+}
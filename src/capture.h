@@ -0,0 +1,57 @@
+/*
+    * capture.h
+    * Traffic capture: with --capture the server appends every inbound request frame to a binary file with the
+    * connection it came from and when it arrived, and the replay tool (replay.c) feeds that file to another server.
+    * Layout (little endian): capture_header_t, then one capture_record_t per event followed by its payload (the
+    * framed Chat__Request without the frame header). Records are in arrival order and not aligned; a record with
+    * CAPTURE_CLOSE and no payload marks that the client closed the connection.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CAPTURE_MAGIC 0x43484350u  // "CHCP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_BUFFER_BYTES (256 * 1024)  // Registros acumulados antes de escribirlos al archivo
+#define CAPTURE_FLUSH_MS 1000  // Espera máxima de un registro en el buffer
+#define CAPTURE_CLOSE 0x80000000u  // Bit de len: la conexión se cerró
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int64_t started_at;  // Hora de inicio de la captura (segundos Unix)
+} capture_header_t;
+
+typedef struct {
+    uint64_t time_ns;  // Desde el inicio de la captura (reloj monotónico)
+    uint32_t conn_id;  // Único por conexión aceptada en el proceso que capturó
+    uint32_t len;      // Bytes del payload, o CAPTURE_CLOSE
+} capture_record_t;
+
+// Captura abierta para leer con mmap
+typedef struct {
+    const uint8_t *data;
+    size_t map_len;
+    size_t len;     // Hasta el último registro completo
+    size_t offset;  // Siguiente registro
+    uint32_t max_conn_id;
+    uint64_t records;
+    uint64_t duration_ns;
+} capture_map_t;
+
+int capture_start(const char *path);
+uint32_t capture_new_conn(void);
+void capture_request(uint32_t conn_id, const uint8_t *payload, size_t len);
+void capture_close(uint32_t conn_id);
+void capture_flush(void);
+int capture_map_open(const char *path, capture_map_t *map);
+bool capture_map_next(capture_map_t *map, capture_record_t *record, const uint8_t **payload);
+void capture_map_close(capture_map_t *map);
+
+#endif
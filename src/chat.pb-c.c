@@ -97,6 +97,96 @@ void   chat__new_user_request__free_unpacked
   assert(message->base.descriptor == &chat__new_user_request__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
+void   chat__session_info__init
+                     (Chat__SessionInfo         *message)
+{
+  static const Chat__SessionInfo init_value = CHAT__SESSION_INFO__INIT;
+  *message = init_value;
+}
+size_t chat__session_info__get_packed_size
+                     (const Chat__SessionInfo *message)
+{
+  assert(message->base.descriptor == &chat__session_info__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__session_info__pack
+                     (const Chat__SessionInfo *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__session_info__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__session_info__pack_to_buffer
+                     (const Chat__SessionInfo *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__session_info__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__SessionInfo *
+       chat__session_info__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__SessionInfo *)
+     protobuf_c_message_unpack (&chat__session_info__descriptor,
+                                allocator, len, data);
+}
+void   chat__session_info__free_unpacked
+                     (Chat__SessionInfo *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__session_info__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   chat__memory_usage__init
+                     (Chat__MemoryUsage         *message)
+{
+  static const Chat__MemoryUsage init_value = CHAT__MEMORY_USAGE__INIT;
+  *message = init_value;
+}
+size_t chat__memory_usage__get_packed_size
+                     (const Chat__MemoryUsage *message)
+{
+  assert(message->base.descriptor == &chat__memory_usage__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__memory_usage__pack
+                     (const Chat__MemoryUsage *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__memory_usage__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__memory_usage__pack_to_buffer
+                     (const Chat__MemoryUsage *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__memory_usage__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__MemoryUsage *
+       chat__memory_usage__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__MemoryUsage *)
+     protobuf_c_message_unpack (&chat__memory_usage__descriptor,
+                                allocator, len, data);
+}
+void   chat__memory_usage__free_unpacked
+                     (Chat__MemoryUsage *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__memory_usage__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 void   chat__send_message_request__init
                      (Chat__SendMessageRequest         *message)
 {
@@ -187,6 +277,186 @@ void   chat__incoming_message_response__free_unpacked
   assert(message->base.descriptor == &chat__incoming_message_response__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
+void   chat__send_message_batch_request__init
+                     (Chat__SendMessageBatchRequest         *message)
+{
+  static const Chat__SendMessageBatchRequest init_value = CHAT__SEND_MESSAGE_BATCH_REQUEST__INIT;
+  *message = init_value;
+}
+size_t chat__send_message_batch_request__get_packed_size
+                     (const Chat__SendMessageBatchRequest *message)
+{
+  assert(message->base.descriptor == &chat__send_message_batch_request__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__send_message_batch_request__pack
+                     (const Chat__SendMessageBatchRequest *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__send_message_batch_request__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__send_message_batch_request__pack_to_buffer
+                     (const Chat__SendMessageBatchRequest *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__send_message_batch_request__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__SendMessageBatchRequest *
+       chat__send_message_batch_request__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__SendMessageBatchRequest *)
+     protobuf_c_message_unpack (&chat__send_message_batch_request__descriptor,
+                                allocator, len, data);
+}
+void   chat__send_message_batch_request__free_unpacked
+                     (Chat__SendMessageBatchRequest *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__send_message_batch_request__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   chat__multicast_message_request__init
+                     (Chat__MulticastMessageRequest         *message)
+{
+  static const Chat__MulticastMessageRequest init_value = CHAT__MULTICAST_MESSAGE_REQUEST__INIT;
+  *message = init_value;
+}
+size_t chat__multicast_message_request__get_packed_size
+                     (const Chat__MulticastMessageRequest *message)
+{
+  assert(message->base.descriptor == &chat__multicast_message_request__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__multicast_message_request__pack
+                     (const Chat__MulticastMessageRequest *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__multicast_message_request__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__multicast_message_request__pack_to_buffer
+                     (const Chat__MulticastMessageRequest *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__multicast_message_request__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__MulticastMessageRequest *
+       chat__multicast_message_request__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__MulticastMessageRequest *)
+     protobuf_c_message_unpack (&chat__multicast_message_request__descriptor,
+                                allocator, len, data);
+}
+void   chat__multicast_message_request__free_unpacked
+                     (Chat__MulticastMessageRequest *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__multicast_message_request__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   chat__delivery_report__init
+                     (Chat__DeliveryReport         *message)
+{
+  static const Chat__DeliveryReport init_value = CHAT__DELIVERY_REPORT__INIT;
+  *message = init_value;
+}
+size_t chat__delivery_report__get_packed_size
+                     (const Chat__DeliveryReport *message)
+{
+  assert(message->base.descriptor == &chat__delivery_report__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__delivery_report__pack
+                     (const Chat__DeliveryReport *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__delivery_report__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__delivery_report__pack_to_buffer
+                     (const Chat__DeliveryReport *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__delivery_report__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__DeliveryReport *
+       chat__delivery_report__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__DeliveryReport *)
+     protobuf_c_message_unpack (&chat__delivery_report__descriptor,
+                                allocator, len, data);
+}
+void   chat__delivery_report__free_unpacked
+                     (Chat__DeliveryReport *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__delivery_report__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   chat__stream_chunk__init
+                     (Chat__StreamChunk         *message)
+{
+  static const Chat__StreamChunk init_value = CHAT__STREAM_CHUNK__INIT;
+  *message = init_value;
+}
+size_t chat__stream_chunk__get_packed_size
+                     (const Chat__StreamChunk *message)
+{
+  assert(message->base.descriptor == &chat__stream_chunk__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__stream_chunk__pack
+                     (const Chat__StreamChunk *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__stream_chunk__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__stream_chunk__pack_to_buffer
+                     (const Chat__StreamChunk *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__stream_chunk__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__StreamChunk *
+       chat__stream_chunk__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__StreamChunk *)
+     protobuf_c_message_unpack (&chat__stream_chunk__descriptor,
+                                allocator, len, data);
+}
+void   chat__stream_chunk__free_unpacked
+                     (Chat__StreamChunk *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__stream_chunk__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 void   chat__user_list_request__init
                      (Chat__UserListRequest         *message)
 {
@@ -412,6 +682,141 @@ void   chat__response__free_unpacked
   assert(message->base.descriptor == &chat__response__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
+void   chat__redirect__init
+                     (Chat__Redirect         *message)
+{
+  static const Chat__Redirect init_value = CHAT__REDIRECT__INIT;
+  *message = init_value;
+}
+size_t chat__redirect__get_packed_size
+                     (const Chat__Redirect *message)
+{
+  assert(message->base.descriptor == &chat__redirect__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__redirect__pack
+                     (const Chat__Redirect *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__redirect__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__redirect__pack_to_buffer
+                     (const Chat__Redirect *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__redirect__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__Redirect *
+       chat__redirect__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__Redirect *)
+     protobuf_c_message_unpack (&chat__redirect__descriptor,
+                                allocator, len, data);
+}
+void   chat__redirect__free_unpacked
+                     (Chat__Redirect *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__redirect__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   chat__node_event__init
+                     (Chat__NodeEvent         *message)
+{
+  static const Chat__NodeEvent init_value = CHAT__NODE_EVENT__INIT;
+  *message = init_value;
+}
+size_t chat__node_event__get_packed_size
+                     (const Chat__NodeEvent *message)
+{
+  assert(message->base.descriptor == &chat__node_event__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__node_event__pack
+                     (const Chat__NodeEvent *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__node_event__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__node_event__pack_to_buffer
+                     (const Chat__NodeEvent *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__node_event__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__NodeEvent *
+       chat__node_event__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__NodeEvent *)
+     protobuf_c_message_unpack (&chat__node_event__descriptor,
+                                allocator, len, data);
+}
+void   chat__node_event__free_unpacked
+                     (Chat__NodeEvent *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__node_event__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   chat__node_batch__init
+                     (Chat__NodeBatch         *message)
+{
+  static const Chat__NodeBatch init_value = CHAT__NODE_BATCH__INIT;
+  *message = init_value;
+}
+size_t chat__node_batch__get_packed_size
+                     (const Chat__NodeBatch *message)
+{
+  assert(message->base.descriptor == &chat__node_batch__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t chat__node_batch__pack
+                     (const Chat__NodeBatch *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &chat__node_batch__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t chat__node_batch__pack_to_buffer
+                     (const Chat__NodeBatch *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &chat__node_batch__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Chat__NodeBatch *
+       chat__node_batch__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Chat__NodeBatch *)
+     protobuf_c_message_unpack (&chat__node_batch__descriptor,
+                                allocator, len, data);
+}
+void   chat__node_batch__free_unpacked
+                     (Chat__NodeBatch *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &chat__node_batch__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 static const ProtobufCFieldDescriptor chat__user__field_descriptors[2] =
 {
   {
@@ -463,7 +868,7 @@ const ProtobufCMessageDescriptor chat__user__descriptor =
   (ProtobufCMessageInit) chat__user__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor chat__new_user_request__field_descriptors[1] =
+static const ProtobufCFieldDescriptor chat__new_user_request__field_descriptors[5] =
 {
   {
     "username",
@@ -477,28 +882,299 @@ static const ProtobufCFieldDescriptor chat__new_user_request__field_descriptors[
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
-};
-static const unsigned chat__new_user_request__field_indices_by_name[] = {
-  0,   /* field[0] = username */
-};
-static const ProtobufCIntRange chat__new_user_request__number_ranges[1 + 1] =
-{
-  { 1, 0 },
-  { 0, 1 }
-};
-const ProtobufCMessageDescriptor chat__new_user_request__descriptor =
-{
-  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-  "chat.NewUserRequest",
-  "NewUserRequest",
-  "Chat__NewUserRequest",
-  "chat",
-  sizeof(Chat__NewUserRequest),
-  1,
-  chat__new_user_request__field_descriptors,
-  chat__new_user_request__field_indices_by_name,
-  1,  chat__new_user_request__number_ranges,
-  (ProtobufCMessageInit) chat__new_user_request__init,
+  {
+    "resumable",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NewUserRequest, resumable),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "session_token",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NewUserRequest, session_token),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "last_sequence",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NewUserRequest, last_sequence),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "compression",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NewUserRequest, compression),
+    &chat__compression__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__new_user_request__field_indices_by_name[] = {
+  4,   /* field[4] = compression */
+  3,   /* field[3] = last_sequence */
+  1,   /* field[1] = resumable */
+  2,   /* field[2] = session_token */
+  0,   /* field[0] = username */
+};
+static const ProtobufCIntRange chat__new_user_request__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 5 }
+};
+const ProtobufCMessageDescriptor chat__new_user_request__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.NewUserRequest",
+  "NewUserRequest",
+  "Chat__NewUserRequest",
+  "chat",
+  sizeof(Chat__NewUserRequest),
+  5,
+  chat__new_user_request__field_descriptors,
+  chat__new_user_request__field_indices_by_name,
+  1,  chat__new_user_request__number_ranges,
+  (ProtobufCMessageInit) chat__new_user_request__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__session_info__field_descriptors[4] =
+{
+  {
+    "token",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__SessionInfo, token),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "resumed",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Chat__SessionInfo, resumed),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "replayed",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__SessionInfo, replayed),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "missed",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__SessionInfo, missed),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__session_info__field_indices_by_name[] = {
+  3,   /* field[3] = missed */
+  2,   /* field[2] = replayed */
+  1,   /* field[1] = resumed */
+  0,   /* field[0] = token */
+};
+static const ProtobufCIntRange chat__session_info__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 4 }
+};
+const ProtobufCMessageDescriptor chat__session_info__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.SessionInfo",
+  "SessionInfo",
+  "Chat__SessionInfo",
+  "chat",
+  sizeof(Chat__SessionInfo),
+  4,
+  chat__session_info__field_descriptors,
+  chat__session_info__field_indices_by_name,
+  1,  chat__session_info__number_ranges,
+  (ProtobufCMessageInit) chat__session_info__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__memory_usage__field_descriptors[9] =
+{
+  {
+    "budget",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, budget),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "used",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, used),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "clients",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, clients),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "buffers",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, buffers),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "queues",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, queues),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "history",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, history),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "shared_memory",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, shared_memory),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "admitting",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, admitting),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "shedding",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Chat__MemoryUsage, shedding),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__memory_usage__field_indices_by_name[] = {
+  7,   /* field[7] = admitting */
+  0,   /* field[0] = budget */
+  3,   /* field[3] = buffers */
+  2,   /* field[2] = clients */
+  5,   /* field[5] = history */
+  4,   /* field[4] = queues */
+  6,   /* field[6] = shared_memory */
+  8,   /* field[8] = shedding */
+  1,   /* field[1] = used */
+};
+static const ProtobufCIntRange chat__memory_usage__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 9 }
+};
+const ProtobufCMessageDescriptor chat__memory_usage__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.MemoryUsage",
+  "MemoryUsage",
+  "Chat__MemoryUsage",
+  "chat",
+  sizeof(Chat__MemoryUsage),
+  9,
+  chat__memory_usage__field_descriptors,
+  chat__memory_usage__field_indices_by_name,
+  1,  chat__memory_usage__number_ranges,
+  (ProtobufCMessageInit) chat__memory_usage__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor chat__send_message_request__field_descriptors[2] =
@@ -616,337 +1292,1019 @@ const ProtobufCMessageDescriptor chat__incoming_message_response__descriptor =
   (ProtobufCMessageInit) chat__incoming_message_response__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor chat__user_list_request__field_descriptors[1] =
+static const ProtobufCFieldDescriptor chat__send_message_batch_request__field_descriptors[1] =
 {
   {
-    "username",
+    "messages",
     1,
-    PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_STRING,
-    0,   /* quantifier_offset */
-    offsetof(Chat__UserListRequest, username),
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__SendMessageBatchRequest, n_messages),
+    offsetof(Chat__SendMessageBatchRequest, messages),
+    &chat__send_message_request__descriptor,
     NULL,
-    &protobuf_c_empty_string,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
 };
-static const unsigned chat__user_list_request__field_indices_by_name[] = {
-  0,   /* field[0] = username */
+static const unsigned chat__send_message_batch_request__field_indices_by_name[] = {
+  0,   /* field[0] = messages */
 };
-static const ProtobufCIntRange chat__user_list_request__number_ranges[1 + 1] =
+static const ProtobufCIntRange chat__send_message_batch_request__number_ranges[1 + 1] =
 {
   { 1, 0 },
   { 0, 1 }
 };
-const ProtobufCMessageDescriptor chat__user_list_request__descriptor =
+const ProtobufCMessageDescriptor chat__send_message_batch_request__descriptor =
 {
   PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-  "chat.UserListRequest",
-  "UserListRequest",
-  "Chat__UserListRequest",
+  "chat.SendMessageBatchRequest",
+  "SendMessageBatchRequest",
+  "Chat__SendMessageBatchRequest",
   "chat",
-  sizeof(Chat__UserListRequest),
+  sizeof(Chat__SendMessageBatchRequest),
   1,
-  chat__user_list_request__field_descriptors,
-  chat__user_list_request__field_indices_by_name,
-  1,  chat__user_list_request__number_ranges,
-  (ProtobufCMessageInit) chat__user_list_request__init,
+  chat__send_message_batch_request__field_descriptors,
+  chat__send_message_batch_request__field_indices_by_name,
+  1,  chat__send_message_batch_request__number_ranges,
+  (ProtobufCMessageInit) chat__send_message_batch_request__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor chat__user_list_response__field_descriptors[2] =
+static const ProtobufCFieldDescriptor chat__multicast_message_request__field_descriptors[2] =
 {
   {
-    "users",
+    "recipients",
     1,
     PROTOBUF_C_LABEL_REPEATED,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__UserListResponse, n_users),
-    offsetof(Chat__UserListResponse, users),
-    &chat__user__descriptor,
+    PROTOBUF_C_TYPE_STRING,
+    offsetof(Chat__MulticastMessageRequest, n_recipients),
+    offsetof(Chat__MulticastMessageRequest, recipients),
+    NULL,
     NULL,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "type",
+    "content",
     2,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_ENUM,
+    PROTOBUF_C_TYPE_STRING,
     0,   /* quantifier_offset */
-    offsetof(Chat__UserListResponse, type),
-    &chat__user_list_type__descriptor,
+    offsetof(Chat__MulticastMessageRequest, content),
     NULL,
+    &protobuf_c_empty_string,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
 };
-static const unsigned chat__user_list_response__field_indices_by_name[] = {
-  1,   /* field[1] = type */
-  0,   /* field[0] = users */
+static const unsigned chat__multicast_message_request__field_indices_by_name[] = {
+  1,   /* field[1] = content */
+  0,   /* field[0] = recipients */
+};
+static const ProtobufCIntRange chat__multicast_message_request__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 2 }
+};
+const ProtobufCMessageDescriptor chat__multicast_message_request__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.MulticastMessageRequest",
+  "MulticastMessageRequest",
+  "Chat__MulticastMessageRequest",
+  "chat",
+  sizeof(Chat__MulticastMessageRequest),
+  2,
+  chat__multicast_message_request__field_descriptors,
+  chat__multicast_message_request__field_indices_by_name,
+  1,  chat__multicast_message_request__number_ranges,
+  (ProtobufCMessageInit) chat__multicast_message_request__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__delivery_report__field_descriptors[3] =
+{
+  {
+    "delivered",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Chat__DeliveryReport, delivered),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "failed",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Chat__DeliveryReport, failed),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "status_bitmap",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BYTES,
+    0,   /* quantifier_offset */
+    offsetof(Chat__DeliveryReport, status_bitmap),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__delivery_report__field_indices_by_name[] = {
+  0,   /* field[0] = delivered */
+  1,   /* field[1] = failed */
+  2,   /* field[2] = status_bitmap */
+};
+static const ProtobufCIntRange chat__delivery_report__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 3 }
+};
+const ProtobufCMessageDescriptor chat__delivery_report__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.DeliveryReport",
+  "DeliveryReport",
+  "Chat__DeliveryReport",
+  "chat",
+  sizeof(Chat__DeliveryReport),
+  3,
+  chat__delivery_report__field_descriptors,
+  chat__delivery_report__field_indices_by_name,
+  1,  chat__delivery_report__number_ranges,
+  (ProtobufCMessageInit) chat__delivery_report__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__stream_chunk__field_descriptors[8] =
+{
+  {
+    "stream_id",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, stream_id),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "phase",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, phase),
+    &chat__stream_phase__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "recipient",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, recipient),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "data",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BYTES,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, data),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "offset",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, offset),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "total_size",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, total_size),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "sender",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, sender),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "type",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__StreamChunk, type),
+    &chat__message_type__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__stream_chunk__field_indices_by_name[] = {
+  3,   /* field[3] = data */
+  4,   /* field[4] = offset */
+  1,   /* field[1] = phase */
+  2,   /* field[2] = recipient */
+  6,   /* field[6] = sender */
+  0,   /* field[0] = stream_id */
+  5,   /* field[5] = total_size */
+  7,   /* field[7] = type */
+};
+static const ProtobufCIntRange chat__stream_chunk__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 8 }
+};
+const ProtobufCMessageDescriptor chat__stream_chunk__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.StreamChunk",
+  "StreamChunk",
+  "Chat__StreamChunk",
+  "chat",
+  sizeof(Chat__StreamChunk),
+  8,
+  chat__stream_chunk__field_descriptors,
+  chat__stream_chunk__field_indices_by_name,
+  1,  chat__stream_chunk__number_ranges,
+  (ProtobufCMessageInit) chat__stream_chunk__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__user_list_request__field_descriptors[1] =
+{
+  {
+    "username",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__UserListRequest, username),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__user_list_request__field_indices_by_name[] = {
+  0,   /* field[0] = username */
+};
+static const ProtobufCIntRange chat__user_list_request__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 1 }
+};
+const ProtobufCMessageDescriptor chat__user_list_request__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.UserListRequest",
+  "UserListRequest",
+  "Chat__UserListRequest",
+  "chat",
+  sizeof(Chat__UserListRequest),
+  1,
+  chat__user_list_request__field_descriptors,
+  chat__user_list_request__field_indices_by_name,
+  1,  chat__user_list_request__number_ranges,
+  (ProtobufCMessageInit) chat__user_list_request__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__user_list_response__field_descriptors[2] =
+{
+  {
+    "users",
+    1,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__UserListResponse, n_users),
+    offsetof(Chat__UserListResponse, users),
+    &chat__user__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "type",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__UserListResponse, type),
+    &chat__user_list_type__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__user_list_response__field_indices_by_name[] = {
+  1,   /* field[1] = type */
+  0,   /* field[0] = users */
+};
+static const ProtobufCIntRange chat__user_list_response__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 2 }
+};
+const ProtobufCMessageDescriptor chat__user_list_response__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.UserListResponse",
+  "UserListResponse",
+  "Chat__UserListResponse",
+  "chat",
+  sizeof(Chat__UserListResponse),
+  2,
+  chat__user_list_response__field_descriptors,
+  chat__user_list_response__field_indices_by_name,
+  1,  chat__user_list_response__number_ranges,
+  (ProtobufCMessageInit) chat__user_list_response__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__update_status_request__field_descriptors[2] =
+{
+  {
+    "username",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__UpdateStatusRequest, username),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "new_status",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__UpdateStatusRequest, new_status),
+    &chat__user_status__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__update_status_request__field_indices_by_name[] = {
+  1,   /* field[1] = new_status */
+  0,   /* field[0] = username */
+};
+static const ProtobufCIntRange chat__update_status_request__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 2 }
+};
+const ProtobufCMessageDescriptor chat__update_status_request__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.UpdateStatusRequest",
+  "UpdateStatusRequest",
+  "Chat__UpdateStatusRequest",
+  "chat",
+  sizeof(Chat__UpdateStatusRequest),
+  2,
+  chat__update_status_request__field_descriptors,
+  chat__update_status_request__field_indices_by_name,
+  1,  chat__update_status_request__number_ranges,
+  (ProtobufCMessageInit) chat__update_status_request__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__request__field_descriptors[9] =
+{
+  {
+    "operation",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Request, operation),
+    &chat__operation__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "register_user",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, register_user),
+    &chat__new_user_request__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "send_message",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, send_message),
+    &chat__send_message_request__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "update_status",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, update_status),
+    &chat__update_status_request__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "get_users",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, get_users),
+    &chat__user_list_request__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "unregister_user",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, unregister_user),
+    &chat__user__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "send_message_batch",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, send_message_batch),
+    &chat__send_message_batch_request__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "send_multicast",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, send_multicast),
+    &chat__multicast_message_request__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "stream",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Request, payload_case),
+    offsetof(Chat__Request, stream),
+    &chat__stream_chunk__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__request__field_indices_by_name[] = {
+  4,   /* field[4] = get_users */
+  0,   /* field[0] = operation */
+  1,   /* field[1] = register_user */
+  2,   /* field[2] = send_message */
+  6,   /* field[6] = send_message_batch */
+  7,   /* field[7] = send_multicast */
+  8,   /* field[8] = stream */
+  5,   /* field[5] = unregister_user */
+  3,   /* field[3] = update_status */
+};
+static const ProtobufCIntRange chat__request__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 9 }
+};
+const ProtobufCMessageDescriptor chat__request__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.Request",
+  "Request",
+  "Chat__Request",
+  "chat",
+  sizeof(Chat__Request),
+  9,
+  chat__request__field_descriptors,
+  chat__request__field_indices_by_name,
+  1,  chat__request__number_ranges,
+  (ProtobufCMessageInit) chat__request__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__response__field_descriptors[12] =
+{
+  {
+    "operation",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Response, operation),
+    &chat__operation__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "status_code",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Response, status_code),
+    &chat__status_code__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "message",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Response, message),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "user_list",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, user_list),
+    &chat__user_list_response__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "incoming_message",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, incoming_message),
+    &chat__incoming_message_response__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "delivery_report",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, delivery_report),
+    &chat__delivery_report__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "session",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, session),
+    &chat__session_info__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "sequence",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Response, sequence),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "memory",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, memory),
+    &chat__memory_usage__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "redirect",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, redirect),
+    &chat__redirect__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "compression",
+    11,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Response, compression),
+    &chat__compression__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "stream",
+    12,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Chat__Response, result_case),
+    offsetof(Chat__Response, stream),
+    &chat__stream_chunk__descriptor,
+    NULL,
+    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__response__field_indices_by_name[] = {
+  10,   /* field[10] = compression */
+  5,   /* field[5] = delivery_report */
+  4,   /* field[4] = incoming_message */
+  8,   /* field[8] = memory */
+  2,   /* field[2] = message */
+  0,   /* field[0] = operation */
+  9,   /* field[9] = redirect */
+  7,   /* field[7] = sequence */
+  6,   /* field[6] = session */
+  1,   /* field[1] = status_code */
+  11,   /* field[11] = stream */
+  3,   /* field[3] = user_list */
 };
-static const ProtobufCIntRange chat__user_list_response__number_ranges[1 + 1] =
+static const ProtobufCIntRange chat__response__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 2 }
+  { 0, 12 }
 };
-const ProtobufCMessageDescriptor chat__user_list_response__descriptor =
+const ProtobufCMessageDescriptor chat__response__descriptor =
 {
   PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-  "chat.UserListResponse",
-  "UserListResponse",
-  "Chat__UserListResponse",
+  "chat.Response",
+  "Response",
+  "Chat__Response",
   "chat",
-  sizeof(Chat__UserListResponse),
-  2,
-  chat__user_list_response__field_descriptors,
-  chat__user_list_response__field_indices_by_name,
-  1,  chat__user_list_response__number_ranges,
-  (ProtobufCMessageInit) chat__user_list_response__init,
+  sizeof(Chat__Response),
+  12,
+  chat__response__field_descriptors,
+  chat__response__field_indices_by_name,
+  1,  chat__response__number_ranges,
+  (ProtobufCMessageInit) chat__response__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor chat__update_status_request__field_descriptors[2] =
+static const ProtobufCFieldDescriptor chat__redirect__field_descriptors[3] =
 {
   {
-    "username",
+    "address",
     1,
     PROTOBUF_C_LABEL_NONE,
     PROTOBUF_C_TYPE_STRING,
     0,   /* quantifier_offset */
-    offsetof(Chat__UpdateStatusRequest, username),
+    offsetof(Chat__Redirect, address),
     NULL,
     &protobuf_c_empty_string,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "new_status",
+    "port",
     2,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_ENUM,
+    PROTOBUF_C_TYPE_UINT32,
     0,   /* quantifier_offset */
-    offsetof(Chat__UpdateStatusRequest, new_status),
-    &chat__user_status__descriptor,
+    offsetof(Chat__Redirect, port),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "node_id",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Chat__Redirect, node_id),
+    NULL,
     NULL,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
 };
-static const unsigned chat__update_status_request__field_indices_by_name[] = {
-  1,   /* field[1] = new_status */
-  0,   /* field[0] = username */
+static const unsigned chat__redirect__field_indices_by_name[] = {
+  0,   /* field[0] = address */
+  2,   /* field[2] = node_id */
+  1,   /* field[1] = port */
 };
-static const ProtobufCIntRange chat__update_status_request__number_ranges[1 + 1] =
+static const ProtobufCIntRange chat__redirect__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 2 }
+  { 0, 3 }
 };
-const ProtobufCMessageDescriptor chat__update_status_request__descriptor =
+const ProtobufCMessageDescriptor chat__redirect__descriptor =
 {
   PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-  "chat.UpdateStatusRequest",
-  "UpdateStatusRequest",
-  "Chat__UpdateStatusRequest",
+  "chat.Redirect",
+  "Redirect",
+  "Chat__Redirect",
   "chat",
-  sizeof(Chat__UpdateStatusRequest),
-  2,
-  chat__update_status_request__field_descriptors,
-  chat__update_status_request__field_indices_by_name,
-  1,  chat__update_status_request__number_ranges,
-  (ProtobufCMessageInit) chat__update_status_request__init,
+  sizeof(Chat__Redirect),
+  3,
+  chat__redirect__field_descriptors,
+  chat__redirect__field_indices_by_name,
+  1,  chat__redirect__number_ranges,
+  (ProtobufCMessageInit) chat__redirect__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor chat__request__field_descriptors[6] =
+static const ProtobufCFieldDescriptor chat__node_event__field_descriptors[11] =
 {
   {
-    "operation",
+    "type",
     1,
     PROTOBUF_C_LABEL_NONE,
     PROTOBUF_C_TYPE_ENUM,
     0,   /* quantifier_offset */
-    offsetof(Chat__Request, operation),
-    &chat__operation__descriptor,
+    offsetof(Chat__NodeEvent, type),
+    &chat__node_event_type__descriptor,
     NULL,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "register_user",
+    "node_id",
     2,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Request, payload_case),
-    offsetof(Chat__Request, register_user),
-    &chat__new_user_request__descriptor,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, node_id),
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    NULL,
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "send_message",
+    "username",
     3,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Request, payload_case),
-    offsetof(Chat__Request, send_message),
-    &chat__send_message_request__descriptor,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, username),
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    &protobuf_c_empty_string,
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "update_status",
+    "status",
     4,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Request, payload_case),
-    offsetof(Chat__Request, update_status),
-    &chat__update_status_request__descriptor,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, status),
+    &chat__user_status__descriptor,
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "get_users",
+    "sender",
     5,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Request, payload_case),
-    offsetof(Chat__Request, get_users),
-    &chat__user_list_request__descriptor,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, sender),
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    &protobuf_c_empty_string,
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "unregister_user",
+    "content",
     6,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Request, payload_case),
-    offsetof(Chat__Request, unregister_user),
-    &chat__user__descriptor,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, content),
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    &protobuf_c_empty_string,
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
-};
-static const unsigned chat__request__field_indices_by_name[] = {
-  4,   /* field[4] = get_users */
-  0,   /* field[0] = operation */
-  1,   /* field[1] = register_user */
-  2,   /* field[2] = send_message */
-  5,   /* field[5] = unregister_user */
-  3,   /* field[3] = update_status */
-};
-static const ProtobufCIntRange chat__request__number_ranges[1 + 1] =
-{
-  { 1, 0 },
-  { 0, 6 }
-};
-const ProtobufCMessageDescriptor chat__request__descriptor =
-{
-  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-  "chat.Request",
-  "Request",
-  "Chat__Request",
-  "chat",
-  sizeof(Chat__Request),
-  6,
-  chat__request__field_descriptors,
-  chat__request__field_indices_by_name,
-  1,  chat__request__number_ranges,
-  (ProtobufCMessageInit) chat__request__init,
-  NULL,NULL,NULL    /* reserved[123] */
-};
-static const ProtobufCFieldDescriptor chat__response__field_descriptors[5] =
-{
   {
-    "operation",
-    1,
+    "client_port",
+    7,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_ENUM,
+    PROTOBUF_C_TYPE_UINT32,
     0,   /* quantifier_offset */
-    offsetof(Chat__Response, operation),
-    &chat__operation__descriptor,
+    offsetof(Chat__NodeEvent, client_port),
+    NULL,
     NULL,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "status_code",
-    2,
+    "session_token",
+    8,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_ENUM,
+    PROTOBUF_C_TYPE_STRING,
     0,   /* quantifier_offset */
-    offsetof(Chat__Response, status_code),
-    &chat__status_code__descriptor,
+    offsetof(Chat__NodeEvent, session_token),
     NULL,
+    &protobuf_c_empty_string,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "message",
-    3,
+    "next_sequence",
+    9,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_STRING,
+    PROTOBUF_C_TYPE_UINT64,
     0,   /* quantifier_offset */
-    offsetof(Chat__Response, message),
+    offsetof(Chat__NodeEvent, next_sequence),
+    NULL,
     NULL,
-    &protobuf_c_empty_string,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "user_list",
-    4,
+    "replay_first",
+    10,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Response, result_case),
-    offsetof(Chat__Response, user_list),
-    &chat__user_list_response__descriptor,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, replay_first),
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    NULL,
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "incoming_message",
-    5,
+    "replay",
+    11,
     PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BYTES,
+    0,   /* quantifier_offset */
+    offsetof(Chat__NodeEvent, replay),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned chat__node_event__field_indices_by_name[] = {
+  6,   /* field[6] = client_port */
+  5,   /* field[5] = content */
+  8,   /* field[8] = next_sequence */
+  1,   /* field[1] = node_id */
+  10,   /* field[10] = replay */
+  9,   /* field[9] = replay_first */
+  4,   /* field[4] = sender */
+  7,   /* field[7] = session_token */
+  3,   /* field[3] = status */
+  0,   /* field[0] = type */
+  2,   /* field[2] = username */
+};
+static const ProtobufCIntRange chat__node_event__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 11 }
+};
+const ProtobufCMessageDescriptor chat__node_event__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "chat.NodeEvent",
+  "NodeEvent",
+  "Chat__NodeEvent",
+  "chat",
+  sizeof(Chat__NodeEvent),
+  11,
+  chat__node_event__field_descriptors,
+  chat__node_event__field_indices_by_name,
+  1,  chat__node_event__number_ranges,
+  (ProtobufCMessageInit) chat__node_event__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor chat__node_batch__field_descriptors[1] =
+{
+  {
+    "events",
+    1,
+    PROTOBUF_C_LABEL_REPEATED,
     PROTOBUF_C_TYPE_MESSAGE,
-    offsetof(Chat__Response, result_case),
-    offsetof(Chat__Response, incoming_message),
-    &chat__incoming_message_response__descriptor,
+    offsetof(Chat__NodeBatch, n_events),
+    offsetof(Chat__NodeBatch, events),
+    &chat__node_event__descriptor,
     NULL,
-    PROTOBUF_C_FIELD_FLAG_ONEOF,             /* flags */
+    0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
 };
-static const unsigned chat__response__field_indices_by_name[] = {
-  4,   /* field[4] = incoming_message */
-  2,   /* field[2] = message */
-  0,   /* field[0] = operation */
-  1,   /* field[1] = status_code */
-  3,   /* field[3] = user_list */
+static const unsigned chat__node_batch__field_indices_by_name[] = {
+  0,   /* field[0] = events */
 };
-static const ProtobufCIntRange chat__response__number_ranges[1 + 1] =
+static const ProtobufCIntRange chat__node_batch__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 5 }
+  { 0, 1 }
 };
-const ProtobufCMessageDescriptor chat__response__descriptor =
+const ProtobufCMessageDescriptor chat__node_batch__descriptor =
 {
   PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-  "chat.Response",
-  "Response",
-  "Chat__Response",
+  "chat.NodeBatch",
+  "NodeBatch",
+  "Chat__NodeBatch",
   "chat",
-  sizeof(Chat__Response),
-  5,
-  chat__response__field_descriptors,
-  chat__response__field_indices_by_name,
-  1,  chat__response__number_ranges,
-  (ProtobufCMessageInit) chat__response__init,
+  sizeof(Chat__NodeBatch),
+  1,
+  chat__node_batch__field_descriptors,
+  chat__node_batch__field_indices_by_name,
+  1,  chat__node_batch__number_ranges,
+  (ProtobufCMessageInit) chat__node_batch__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
 static const ProtobufCEnumValue chat__user_status__enum_values_by_number[3] =
@@ -979,6 +2337,34 @@ const ProtobufCEnumDescriptor chat__user_status__descriptor =
   chat__user_status__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
+static const ProtobufCEnumValue chat__compression__enum_values_by_number[2] =
+{
+  { "COMPRESSION_NONE", "CHAT__COMPRESSION__COMPRESSION_NONE", 0 },
+  { "COMPRESSION_DEFLATE", "CHAT__COMPRESSION__COMPRESSION_DEFLATE", 1 },
+};
+static const ProtobufCIntRange chat__compression__value_ranges[] = {
+{0, 0},{0, 2}
+};
+static const ProtobufCEnumValueIndex chat__compression__enum_values_by_name[2] =
+{
+  { "COMPRESSION_DEFLATE", 1 },
+  { "COMPRESSION_NONE", 0 },
+};
+const ProtobufCEnumDescriptor chat__compression__descriptor =
+{
+  PROTOBUF_C__ENUM_DESCRIPTOR_MAGIC,
+  "chat.Compression",
+  "Compression",
+  "Chat__Compression",
+  "chat",
+  2,
+  chat__compression__enum_values_by_number,
+  2,
+  chat__compression__enum_values_by_name,
+  1,
+  chat__compression__value_ranges,
+  NULL,NULL,NULL,NULL   /* reserved[1234] */
+};
 static const ProtobufCEnumValue chat__message_type__enum_values_by_number[2] =
 {
   { "BROADCAST", "CHAT__MESSAGE_TYPE__BROADCAST", 0 },
@@ -1007,6 +2393,38 @@ const ProtobufCEnumDescriptor chat__message_type__descriptor =
   chat__message_type__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
+static const ProtobufCEnumValue chat__stream_phase__enum_values_by_number[4] =
+{
+  { "STREAM_START", "CHAT__STREAM_PHASE__STREAM_START", 0 },
+  { "STREAM_DATA", "CHAT__STREAM_PHASE__STREAM_DATA", 1 },
+  { "STREAM_END", "CHAT__STREAM_PHASE__STREAM_END", 2 },
+  { "STREAM_ABORT", "CHAT__STREAM_PHASE__STREAM_ABORT", 3 },
+};
+static const ProtobufCIntRange chat__stream_phase__value_ranges[] = {
+{0, 0},{0, 4}
+};
+static const ProtobufCEnumValueIndex chat__stream_phase__enum_values_by_name[4] =
+{
+  { "STREAM_ABORT", 3 },
+  { "STREAM_DATA", 1 },
+  { "STREAM_END", 2 },
+  { "STREAM_START", 0 },
+};
+const ProtobufCEnumDescriptor chat__stream_phase__descriptor =
+{
+  PROTOBUF_C__ENUM_DESCRIPTOR_MAGIC,
+  "chat.StreamPhase",
+  "StreamPhase",
+  "Chat__StreamPhase",
+  "chat",
+  4,
+  chat__stream_phase__enum_values_by_number,
+  4,
+  chat__stream_phase__enum_values_by_name,
+  1,
+  chat__stream_phase__value_ranges,
+  NULL,NULL,NULL,NULL   /* reserved[1234] */
+};
 static const ProtobufCEnumValue chat__user_list_type__enum_values_by_number[2] =
 {
   { "ALL", "CHAT__USER_LIST_TYPE__ALL", 0 },
@@ -1035,7 +2453,7 @@ const ProtobufCEnumDescriptor chat__user_list_type__descriptor =
   chat__user_list_type__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
-static const ProtobufCEnumValue chat__operation__enum_values_by_number[6] =
+static const ProtobufCEnumValue chat__operation__enum_values_by_number[11] =
 {
   { "REGISTER_USER", "CHAT__OPERATION__REGISTER_USER", 0 },
   { "SEND_MESSAGE", "CHAT__OPERATION__SEND_MESSAGE", 1 },
@@ -1043,16 +2461,26 @@ static const ProtobufCEnumValue chat__operation__enum_values_by_number[6] =
   { "GET_USERS", "CHAT__OPERATION__GET_USERS", 3 },
   { "UNREGISTER_USER", "CHAT__OPERATION__UNREGISTER_USER", 4 },
   { "INCOMING_MESSAGE", "CHAT__OPERATION__INCOMING_MESSAGE", 5 },
+  { "SEND_MESSAGE_BATCH", "CHAT__OPERATION__SEND_MESSAGE_BATCH", 6 },
+  { "SEND_MESSAGE_MULTICAST", "CHAT__OPERATION__SEND_MESSAGE_MULTICAST", 7 },
+  { "GET_MEMORY", "CHAT__OPERATION__GET_MEMORY", 8 },
+  { "SEND_STREAM", "CHAT__OPERATION__SEND_STREAM", 9 },
+  { "INCOMING_STREAM", "CHAT__OPERATION__INCOMING_STREAM", 10 },
 };
 static const ProtobufCIntRange chat__operation__value_ranges[] = {
-{0, 0},{0, 6}
+{0, 0},{0, 11}
 };
-static const ProtobufCEnumValueIndex chat__operation__enum_values_by_name[6] =
+static const ProtobufCEnumValueIndex chat__operation__enum_values_by_name[11] =
 {
+  { "GET_MEMORY", 8 },
   { "GET_USERS", 3 },
   { "INCOMING_MESSAGE", 5 },
+  { "INCOMING_STREAM", 10 },
   { "REGISTER_USER", 0 },
   { "SEND_MESSAGE", 1 },
+  { "SEND_MESSAGE_BATCH", 6 },
+  { "SEND_MESSAGE_MULTICAST", 7 },
+  { "SEND_STREAM", 9 },
   { "UNREGISTER_USER", 4 },
   { "UPDATE_STATUS", 2 },
 };
@@ -1063,9 +2491,9 @@ const ProtobufCEnumDescriptor chat__operation__descriptor =
   "Operation",
   "Chat__Operation",
   "chat",
-  6,
+  11,
   chat__operation__enum_values_by_number,
-  6,
+  11,
   chat__operation__enum_values_by_name,
   1,
   chat__operation__value_ranges,
@@ -1103,3 +2531,43 @@ const ProtobufCEnumDescriptor chat__status_code__descriptor =
   chat__status_code__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
+static const ProtobufCEnumValue chat__node_event_type__enum_values_by_number[8] =
+{
+  { "NODE_HELLO", "CHAT__NODE_EVENT_TYPE__NODE_HELLO", 0 },
+  { "NODE_USER_JOINED", "CHAT__NODE_EVENT_TYPE__NODE_USER_JOINED", 1 },
+  { "NODE_USER_LEFT", "CHAT__NODE_EVENT_TYPE__NODE_USER_LEFT", 2 },
+  { "NODE_USER_STATUS", "CHAT__NODE_EVENT_TYPE__NODE_USER_STATUS", 3 },
+  { "NODE_BROADCAST", "CHAT__NODE_EVENT_TYPE__NODE_BROADCAST", 4 },
+  { "NODE_DIRECT", "CHAT__NODE_EVENT_TYPE__NODE_DIRECT", 5 },
+  { "NODE_LEAVING", "CHAT__NODE_EVENT_TYPE__NODE_LEAVING", 6 },
+  { "NODE_SESSION", "CHAT__NODE_EVENT_TYPE__NODE_SESSION", 7 },
+};
+static const ProtobufCIntRange chat__node_event_type__value_ranges[] = {
+{0, 0},{0, 8}
+};
+static const ProtobufCEnumValueIndex chat__node_event_type__enum_values_by_name[8] =
+{
+  { "NODE_BROADCAST", 4 },
+  { "NODE_DIRECT", 5 },
+  { "NODE_HELLO", 0 },
+  { "NODE_LEAVING", 6 },
+  { "NODE_SESSION", 7 },
+  { "NODE_USER_JOINED", 1 },
+  { "NODE_USER_LEFT", 2 },
+  { "NODE_USER_STATUS", 3 },
+};
+const ProtobufCEnumDescriptor chat__node_event_type__descriptor =
+{
+  PROTOBUF_C__ENUM_DESCRIPTOR_MAGIC,
+  "chat.NodeEventType",
+  "NodeEventType",
+  "Chat__NodeEventType",
+  "chat",
+  8,
+  chat__node_event_type__enum_values_by_number,
+  8,
+  chat__node_event_type__enum_values_by_name,
+  1,
+  chat__node_event_type__value_ranges,
+  NULL,NULL,NULL,NULL   /* reserved[1234] */
+};
@@ -17,13 +17,22 @@ PROTOBUF_C__BEGIN_DECLS
 
 typedef struct Chat__User Chat__User;
 typedef struct Chat__NewUserRequest Chat__NewUserRequest;
+typedef struct Chat__SessionInfo Chat__SessionInfo;
+typedef struct Chat__MemoryUsage Chat__MemoryUsage;
 typedef struct Chat__SendMessageRequest Chat__SendMessageRequest;
 typedef struct Chat__IncomingMessageResponse Chat__IncomingMessageResponse;
+typedef struct Chat__SendMessageBatchRequest Chat__SendMessageBatchRequest;
+typedef struct Chat__MulticastMessageRequest Chat__MulticastMessageRequest;
+typedef struct Chat__DeliveryReport Chat__DeliveryReport;
+typedef struct Chat__StreamChunk Chat__StreamChunk;
 typedef struct Chat__UserListRequest Chat__UserListRequest;
 typedef struct Chat__UserListResponse Chat__UserListResponse;
 typedef struct Chat__UpdateStatusRequest Chat__UpdateStatusRequest;
 typedef struct Chat__Request Chat__Request;
 typedef struct Chat__Response Chat__Response;
+typedef struct Chat__Redirect Chat__Redirect;
+typedef struct Chat__NodeEvent Chat__NodeEvent;
+typedef struct Chat__NodeBatch Chat__NodeBatch;
 
 
 /* --- enums --- */
@@ -47,6 +56,18 @@ typedef enum _Chat__UserStatus {
   CHAT__USER_STATUS__OFFLINE = 2
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__USER_STATUS)
 } Chat__UserStatus;
+/*
+ * Compression of the frames the server sends on a connection, negotiated at registration.
+ */
+typedef enum _Chat__Compression {
+  CHAT__COMPRESSION__COMPRESSION_NONE = 0,
+  /*
+   * Raw deflate with the shared chat dictionary. A compressed frame sets the high bit of its length header and
+   * inflates to one or more complete frames (headers included). Only frames above a size threshold are compressed.
+   */
+  CHAT__COMPRESSION__COMPRESSION_DEFLATE = 1
+    PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__COMPRESSION)
+} Chat__Compression;
 typedef enum _Chat__MessageType {
   /*
    * Message is broadcast to all online users.
@@ -58,6 +79,30 @@ typedef enum _Chat__MessageType {
   CHAT__MESSAGE_TYPE__DIRECT = 1
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__MESSAGE_TYPE)
 } Chat__MessageType;
+/*
+ * Large content (logs, pasted snippets) goes as a stream of chunks that the server relays as they arrive, without
+ * holding the whole message. Each chunk is a SEND_STREAM request from the sender and an INCOMING_STREAM response to
+ * every recipient, so other traffic interleaves between chunks.
+ */
+typedef enum _Chat__StreamPhase {
+  /*
+   * Opens the stream: recipient and, if known, total_size.
+   */
+  CHAT__STREAM_PHASE__STREAM_START = 0,
+  /*
+   * Next piece of the content.
+   */
+  CHAT__STREAM_PHASE__STREAM_DATA = 1,
+  /*
+   * Last chunk; the server confirms it with an OK SEND_STREAM response.
+   */
+  CHAT__STREAM_PHASE__STREAM_END = 2,
+  /*
+   * Cancelled by the sender, or stopped by the server (a BAD_REQUEST SEND_STREAM response says why).
+   */
+  CHAT__STREAM_PHASE__STREAM_ABORT = 3
+    PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__STREAM_PHASE)
+} Chat__StreamPhase;
 typedef enum _Chat__UserListType {
   /*
    * Fetch all connected users.
@@ -75,7 +120,12 @@ typedef enum _Chat__Operation {
   CHAT__OPERATION__UPDATE_STATUS = 2,
   CHAT__OPERATION__GET_USERS = 3,
   CHAT__OPERATION__UNREGISTER_USER = 4,
-  CHAT__OPERATION__INCOMING_MESSAGE = 5
+  CHAT__OPERATION__INCOMING_MESSAGE = 5,
+  CHAT__OPERATION__SEND_MESSAGE_BATCH = 6,
+  CHAT__OPERATION__SEND_MESSAGE_MULTICAST = 7,
+  CHAT__OPERATION__GET_MEMORY = 8,
+  CHAT__OPERATION__SEND_STREAM = 9,
+  CHAT__OPERATION__INCOMING_STREAM = 10
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__OPERATION)
 } Chat__Operation;
 typedef enum _Chat__StatusCode {
@@ -97,6 +147,44 @@ typedef enum _Chat__StatusCode {
   CHAT__STATUS_CODE__INTERNAL_SERVER_ERROR = 500
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__STATUS_CODE)
 } Chat__StatusCode;
+/*
+ * Federation: events a server node sends to another over the inter-node link (see federation.h).
+ */
+typedef enum _Chat__NodeEventType {
+  /*
+   * First event of a link: node_id of the sending node.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_HELLO = 0,
+  /*
+   * username registered on the sending node, with its status.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_USER_JOINED = 1,
+  /*
+   * username is no longer on the sending node.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_USER_LEFT = 2,
+  /*
+   * username changed its status.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_USER_STATUS = 3,
+  /*
+   * Deliver content from sender to every user of the receiving node.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_BROADCAST = 4,
+  /*
+   * Deliver content from sender to username, a user of the receiving node.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_DIRECT = 5,
+  /*
+   * The sending node is shutting down: take it out of the ring, its sessions follow.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_LEAVING = 6,
+  /*
+   * Resumable session of username migrated to the receiving node, which now owns it.
+   */
+  CHAT__NODE_EVENT_TYPE__NODE_SESSION = 7
+    PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__NODE_EVENT_TYPE)
+} Chat__NodeEventType;
 
 /* --- messages --- */
 
@@ -130,10 +218,102 @@ struct  Chat__NewUserRequest
    * Desired username for the new user. Must be unique across all users.
    */
   char *username;
+  /*
+   * Ask for a resumable session: incoming messages carry a sequence number and are kept for replay.
+   */
+  protobuf_c_boolean resumable;
+  /*
+   * Token of a session to resume (from SessionInfo). Empty starts a new session.
+   */
+  char *session_token;
+  /*
+   * Last sequence received in the session being resumed; everything after it is replayed.
+   */
+  uint64_t last_sequence;
+  /*
+   * Compression the client can decode; the server answers with the one it will use.
+   */
+  Chat__Compression compression;
 };
 #define CHAT__NEW_USER_REQUEST__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&chat__new_user_request__descriptor) \
-, (char *)protobuf_c_empty_string }
+, (char *)protobuf_c_empty_string, 0, (char *)protobuf_c_empty_string, 0, CHAT__COMPRESSION__COMPRESSION_NONE }
+
+
+/*
+ * SessionInfo answers a resumable REGISTER_USER.
+ */
+struct  Chat__SessionInfo
+{
+  ProtobufCMessage base;
+  /*
+   * Secret that identifies the session, needed to resume it after the connection drops.
+   */
+  char *token;
+  /*
+   * True if an existing session was resumed, false if a new one was started.
+   */
+  protobuf_c_boolean resumed;
+  /*
+   * Messages replayed right after this response.
+   */
+  uint64_t replayed;
+  /*
+   * Messages after last_sequence that had already left the replay window (refetch state if > 0).
+   */
+  uint64_t missed;
+};
+#define CHAT__SESSION_INFO__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__session_info__descriptor) \
+, (char *)protobuf_c_empty_string, 0, 0, 0 }
+
+
+/*
+ * MemoryUsage answers GET_MEMORY with the server's accounted memory, in bytes.
+ */
+struct  Chat__MemoryUsage
+{
+  ProtobufCMessage base;
+  /*
+   * Configured budget (0 if unlimited).
+   */
+  uint64_t budget;
+  /*
+   * Sum of every category below.
+   */
+  uint64_t used;
+  /*
+   * Client records (connected users and detached sessions).
+   */
+  uint64_t clients;
+  /*
+   * Request buffers of the connections.
+   */
+  uint64_t buffers;
+  /*
+   * Outgoing queues (coalesced broadcasts).
+   */
+  uint64_t queues;
+  /*
+   * Replay windows of resumable sessions.
+   */
+  uint64_t history;
+  /*
+   * Shared-memory rings mapped for local clients.
+   */
+  uint64_t shared_memory;
+  /*
+   * New registrations are accepted.
+   */
+  protobuf_c_boolean admitting;
+  /*
+   * Broadcasts are being rejected to stay within the budget.
+   */
+  protobuf_c_boolean shedding;
+};
+#define CHAT__MEMORY_USAGE__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__memory_usage__descriptor) \
+, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 
 
 /*
@@ -177,6 +357,106 @@ struct  Chat__IncomingMessageResponse
 , (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, CHAT__MESSAGE_TYPE__BROADCAST }
 
 
+/*
+ * SendMessageBatchRequest carries many messages (broadcast and direct mixed) that the server processes in one pass.
+ */
+struct  Chat__SendMessageBatchRequest
+{
+  ProtobufCMessage base;
+  /*
+   * Processed in order, each one with the same rules as a single SendMessageRequest.
+   */
+  size_t n_messages;
+  Chat__SendMessageRequest **messages;
+};
+#define CHAT__SEND_MESSAGE_BATCH_REQUEST__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__send_message_batch_request__descriptor) \
+, 0,NULL }
+
+
+/*
+ * MulticastMessageRequest sends the same direct message to an explicit list of users.
+ */
+struct  Chat__MulticastMessageRequest
+{
+  ProtobufCMessage base;
+  /*
+   * Usernames of the recipients, in the order used by the DeliveryReport.
+   */
+  size_t n_recipients;
+  char **recipients;
+  /*
+   * Content of the message, the same for every recipient.
+   */
+  char *content;
+};
+#define CHAT__MULTICAST_MESSAGE_REQUEST__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__multicast_message_request__descriptor) \
+, 0,NULL, (char *)protobuf_c_empty_string }
+
+
+/*
+ * DeliveryReport tells the sender which of its messages (batch) or recipients (multicast) were delivered.
+ */
+struct  Chat__DeliveryReport
+{
+  ProtobufCMessage base;
+  /*
+   * Number of messages or recipients delivered.
+   */
+  uint32_t delivered;
+  /*
+   * Number that could not be delivered (unknown or offline recipient).
+   */
+  uint32_t failed;
+  /*
+   * Bit i (byte i / 8, bit i % 8) is set if message or recipient i was delivered.
+   */
+  ProtobufCBinaryData status_bitmap;
+};
+#define CHAT__DELIVERY_REPORT__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__delivery_report__descriptor) \
+, 0, 0, {0,NULL} }
+
+
+struct  Chat__StreamChunk
+{
+  ProtobufCMessage base;
+  /*
+   * Chosen by the sender, unique among its open streams. Receivers key streams by (sender, stream_id).
+   */
+  uint32_t stream_id;
+  Chat__StreamPhase phase;
+  /*
+   * START: username of the recipient, empty to stream to every online user.
+   */
+  char *recipient;
+  /*
+   * At most 16 KiB per chunk; START, DATA and END may all carry data.
+   */
+  ProtobufCBinaryData data;
+  /*
+   * Position of data within the content. A receiver that sees a gap drops the stream.
+   */
+  uint64_t offset;
+  /*
+   * START: size of the content if the sender knows it, 0 otherwise.
+   */
+  uint64_t total_size;
+  /*
+   * INCOMING_STREAM: user that sends the stream.
+   */
+  char *sender;
+  /*
+   * INCOMING_STREAM: broadcast or direct.
+   */
+  Chat__MessageType type;
+};
+#define CHAT__STREAM_CHUNK__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__stream_chunk__descriptor) \
+, 0, CHAT__STREAM_PHASE__STREAM_START, (char *)protobuf_c_empty_string, {0,NULL}, 0, 0, (char *)protobuf_c_empty_string, CHAT__MESSAGE_TYPE__BROADCAST }
+
+
 /*
  * UserListRequest is used to fetch a list of currently connected users.
  */
@@ -237,7 +517,10 @@ typedef enum {
   CHAT__REQUEST__PAYLOAD_SEND_MESSAGE = 3,
   CHAT__REQUEST__PAYLOAD_UPDATE_STATUS = 4,
   CHAT__REQUEST__PAYLOAD_GET_USERS = 5,
-  CHAT__REQUEST__PAYLOAD_UNREGISTER_USER = 6
+  CHAT__REQUEST__PAYLOAD_UNREGISTER_USER = 6,
+  CHAT__REQUEST__PAYLOAD_SEND_MESSAGE_BATCH = 7,
+  CHAT__REQUEST__PAYLOAD_SEND_MULTICAST = 8,
+  CHAT__REQUEST__PAYLOAD_STREAM = 9
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__REQUEST__PAYLOAD__CASE)
 } Chat__Request__PayloadCase;
 
@@ -258,6 +541,9 @@ struct  Chat__Request
     Chat__UpdateStatusRequest *update_status;
     Chat__UserListRequest *get_users;
     Chat__User *unregister_user;
+    Chat__SendMessageBatchRequest *send_message_batch;
+    Chat__MulticastMessageRequest *send_multicast;
+    Chat__StreamChunk *stream;
   };
 };
 #define CHAT__REQUEST__INIT \
@@ -268,7 +554,12 @@ struct  Chat__Request
 typedef enum {
   CHAT__RESPONSE__RESULT__NOT_SET = 0,
   CHAT__RESPONSE__RESULT_USER_LIST = 4,
-  CHAT__RESPONSE__RESULT_INCOMING_MESSAGE = 5
+  CHAT__RESPONSE__RESULT_INCOMING_MESSAGE = 5,
+  CHAT__RESPONSE__RESULT_DELIVERY_REPORT = 6,
+  CHAT__RESPONSE__RESULT_SESSION = 7,
+  CHAT__RESPONSE__RESULT_MEMORY = 9,
+  CHAT__RESPONSE__RESULT_REDIRECT = 10,
+  CHAT__RESPONSE__RESULT_STREAM = 12
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(CHAT__RESPONSE__RESULT__CASE)
 } Chat__Response__ResultCase;
 
@@ -300,11 +591,110 @@ struct  Chat__Response
      * Details specific to incoming chat messages.
      */
     Chat__IncomingMessageResponse *incoming_message;
+    /*
+     * Delivery status of a SEND_MESSAGE_BATCH or SEND_MESSAGE_MULTICAST.
+     */
+    Chat__DeliveryReport *delivery_report;
+    /*
+     * Session of a resumable REGISTER_USER.
+     */
+    Chat__SessionInfo *session;
+    /*
+     * Memory accounting of a GET_MEMORY.
+     */
+    Chat__MemoryUsage *memory;
+    /*
+     * REGISTER_USER sent to a node that does not own the username.
+     */
+    Chat__Redirect *redirect;
+    /*
+     * Chunk of an INCOMING_STREAM, or the end of a SEND_STREAM (stream_id, phase, offset).
+     */
+    Chat__StreamChunk *stream;
   };
+  /*
+   * Sequence number of an INCOMING_MESSAGE within a resumable session (0 outside one). It is the last field
+   * of an INCOMING_MESSAGE, so the server appends it to a message packed once for every recipient.
+   */
+  uint64_t sequence;
+  /*
+   * REGISTER_USER: compression the server applies from now on (never in an INCOMING_MESSAGE).
+   */
+  Chat__Compression compression;
 };
 #define CHAT__RESPONSE__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&chat__response__descriptor) \
-, CHAT__OPERATION__REGISTER_USER, CHAT__STATUS_CODE__UNKNOWN_STATUS, (char *)protobuf_c_empty_string, CHAT__RESPONSE__RESULT__NOT_SET, {0} }
+, CHAT__OPERATION__REGISTER_USER, CHAT__STATUS_CODE__UNKNOWN_STATUS, (char *)protobuf_c_empty_string, CHAT__RESPONSE__RESULT__NOT_SET, {0}, 0, CHAT__COMPRESSION__COMPRESSION_NONE }
+
+
+/*
+ * Redirect tells a client which node owns its username (consistent hashing across the federation).
+ */
+struct  Chat__Redirect
+{
+  ProtobufCMessage base;
+  /*
+   * IPv4 of the node.
+   */
+  char *address;
+  /*
+   * Port where the node accepts clients.
+   */
+  uint32_t port;
+  uint32_t node_id;
+};
+#define CHAT__REDIRECT__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__redirect__descriptor) \
+, (char *)protobuf_c_empty_string, 0, 0 }
+
+
+struct  Chat__NodeEvent
+{
+  ProtobufCMessage base;
+  Chat__NodeEventType type;
+  uint32_t node_id;
+  char *username;
+  Chat__UserStatus status;
+  char *sender;
+  char *content;
+  /*
+   * HELLO: port where the sending node accepts clients.
+   */
+  uint32_t client_port;
+  /*
+   * SESSION: token the client resumes with.
+   */
+  char *session_token;
+  /*
+   * SESSION: number of the next INCOMING_MESSAGE.
+   */
+  uint64_t next_sequence;
+  /*
+   * SESSION: number of the first message in replay.
+   */
+  uint64_t replay_first;
+  /*
+   * SESSION: replay window, framed INCOMING_MESSAGE responses.
+   */
+  ProtobufCBinaryData replay;
+};
+#define CHAT__NODE_EVENT__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__node_event__descriptor) \
+, CHAT__NODE_EVENT_TYPE__NODE_HELLO, 0, (char *)protobuf_c_empty_string, CHAT__USER_STATUS__ONLINE, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, 0, (char *)protobuf_c_empty_string, 0, 0, {0,NULL} }
+
+
+/*
+ * Every frame of an inter-node link carries one NodeBatch with all the events queued since the previous one.
+ */
+struct  Chat__NodeBatch
+{
+  ProtobufCMessage base;
+  size_t n_events;
+  Chat__NodeEvent **events;
+};
+#define CHAT__NODE_BATCH__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&chat__node_batch__descriptor) \
+, 0,NULL }
 
 
 /* Chat__User methods */
@@ -345,6 +735,44 @@ Chat__NewUserRequest *
 void   chat__new_user_request__free_unpacked
                      (Chat__NewUserRequest *message,
                       ProtobufCAllocator *allocator);
+/* Chat__SessionInfo methods */
+void   chat__session_info__init
+                     (Chat__SessionInfo         *message);
+size_t chat__session_info__get_packed_size
+                     (const Chat__SessionInfo   *message);
+size_t chat__session_info__pack
+                     (const Chat__SessionInfo   *message,
+                      uint8_t             *out);
+size_t chat__session_info__pack_to_buffer
+                     (const Chat__SessionInfo   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__SessionInfo *
+       chat__session_info__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__session_info__free_unpacked
+                     (Chat__SessionInfo *message,
+                      ProtobufCAllocator *allocator);
+/* Chat__MemoryUsage methods */
+void   chat__memory_usage__init
+                     (Chat__MemoryUsage         *message);
+size_t chat__memory_usage__get_packed_size
+                     (const Chat__MemoryUsage   *message);
+size_t chat__memory_usage__pack
+                     (const Chat__MemoryUsage   *message,
+                      uint8_t             *out);
+size_t chat__memory_usage__pack_to_buffer
+                     (const Chat__MemoryUsage   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__MemoryUsage *
+       chat__memory_usage__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__memory_usage__free_unpacked
+                     (Chat__MemoryUsage *message,
+                      ProtobufCAllocator *allocator);
 /* Chat__SendMessageRequest methods */
 void   chat__send_message_request__init
                      (Chat__SendMessageRequest         *message);
@@ -383,6 +811,82 @@ Chat__IncomingMessageResponse *
 void   chat__incoming_message_response__free_unpacked
                      (Chat__IncomingMessageResponse *message,
                       ProtobufCAllocator *allocator);
+/* Chat__SendMessageBatchRequest methods */
+void   chat__send_message_batch_request__init
+                     (Chat__SendMessageBatchRequest         *message);
+size_t chat__send_message_batch_request__get_packed_size
+                     (const Chat__SendMessageBatchRequest   *message);
+size_t chat__send_message_batch_request__pack
+                     (const Chat__SendMessageBatchRequest   *message,
+                      uint8_t             *out);
+size_t chat__send_message_batch_request__pack_to_buffer
+                     (const Chat__SendMessageBatchRequest   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__SendMessageBatchRequest *
+       chat__send_message_batch_request__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__send_message_batch_request__free_unpacked
+                     (Chat__SendMessageBatchRequest *message,
+                      ProtobufCAllocator *allocator);
+/* Chat__MulticastMessageRequest methods */
+void   chat__multicast_message_request__init
+                     (Chat__MulticastMessageRequest         *message);
+size_t chat__multicast_message_request__get_packed_size
+                     (const Chat__MulticastMessageRequest   *message);
+size_t chat__multicast_message_request__pack
+                     (const Chat__MulticastMessageRequest   *message,
+                      uint8_t             *out);
+size_t chat__multicast_message_request__pack_to_buffer
+                     (const Chat__MulticastMessageRequest   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__MulticastMessageRequest *
+       chat__multicast_message_request__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__multicast_message_request__free_unpacked
+                     (Chat__MulticastMessageRequest *message,
+                      ProtobufCAllocator *allocator);
+/* Chat__DeliveryReport methods */
+void   chat__delivery_report__init
+                     (Chat__DeliveryReport         *message);
+size_t chat__delivery_report__get_packed_size
+                     (const Chat__DeliveryReport   *message);
+size_t chat__delivery_report__pack
+                     (const Chat__DeliveryReport   *message,
+                      uint8_t             *out);
+size_t chat__delivery_report__pack_to_buffer
+                     (const Chat__DeliveryReport   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__DeliveryReport *
+       chat__delivery_report__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__delivery_report__free_unpacked
+                     (Chat__DeliveryReport *message,
+                      ProtobufCAllocator *allocator);
+/* Chat__StreamChunk methods */
+void   chat__stream_chunk__init
+                     (Chat__StreamChunk         *message);
+size_t chat__stream_chunk__get_packed_size
+                     (const Chat__StreamChunk   *message);
+size_t chat__stream_chunk__pack
+                     (const Chat__StreamChunk   *message,
+                      uint8_t             *out);
+size_t chat__stream_chunk__pack_to_buffer
+                     (const Chat__StreamChunk   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__StreamChunk *
+       chat__stream_chunk__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__stream_chunk__free_unpacked
+                     (Chat__StreamChunk *message,
+                      ProtobufCAllocator *allocator);
 /* Chat__UserListRequest methods */
 void   chat__user_list_request__init
                      (Chat__UserListRequest         *message);
@@ -478,6 +982,63 @@ Chat__Response *
 void   chat__response__free_unpacked
                      (Chat__Response *message,
                       ProtobufCAllocator *allocator);
+/* Chat__Redirect methods */
+void   chat__redirect__init
+                     (Chat__Redirect         *message);
+size_t chat__redirect__get_packed_size
+                     (const Chat__Redirect   *message);
+size_t chat__redirect__pack
+                     (const Chat__Redirect   *message,
+                      uint8_t             *out);
+size_t chat__redirect__pack_to_buffer
+                     (const Chat__Redirect   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__Redirect *
+       chat__redirect__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__redirect__free_unpacked
+                     (Chat__Redirect *message,
+                      ProtobufCAllocator *allocator);
+/* Chat__NodeEvent methods */
+void   chat__node_event__init
+                     (Chat__NodeEvent         *message);
+size_t chat__node_event__get_packed_size
+                     (const Chat__NodeEvent   *message);
+size_t chat__node_event__pack
+                     (const Chat__NodeEvent   *message,
+                      uint8_t             *out);
+size_t chat__node_event__pack_to_buffer
+                     (const Chat__NodeEvent   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__NodeEvent *
+       chat__node_event__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__node_event__free_unpacked
+                     (Chat__NodeEvent *message,
+                      ProtobufCAllocator *allocator);
+/* Chat__NodeBatch methods */
+void   chat__node_batch__init
+                     (Chat__NodeBatch         *message);
+size_t chat__node_batch__get_packed_size
+                     (const Chat__NodeBatch   *message);
+size_t chat__node_batch__pack
+                     (const Chat__NodeBatch   *message,
+                      uint8_t             *out);
+size_t chat__node_batch__pack_to_buffer
+                     (const Chat__NodeBatch   *message,
+                      ProtobufCBuffer     *buffer);
+Chat__NodeBatch *
+       chat__node_batch__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   chat__node_batch__free_unpacked
+                     (Chat__NodeBatch *message,
+                      ProtobufCAllocator *allocator);
 /* --- per-message closures --- */
 
 typedef void (*Chat__User_Closure)
@@ -486,12 +1047,30 @@ typedef void (*Chat__User_Closure)
 typedef void (*Chat__NewUserRequest_Closure)
                  (const Chat__NewUserRequest *message,
                   void *closure_data);
+typedef void (*Chat__SessionInfo_Closure)
+                 (const Chat__SessionInfo *message,
+                  void *closure_data);
+typedef void (*Chat__MemoryUsage_Closure)
+                 (const Chat__MemoryUsage *message,
+                  void *closure_data);
 typedef void (*Chat__SendMessageRequest_Closure)
                  (const Chat__SendMessageRequest *message,
                   void *closure_data);
 typedef void (*Chat__IncomingMessageResponse_Closure)
                  (const Chat__IncomingMessageResponse *message,
                   void *closure_data);
+typedef void (*Chat__SendMessageBatchRequest_Closure)
+                 (const Chat__SendMessageBatchRequest *message,
+                  void *closure_data);
+typedef void (*Chat__MulticastMessageRequest_Closure)
+                 (const Chat__MulticastMessageRequest *message,
+                  void *closure_data);
+typedef void (*Chat__DeliveryReport_Closure)
+                 (const Chat__DeliveryReport *message,
+                  void *closure_data);
+typedef void (*Chat__StreamChunk_Closure)
+                 (const Chat__StreamChunk *message,
+                  void *closure_data);
 typedef void (*Chat__UserListRequest_Closure)
                  (const Chat__UserListRequest *message,
                   void *closure_data);
@@ -507,6 +1086,15 @@ typedef void (*Chat__Request_Closure)
 typedef void (*Chat__Response_Closure)
                  (const Chat__Response *message,
                   void *closure_data);
+typedef void (*Chat__Redirect_Closure)
+                 (const Chat__Redirect *message,
+                  void *closure_data);
+typedef void (*Chat__NodeEvent_Closure)
+                 (const Chat__NodeEvent *message,
+                  void *closure_data);
+typedef void (*Chat__NodeBatch_Closure)
+                 (const Chat__NodeBatch *message,
+                  void *closure_data);
 
 /* --- services --- */
 
@@ -514,19 +1102,31 @@ typedef void (*Chat__Response_Closure)
 /* --- descriptors --- */
 
 extern const ProtobufCEnumDescriptor    chat__user_status__descriptor;
+extern const ProtobufCEnumDescriptor    chat__compression__descriptor;
 extern const ProtobufCEnumDescriptor    chat__message_type__descriptor;
+extern const ProtobufCEnumDescriptor    chat__stream_phase__descriptor;
 extern const ProtobufCEnumDescriptor    chat__user_list_type__descriptor;
 extern const ProtobufCEnumDescriptor    chat__operation__descriptor;
 extern const ProtobufCEnumDescriptor    chat__status_code__descriptor;
+extern const ProtobufCEnumDescriptor    chat__node_event_type__descriptor;
 extern const ProtobufCMessageDescriptor chat__user__descriptor;
 extern const ProtobufCMessageDescriptor chat__new_user_request__descriptor;
+extern const ProtobufCMessageDescriptor chat__session_info__descriptor;
+extern const ProtobufCMessageDescriptor chat__memory_usage__descriptor;
 extern const ProtobufCMessageDescriptor chat__send_message_request__descriptor;
 extern const ProtobufCMessageDescriptor chat__incoming_message_response__descriptor;
+extern const ProtobufCMessageDescriptor chat__send_message_batch_request__descriptor;
+extern const ProtobufCMessageDescriptor chat__multicast_message_request__descriptor;
+extern const ProtobufCMessageDescriptor chat__delivery_report__descriptor;
+extern const ProtobufCMessageDescriptor chat__stream_chunk__descriptor;
 extern const ProtobufCMessageDescriptor chat__user_list_request__descriptor;
 extern const ProtobufCMessageDescriptor chat__user_list_response__descriptor;
 extern const ProtobufCMessageDescriptor chat__update_status_request__descriptor;
 extern const ProtobufCMessageDescriptor chat__request__descriptor;
 extern const ProtobufCMessageDescriptor chat__response__descriptor;
+extern const ProtobufCMessageDescriptor chat__redirect__descriptor;
+extern const ProtobufCMessageDescriptor chat__node_event__descriptor;
+extern const ProtobufCMessageDescriptor chat__node_batch__descriptor;
 
 PROTOBUF_C__END_DECLS
 
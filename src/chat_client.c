@@ -0,0 +1,947 @@
+/*
+    * chat_client.c
+    * Implementation of the chat client library: registration, the epoll event loop, reply matching and
+    * the batched outbox.
+    * The protocol has no request ids, but the server answers each connection in order, so every kind of
+    * reply is matched against a FIFO of the requests of that kind:
+    *   - UserListResponse             -> oldest pending user list request
+    *   - DIRECT from us or "Server"   -> oldest pending direct message (delivery ack or error)
+    *   - Response without a result    -> oldest pending status update
+    *   - DeliveryReport               -> oldest pending batch or multicast, by the response operation
+    *   - StreamChunk of a SEND_STREAM -> the outgoing stream with that stream_id
+    * Anything else is an incoming message, a chunk of an incoming stream or a notice.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "chat_client.h"
+#include "frame.h"
+#include "transport.h"
+#include "shm_ring.h"
+#include "compress.h"
+
+#define MAX_EVENTS 8
+
+typedef enum {
+    PENDING_DIRECT = 0,
+    PENDING_STATUS,
+    PENDING_USERS,
+    PENDING_BATCH,
+    PENDING_MULTICAST,
+    PENDING_MEMORY,
+    PENDING_KINDS,
+    PENDING_NONE = -1
+} pending_kind_t;
+
+// Solicitud por encolar: un Request de protobuf-c o mensajes que se empaquetan con el codec nativo
+typedef struct {
+    const Chat__Request *request;
+    const codec_send_message_t *messages;
+    size_t count;
+    bool batch;
+} outgoing_t;
+
+typedef struct pending {
+    uint64_t handle;
+    chat_reply_fn done;
+    void *arg;
+    struct pending *next;
+} pending_t;
+
+// Stream que envía la aplicación, hasta que el servidor responde cómo terminó
+typedef struct outgoing_stream {
+    uint32_t id;
+    uint64_t offset;  // Bytes ya encolados
+    bool closing;     // Ya se encoló el END o el ABORT
+    chat_reply_fn done;
+    void *arg;
+    struct outgoing_stream *next;
+} outgoing_stream_t;
+
+// Stream que se está recibiendo; solo lo usa el loop
+typedef struct incoming_stream {
+    char sender[32];
+    uint32_t id;
+    uint64_t offset;  // Posición que tiene que traer el siguiente chunk
+    Chat__MessageType type;
+    struct incoming_stream *next;
+} incoming_stream_t;
+
+struct chat_client {
+    int sockfd;
+    int epfd;
+    int wakefd;  // eventfd para despertar el loop cuando otro thread encola una solicitud
+    shm_conn_t *shm;  // Rings de memoria compartida con una dirección shm:, NULL si todo va por el socket
+    char username[32];
+    chat_callbacks_t callbacks;
+    void *user_data;
+    frame_buffer_t in;
+    bool compressed;  // El servidor comprime lo que envía (negociado al registrarse)
+    frame_buffer_t inflated;  // Frames de un frame comprimido que todavía no se entregan
+    chat_session_t session;  // Lo actualiza el loop con cada mensaje numerado
+    incoming_stream_t *incoming;
+    size_t incoming_count;
+
+    // Protegido por lock: lo escriben los threads que envían y lo vacía el loop
+    pthread_mutex_t lock;
+    uint8_t *out;
+    size_t out_len;
+    size_t out_cap;
+    pending_t *pending_head[PENDING_KINDS];
+    pending_t *pending_tail[PENDING_KINDS];
+    uint64_t next_handle;
+    outgoing_stream_t *streams;
+    uint32_t next_stream_id;
+    bool wake_pending;
+    bool want_write;
+    bool closed;
+
+    volatile bool running;
+    bool has_thread;
+    pthread_t thread;
+};
+
+static void set_error(char *error, size_t error_len, const char *message) {
+    if (error && error_len > 0) snprintf(error, error_len, "%s", message);
+}
+
+/*
+Funcion que registra al usuario con la conexión todavía bloqueante (el loop aún no existe,
+así que la respuesta del registro no puede mezclarse con nada más). Los mensajes que el servidor
+reenvía al reanudar una sesión quedan en el socket para el loop.
+Parametros:
+    * const chat_session_t *resume: sesión que se reanuda (NULL para empezar una nueva)
+    * chat_session_t *session: donde queda la sesión abierta; NULL si no se pide sesión reanudable
+    * char *redirect_address, int *redirect_port: nodo al que hay que reconectarse si el servidor redirige
+    * bool *compressed: al llamar, si se ofrece compresión; al retornar, si el servidor comprime lo que envíe
+      después de la respuesta
+Retornos:
+    * int: 0 si el servidor aceptó el registro, 1 si el nombre es de otro nodo de la federación y -1 para lo contrario
+*/
+static int register_user(int sockfd, shm_conn_t *shm, const char *username, const chat_session_t *resume,
+                         chat_session_t *session, char *redirect_address, size_t redirect_len, int *redirect_port,
+                         bool *compressed, char *error, size_t error_len) {
+    Chat__NewUserRequest new_user = CHAT__NEW_USER_REQUEST__INIT;
+    new_user.username = (char *)username;
+    new_user.resumable = session != NULL;
+    new_user.compression = *compressed ? CHAT__COMPRESSION__COMPRESSION_DEFLATE : CHAT__COMPRESSION__COMPRESSION_NONE;
+    *compressed = false;
+    if (session && resume) {
+        new_user.session_token = (char *)resume->token;
+        new_user.last_sequence = resume->last_sequence;
+    }
+    Chat__Request request = CHAT__REQUEST__INIT;
+    request.operation = CHAT__OPERATION__REGISTER_USER;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_REGISTER_USER;
+    request.register_user = &new_user;
+
+    size_t len = chat__request__get_packed_size(&request);
+    uint8_t *buffer = malloc(len);
+    chat__request__pack(&request, buffer);
+    // Con memoria compartida los descriptores de los rings viajan con el registro y la respuesta ya llega por el ring
+    int rc = shm ? send_frame_fds(sockfd, buffer, len, shm->fds, SHM_RING_FDS) : send_frame(sockfd, buffer, len);
+    free(buffer);
+    if (rc != 0) {
+        set_error(error, error_len, strerror(errno));
+        return -1;
+    }
+
+    buffer = NULL;
+    size_t capacity = 0;
+    ssize_t received = shm ? shm_ring_recv_frame(&shm->responses, &buffer, &capacity, sockfd)
+                           : recv_frame(sockfd, &buffer, &capacity);
+    if (received <= 0) {
+        set_error(error, error_len, received == 0 ? "Server closed the connection" : strerror(errno));
+        free(buffer);
+        return -1;
+    }
+    Chat__Response *response = chat__response__unpack(NULL, received, buffer);
+    free(buffer);
+    if (!response) {
+        set_error(error, error_len, "Invalid registration response");
+        return -1;
+    }
+    rc = response->status_code == CHAT__STATUS_CODE__OK ? 0 : -1;
+    if (rc != 0) set_error(error, error_len, response->message);
+    if (rc == 0) *compressed = response->compression == CHAT__COMPRESSION__COMPRESSION_DEFLATE;
+    if (rc != 0 && response->result_case == CHAT__RESPONSE__RESULT_REDIRECT) {
+        snprintf(redirect_address, redirect_len, "%s", response->redirect->address);
+        *redirect_port = response->redirect->port;
+        rc = 1;
+    }
+    if (rc == 0 && session) {
+        memset(session, 0, sizeof(*session));
+        if (response->result_case == CHAT__RESPONSE__RESULT_SESSION) {
+            snprintf(session->token, sizeof(session->token), "%s", response->session->token);
+            session->resumed = response->session->resumed;
+            session->missed = response->session->missed;
+            if (session->resumed) session->last_sequence = resume->last_sequence;
+        }
+    }
+    chat__response__free_unpacked(response, NULL);
+    return rc;
+}
+
+/*
+Funcion que se conecta al servidor, registra al usuario y prepara el event loop (sin iniciarlo).
+Si el servidor es parte de una federación y el nombre le toca a otro nodo, se reconecta a ese nodo.
+Parametros:
+    * const char *address: IPv4 del servidor, "unix:/ruta" / "unix:@nombre" para un socket Unix local,
+      o "shm:/ruta" / "shm:@nombre" para usar además los rings de memoria compartida
+    * int port: puerto del servidor (se ignora con un socket Unix)
+    * const char *username: nombre con el que se registra el usuario
+    * const chat_session_t *resume: sesión que se reanuda, o NULL
+    * bool resumable: si se pide sesión reanudable
+    * const chat_callbacks_t *callbacks: callbacks de mensajes, avisos y desconexión (pueden ser NULL)
+    * void *user_data: puntero que se entrega a los callbacks
+    * char *error: buffer donde se escribe el motivo si falla (puede ser NULL)
+    * size_t error_len: tamaño de error
+Retornos:
+    * chat_client_t *: cliente listo para chat_client_start o chat_client_run, NULL si falló
+*/
+static chat_client_t *connect_client(const char *address, int port, const char *username, const chat_session_t *resume,
+                                     bool resumable, const chat_callbacks_t *callbacks, void *user_data,
+                                     char *error, size_t error_len) {
+    char redirect_address[64];
+    int sockfd = -1;
+    shm_conn_t *shm = NULL;
+    chat_session_t session = { .token = "" };
+    bool compressed;
+    for (int redirects = 0; ; redirects++) {
+        sockfd = transport_connect(address, port);
+        if (sockfd < 0) {
+            set_error(error, error_len, errno == EINVAL ? "Invalid server address" : strerror(errno));
+            return NULL;
+        }
+        if (transport_is_shm(address) && (shm = shm_conn_create()) == NULL) {
+            set_error(error, error_len, "Could not create the shared memory rings");
+            close(sockfd);
+            return NULL;
+        }
+        // Por un socket local o memoria compartida comprimir solo gastaría CPU
+        compressed = !transport_is_unix(address) && !shm;
+        int rc = register_user(sockfd, shm, username, resume, resumable ? &session : NULL,
+                               redirect_address, sizeof(redirect_address), &port, &compressed, error, error_len);
+        if (rc == 0) break;
+        if (shm) shm_conn_close(shm);
+        shm = NULL;
+        close(sockfd);
+        if (rc < 0 || redirects == CHAT_CLIENT_MAX_REDIRECTS) return NULL;
+        address = redirect_address;  // El otro nodo siempre es una IPv4
+    }
+
+    chat_client_t *client = calloc(1, sizeof(chat_client_t));
+    client->sockfd = sockfd;
+    client->shm = shm;
+    snprintf(client->username, sizeof(client->username), "%s", username);
+    if (callbacks) client->callbacks = *callbacks;
+    client->user_data = user_data;
+    client->session = session;
+    client->compressed = compressed;
+    frame_buffer_init(&client->in);
+    frame_buffer_init(&client->inflated);
+    pthread_mutex_init(&client->lock, NULL);
+
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK);
+    client->epfd = epoll_create1(0);
+    client->wakefd = eventfd(0, EFD_NONBLOCK);
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = sockfd };
+    epoll_ctl(client->epfd, EPOLL_CTL_ADD, sockfd, &ev);
+    ev.data.fd = client->wakefd;
+    epoll_ctl(client->epfd, EPOLL_CTL_ADD, client->wakefd, &ev);
+    if (shm) {
+        // El socket queda solo para saber si el servidor se fue; los datos llegan con los doorbells de los rings
+        ev.data.fd = shm->responses.data_fd;
+        epoll_ctl(client->epfd, EPOLL_CTL_ADD, shm->responses.data_fd, &ev);
+        ev.data.fd = shm->requests.space_fd;
+        epoll_ctl(client->epfd, EPOLL_CTL_ADD, shm->requests.space_fd, &ev);
+    }
+    return client;
+}
+
+/*
+Funcion que se conecta sin sesión reanudable (ver connect_client).
+*/
+chat_client_t *chat_client_connect(const char *address, int port, const char *username, const chat_callbacks_t *callbacks,
+                                   void *user_data, char *error, size_t error_len) {
+    return connect_client(address, port, username, NULL, false, callbacks, user_data, error, error_len);
+}
+
+/*
+Funcion que se conecta con una sesión reanudable: los mensajes entrantes vienen numerados y, si la conexión se
+cae, otra conexión con la misma sesión recibe los que se perdieron mientras tanto (sin repetir ninguno).
+Parametros:
+    * const chat_session_t *session: sesión que se reanuda (de chat_client_session), o NULL para abrir una nueva
+    * el resto igual que chat_client_connect
+Retornos:
+    * chat_client_t *: cliente listo para chat_client_start o chat_client_run, NULL si falló (por ejemplo,
+      si la sesión expiró; entonces hay que abrir una nueva)
+*/
+chat_client_t *chat_client_resume(const char *address, int port, const char *username, const chat_session_t *session,
+                                  const chat_callbacks_t *callbacks, void *user_data, char *error, size_t error_len) {
+    return connect_client(address, port, username, session, true, callbacks, user_data, error, error_len);
+}
+
+/*
+Funcion que copia el estado de la sesión reanudable. Se llama desde un callback del loop o después de que
+el loop terminó (por ejemplo en on_disconnect), que es cuando se necesita para reanudar.
+*/
+void chat_client_session(const chat_client_t *client, chat_session_t *session) {
+    *session = client->session;
+}
+
+const char *chat_client_username(const chat_client_t *client) {
+    return client->username;
+}
+
+static void wake_loop(chat_client_t *client) {
+    uint64_t one = 1;
+    ssize_t rc = write(client->wakefd, &one, sizeof(one));
+    (void)rc;
+}
+
+/*
+Funcion que encola una solicitud empaquetada en el outbox y, si espera respuesta, la agrega a su FIFO.
+El loop se despierta solo con la primera solicitud después de cada envío: las que llegan mientras tanto
+se van juntas en el mismo send.
+Retornos:
+    * uint64_t: handle de la solicitud, 0 si la conexión está cerrada o el outbox está lleno
+*/
+static uint64_t submit(chat_client_t *client, pending_kind_t kind, chat_reply_fn done, void *arg, const outgoing_t *outgoing) {
+    size_t len;
+    if (outgoing->request) {
+        len = chat__request__get_packed_size(outgoing->request);
+    } else if (outgoing->batch) {
+        len = codec_send_message_batch_size(outgoing->messages, outgoing->count);
+    } else {
+        len = codec_send_message_size(outgoing->messages);
+    }
+
+    uint64_t handle = 0;
+    bool wake = false;
+
+    pthread_mutex_lock(&client->lock);
+    size_t needed = client->out_len + FRAME_HEADER_SIZE + len;
+    if (!client->closed && needed <= CHAT_CLIENT_MAX_OUTBOX) {
+        if (needed > client->out_cap) {
+            size_t cap = client->out_cap ? client->out_cap : 4096;
+            while (cap < needed) cap *= 2;
+            client->out = realloc(client->out, cap);
+            client->out_cap = cap;
+        }
+        uint8_t *frame = client->out + client->out_len;
+        frame_write_header(frame, len);
+        if (outgoing->request) {
+            chat__request__pack(outgoing->request, frame + FRAME_HEADER_SIZE);
+        } else if (outgoing->batch) {
+            codec_encode_send_message_batch(outgoing->messages, outgoing->count, frame + FRAME_HEADER_SIZE);
+        } else {
+            codec_encode_send_message(outgoing->messages, frame + FRAME_HEADER_SIZE);
+        }
+        client->out_len = needed;
+        handle = ++client->next_handle;
+
+        if (kind != PENDING_NONE) {
+            pending_t *p = malloc(sizeof(pending_t));
+            p->handle = handle;
+            p->done = done;
+            p->arg = arg;
+            p->next = NULL;
+            if (client->pending_tail[kind]) {
+                client->pending_tail[kind]->next = p;
+            } else {
+                client->pending_head[kind] = p;
+            }
+            client->pending_tail[kind] = p;
+        }
+        wake = !client->wake_pending;
+        client->wake_pending = true;
+    }
+    pthread_mutex_unlock(&client->lock);
+
+    if (wake) wake_loop(client);
+    return handle;
+}
+
+uint64_t chat_client_broadcast(chat_client_t *client, const char *content) {
+    codec_send_message_t msg = { codec_str(""), codec_str(content) };
+    outgoing_t outgoing = { .messages = &msg };
+    return submit(client, PENDING_NONE, NULL, NULL, &outgoing);
+}
+
+/*
+Funcion que envía un mensaje directo.
+done recibe el INCOMING_MESSAGE de confirmación (status OK) o el error del servidor (BAD_REQUEST, sender "Server").
+*/
+uint64_t chat_client_direct(chat_client_t *client, const char *recipient, const char *content, chat_reply_fn done, void *arg) {
+    codec_send_message_t msg = { codec_str(recipient), codec_str(content) };
+    outgoing_t outgoing = { .messages = &msg };
+    return submit(client, PENDING_DIRECT, done, arg, &outgoing);
+}
+
+/*
+Funcion que envía varios mensajes (broadcast y directos mezclados) en un solo SEND_MESSAGE_BATCH.
+done recibe un DeliveryReport con un bit por mensaje en lugar de una confirmación por cada DM.
+Parametros:
+    * const codec_send_message_t *messages: mensajes en orden; recipient vacío significa broadcast
+    * size_t count: cantidad de mensajes (el servidor acepta hasta 8192)
+*/
+uint64_t chat_client_send_batch(chat_client_t *client, const codec_send_message_t *messages, size_t count, chat_reply_fn done, void *arg) {
+    outgoing_t outgoing = { .messages = messages, .count = count, .batch = true };
+    return submit(client, PENDING_BATCH, done, arg, &outgoing);
+}
+
+/*
+Funcion que envía el mismo mensaje directo a varios usuarios en un solo SEND_MESSAGE_MULTICAST.
+done recibe un DeliveryReport con un bit por destinatario (en el orden de recipients).
+Parametros:
+    * const char *const *recipients: nombres de los destinatarios
+    * size_t count: cantidad de destinatarios (el servidor acepta hasta 4096)
+    * const char *content: contenido del mensaje
+*/
+uint64_t chat_client_multicast(chat_client_t *client, const char *const *recipients, size_t count, const char *content,
+                               chat_reply_fn done, void *arg) {
+    Chat__MulticastMessageRequest multicast = CHAT__MULTICAST_MESSAGE_REQUEST__INIT;
+    multicast.n_recipients = count;
+    multicast.recipients = (char **)recipients;
+    multicast.content = (char *)content;
+    Chat__Request request = CHAT__REQUEST__INIT;
+    request.operation = CHAT__OPERATION__SEND_MESSAGE_MULTICAST;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MULTICAST;
+    request.send_multicast = &multicast;
+    outgoing_t outgoing = { .request = &request };
+    return submit(client, PENDING_MULTICAST, done, arg, &outgoing);
+}
+
+uint64_t chat_client_set_status(chat_client_t *client, Chat__UserStatus status, chat_reply_fn done, void *arg) {
+    Chat__UpdateStatusRequest update_status = CHAT__UPDATE_STATUS_REQUEST__INIT;
+    update_status.username = client->username;
+    update_status.new_status = status;
+    Chat__Request request = CHAT__REQUEST__INIT;
+    request.operation = CHAT__OPERATION__UPDATE_STATUS;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_UPDATE_STATUS;
+    request.update_status = &update_status;
+    outgoing_t outgoing = { .request = &request };
+    return submit(client, PENDING_STATUS, done, arg, &outgoing);
+}
+
+/*
+Funcion que pide la lista de usuarios conectados, o solo la de username si no es NULL ni vacío.
+*/
+uint64_t chat_client_list_users(chat_client_t *client, const char *username, chat_reply_fn done, void *arg) {
+    Chat__UserListRequest get_users = CHAT__USER_LIST_REQUEST__INIT;
+    if (username) get_users.username = (char *)username;
+    Chat__Request request = CHAT__REQUEST__INIT;
+    request.operation = CHAT__OPERATION__GET_USERS;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_GET_USERS;
+    request.get_users = &get_users;
+    outgoing_t outgoing = { .request = &request };
+    return submit(client, PENDING_USERS, done, arg, &outgoing);
+}
+
+/*
+Funcion que pide la memoria que el servidor tiene registrada en su presupuesto.
+done recibe un Response con result memory (MemoryUsage).
+*/
+uint64_t chat_client_memory_usage(chat_client_t *client, chat_reply_fn done, void *arg) {
+    Chat__Request request = CHAT__REQUEST__INIT;
+    request.operation = CHAT__OPERATION__GET_MEMORY;
+    outgoing_t outgoing = { .request = &request };
+    return submit(client, PENDING_MEMORY, done, arg, &outgoing);
+}
+
+/*
+Funcion que busca un stream saliente. Debe llamarse con client->lock bloqueado.
+Retornos:
+    * outgoing_stream_t **: enlace que apunta al stream (para quitarlo de la lista), NULL si no existe
+*/
+static outgoing_stream_t **find_outgoing_stream(chat_client_t *client, uint32_t stream_id) {
+    for (outgoing_stream_t **link = &client->streams; *link; link = &(*link)->next) {
+        if ((*link)->id == stream_id) return link;
+    }
+    return NULL;
+}
+
+static uint64_t submit_stream_chunk(chat_client_t *client, uint32_t stream_id, Chat__StreamPhase phase, const char *recipient,
+                                    const uint8_t *data, size_t len, uint64_t offset, uint64_t total_size) {
+    Chat__StreamChunk chunk = CHAT__STREAM_CHUNK__INIT;
+    chunk.stream_id = stream_id;
+    chunk.phase = phase;
+    if (recipient) chunk.recipient = (char *)recipient;
+    chunk.data.data = (uint8_t *)data;
+    chunk.data.len = len;
+    chunk.offset = offset;
+    chunk.total_size = total_size;
+    Chat__Request request = CHAT__REQUEST__INIT;
+    request.operation = CHAT__OPERATION__SEND_STREAM;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_STREAM;
+    request.stream = &chunk;
+    outgoing_t outgoing = { .request = &request };
+    return submit(client, PENDING_NONE, NULL, NULL, &outgoing);
+}
+
+/*
+Funcion que abre un stream para enviar contenido grande (logs, texto pegado) por partes: el servidor reenvía cada
+chunk apenas llega, sin juntar el mensaje completo, y el resto del tráfico se intercala entre los chunks.
+Cada stream lo escribe un solo thread a la vez.
+Parametros:
+    * const char *recipient: destinatario, o NULL / vacío para todos los usuarios en línea
+    * uint64_t total_size: tamaño del contenido si se conoce (los destinatarios lo reciben con el START), 0 si no
+    * chat_reply_fn done: se llama una vez con el resultado: OK cuando el servidor confirma el END (o el ABORT
+      propio), BAD_REQUEST si el servidor detuvo el stream (message dice por qué) o NULL si se cerró la conexión.
+      Su handle es el id del stream
+Retornos:
+    * uint32_t: id del stream, 0 si la conexión está cerrada o el outbox está lleno
+*/
+uint32_t chat_client_stream_open(chat_client_t *client, const char *recipient, uint64_t total_size, chat_reply_fn done, void *arg) {
+    outgoing_stream_t *stream = calloc(1, sizeof(outgoing_stream_t));
+    stream->done = done;
+    stream->arg = arg;
+    pthread_mutex_lock(&client->lock);
+    if (++client->next_stream_id == 0) client->next_stream_id = 1;
+    stream->id = client->next_stream_id;
+    // Se registra antes de encolar el START: la respuesta puede llegar antes de que submit retorne
+    stream->next = client->streams;
+    client->streams = stream;
+    pthread_mutex_unlock(&client->lock);
+
+    uint32_t stream_id = stream->id;
+    if (submit_stream_chunk(client, stream_id, CHAT__STREAM_PHASE__STREAM_START, recipient, NULL, 0, 0, total_size) == 0) {
+        pthread_mutex_lock(&client->lock);
+        outgoing_stream_t **link = find_outgoing_stream(client, stream_id);
+        if (link) {
+            *link = stream->next;
+            free(stream);
+        }
+        pthread_mutex_unlock(&client->lock);
+        return 0;
+    }
+    return stream_id;
+}
+
+/*
+Funcion que encola contenido de un stream, partido en chunks de CHAT_STREAM_CHUNK_BYTES.
+Retornos:
+    * ssize_t: bytes encolados, menos que len si el outbox se llenó (se reintenta el resto más tarde), y -1 si el
+      stream ya terminó (el servidor lo detuvo, se cerró o se cortó la conexión)
+*/
+ssize_t chat_client_stream_write(chat_client_t *client, uint32_t stream_id, const void *data, size_t len) {
+    pthread_mutex_lock(&client->lock);
+    outgoing_stream_t **link = find_outgoing_stream(client, stream_id);
+    bool writable = link && !(*link)->closing && !client->closed;
+    uint64_t offset = writable ? (*link)->offset : 0;
+    pthread_mutex_unlock(&client->lock);
+    if (!writable) return -1;
+
+    size_t written = 0;
+    while (written < len) {
+        size_t chunk = len - written < CHAT_STREAM_CHUNK_BYTES ? len - written : CHAT_STREAM_CHUNK_BYTES;
+        if (submit_stream_chunk(client, stream_id, CHAT__STREAM_PHASE__STREAM_DATA, NULL, (const uint8_t *)data + written,
+                                chunk, offset + written, 0) == 0) {
+            break;
+        }
+        written += chunk;
+    }
+
+    pthread_mutex_lock(&client->lock);
+    link = find_outgoing_stream(client, stream_id);
+    if (link) (*link)->offset = offset + written;
+    bool ended = !link || client->closed;
+    pthread_mutex_unlock(&client->lock);
+    return written == 0 && ended ? -1 : (ssize_t)written;
+}
+
+/*
+Funcion que encola el final de un stream (END) o su cancelación (ABORT). done recibe la confirmación del servidor.
+Retornos:
+    * int: 0 para exito y -1 si el stream ya terminó o el outbox está lleno
+*/
+static int finish_stream(chat_client_t *client, uint32_t stream_id, Chat__StreamPhase phase) {
+    pthread_mutex_lock(&client->lock);
+    outgoing_stream_t **link = find_outgoing_stream(client, stream_id);
+    bool open = link && !(*link)->closing;
+    uint64_t offset = open ? (*link)->offset : 0;
+    pthread_mutex_unlock(&client->lock);
+    if (!open || submit_stream_chunk(client, stream_id, phase, NULL, NULL, 0, offset, 0) == 0) return -1;
+
+    pthread_mutex_lock(&client->lock);
+    link = find_outgoing_stream(client, stream_id);
+    if (link) (*link)->closing = true;
+    pthread_mutex_unlock(&client->lock);
+    return 0;
+}
+
+int chat_client_stream_close(chat_client_t *client, uint32_t stream_id) {
+    return finish_stream(client, stream_id, CHAT__STREAM_PHASE__STREAM_END);
+}
+
+int chat_client_stream_abort(chat_client_t *client, uint32_t stream_id) {
+    return finish_stream(client, stream_id, CHAT__STREAM_PHASE__STREAM_ABORT);
+}
+
+static pending_t *pending_pop(chat_client_t *client, pending_kind_t kind) {
+    pthread_mutex_lock(&client->lock);
+    pending_t *p = client->pending_head[kind];
+    if (p) {
+        client->pending_head[kind] = p->next;
+        if (!p->next) client->pending_tail[kind] = NULL;
+    }
+    pthread_mutex_unlock(&client->lock);
+    return p;
+}
+
+static void complete(chat_client_t *client, pending_t *p, const Chat__Response *response) {
+    if (p->done) p->done(client, p->handle, response, p->arg);
+    free(p);
+}
+
+/*
+Funcion que entrega al callback el final de un stream entrante cortado (falta un chunk o se cayó la conexión) y
+lo deja de seguir.
+*/
+static void drop_incoming_stream(chat_client_t *client, incoming_stream_t **link) {
+    incoming_stream_t *stream = *link;
+    *link = stream->next;
+    client->incoming_count--;
+    if (client->callbacks.on_stream) {
+        Chat__StreamChunk chunk = CHAT__STREAM_CHUNK__INIT;
+        chunk.stream_id = stream->id;
+        chunk.phase = CHAT__STREAM_PHASE__STREAM_ABORT;
+        chunk.offset = stream->offset;
+        chunk.sender = stream->sender;
+        chunk.type = stream->type;
+        client->callbacks.on_stream(client, &chunk, client->user_data);
+    }
+    free(stream);
+}
+
+/*
+Funcion que entrega un chunk de un stream entrante si sigue al anterior del mismo stream.
+Los chunks de un stream cuyo START no se vio (o que ya se cortó) se ignoran.
+*/
+static void dispatch_incoming_stream(chat_client_t *client, const Chat__StreamChunk *chunk) {
+    incoming_stream_t **link = &client->incoming;
+    while (*link && !((*link)->id == chunk->stream_id && strcmp((*link)->sender, chunk->sender) == 0)) {
+        link = &(*link)->next;
+    }
+    if (chunk->phase == CHAT__STREAM_PHASE__STREAM_START) {
+        if (*link) {
+            drop_incoming_stream(client, link);
+        } else if (client->incoming_count >= CHAT_CLIENT_MAX_INCOMING_STREAMS) {
+            return;
+        }
+        incoming_stream_t *stream = calloc(1, sizeof(incoming_stream_t));
+        snprintf(stream->sender, sizeof(stream->sender), "%s", chunk->sender);
+        stream->id = chunk->stream_id;
+        stream->type = chunk->type;
+        stream->next = client->incoming;
+        client->incoming = stream;
+        client->incoming_count++;
+        link = &client->incoming;
+    }
+    if (!*link) return;
+    if (chunk->phase != CHAT__STREAM_PHASE__STREAM_ABORT && chunk->offset != (*link)->offset) {
+        // El servidor descartó un chunk para esta conexión: lo que siga ya no sirve
+        drop_incoming_stream(client, link);
+        return;
+    }
+    (*link)->offset += chunk->data.len;
+    if (client->callbacks.on_stream) client->callbacks.on_stream(client, chunk, client->user_data);
+    if (chunk->phase == CHAT__STREAM_PHASE__STREAM_END || chunk->phase == CHAT__STREAM_PHASE__STREAM_ABORT) {
+        incoming_stream_t *stream = *link;
+        *link = stream->next;
+        client->incoming_count--;
+        free(stream);
+    }
+}
+
+/*
+Funcion que completa un stream saliente con la respuesta del servidor (confirmación del END o del ABORT, o el
+motivo por el que lo detuvo). Una respuesta de un stream que ya terminó se ignora.
+*/
+static void complete_outgoing_stream(chat_client_t *client, const Chat__Response *response) {
+    pthread_mutex_lock(&client->lock);
+    outgoing_stream_t **link = find_outgoing_stream(client, response->stream->stream_id);
+    outgoing_stream_t *stream = link ? *link : NULL;
+    if (stream) *link = stream->next;
+    pthread_mutex_unlock(&client->lock);
+    if (!stream) return;
+    if (stream->done) stream->done(client, stream->id, response, stream->arg);
+    free(stream);
+}
+
+/*
+Funcion que entrega un frame recibido al callback que le corresponde.
+Los INCOMING_MESSAGE (la mayor parte del tráfico) se decodifican con el codec nativo, sin copias.
+*/
+static void dispatch(chat_client_t *client, const uint8_t *payload, size_t len) {
+    codec_incoming_message_t msg;
+    if (codec_decode_incoming_message(payload, len, &msg)) {
+        if (msg.sequence) {
+            // Reenviado al reanudar la sesión pero ya recibido por la conexión anterior
+            if (msg.sequence <= client->session.last_sequence) return;
+            client->session.last_sequence = msg.sequence;
+        }
+        bool reply = msg.type == CHAT__MESSAGE_TYPE__DIRECT &&
+                     (codec_str_equals(msg.sender, client->username) || codec_str_equals(msg.sender, "Server"));
+        pending_t *p = reply ? pending_pop(client, PENDING_DIRECT) : NULL;
+        if (!p) {
+            if (client->callbacks.on_message) client->callbacks.on_message(client, &msg, client->user_data);
+            return;
+        }
+        Chat__Response *response = chat__response__unpack(NULL, len, payload);
+        complete(client, p, response);
+        chat__response__free_unpacked(response, NULL);
+        return;
+    }
+
+    Chat__Response *response = chat__response__unpack(NULL, len, payload);
+    if (!response) return;
+    if (response->result_case == CHAT__RESPONSE__RESULT_STREAM) {
+        if (response->operation == CHAT__OPERATION__INCOMING_STREAM) {
+            dispatch_incoming_stream(client, response->stream);
+        } else {
+            complete_outgoing_stream(client, response);
+        }
+        chat__response__free_unpacked(response, NULL);
+        return;
+    }
+    pending_t *p = NULL;
+    if (response->result_case == CHAT__RESPONSE__RESULT_USER_LIST) {
+        p = pending_pop(client, PENDING_USERS);
+    } else if (response->result_case == CHAT__RESPONSE__RESULT_DELIVERY_REPORT) {
+        bool multicast = response->operation == CHAT__OPERATION__SEND_MESSAGE_MULTICAST;
+        p = pending_pop(client, multicast ? PENDING_MULTICAST : PENDING_BATCH);
+    } else if (response->result_case == CHAT__RESPONSE__RESULT_MEMORY) {
+        p = pending_pop(client, PENDING_MEMORY);
+    } else if (response->result_case == CHAT__RESPONSE__RESULT__NOT_SET) {
+        p = pending_pop(client, PENDING_STATUS);
+    }
+    if (p) {
+        complete(client, p, response);
+    } else if (client->callbacks.on_notice) {
+        client->callbacks.on_notice(client, response, client->user_data);
+    }
+    chat__response__free_unpacked(response, NULL);
+}
+
+/*
+Funcion que marca la conexión como cerrada y completa con NULL todas las solicitudes pendientes.
+Parametros:
+    * bool notify: si se llama on_disconnect (no cuando el cierre lo pidió la aplicación)
+*/
+static void disconnect(chat_client_t *client, bool notify) {
+    pthread_mutex_lock(&client->lock);
+    bool was_closed = client->closed;
+    client->closed = true;
+    client->out_len = 0;
+    pthread_mutex_unlock(&client->lock);
+    if (was_closed) return;
+
+    for (int kind = 0; kind < PENDING_KINDS; kind++) {
+        pending_t *p;
+        while ((p = pending_pop(client, kind)) != NULL) {
+            complete(client, p, NULL);
+        }
+    }
+    pthread_mutex_lock(&client->lock);
+    outgoing_stream_t *streams = client->streams;
+    client->streams = NULL;
+    pthread_mutex_unlock(&client->lock);
+    while (streams) {
+        outgoing_stream_t *next = streams->next;
+        if (streams->done) streams->done(client, streams->id, NULL, streams->arg);
+        free(streams);
+        streams = next;
+    }
+    while (client->incoming) drop_incoming_stream(client, &client->incoming);
+    epoll_ctl(client->epfd, EPOLL_CTL_DEL, client->sockfd, NULL);
+    client->running = false;
+    if (notify && client->callbacks.on_disconnect) client->callbacks.on_disconnect(client, client->user_data);
+}
+
+/*
+Funcion que entrega los frames recibidos. Con compresión, los frames de un frame comprimido se inflan a
+client->inflated y se entregan antes que los que siguen en el socket.
+*/
+static void read_frames(chat_client_t *client) {
+    ssize_t n = client->shm ? shm_ring_fill(&client->shm->responses, &client->in) : frame_buffer_fill(&client->in, client->sockfd);
+    const uint8_t *payload;
+    size_t len;
+    bool invalid = false;
+    while (client->running) {
+        frame_buffer_t *from = &client->inflated;
+        if (!frame_buffer_next(from, &payload, &len)) {
+            int rc = client->compressed ? decompress_next(&client->in, &client->inflated) : 0;
+            if (rc < 0) {
+                invalid = true;
+                break;
+            }
+            if (rc > 0) continue;
+            from = &client->in;
+            if (!frame_buffer_next(from, &payload, &len)) break;
+        }
+        dispatch(client, payload, len);
+        frame_buffer_consume(from, FRAME_HEADER_SIZE + len);
+    }
+    invalid = invalid || (client->compressed ? decompress_invalid(&client->in) : frame_buffer_invalid(&client->in));
+    if (n == 0 || n == -1 || invalid) {
+        disconnect(client, true);
+    }
+}
+
+/*
+Funcion que envía todo lo que haya en el outbox sin bloquear; lo que el socket no acepta queda para EPOLLOUT.
+Retornos:
+    * int: 0 para exito y -1 si la conexión falló
+*/
+static int flush_outbox(chat_client_t *client) {
+    pthread_mutex_lock(&client->lock);
+    client->wake_pending = false;
+    size_t offset = 0;
+    int rc = 0;
+    while (offset < client->out_len) {
+        ssize_t n;
+        if (client->shm) {
+            // Lo que no cabe en el ring espera a space_fd
+            n = shm_ring_write(&client->shm->requests, client->out + offset, client->out_len - offset);
+            if (n < 0) rc = -1;
+            if (n <= 0) break;
+            offset += n;
+            continue;
+        }
+        n = send(client->sockfd, client->out + offset, client->out_len - offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) rc = -1;
+            break;
+        }
+        offset += n;
+    }
+    memmove(client->out, client->out + offset, client->out_len - offset);
+    client->out_len -= offset;
+
+    bool want_write = rc == 0 && client->out_len > 0;
+    if (want_write != client->want_write && !client->closed) {
+        // Con memoria compartida space_fd siempre está en epoll: basta con armar el doorbell antes de dormir
+        if (!client->shm) {
+            struct epoll_event ev = { .events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.fd = client->sockfd };
+            epoll_ctl(client->epfd, EPOLL_CTL_MOD, client->sockfd, &ev);
+        }
+        client->want_write = want_write;
+    }
+    pthread_mutex_unlock(&client->lock);
+    return rc;
+}
+
+/*
+Funcion que ejecuta el event loop en el thread actual hasta chat_client_stop o hasta que se cierre la conexión.
+Retornos:
+    * int: 0 si se detuvo con chat_client_stop y -1 si se perdió la conexión
+*/
+int chat_client_run(chat_client_t *client) {
+    struct epoll_event events[MAX_EVENTS];
+    if (!client->has_thread) client->running = true;
+
+    while (client->running) {
+        // Antes de dormir se avisa a los productores de los rings; si ya hay algo pendiente no se duerme
+        int timeout = -1;
+        if (client->shm && !shm_ring_arm_read(&client->shm->responses)) timeout = 0;
+        if (client->shm && client->want_write && !shm_ring_arm_write(&client->shm->requests)) timeout = 0;
+
+        int n = epoll_wait(client->epfd, events, MAX_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) break;
+        bool peer_closed = false;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == client->wakefd || (client->shm && (fd == client->shm->responses.data_fd || fd == client->shm->requests.space_fd))) {
+                uint64_t count;
+                ssize_t rc = read(fd, &count, sizeof(count));
+                (void)rc;
+            } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                if (client->shm) {
+                    peer_closed = true;
+                } else {
+                    read_frames(client);
+                }
+            }
+        }
+        if (client->shm && !client->closed) {
+            read_frames(client);
+            if (peer_closed) disconnect(client, true);
+        }
+        if (!client->closed && flush_outbox(client) != 0) {
+            disconnect(client, true);
+        }
+    }
+
+    pthread_mutex_lock(&client->lock);
+    bool closed = client->closed;
+    pthread_mutex_unlock(&client->lock);
+    return closed ? -1 : 0;
+}
+
+static void *loop_main(void *arg) {
+    chat_client_run((chat_client_t *)arg);
+    return NULL;
+}
+
+/*
+Funcion que ejecuta el event loop en un thread propio.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo crear el thread
+*/
+int chat_client_start(chat_client_t *client) {
+    client->running = true;
+    client->has_thread = true;
+    if (pthread_create(&client->thread, NULL, loop_main, client) != 0) {
+        client->running = false;
+        client->has_thread = false;
+        return -1;
+    }
+    return 0;
+}
+
+void chat_client_stop(chat_client_t *client) {
+    client->running = false;
+    wake_loop(client);
+}
+
+/*
+Funcion que detiene el loop, cierra la conexión y libera el cliente.
+Las solicitudes que seguían pendientes se completan con NULL.
+*/
+void chat_client_close(chat_client_t *client) {
+    chat_client_stop(client);
+    if (client->has_thread) pthread_join(client->thread, NULL);
+
+    // Lo que quedó encolado se intenta enviar antes de cerrar; un cierre voluntario también descarta la sesión
+    if (!client->closed && client->session.token[0]) {
+        Chat__Request request = CHAT__REQUEST__INIT;
+        request.operation = CHAT__OPERATION__UNREGISTER_USER;
+        outgoing_t outgoing = { .request = &request };
+        submit(client, PENDING_NONE, NULL, NULL, &outgoing);
+    }
+    if (!client->closed) flush_outbox(client);
+    disconnect(client, false);
+
+    close(client->sockfd);
+    if (client->shm) shm_conn_close(client->shm);
+    close(client->epfd);
+    close(client->wakefd);
+    frame_buffer_free(&client->in);
+    frame_buffer_free(&client->inflated);
+    free(client->out);
+    pthread_mutex_destroy(&client->lock);
+    free(client);
+}
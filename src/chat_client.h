@@ -0,0 +1,80 @@
+/*
+    * chat_client.h
+    * Reusable client library for the chat protocol, independent of the console UI.
+    * One non-blocking event loop per connection owns the socket: it reads every frame (nothing is stolen by
+    * synchronous receives), matches replies to the requests that are waiting for them and flushes all the
+    * queued requests with as few send calls as possible. Requests can be issued from any thread; callbacks
+    * run on the loop thread.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef CHAT_CLIENT_H
+#define CHAT_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "chat.pb-c.h"
+#include "codec.h"
+
+#define CHAT_CLIENT_MAX_OUTBOX (16 << 20)  // Bytes encolados sin enviar antes de rechazar solicitudes
+#define CHAT_SESSION_TOKEN_LEN 32
+#define CHAT_CLIENT_MAX_REDIRECTS 3  // Redirecciones de un servidor federado que se siguen al registrarse
+#define CHAT_STREAM_CHUNK_BYTES (16 * 1024)  // Datos por chunk de un stream, el máximo que acepta el servidor
+#define CHAT_CLIENT_MAX_INCOMING_STREAMS 64  // Streams entrantes que se siguen a la vez; los que no caben se ignoran
+
+typedef struct chat_client chat_client_t;
+
+/*
+Callback de una solicitud que espera respuesta (DM, estado, lista de usuarios, batch, multicast).
+response es NULL si la conexión se cerró antes de recibirla; solo es válido durante el callback.
+*/
+typedef void (*chat_reply_fn)(chat_client_t *client, uint64_t handle, const Chat__Response *response, void *arg);
+
+typedef struct {
+    // Mensaje entrante (broadcast o DM de otro usuario); los strings son vistas válidas durante el callback
+    void (*on_message)(chat_client_t *client, const codec_incoming_message_t *msg, void *user_data);
+    // Respuesta del servidor que no corresponde a ninguna solicitud pendiente (por ejemplo, el aviso de inactividad)
+    void (*on_notice)(chat_client_t *client, const Chat__Response *response, void *user_data);
+    // La conexión se cerró; después de esto las solicitudes retornan 0
+    void (*on_disconnect)(chat_client_t *client, void *user_data);
+    // Chunk de un stream entrante, en orden: START, DATA, END, o ABORT si se cortó (también cuando falta un chunk o
+    // se cae la conexión). chunk->data solo es válido durante el callback
+    void (*on_stream)(chat_client_t *client, const Chat__StreamChunk *chunk, void *user_data);
+} chat_callbacks_t;
+
+// Sesión reanudable: lo necesario para retomar la conversación con una conexión nueva si la anterior se cae
+typedef struct {
+    char token[CHAT_SESSION_TOKEN_LEN + 1];  // Vacío si el servidor no abrió una sesión
+    uint64_t last_sequence;  // Número del último mensaje entrante recibido
+    bool resumed;            // La conexión actual reanudó la sesión en lugar de empezar una nueva
+    uint64_t missed;         // Mensajes que ya no estaban en la ventana del servidor al reanudar
+} chat_session_t;
+
+chat_client_t *chat_client_resume(const char *address, int port, const char *username, const chat_session_t *session,
+                                  const chat_callbacks_t *callbacks, void *user_data, char *error, size_t error_len);
+void chat_client_session(const chat_client_t *client, chat_session_t *session);
+chat_client_t *chat_client_connect(const char *address, int port, const char *username, const chat_callbacks_t *callbacks,
+                                   void *user_data, char *error, size_t error_len);
+int chat_client_start(chat_client_t *client);
+int chat_client_run(chat_client_t *client);
+void chat_client_stop(chat_client_t *client);
+void chat_client_close(chat_client_t *client);
+const char *chat_client_username(const chat_client_t *client);
+
+uint64_t chat_client_broadcast(chat_client_t *client, const char *content);
+uint64_t chat_client_direct(chat_client_t *client, const char *recipient, const char *content, chat_reply_fn done, void *arg);
+uint64_t chat_client_send_batch(chat_client_t *client, const codec_send_message_t *messages, size_t count, chat_reply_fn done, void *arg);
+uint64_t chat_client_multicast(chat_client_t *client, const char *const *recipients, size_t count, const char *content,
+                               chat_reply_fn done, void *arg);
+uint64_t chat_client_set_status(chat_client_t *client, Chat__UserStatus status, chat_reply_fn done, void *arg);
+uint64_t chat_client_list_users(chat_client_t *client, const char *username, chat_reply_fn done, void *arg);
+uint64_t chat_client_memory_usage(chat_client_t *client, chat_reply_fn done, void *arg);
+
+uint32_t chat_client_stream_open(chat_client_t *client, const char *recipient, uint64_t total_size, chat_reply_fn done, void *arg);
+ssize_t chat_client_stream_write(chat_client_t *client, uint32_t stream_id, const void *data, size_t len);
+int chat_client_stream_close(chat_client_t *client, uint32_t stream_id);
+int chat_client_stream_abort(chat_client_t *client, uint32_t stream_id);
+
+#endif
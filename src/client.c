@@ -2,6 +2,7 @@
     * client.c
     * This file contains the client side of the chat application.
     * The client will be able to connect to the server, send messages, change status, view connected users, and see user information.
+    * The connection is handled by the chat_client library; this file is only the console interface.
     * @autors: Melissa Pérez, Fernanda Esquivel
 */
 
@@ -9,18 +10,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include "chat.pb-c.h"
 #include <pthread.h>
-#include <sys/select.h>
-#include <errno.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "chat.pb-c.h"
+#include "chat_client.h"
+#include "transport.h"
 
-#define BUFFER_SIZE 1024
 const char* status_names[] = {"ACTIVE", "BUSY", "OFFLINE"};
 
-// Variable global para controlar el thread de recepción
-volatile int keep_receiving = 1;
-int in_chatroom = 0;
+// Los mensajes entrantes solo se muestran dentro del chatroom
+volatile int in_chatroom = 0;
+
+// La conexión se cayó: se reanuda la sesión antes de la siguiente solicitud
+volatile int connection_lost = 0;
+#define RECONNECT_ATTEMPTS 10
+
+// Datos de la conexión, para reanudarla
+static const char *server_address;
+static int server_port;
+static const char *user_name;
+
+// Espera de la respuesta a una solicitud hecha desde el menú
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool done;
+    int result;
+} reply_wait_t;
 
 void menu() {
     printf("\n----------------------------------\n1. Enter the chatroom\n");
@@ -36,17 +53,20 @@ void chatroom_menu() {
     printf("\n------ Chatroom Menu ------\n");
     printf("1. Chat with everyone (broadcast)\n");
     printf("2. Send a direct message\n");
-    printf("3. Exit the chatroom\n");
+    printf("3. Send a file or a long text\n");
+    printf("4. Exit the chatroom\n");
     printf("----------------------------------\n");
 }
 
 /*
 Funcion que imprime el nombre de usuario y la dirección IP de un usuario.
 Parametros:
-    * char* full_username: nombre de usuario y dirección IP
+    * const char* full_username: nombre de usuario y dirección IP
 */
-void print_user_info(char* full_username) {
-    char* token = strtok(full_username, "@");
+void print_user_info(const char* full_username) {
+    char copy[64];
+    snprintf(copy, sizeof(copy), "%s", full_username);
+    char* token = strtok(copy, "@");
     if (token != NULL) {
         printf("\033[33mUser:\033[0m %s", token);  // Imprime el nombre del usuario
         token = strtok(NULL, "@");
@@ -56,316 +76,313 @@ void print_user_info(char* full_username) {
     }
 }
 
-/*
-Funcion que envía un mensaje de broadcast al servidor.
-Parametros:
-    * int sockfd: socket descriptor
-    * const char *message: mensaje a enviar
-*/
-void send_broadcast_message(int sockfd, const char *message) {
-    Chat__Request request = CHAT__REQUEST__INIT;
-    request.operation = CHAT__OPERATION__SEND_MESSAGE;
-    Chat__SendMessageRequest send_message_request = CHAT__SEND_MESSAGE_REQUEST__INIT;
-    send_message_request.recipient = ""; // Campo vacío para broadcast
-    send_message_request.content = (char *)message;
-    request.send_message = &send_message_request;
-    request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MESSAGE;
-
-    size_t len = chat__request__get_packed_size(&request);
-    uint8_t *buffer = malloc(len);
-    chat__request__pack(&request, buffer);
-
-    send(sockfd, buffer, len, 0);
-    free(buffer);
+static const char *user_status_name(Chat__UserStatus status) {
+    return status >= 0 && status <= 2 ? status_names[status] : "UNKNOWN";
+}
+
+void print_incoming_message(const codec_incoming_message_t *msg) {
+    if (msg->type == CHAT__MESSAGE_TYPE__DIRECT) {
+        printf("\033[1m\033[36m\n\tDIRECT [%.*s]:\033[0m %.*s\n", (int)msg->sender.len, msg->sender.data, (int)msg->content.len, msg->content.data);
+    } else {
+        printf("\033[1m\033[35m\n\tBROADCAST [%.*s]:\033[0m %.*s\n", (int)msg->sender.len, msg->sender.data, (int)msg->content.len, msg->content.data);
+    }
+}
+
+static void on_message(chat_client_t *client, const codec_incoming_message_t *msg, void *user_data) {
+    (void)client;
+    (void)user_data;
+    if (in_chatroom) print_incoming_message(msg);
+}
+
+static void on_notice(chat_client_t *client, const Chat__Response *response, void *user_data) {
+    (void)client;
+    (void)user_data;
+    if (response->message && strlen(response->message) > 0) {
+        printf("\n%s\n", response->message);
+    }
 }
 
-void register_user(int sockfd, const char *username) {
-    Chat__Request request = CHAT__REQUEST__INIT;
-    request.operation = CHAT__OPERATION__REGISTER_USER;
-    Chat__NewUserRequest new_user_request = CHAT__NEW_USER_REQUEST__INIT;
-    new_user_request.username = (char *)username;
-    request.register_user = &new_user_request;
-    request.payload_case = CHAT__REQUEST__PAYLOAD_REGISTER_USER;
-
-    size_t len = chat__request__get_packed_size(&request);
-    uint8_t *buffer = malloc(len);
-    chat__request__pack(&request, buffer);
-
-    send(sockfd, buffer, len, 0);
-    free(buffer);
-    //printf("Registration request sent for username '%s'.\n", username);
+static void on_disconnect(chat_client_t *client, void *user_data) {
+    (void)client;
+    (void)user_data;
+    printf("\n\033[31mConnection to the server lost.\033[0m\n");
+    connection_lost = 1;
 }
 
+// El contenido de un stream se muestra a medida que llega
+static void on_stream(chat_client_t *client, const Chat__StreamChunk *chunk, void *user_data) {
+    (void)client;
+    (void)user_data;
+    if (!in_chatroom) return;
+    const char *kind = chunk->type == CHAT__MESSAGE_TYPE__DIRECT ? "DIRECT" : "BROADCAST";
+    if (chunk->phase == CHAT__STREAM_PHASE__STREAM_START) {
+        printf("\033[1m\033[33m\n\t%s STREAM [%s]", kind, chunk->sender);
+        if (chunk->total_size > 0) printf(" (%llu bytes)", (unsigned long long)chunk->total_size);
+        printf(":\033[0m\n");
+    }
+    fwrite(chunk->data.data, 1, chunk->data.len, stdout);
+    if (chunk->phase == CHAT__STREAM_PHASE__STREAM_END) {
+        printf("\n\033[33m\t--- end of stream from %s ---\033[0m\n", chunk->sender);
+    } else if (chunk->phase == CHAT__STREAM_PHASE__STREAM_ABORT) {
+        printf("\n\033[31m\t--- stream from %s interrupted ---\033[0m\n", chunk->sender);
+    }
+    fflush(stdout);
+}
+
+static chat_callbacks_t callbacks = { on_message, on_notice, on_disconnect, on_stream };
+
 /*
-Funcion que envìa una solicitud para obtener la lista de los usuarios conectados, la procesa e imprime la respuesta del servidor.
+Funcion que reanuda la sesión si la conexión se cayó; los mensajes que llegaron mientras tanto se reciben
+como si nada hubiera pasado. Si no se logra (el servidor no vuelve o la sesión expiró) el programa termina.
 Parametros:
-    * int sockfd: socket descriptor para comunicarse con el servidor
-Retornos:
-    * int: codigo de estado; 0 para exito y -1 para fallas
+    * chat_client_t **client: cliente actual; se reemplaza por el de la conexión nueva
 */
-int request_user_list(int sockfd) {
-    Chat__Request request = CHAT__REQUEST__INIT;
-    request.operation = CHAT__OPERATION__GET_USERS;
-    request.payload_case = CHAT__REQUEST__PAYLOAD_GET_USERS;
-
-    size_t len = chat__request__get_packed_size(&request);
-    uint8_t *buffer = malloc(len);
-    chat__request__pack(&request, buffer);
-
-    send(sockfd, buffer, len, 0);
-    free(buffer);
-
-    // Recibir y procesar la respuesta
-    uint8_t response_buffer[BUFFER_SIZE];
-    len = recv(sockfd, response_buffer, BUFFER_SIZE, 0);
-    if (len > 0) {
-        Chat__Response *response = chat__response__unpack(NULL, len, response_buffer);
-        if (response) {
-            if (response->status_code == CHAT__STATUS_CODE__BAD_REQUEST) {
-                fprintf(stderr, "Error: %s\n", response->message);
-                chat__response__free_unpacked(response, NULL);
-                return -1;
-            }
-            if (response->result_case == CHAT__RESPONSE__RESULT_USER_LIST) {
-                Chat__UserListResponse *user_list = response->user_list;
-                printf("\nConnected Users:\n");
-                for (size_t i = 0; i < user_list->n_users; i++) {
-                    //printf("User: %s, Status: %d\n", user_list->users[i]->username, user_list->users[i]->status);
-                    print_user_info(user_list->users[i]->username);
-                    printf("\033[32m\tStatus:\033[0m %s\n", status_names[user_list->users[i]->status]);   // Imprime el estado del usuario
-                }
-                chat__response__free_unpacked(response, NULL);
-                return 0;  // Success
-            }
-            chat__response__free_unpacked(response, NULL);
+void ensure_connected(chat_client_t **client) {
+    if (!connection_lost) return;
+    chat_session_t session;
+    chat_client_session(*client, &session);
+    chat_client_close(*client);
+
+    char error[256] = "no session to resume";
+    for (int attempt = 0; attempt < RECONNECT_ATTEMPTS && session.token[0]; attempt++) {
+        if (attempt > 0) sleep(1);
+        connection_lost = 0;
+        chat_client_t *next = chat_client_resume(server_address, server_port, user_name, &session, &callbacks, NULL, error, sizeof(error));
+        if (!next) continue;
+        if (chat_client_start(next) != 0) {
+            chat_client_close(next);
+            break;
         }
-    } else if (len == 0) {
-        printf("Server closed the connection.\n");
-        return -1;
-    } else {
-        perror("recv failed");
-        return -1;
+        chat_session_t resumed;
+        chat_client_session(next, &resumed);
+        printf("\033[32mSession resumed.\033[0m\n");
+        if (resumed.missed > 0) printf("\033[33m%lu messages were lost while disconnected.\033[0m\n", (unsigned long)resumed.missed);
+        *client = next;
+        return;
     }
-    return 0;
+    fprintf(stderr, "Could not reconnect: %s\n", error);
+    exit(1);
 }
 
-/*
-Funcion que envia una solicitud al servidor para actualizar el estado del usuario.
-Parametros: 
-    * int sockfd: socket descriptor
-    * const char *username: usuario al que se le actualiza el estado
-    * Chat__UserStatus new_status: nuevo estatu a aplicar
-*/
-void update_status(int sockfd, const char *username, Chat__UserStatus new_status) {
-    Chat__Request request = CHAT__REQUEST__INIT;
-    request.operation = CHAT__OPERATION__UPDATE_STATUS;
-    Chat__UpdateStatusRequest update_status_request = CHAT__UPDATE_STATUS_REQUEST__INIT;
-    update_status_request.username = (char *)username;
-    update_status_request.new_status = new_status;
-    request.update_status = &update_status_request;
-    request.payload_case = CHAT__REQUEST__PAYLOAD_UPDATE_STATUS;
-
-    size_t len = chat__request__get_packed_size(&request);
-    uint8_t *buffer = malloc(len);
-    chat__request__pack(&request, buffer);
-    send(sockfd, buffer, len, 0);
-    free(buffer);
+void reply_wait_init(reply_wait_t *wait) {
+    pthread_mutex_init(&wait->mutex, NULL);
+    pthread_cond_init(&wait->cond, NULL);
+    wait->done = false;
+    wait->result = -1;
+}
+
+void reply_wait_finish(reply_wait_t *wait, int result) {
+    pthread_mutex_lock(&wait->mutex);
+    wait->result = result;
+    wait->done = true;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->mutex);
 }
 
 /*
-Funcion que limpia un buffer de bytes.
+Funcion que espera a que el event loop complete una solicitud.
 Parametros:
-    * uint8_t *buffer: buffer a limpiar
-    * size_t size: tamaño del buffer
+    * uint64_t handle: handle de la solicitud (0 si no se pudo encolar)
+Retornos:
+    * int: resultado que dejó el callback; -1 si la solicitud no se envió
 */
-void clear_buffer(uint8_t *buffer, size_t size) {
-    memset(buffer, 0, size);
+int reply_wait(reply_wait_t *wait, uint64_t handle) {
+    if (handle != 0) {
+        pthread_mutex_lock(&wait->mutex);
+        while (!wait->done) pthread_cond_wait(&wait->cond, &wait->mutex);
+        pthread_mutex_unlock(&wait->mutex);
+    }
+    pthread_mutex_destroy(&wait->mutex);
+    pthread_cond_destroy(&wait->cond);
+    return handle != 0 ? wait->result : -1;
 }
 
 /*
-Funcion que maneja errores en la recepción de mensajes.
-Parametros:
-    * int len: longitud del mensaje recibido
-Retornos:
-    * int: codigo de estado; 0 para no errores y -1 para sí el server cerro la conexión o hubo un error
+Funcion que procesa la respuesta a la lista de los usuarios conectados e imprime la respuesta del servidor.
+Retornos (en wait->result):
+    * int: codigo de estado; 0 para exito y -1 para fallas
 */
-int handle_recv_errors(int len) {
-    if (len == 0) {
-        printf("Server closed the connection.\n");
-        return -1;
-    } else if (len < 0) {
-        perror("recv failed");
-        return -1;
+static void user_list_done(chat_client_t *client, uint64_t handle, const Chat__Response *response, void *arg) {
+    (void)client;
+    (void)handle;
+    int result = -1;
+    if (response && response->status_code == CHAT__STATUS_CODE__OK && response->result_case == CHAT__RESPONSE__RESULT_USER_LIST) {
+        Chat__UserListResponse *user_list = response->user_list;
+        printf("\nConnected Users:\n");
+        for (size_t i = 0; i < user_list->n_users; i++) {
+            print_user_info(user_list->users[i]->username);
+            printf("\033[32m\tStatus:\033[0m %s\n", user_status_name(user_list->users[i]->status));   // Imprime el estado del usuario
+        }
+        result = 0;
+    } else if (response) {
+        fprintf(stderr, "Error: %s\n", response->message);
     }
-    return 0;
+    reply_wait_finish(arg, result);
 }
 
 /*
-Funcion que recibe mensajes del servidor y los imprime en la consola.
-Parametros:
-    * void *sockfd_ptr: puntero al descriptor del socket
-Retornos:
-    * void: puntero nulo
+Funcion que maneja la respuesta del servidor a una solicitud de información del usuario, imprimiendo detalles o un mensaje de error.
+Retornos (en wait->result):
+    * int: codigo de estado; 0 usuario encontrado y -1 para lo contrario
 */
-void *receive_messages(void *sockfd_ptr) {
-    int sockfd = *(int *)sockfd_ptr;
-    fd_set readfds;
-    uint8_t buffer[1024];
-    char formatted_message[1024];
-
-    while (keep_receiving) {
-        FD_ZERO(&readfds);
-        FD_SET(sockfd, &readfds);
-
-        struct timeval tv;
-        tv.tv_sec = 1;  // Espera de 1 segundo
-        tv.tv_usec = 0; // 0 milisegundos
-
-        int result = select(sockfd + 1, &readfds, NULL, NULL, &tv);
-
-        if (result > 0 && FD_ISSET(sockfd, &readfds)) {
-            clear_buffer(buffer, sizeof(buffer));
-            int len = recv(sockfd, buffer, sizeof(buffer), 0);
-            if (len > 0) {
-                Chat__Response *response = chat__response__unpack(NULL, len, buffer);
-                if (response) {
-                    if (in_chatroom && response->result_case == CHAT__RESPONSE__RESULT_INCOMING_MESSAGE) {
-                        Chat__IncomingMessageResponse *msg = response->incoming_message;
-                        if (msg->type == CHAT__MESSAGE_TYPE__DIRECT) {
-                            snprintf(formatted_message, sizeof(formatted_message), "\033[1m\033[36m\n\tDIRECT [%s]:\033[0m %s", msg->sender, msg->content);
-                        } else {
-                            snprintf(formatted_message, sizeof(formatted_message), "\033[1m\033[35m\n\tBROADCAST [%s]:\033[0m %s", msg->sender, msg->content);
-                        }
-                        printf("%s\n", formatted_message);
-                    }
-                    chat__response__free_unpacked(response, NULL);
-                }
-            } else if (len == 0) {
-                printf("Server closed the connection.\n");
-                break;
-            } else if (len < 0) {
-                perror("recv failed");
-                break;
+static void user_info_done(chat_client_t *client, uint64_t handle, const Chat__Response *response, void *arg) {
+    (void)client;
+    (void)handle;
+    int result = -1;
+    if (response && response->status_code == CHAT__STATUS_CODE__OK && response->result_case == CHAT__RESPONSE__RESULT_USER_LIST) {
+        Chat__UserListResponse *user_list = response->user_list;
+        if (user_list->n_users > 0) {
+            print_user_info(user_list->users[0]->username);
+            for (size_t i = 0; i < user_list->n_users; i++) {
+                printf("\033[32m\tStatus:\033[0m %s\n", user_status_name(user_list->users[i]->status));
             }
-        } else if (result == 0) {
-            // Timeout: No data available within 1 second
-            continue;
+            result = 0;
         }
+    } else if (response) {
+        printf("Error: %s\n", response->message);
     }
+    reply_wait_finish(arg, result);
+}
 
-    return NULL;
+static void status_done(chat_client_t *client, uint64_t handle, const Chat__Response *response, void *arg) {
+    (void)client;
+    (void)handle;
+    if (response) printf("Received server response: %s\n", response->message);
+    bool ok = response && response->status_code != CHAT__STATUS_CODE__BAD_REQUEST;
+    if (response && !ok) fprintf(stderr, "Error: %s\n", response->message);
+    reply_wait_finish(arg, ok ? 0 : -1);
 }
 
+// La confirmación de un DM (o el error del servidor) se muestra igual que un mensaje entrante
+static void direct_done(chat_client_t *client, uint64_t handle, const Chat__Response *response, void *arg) {
+    (void)client;
+    (void)handle;
+    (void)arg;
+    if (in_chatroom && response && response->result_case == CHAT__RESPONSE__RESULT_INCOMING_MESSAGE) {
+        codec_incoming_message_t msg = {
+            .status_code = response->status_code,
+            .sender = codec_str(response->incoming_message->sender),
+            .content = codec_str(response->incoming_message->content),
+            .type = response->incoming_message->type
+        };
+        print_incoming_message(&msg);
+    }
+}
 
+/*
+Funcion que lee un mensaje de una línea. Una línea que no cabe se descarta completa en lugar de mandarse partida;
+al terminar la entrada se lee "/exit".
+Retornos:
+    * bool: true si se leyó la línea, false si era demasiado larga
+*/
+static bool read_message(char *message, size_t size) {
+    if (!fgets(message, size, stdin)) {
+        snprintf(message, size, "/exit");
+        return true;
+    }
+    if (strchr(message, '\n') == NULL && strlen(message) == size - 1) {
+        int c;
+        while ((c = getchar()) != '\n' && c != EOF) { }
+        printf("\033[31mMessage too long, send it as a stream (option 3).\033[0m\n");
+        return false;
+    }
+    message[strcspn(message, "\n")] = 0;
+    return true;
+}
 
 /*
-Funcion que envía un mensaje directo a un usuario específico.
-Parametros:
-    * int sockfd: socket descriptor
-    * const char *recipient: destinatario del mensaje
-    * const char *message: mensaje a enviar
+Funcion que muestra el resultado de un stream enviado, cuando el servidor confirma el final o lo detiene.
+Retornos (en wait->result):
+    * int: 0 si el stream llegó completo y -1 para lo contrario
 */
-void send_direct_message(int sockfd, const char *recipient, const char *message) {
-    Chat__Request request = CHAT__REQUEST__INIT;
-    request.operation = CHAT__OPERATION__SEND_MESSAGE;
-    Chat__SendMessageRequest send_message_request = CHAT__SEND_MESSAGE_REQUEST__INIT;
-    send_message_request.recipient = (char *)recipient;  // Especificar destinatario
-    send_message_request.content = (char *)message;
-    request.send_message = &send_message_request;
-    request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MESSAGE;
-
-    size_t len = chat__request__get_packed_size(&request);
-    uint8_t *buffer = malloc(len);
-    chat__request__pack(&request, buffer);
-
-    send(sockfd, buffer, len, 0);
-    free(buffer);
+static void stream_done(chat_client_t *client, uint64_t handle, const Chat__Response *response, void *arg) {
+    (void)client;
+    (void)handle;
+    bool ok = response && response->status_code == CHAT__STATUS_CODE__OK &&
+              response->stream->phase == CHAT__STREAM_PHASE__STREAM_END;
+    if (ok) {
+        printf("\033[32mStream sent (%llu bytes).\033[0m\n", (unsigned long long)response->stream->offset);
+    } else if (response && response->status_code == CHAT__STATUS_CODE__OK) {
+        printf("Stream cancelled.\n");
+    } else if (response) {
+        fprintf(stderr, "Error: %s\n", response->message);
+    }
+    reply_wait_finish(arg, ok ? 0 : -1);
 }
 
 /*
-Funcion que maneja la respuesta del servidor a una solicitud de información del usuario, imprimiendo detalles o un mensaje de error.
-Parametros:
-    * int sockfd: socket descriptor
+Funcion que encola todo un bloque de un stream, esperando mientras el outbox esté lleno.
 Retornos:
-    * int: codigo de estado; 0 usuario encontrado y -1 para lo contrario
+    * int: 0 para exito y -1 si el stream ya terminó
 */
-int receive_user_info_response(int sockfd) {
-    uint8_t buffer[BUFFER_SIZE];
-    clear_buffer(buffer, BUFFER_SIZE);
-    int len = recv(sockfd, buffer, BUFFER_SIZE, 0);
-    if (len > 0) {
-        Chat__Response *response = chat__response__unpack(NULL, len, buffer);
-        if (response && response->status_code == CHAT__STATUS_CODE__OK && response->result_case == CHAT__RESPONSE__RESULT_USER_LIST) {
-            Chat__UserListResponse *user_list = response->user_list;
-            if (user_list->n_users > 0) {
-                print_user_info(user_list->users[0]->username);
-                //printf("Status: %d\n", user_list->users[0]->status);
-                for (size_t i = 0; i < user_list->n_users; i++) {
-                    printf("\033[32m\tStatus:\033[0m %s\n", status_names[user_list->users[i]->status]);
-                }
-            } else {
-                printf("No user found.\n");
-                return -1;
-            }
-            chat__response__free_unpacked(response, NULL);
-            return 0;
-        } else {
-            printf("Error: %s\n", response->message);
-            chat__response__free_unpacked(response, NULL);
-            return -1;
-        }
+static int stream_write_all(chat_client_t *client, uint32_t stream_id, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = chat_client_stream_write(client, stream_id, data, len);
+        if (n < 0) return -1;
+        if (n == 0) usleep(1000);
+        data += n;
+        len -= n;
     }
-    return handle_recv_errors(len);
+    return 0;
 }
 
-int receive_server_response(int sockfd) {
-    uint8_t buffer[BUFFER_SIZE];
-    int len = recv(sockfd, buffer, BUFFER_SIZE, 0);
-    if (len > 0) {
-        Chat__Response *response = chat__response__unpack(NULL, len, buffer);
-        if (response) {
-            printf("Received server response: %s\n", response->message);
-            if (response->status_code == CHAT__STATUS_CODE__BAD_REQUEST) {
-                fprintf(stderr, "Error: %s\n", response->message);
-                chat__response__free_unpacked(response, NULL);
-                return -1;
-            }
-
-            if (response->result_case == CHAT__RESPONSE__RESULT_USER_LIST) {
-                Chat__UserListResponse *user_list = response->user_list;
-                printf("\nConnected Users:\n");
-                for (size_t i = 0; i < user_list->n_users; i++) {
-                    print_user_info(user_list->users[i]->username);
-                    printf("\033[32m\tStatus:\033[0m %s\n", status_names[user_list->users[i]->status]);
-                }
-                chat__response__free_unpacked(response, NULL);
-                return 0;
-            }
+/*
+Funcion que envía un archivo, o texto pegado en la consola, como un stream: sin el límite de un mensaje normal.
+El texto pegado termina con una línea que solo tiene un punto.
+Parametros:
+    * const char *recipient: destinatario, vacío para todos
+*/
+void send_stream(chat_client_t **client, const char *recipient) {
+    char path[256];
+    printf("\033[33mFile to send (empty to paste text, end it with a line with only a dot):\033[0m ");
+    fgets(path, sizeof(path), stdin);
+    path[strcspn(path, "\n")] = 0;
+    FILE *in = stdin;
+    uint64_t total_size = 0;
+    if (path[0]) {
+        in = fopen(path, "rb");
+        if (!in) {
+            perror(path);
+            return;
+        }
+        struct stat st;
+        if (fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode)) total_size = st.st_size;
+    }
 
-            chat__response__free_unpacked(response, NULL);
-            return 0;
+    ensure_connected(client);
+    reply_wait_t wait;
+    reply_wait_init(&wait);
+    uint32_t stream_id = chat_client_stream_open(*client, recipient, total_size, stream_done, &wait);
+    bool failed = stream_id == 0;
+    char buffer[CHAT_STREAM_CHUNK_BYTES];
+    if (in != stdin) {
+        size_t n;
+        while (!failed && (n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            failed = stream_write_all(*client, stream_id, buffer, n) != 0;
         }
-    } else if (len == 0) {
-        printf("Server closed the connection.\n");
-        return -1;
+        failed = failed || ferror(in);
+        fclose(in);
     } else {
-        perror("recv failed");
-        return -1;
+        // Aunque el stream falle se siguen leyendo las líneas pegadas, para que no terminen en el menú
+        while (fgets(buffer, sizeof(buffer), stdin) && strcmp(buffer, ".\n") != 0 && strcmp(buffer, ".") != 0) {
+            if (!failed) failed = stream_write_all(*client, stream_id, buffer, strlen(buffer)) != 0;
+        }
+    }
+    if (stream_id != 0) {
+        if (failed) {
+            chat_client_stream_abort(*client, stream_id);
+        } else {
+            chat_client_stream_close(*client, stream_id);
+        }
     }
+    if (reply_wait(&wait, stream_id) != 0 && stream_id == 0) printf("Failed to start the stream.\n");
 }
 
-void enter_chatroom(int sockfd) {
-    keep_receiving = 1; // Habilita la recepción de mensajes
+void enter_chatroom(chat_client_t **client) {
     in_chatroom = 1;
 
-    pthread_t recv_thread;
-    if (pthread_create(&recv_thread, NULL, receive_messages, (void *)&sockfd) != 0) {
-        fprintf(stderr, "Failed to create thread for receiving messages.\n");
-        return;
-    }
-
     int option;
-    char message[256];
+    char message[1024];
     do {
         chatroom_menu();
         printf("Select an option: ");
@@ -377,10 +394,10 @@ void enter_chatroom(int sockfd) {
                 printf("\n\033[4m\033[95mBROADCAST MESSAGE\033[0m\n");
                 do {
                     printf("\033[34mMessage: \033[0m");
-                    fgets(message, sizeof(message), stdin);
-                    message[strcspn(message, "\n")] = 0;
+                    if (!read_message(message, sizeof(message))) continue;
                     if (strcmp(message, "/exit") == 0) break;
-                    send_broadcast_message(sockfd, message);
+                    ensure_connected(client);
+                    chat_client_broadcast(*client, message);
                 } while (1);
                 break;
             case 2:
@@ -391,62 +408,62 @@ void enter_chatroom(int sockfd) {
                 recipient[strcspn(recipient, "\n")] = 0;
                 do {
                     printf("\033[34mMessage:\033[0m ");
-                    fgets(message, sizeof(message), stdin);
-                    message[strcspn(message, "\n")] = 0;
+                    if (!read_message(message, sizeof(message))) continue;
                     if (strcmp(message, "/exit") == 0) break;
 
-                    send_direct_message(sockfd, recipient, message);
+                    ensure_connected(client);
+                    chat_client_direct(*client, recipient, message, direct_done, NULL);
                 } while (1);
                 break;
             case 3:
+                printf("\n\033[4m\033[93mSTREAM\033[0m\n");
+                printf("\033[33mUsername to send it to (empty for everyone):\033[0m ");
+                char stream_recipient[32];
+                fgets(stream_recipient, sizeof(stream_recipient), stdin);
+                stream_recipient[strcspn(stream_recipient, "\n")] = 0;
+                send_stream(client, stream_recipient);
+                break;
+            case 4:
                 printf("Exiting chatroom...\n");
                 break;
             default:
                 printf("Invalid option. Please try again.\n");
                 break;
         }
-    } while (option != 3);
+    } while (option != 4);
 
-    keep_receiving = 0; // Deshabilita la recepción de mensajes
     in_chatroom = 0;
-    pthread_join(recv_thread, NULL); // Espera a que el thread termine correctamente
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <username> <server_ip> <server_port>\n", argv[0]);
+    // Con un socket Unix ("unix:/ruta", "unix:@nombre" o lo mismo con "shm:") el puerto no hace falta
+    if (argc != 4 && !(argc == 3 && (transport_is_unix(argv[2]) || transport_is_shm(argv[2])))) {
+        fprintf(stderr, "Usage: %s <username> <server_ip> <server_port>\n       %s <username> unix:<path|@name>|shm:<path|@name>\n", argv[0], argv[0]);
         exit(1);
     }
 
     const char *username = argv[1];
     const char *server_ip = argv[2];
-    int port = atoi(argv[3]);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    struct sockaddr_in serv_addr = {0};
-
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    inet_pton(AF_INET, server_ip, &serv_addr.sin_addr);
-
-    if (connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
-        perror("Connect failed");
-        exit(1);
-    }
-
-    register_user(sockfd, username);
-    if (receive_server_response(sockfd) != 0) {
-        close(sockfd);
+    int port = argc == 4 ? atoi(argv[3]) : 0;
+    server_address = server_ip;
+    server_port = port;
+    user_name = username;
+
+    // La sesión es reanudable: si la conexión se cae se recupera sin perder mensajes
+    char error[256];
+    chat_client_t *client = chat_client_resume(server_ip, port, username, NULL, &callbacks, NULL, error, sizeof(error));
+    if (!client) {
+        fprintf(stderr, "Error: %s\n", error);
         return 1;
     }
 
     printf("\nRegistered as \033[1m\033[33m%s.\033[1m\033[34m Welcome to the chat!\033[0m\n", username);
 
-    // Creación del thread para recibir mensajes
-    pthread_t recv_thread;
-    if (pthread_create(&recv_thread, NULL, receive_messages, (void *)&sockfd) != 0) {
+    // El event loop de la conexión corre en su propio thread
+    if (chat_client_start(client) != 0) {
         fprintf(stderr, "Failed to create thread for receiving messages.\n");
-    } else {
-        pthread_detach(recv_thread);
+        chat_client_close(client);
+        return 1;
     }
 
     while (1) {
@@ -455,10 +472,11 @@ int main(int argc, char *argv[]) {
         int option;
         scanf("%d", &option);
         getchar();
+        ensure_connected(&client);
 
         switch (option) {
             case 1:
-                enter_chatroom(sockfd);
+                enter_chatroom(&client);
                 break;
             case 2:
                 // Change status
@@ -467,8 +485,9 @@ int main(int argc, char *argv[]) {
                 scanf("%d", &new_status);
                 char* status_names[] = {"ONLINE", "BUSY", "OFFLINE"};
                 if (new_status >= 0 && new_status <= 2) {
-                    update_status(sockfd, username, new_status);
-                    if (receive_server_response(sockfd) == 0) {
+                    reply_wait_t wait;
+                    reply_wait_init(&wait);
+                    if (reply_wait(&wait, chat_client_set_status(client, new_status, status_done, &wait)) == 0) {
                         printf("\nStatus updated to %s.\n", status_names[new_status]);
                     } else {
                         printf("\nFailed to update status.\n");
@@ -480,22 +499,9 @@ int main(int argc, char *argv[]) {
             case 3:
                 // Solicitar la lista de usuarios conectados
                 {
-                    Chat__UserListRequest user_list_request = CHAT__USER_LIST_REQUEST__INIT;
-                    user_list_request.username = NULL;  // Solicitar todos los usuarios
-
-                    Chat__Request request = CHAT__REQUEST__INIT;
-                    request.operation = CHAT__OPERATION__GET_USERS;
-                    request.get_users = &user_list_request;
-                    request.payload_case = CHAT__REQUEST__PAYLOAD_GET_USERS;
-
-                    size_t len = chat__request__get_packed_size(&request);
-                    uint8_t *buffer = malloc(len);
-                    chat__request__pack(&request, buffer);
-
-                    send(sockfd, buffer, len, 0);
-                    free(buffer);
-
-                    if (receive_server_response(sockfd) != 0) {
+                    reply_wait_t wait;
+                    reply_wait_init(&wait);
+                    if (reply_wait(&wait, chat_client_list_users(client, NULL, user_list_done, &wait)) != 0) {
                         printf("Failed to fetch user list.\n");
                     }
                 }
@@ -508,23 +514,9 @@ int main(int argc, char *argv[]) {
                     fgets(username, sizeof(username), stdin);
                     username[strcspn(username, "\n")] = 0; // Remove newline character
 
-                    Chat__UserListRequest user_info_request = CHAT__USER_LIST_REQUEST__INIT;
-                    user_info_request.username = username; // Specify the user
-
-                    Chat__Request request = CHAT__REQUEST__INIT;
-                    request.operation = CHAT__OPERATION__GET_USERS;
-                    request.payload_case = CHAT__REQUEST__PAYLOAD_GET_USERS;
-                    request.get_users = &user_info_request;
-
-                    size_t len = chat__request__get_packed_size(&request);
-                    uint8_t *buffer = malloc(len);
-                    chat__request__pack(&request, buffer);
-
-                    send(sockfd, buffer, len, 0);
-                    free(buffer);
-
-                    // Call the function to receive and process the response from the server
-                    if (receive_user_info_response(sockfd) != 0) {
+                    reply_wait_t wait;
+                    reply_wait_init(&wait);
+                    if (reply_wait(&wait, chat_client_list_users(client, username, user_info_done, &wait)) != 0) {
                         printf("No user found with the username '%s'.\n", username);
                     }
                 }
@@ -535,7 +527,7 @@ int main(int argc, char *argv[]) {
                 break;
             case 6:
                 // Exit the chat
-                close(sockfd);
+                chat_client_close(client);
                 printf("\nDisconnected from server.\n");
                 exit(0);
             default:
@@ -544,6 +536,6 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    close(sockfd);
+    chat_client_close(client);
     return 0;
 }
@@ -0,0 +1,512 @@
+/*
+    * codec.c
+    * Implementation of the native codec for SendMessageRequest and IncomingMessageResponse.
+    * Field numbers and wire types follow chat.proto; fields are written in field-number order and proto3
+    * defaults are omitted, exactly like protobuf-c, so both codecs produce and accept the same bytes.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <string.h>
+#include "codec.h"
+
+#define WIRE_VARINT 0
+#define WIRE_64BIT 1
+#define WIRE_LENGTH 2
+#define WIRE_32BIT 5
+
+#define TAG(field, wire) (((field) << 3) | (wire))
+
+// Números de campo de chat.proto
+#define REQUEST_OPERATION 1
+#define REQUEST_REGISTER_USER 2
+#define REQUEST_SEND_MESSAGE 3
+#define REQUEST_SEND_MESSAGE_BATCH 7
+#define REQUEST_SEND_MULTICAST 8
+#define SEND_MESSAGE_RECIPIENT 1
+#define SEND_MESSAGE_CONTENT 2
+#define BATCH_MESSAGES 1
+#define RESPONSE_OPERATION 1
+#define RESPONSE_STATUS_CODE 2
+#define RESPONSE_MESSAGE 3
+#define RESPONSE_USER_LIST 4
+#define RESPONSE_INCOMING_MESSAGE 5
+#define RESPONSE_DELIVERY_REPORT 6
+#define RESPONSE_SESSION 7
+#define RESPONSE_SEQUENCE 8
+#define RESPONSE_MEMORY 9
+#define RESPONSE_REDIRECT 10
+#define INCOMING_SENDER 1
+#define INCOMING_CONTENT 2
+#define INCOMING_TYPE 3
+#define NODE_BATCH_EVENTS 1
+#define NODE_EVENT_TYPE 1
+#define NODE_EVENT_NODE_ID 2
+#define NODE_EVENT_USERNAME 3
+#define NODE_EVENT_STATUS 4
+#define NODE_EVENT_SENDER 5
+#define NODE_EVENT_CONTENT 6
+#define NODE_EVENT_CLIENT_PORT 7
+#define NODE_EVENT_SESSION_TOKEN 8
+#define NODE_EVENT_NEXT_SEQUENCE 9
+#define NODE_EVENT_REPLAY_FIRST 10
+#define NODE_EVENT_REPLAY 11
+
+// Valores de Operation usados por el codec
+#define OPERATION_SEND_MESSAGE 1
+#define OPERATION_INCOMING_MESSAGE 5
+#define OPERATION_SEND_MESSAGE_BATCH 6
+
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} reader_t;
+
+codec_str_t codec_str(const char *s) {
+    codec_str_t view = { s ? s : "", s ? strlen(s) : 0 };
+    return view;
+}
+
+bool codec_str_equals(codec_str_t view, const char *s) {
+    return strlen(s) == view.len && memcmp(s, view.data, view.len) == 0;
+}
+
+const char *codec_kind_name(codec_kind_t kind) {
+    return kind == CODEC_NATIVE ? "native" : "protobuf-c";
+}
+
+int codec_kind_parse(const char *name, codec_kind_t *kind) {
+    if (strcmp(name, "native") == 0) {
+        *kind = CODEC_NATIVE;
+    } else if (strcmp(name, "protobuf-c") == 0 || strcmp(name, "protobuf") == 0) {
+        *kind = CODEC_PROTOBUF_C;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static bool read_varint(reader_t *r, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && r->pos < r->end; shift += 7) {
+        uint8_t byte = *r->pos++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Lee un campo de longitud variable y deja el sub-lector apuntando a su contenido
+static bool read_length(reader_t *r, reader_t *sub) {
+    uint64_t len;
+    if (!read_varint(r, &len) || len > (uint64_t)(r->end - r->pos)) return false;
+    sub->pos = r->pos;
+    sub->end = r->pos + len;
+    r->pos += len;
+    return true;
+}
+
+static bool read_string(reader_t *r, codec_str_t *view) {
+    reader_t sub;
+    if (!read_length(r, &sub)) return false;
+    view->data = (const char *)sub.pos;
+    view->len = sub.end - sub.pos;
+    return true;
+}
+
+// Salta un campo que el codec no usa (protobuf-c lo guardaría como campo desconocido)
+static bool skip_field(reader_t *r, int wire) {
+    uint64_t ignored;
+    reader_t sub;
+    switch (wire) {
+        case WIRE_VARINT: return read_varint(r, &ignored);
+        case WIRE_LENGTH: return read_length(r, &sub);
+        case WIRE_64BIT:
+            if (r->end - r->pos < 8) return false;
+            r->pos += 8;
+            return true;
+        case WIRE_32BIT:
+            if (r->end - r->pos < 4) return false;
+            r->pos += 4;
+            return true;
+        default: return false;
+    }
+}
+
+// Los callbacks retornan 1 si consumieron el campo, 0 para saltarlo y -1 para rechazar el mensaje
+typedef int (*field_fn)(void *ctx, int field, int wire, reader_t *r);
+
+/*
+Funcion que recorre un mensaje campo por campo.
+Los campos que el codec entiende se entregan a on_field; los demás se saltan.
+Retornos:
+    * bool: false si el mensaje está mal formado o on_field lo rechaza
+*/
+static bool parse_fields(reader_t *r, field_fn on_field, void *ctx) {
+    while (r->pos < r->end) {
+        // Como protobuf-c, el tag ocupa a lo más 5 bytes
+        const uint8_t *tag_start = r->pos;
+        uint64_t tag;
+        if (!read_varint(r, &tag) || r->pos - tag_start > 5) return false;
+        int field = (int)(uint32_t)(tag >> 3);
+        int wire = (int)(tag & 7);
+
+        int handled = on_field(ctx, field, wire, r);
+        if (handled < 0) return false;
+        if (!handled && !skip_field(r, wire)) return false;
+    }
+    return true;
+}
+
+static bool read_enum(reader_t *r, int wire, int *value) {
+    uint64_t raw;
+    if (wire != WIRE_VARINT || !read_varint(r, &raw)) return false;
+    *value = (int32_t)(uint32_t)raw;
+    return true;
+}
+
+static int send_message_field(void *ctx, int field, int wire, reader_t *r) {
+    codec_send_message_t *msg = ctx;
+    if (field != SEND_MESSAGE_RECIPIENT && field != SEND_MESSAGE_CONTENT) return 0;
+    if (wire != WIRE_LENGTH) return -1;
+    return read_string(r, field == SEND_MESSAGE_RECIPIENT ? &msg->recipient : &msg->content) ? 1 : -1;
+}
+
+typedef struct {
+    int operation;
+    int payload;
+    int expected_payload;  // Único payload del oneof que se acepta
+    codec_send_message_t *msg;
+    codec_send_message_t *batch;
+    size_t batch_max;
+    size_t batch_count;
+} request_ctx_t;
+
+// Cada elemento del batch es un SendMessageRequest; los que no caben en el arreglo solo se validan
+static int batch_field(void *ctx, int field, int wire, reader_t *r) {
+    request_ctx_t *req = ctx;
+    if (field != BATCH_MESSAGES) return 0;
+    reader_t sub;
+    if (wire != WIRE_LENGTH || !read_length(r, &sub)) return -1;
+    codec_send_message_t scratch;
+    codec_send_message_t *msg = req->batch_count < req->batch_max ? &req->batch[req->batch_count] : &scratch;
+    msg->recipient = codec_str("");
+    msg->content = codec_str("");
+    req->batch_count++;
+    return parse_fields(&sub, send_message_field, msg) ? 1 : -1;
+}
+
+static int request_field(void *ctx, int field, int wire, reader_t *r) {
+    request_ctx_t *req = ctx;
+    if (field == REQUEST_OPERATION) {
+        return read_enum(r, wire, &req->operation) ? 1 : -1;
+    }
+    if (field < REQUEST_REGISTER_USER || field > REQUEST_SEND_MULTICAST) {
+        return 0;
+    }
+    if (field != req->expected_payload) {
+        // Otro payload del oneof: lo resuelve protobuf-c
+        return -1;
+    }
+
+    // Si el campo se repite protobuf-c mezcla los submensajes: los strings posteriores reemplazan a los
+    // anteriores y los elementos de un campo repeated se acumulan
+    reader_t sub;
+    if (wire != WIRE_LENGTH || !read_length(r, &sub)) return -1;
+    req->payload = field;
+    if (field == REQUEST_SEND_MESSAGE) {
+        return parse_fields(&sub, send_message_field, req->msg) ? 1 : -1;
+    }
+    return parse_fields(&sub, batch_field, req) ? 1 : -1;
+}
+
+/*
+Funcion que decodifica un Request de SEND_MESSAGE sin copiar ni reservar memoria.
+Parametros:
+    * const uint8_t *buf: mensaje empaquetado (sin el header del frame)
+    * size_t len: largo del mensaje
+    * codec_send_message_t *out: recipient y content quedan apuntando dentro de buf
+Retornos:
+    * bool: true si era un SEND_MESSAGE con su payload; false para cualquier otra cosa (usar protobuf-c)
+*/
+bool codec_decode_send_message(const uint8_t *buf, size_t len, codec_send_message_t *out) {
+    out->recipient = codec_str("");
+    out->content = codec_str("");
+    request_ctx_t ctx = { .expected_payload = REQUEST_SEND_MESSAGE, .msg = out };
+    reader_t r = { buf, buf + len };
+    if (!parse_fields(&r, request_field, &ctx)) return false;
+    return ctx.operation == OPERATION_SEND_MESSAGE && ctx.payload == REQUEST_SEND_MESSAGE;
+}
+
+/*
+Funcion que decodifica un Request de SEND_MESSAGE_BATCH sin copiar ni reservar memoria.
+Parametros:
+    * codec_send_message_t *out: arreglo donde quedan los mensajes, en orden
+    * size_t max: capacidad de out
+    * size_t *count: cantidad de mensajes del batch; si es mayor que max solo se llenaron los primeros max
+Retornos:
+    * bool: true si era un SEND_MESSAGE_BATCH bien formado; false para cualquier otra cosa (usar protobuf-c)
+*/
+bool codec_decode_send_message_batch(const uint8_t *buf, size_t len, codec_send_message_t *out, size_t max, size_t *count) {
+    request_ctx_t ctx = { .expected_payload = REQUEST_SEND_MESSAGE_BATCH, .batch = out, .batch_max = max };
+    reader_t r = { buf, buf + len };
+    if (!parse_fields(&r, request_field, &ctx)) return false;
+    *count = ctx.batch_count;
+    return ctx.operation == OPERATION_SEND_MESSAGE_BATCH && ctx.payload == REQUEST_SEND_MESSAGE_BATCH;
+}
+
+static int incoming_field(void *ctx, int field, int wire, reader_t *r) {
+    codec_incoming_message_t *msg = ctx;
+    if (field == INCOMING_SENDER || field == INCOMING_CONTENT) {
+        if (wire != WIRE_LENGTH) return -1;
+        return read_string(r, field == INCOMING_SENDER ? &msg->sender : &msg->content) ? 1 : -1;
+    }
+    if (field == INCOMING_TYPE) {
+        return read_enum(r, wire, &msg->type) ? 1 : -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    codec_incoming_message_t *msg;
+    int operation;
+    int result;
+} response_ctx_t;
+
+static int response_field(void *ctx, int field, int wire, reader_t *r) {
+    response_ctx_t *res = ctx;
+    codec_str_t ignored;
+    reader_t sub;
+    switch (field) {
+        case RESPONSE_OPERATION: return read_enum(r, wire, &res->operation) ? 1 : -1;
+        case RESPONSE_STATUS_CODE: return read_enum(r, wire, &res->msg->status_code) ? 1 : -1;
+        case RESPONSE_MESSAGE: return wire == WIRE_LENGTH && read_string(r, &ignored) ? 1 : -1;
+        case RESPONSE_USER_LIST:
+        case RESPONSE_DELIVERY_REPORT:
+        case RESPONSE_SESSION:
+        case RESPONSE_MEMORY:
+        case RESPONSE_REDIRECT: return -1;
+        case RESPONSE_SEQUENCE: return wire == WIRE_VARINT && read_varint(r, &res->msg->sequence) ? 1 : -1;
+        case RESPONSE_INCOMING_MESSAGE:
+            if (wire != WIRE_LENGTH || !read_length(r, &sub)) return -1;
+            res->result = field;
+            return parse_fields(&sub, incoming_field, res->msg) ? 1 : -1;
+        default: return 0;
+    }
+}
+
+/*
+Funcion que decodifica un Response de INCOMING_MESSAGE sin copiar ni reservar memoria.
+Retornos:
+    * bool: true si era un INCOMING_MESSAGE con su payload; false para cualquier otra cosa
+*/
+bool codec_decode_incoming_message(const uint8_t *buf, size_t len, codec_incoming_message_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->sender = codec_str("");
+    out->content = codec_str("");
+    response_ctx_t ctx = { out, 0, 0 };
+    reader_t r = { buf, buf + len };
+    if (!parse_fields(&r, response_field, &ctx)) return false;
+    return ctx.operation == OPERATION_INCOMING_MESSAGE && ctx.result == RESPONSE_INCOMING_MESSAGE;
+}
+
+static size_t varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static uint8_t *write_varint(uint8_t *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Los enums se empaquetan como int32: los negativos ocupan 10 bytes
+static uint64_t enum_wire(int value) {
+    return (uint64_t)(int64_t)value;
+}
+
+static size_t string_field_size(codec_str_t s) {
+    return s.len ? 1 + varint_size(s.len) + s.len : 0;
+}
+
+static size_t enum_field_size(int value) {
+    return value ? 1 + varint_size(enum_wire(value)) : 0;
+}
+
+static uint8_t *write_string_field(uint8_t *out, int field, codec_str_t s) {
+    if (!s.len) return out;
+    *out++ = TAG(field, WIRE_LENGTH);
+    out = write_varint(out, s.len);
+    memcpy(out, s.data, s.len);
+    return out + s.len;
+}
+
+static uint8_t *write_enum_field(uint8_t *out, int field, int value) {
+    if (!value) return out;
+    *out++ = TAG(field, WIRE_VARINT);
+    return write_varint(out, enum_wire(value));
+}
+
+static size_t send_message_body_size(const codec_send_message_t *msg) {
+    return string_field_size(msg->recipient) + string_field_size(msg->content);
+}
+
+size_t codec_send_message_size(const codec_send_message_t *msg) {
+    size_t body = send_message_body_size(msg);
+    return enum_field_size(OPERATION_SEND_MESSAGE) + 1 + varint_size(body) + body;
+}
+
+static size_t batch_body_size(const codec_send_message_t *messages, size_t count) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t body = send_message_body_size(&messages[i]);
+        size += 1 + varint_size(body) + body;
+    }
+    return size;
+}
+
+size_t codec_send_message_batch_size(const codec_send_message_t *messages, size_t count) {
+    size_t body = batch_body_size(messages, count);
+    return enum_field_size(OPERATION_SEND_MESSAGE_BATCH) + 1 + varint_size(body) + body;
+}
+
+/*
+Funcion que empaqueta un Request de SEND_MESSAGE_BATCH.
+Parametros:
+    * uint8_t *out: buffer de al menos codec_send_message_batch_size(messages, count) bytes
+Retornos:
+    * size_t: bytes escritos
+*/
+size_t codec_encode_send_message_batch(const codec_send_message_t *messages, size_t count, uint8_t *out) {
+    uint8_t *p = write_enum_field(out, REQUEST_OPERATION, OPERATION_SEND_MESSAGE_BATCH);
+    *p++ = TAG(REQUEST_SEND_MESSAGE_BATCH, WIRE_LENGTH);
+    p = write_varint(p, batch_body_size(messages, count));
+    for (size_t i = 0; i < count; i++) {
+        *p++ = TAG(BATCH_MESSAGES, WIRE_LENGTH);
+        p = write_varint(p, send_message_body_size(&messages[i]));
+        p = write_string_field(p, SEND_MESSAGE_RECIPIENT, messages[i].recipient);
+        p = write_string_field(p, SEND_MESSAGE_CONTENT, messages[i].content);
+    }
+    return p - out;
+}
+
+/*
+Funcion que empaqueta un Request de SEND_MESSAGE.
+Parametros:
+    * uint8_t *out: buffer de al menos codec_send_message_size(msg) bytes
+Retornos:
+    * size_t: bytes escritos
+*/
+size_t codec_encode_send_message(const codec_send_message_t *msg, uint8_t *out) {
+    uint8_t *p = write_enum_field(out, REQUEST_OPERATION, OPERATION_SEND_MESSAGE);
+    *p++ = TAG(REQUEST_SEND_MESSAGE, WIRE_LENGTH);
+    p = write_varint(p, send_message_body_size(msg));
+    p = write_string_field(p, SEND_MESSAGE_RECIPIENT, msg->recipient);
+    p = write_string_field(p, SEND_MESSAGE_CONTENT, msg->content);
+    return p - out;
+}
+
+static size_t incoming_body_size(const codec_incoming_message_t *msg) {
+    return string_field_size(msg->sender) + string_field_size(msg->content) + enum_field_size(msg->type);
+}
+
+size_t codec_incoming_message_size(const codec_incoming_message_t *msg) {
+    size_t body = incoming_body_size(msg);
+    size_t sequence = msg->sequence ? 1 + varint_size(msg->sequence) : 0;
+    return enum_field_size(OPERATION_INCOMING_MESSAGE) + enum_field_size(msg->status_code) + 1 + varint_size(body) + body + sequence;
+}
+
+/*
+Funcion que empaqueta un Response de INCOMING_MESSAGE (sin el campo message, que el servidor no usa en este caso).
+Parametros:
+    * uint8_t *out: buffer de al menos codec_incoming_message_size(msg) bytes
+Retornos:
+    * size_t: bytes escritos
+*/
+size_t codec_encode_incoming_message(const codec_incoming_message_t *msg, uint8_t *out) {
+    uint8_t *p = write_enum_field(out, RESPONSE_OPERATION, OPERATION_INCOMING_MESSAGE);
+    p = write_enum_field(p, RESPONSE_STATUS_CODE, msg->status_code);
+    *p++ = TAG(RESPONSE_INCOMING_MESSAGE, WIRE_LENGTH);
+    p = write_varint(p, incoming_body_size(msg));
+    p = write_string_field(p, INCOMING_SENDER, msg->sender);
+    p = write_string_field(p, INCOMING_CONTENT, msg->content);
+    p = write_enum_field(p, INCOMING_TYPE, msg->type);
+    p += codec_encode_sequence(msg->sequence, p);
+    return p - out;
+}
+
+/*
+Funcion que escribe el campo sequence de un Response.
+Es el campo con el número más alto, así que agregarlo al final de un Response ya empaquetado da los mismos bytes
+que empaquetarlo con él.
+Parametros:
+    * uint8_t *out: buffer de al menos CODEC_SEQUENCE_MAX_SIZE bytes
+Retornos:
+    * size_t: bytes escritos (0 si sequence es 0, el valor por defecto)
+*/
+size_t codec_encode_sequence(uint64_t sequence, uint8_t *out) {
+    if (!sequence) return 0;
+    out[0] = TAG(RESPONSE_SEQUENCE, WIRE_VARINT);
+    return write_varint(out + 1, sequence) - out;
+}
+
+static size_t varint_field_size(uint64_t value) {
+    return value ? 1 + varint_size(value) : 0;
+}
+
+static uint8_t *write_varint_field(uint8_t *out, int field, uint64_t value) {
+    if (!value) return out;
+    *out++ = TAG(field, WIRE_VARINT);
+    return write_varint(out, value);
+}
+
+static size_t node_event_body_size(const codec_node_event_t *event) {
+    return enum_field_size(event->type) + varint_field_size(event->node_id) +
+           string_field_size(event->username) + enum_field_size(event->status) +
+           string_field_size(event->sender) + string_field_size(event->content) +
+           varint_field_size(event->client_port) + string_field_size(event->session_token) +
+           varint_field_size(event->next_sequence) + varint_field_size(event->replay_first) +
+           string_field_size(event->replay);
+}
+
+size_t codec_node_batch_entry_size(const codec_node_event_t *event) {
+    size_t body = node_event_body_size(event);
+    return 1 + varint_size(body) + body;
+}
+
+/*
+Funcion que empaqueta un NodeEvent como un elemento del campo events de un NodeBatch.
+Un NodeBatch no tiene otros campos, así que los elementos concatenados ya son un NodeBatch completo: el enlace
+entre nodos los va agregando a su cola sin armar nunca el mensaje entero.
+Parametros:
+    * uint8_t *out: buffer de al menos codec_node_batch_entry_size(event) bytes
+Retornos:
+    * size_t: bytes escritos
+*/
+size_t codec_encode_node_batch_entry(const codec_node_event_t *event, uint8_t *out) {
+    uint8_t *p = out;
+    *p++ = TAG(NODE_BATCH_EVENTS, WIRE_LENGTH);
+    p = write_varint(p, node_event_body_size(event));
+    p = write_enum_field(p, NODE_EVENT_TYPE, event->type);
+    p = write_varint_field(p, NODE_EVENT_NODE_ID, event->node_id);
+    p = write_string_field(p, NODE_EVENT_USERNAME, event->username);
+    p = write_enum_field(p, NODE_EVENT_STATUS, event->status);
+    p = write_string_field(p, NODE_EVENT_SENDER, event->sender);
+    p = write_string_field(p, NODE_EVENT_CONTENT, event->content);
+    p = write_varint_field(p, NODE_EVENT_CLIENT_PORT, event->client_port);
+    p = write_string_field(p, NODE_EVENT_SESSION_TOKEN, event->session_token);
+    p = write_varint_field(p, NODE_EVENT_NEXT_SEQUENCE, event->next_sequence);
+    p = write_varint_field(p, NODE_EVENT_REPLAY_FIRST, event->replay_first);
+    p = write_string_field(p, NODE_EVENT_REPLAY, event->replay);  // bytes y string se codifican igual
+    return p - out;
+}
@@ -0,0 +1,79 @@
+/*
+    * codec.h
+    * Hand-written encoder/decoder for the messages that dominate the traffic: a Request carrying a SendMessageRequest
+    * (alone or in a batch) and a Response carrying an IncomingMessageResponse. Wire-compatible with chat.proto
+    * (same bytes as chat.pb-c.c produces), no allocation, and decoded strings are views into the input buffer.
+    * Anything else (other operations, unknown shapes, malformed input) is left to protobuf-c.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    CODEC_PROTOBUF_C = 0,  // chat__request__unpack / chat__response__pack generados
+    CODEC_NATIVE           // Funciones de este módulo
+} codec_kind_t;
+
+// Vista a un string dentro de un buffer: no termina en '\0' y vive lo mismo que el buffer
+typedef struct {
+    const char *data;
+    size_t len;
+} codec_str_t;
+
+typedef struct {
+    codec_str_t recipient;
+    codec_str_t content;
+} codec_send_message_t;
+
+typedef struct {
+    int status_code;
+    codec_str_t sender;
+    codec_str_t content;
+    int type;
+    uint64_t sequence;  // Número del mensaje en una sesión reanudable, 0 fuera de una
+} codec_incoming_message_t;
+
+// NodeEvent del enlace entre nodos de la federación (federation.h)
+typedef struct {
+    int type;
+    uint32_t node_id;
+    codec_str_t username;
+    int status;
+    codec_str_t sender;
+    codec_str_t content;
+    uint32_t client_port;
+    codec_str_t session_token;
+    uint64_t next_sequence;
+    uint64_t replay_first;
+    codec_str_t replay;  // Bytes de la ventana de reenvío de una sesión migrada
+} codec_node_event_t;
+
+#define CODEC_SEQUENCE_MAX_SIZE 11  // Tag y varint del campo sequence de un Response
+
+codec_str_t codec_str(const char *s);
+bool codec_str_equals(codec_str_t view, const char *s);
+const char *codec_kind_name(codec_kind_t kind);
+int codec_kind_parse(const char *name, codec_kind_t *kind);
+
+bool codec_decode_send_message(const uint8_t *buf, size_t len, codec_send_message_t *out);
+size_t codec_send_message_size(const codec_send_message_t *msg);
+size_t codec_encode_send_message(const codec_send_message_t *msg, uint8_t *out);
+
+bool codec_decode_send_message_batch(const uint8_t *buf, size_t len, codec_send_message_t *out, size_t max, size_t *count);
+size_t codec_send_message_batch_size(const codec_send_message_t *messages, size_t count);
+size_t codec_encode_send_message_batch(const codec_send_message_t *messages, size_t count, uint8_t *out);
+
+bool codec_decode_incoming_message(const uint8_t *buf, size_t len, codec_incoming_message_t *out);
+size_t codec_incoming_message_size(const codec_incoming_message_t *msg);
+size_t codec_encode_incoming_message(const codec_incoming_message_t *msg, uint8_t *out);
+size_t codec_encode_sequence(uint64_t sequence, uint8_t *out);
+
+size_t codec_node_batch_entry_size(const codec_node_event_t *event);
+size_t codec_encode_node_batch_entry(const codec_node_event_t *event, uint8_t *out);
+
+#endif
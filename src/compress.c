@@ -0,0 +1,265 @@
+/*
+    * compress.c
+    * Raw deflate of frame groups with the shared chat dictionary, and the matching inflate for the client.
+    * Each thread keeps its own z_stream (freed when the thread exits), so compressing never takes a lock.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "compress.h"
+
+/*
+Diccionario compartido por el servidor y los clientes; cambiarlo rompe la compatibilidad con los clientes existentes.
+Son secuencias que se repiten en el tráfico del chat: headers de frame, los tags de un
+INCOMING_MESSAGE y de una lista de usuarios, los textos del servidor y palabras frecuentes. Deflate encuentra
+más rápido (con distancias más cortas) lo que está al final, así que lo más común va al final.
+*/
+static const char dictionary[] =
+    "\033[34mYour status has been changed to OFFLINE due to inactivity.\033[0m"
+    " has been set OFFLINE due to inactivity.\n\033[0m"
+    "\n\033[31m(!) Server is at capacity, try again later\033[0m"
+    "\n\033[31m(!) User is already connected\033[0m\n\033[31m(!) Session expired\033[0m"
+    "\033[31mServer is low on memory, broadcast dropped\033[0m"
+    "\033[32mRegistration successful\033[0m\033[32mSession resumed\033[0m"
+    "\n\033[32mStatus updated successfully!\033[0m\033[31mUser not found\033[0m"
+    "User not found.User is offline.Server"
+    "https://www.http://.com/ :) jaja gracias hola buenas buenos dias noches bien que tal "
+    "de la que el en los se del las un por con no una su para es al lo como mas pero sus le ya o este si porque "
+    "the be to of and a in that have I it for not on with he as you do at this but his by from they we say her "
+    "ok okay yes no thanks hello hi good morning night see you later meeting today tomorrow "
+    // Lista de usuarios: Response GET_USERS con Users (username, status)
+    "\x08\x03\x10\xc8\x01\x22" "\x0a" "\x0a" "user" "\x10\x01" "\x0a" "\x0a" "user" "\x10\x02" "\x0a" "\x0a" "user"
+    // Respuestas de estado y DeliveryReport
+    "\x08\x02\x10\xc8\x01\x1a" "\x08\x06\x10\xc8\x01\x32" "\x08\x07\x10\xc8\x01\x32" "\x08\x01\x10\x90\x03\x2a"
+    // INCOMING_MESSAGE directo y broadcast, con el header del frame y el número de secuencia
+    "\x00\x00\x00" "\x08\x05\x10\xc8\x01\x2a" "\x0a" "user" "\x12" "\x18\x01" "\x40"
+    "\x00\x00\x00" "\x08\x05\x10\xc8\x01\x2a" "\x0a" "user" "\x12" "\x40"
+    "\x00\x00\x00" "\x08\x05\x10\xc8\x01\x2a" "\x0a";
+
+static pthread_key_t deflater_key;
+static pthread_key_t inflater_key;
+static pthread_once_t keys_once = PTHREAD_ONCE_INIT;
+
+static void free_deflater(void *stream) {
+    deflateEnd(stream);
+    free(stream);
+}
+
+static void free_inflater(void *stream) {
+    inflateEnd(stream);
+    free(stream);
+}
+
+static void create_keys(void) {
+    pthread_key_create(&deflater_key, free_deflater);
+    pthread_key_create(&inflater_key, free_inflater);
+}
+
+/*
+Funcion que obtiene el deflater del thread, listo para un stream nuevo con el diccionario cargado.
+Retornos:
+    * z_stream *: deflater, NULL si no hubo memoria
+*/
+static z_stream *deflater(void) {
+    pthread_once(&keys_once, create_keys);
+    z_stream *stream = pthread_getspecific(deflater_key);
+    if (stream) {
+        deflateReset(stream);
+    } else {
+        stream = calloc(1, sizeof(z_stream));
+        if (!stream) return NULL;
+        if (deflateInit2(stream, COMPRESS_LEVEL, Z_DEFLATED, -COMPRESS_WINDOW_BITS, COMPRESS_MEM_LEVEL,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            free(stream);
+            return NULL;
+        }
+        pthread_setspecific(deflater_key, stream);
+    }
+    deflateSetDictionary(stream, (const Bytef *)dictionary, sizeof(dictionary) - 1);
+    return stream;
+}
+
+static z_stream *inflater(void) {
+    pthread_once(&keys_once, create_keys);
+    z_stream *stream = pthread_getspecific(inflater_key);
+    if (stream) {
+        inflateReset(stream);
+    } else {
+        stream = calloc(1, sizeof(z_stream));
+        if (!stream) return NULL;
+        // Con la ventana máxima se puede inflar lo que comprima un servidor con cualquier COMPRESS_WINDOW_BITS
+        if (inflateInit2(stream, -15) != Z_OK) {
+            free(stream);
+            return NULL;
+        }
+        pthread_setspecific(inflater_key, stream);
+    }
+    inflateSetDictionary(stream, (const Bytef *)dictionary, sizeof(dictionary) - 1);
+    return stream;
+}
+
+static int out_reserve(frame_out_t *out, size_t len) {
+    if (out->len + len <= out->cap) return 0;
+    size_t cap = out->cap ? out->cap : 4096;
+    while (cap < out->len + len) cap *= 2;
+    uint8_t *grown = realloc(out->data, cap);
+    if (!grown) return -1;
+    out->data = grown;
+    out->cap = cap;
+    return 0;
+}
+
+/*
+Funcion que agrega a out un grupo de frames completos como un solo frame comprimido, o tal cual si no se achica.
+out->frames cuenta los frames que quedan para el socket.
+Parametros:
+    * const uint8_t *header: header del único frame del grupo, o NULL si data ya son frames completos
+    * const uint8_t *data: payload del frame, o los frames completos
+    * size_t len: bytes de data
+    * size_t frames: cantidad de frames del grupo
+*/
+static int deflate_group(const uint8_t *header, const uint8_t *data, size_t len, size_t frames, frame_out_t *out) {
+    size_t header_len = header ? FRAME_HEADER_SIZE : 0;
+    size_t total = header_len + len;
+    if (out_reserve(out, FRAME_HEADER_SIZE + total) != 0) return -1;
+    uint8_t *frame = out->data + out->len;
+    z_stream *stream = deflater();
+    if (stream) {
+        stream->next_out = frame + FRAME_HEADER_SIZE;
+        // Si no queda en menos bytes que el original no vale la pena: el stream no termina y sale sin comprimir
+        stream->avail_out = total - 1 < FRAME_MAX_SIZE ? total - 1 : FRAME_MAX_SIZE;
+        stream->next_in = (Bytef *)header;
+        stream->avail_in = header_len;
+        int rc = header ? deflate(stream, Z_NO_FLUSH) : Z_OK;
+        if (rc == Z_OK) {
+            stream->next_in = (Bytef *)data;
+            stream->avail_in = len;
+            rc = deflate(stream, Z_FINISH);
+        }
+        if (rc == Z_STREAM_END) {
+            frame_write_header(frame, stream->total_out | FRAME_COMPRESSED);
+            out->len += FRAME_HEADER_SIZE + stream->total_out;
+            out->frames++;
+            return 0;
+        }
+    }
+    if (header) memcpy(frame, header, FRAME_HEADER_SIZE);
+    memcpy(frame + header_len, data, len);
+    out->len += total;
+    out->frames += frames;
+    return 0;
+}
+
+/*
+Funcion que comprime un mensaje empaquetado (sin header) y lo agrega a out como un frame.
+Retornos:
+    * int: 0 para exito y -1 si no hubo memoria
+*/
+int compress_frame(const uint8_t *payload, size_t len, frame_out_t *out) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_write_header(header, len);
+    return deflate_group(header, payload, len, 1, out);
+}
+
+/*
+Funcion que comprime frames completos (con sus headers, sin comprimir) y los agrega a out.
+Se juntan en un frame comprimido tantos frames como quepan en COMPRESS_MAX_INFLATED.
+Parametros:
+    * const uint8_t *frames: frames completos
+    * size_t len: bytes de frames
+    * frame_out_t *out: donde quedan los frames para el socket; out->frames suma cuántos son
+Retornos:
+    * int: 0 para exito y -1 si no hubo memoria
+*/
+int compress_frames(const uint8_t *frames, size_t len, frame_out_t *out) {
+    size_t offset = 0;
+    while (offset < len) {
+        size_t group = 0;
+        size_t count = 0;
+        while (offset + group < len) {
+            size_t frame = FRAME_HEADER_SIZE + frame_read_header(frames + offset + group);
+            if (count > 0 && group + frame > COMPRESS_MAX_INFLATED) break;
+            group += frame;
+            count++;
+        }
+        if (offset + group > len) group = len - offset;
+        if (deflate_group(NULL, frames + offset, group, count, out) != 0) return -1;
+        offset += group;
+    }
+    return 0;
+}
+
+/*
+Funcion que infla un frame comprimido al final de inflated y verifica que sean frames completos sin comprimir.
+*/
+static int inflate_frames(const uint8_t *payload, size_t len, frame_buffer_t *inflated) {
+    z_stream *stream = inflater();
+    if (!stream) return -1;
+    stream->next_in = (Bytef *)payload;
+    stream->avail_in = len;
+    size_t produced = 0;
+    int rc = Z_OK;
+    while (rc != Z_STREAM_END) {
+        size_t chunk = produced < 16384 ? 16384 : produced;
+        if (chunk > COMPRESS_MAX_INFLATED - produced) chunk = COMPRESS_MAX_INFLATED - produced;
+        if (chunk == 0) return -1;  // Infla a más de lo que el servidor puede juntar en un frame
+        uint8_t *dst = frame_buffer_reserve(inflated, chunk);
+        if (!dst) return -1;
+        stream->next_out = dst;
+        stream->avail_out = chunk;
+        rc = inflate(stream, Z_NO_FLUSH);
+        inflated->len -= stream->avail_out;
+        produced += chunk - stream->avail_out;
+        if (rc != Z_OK && rc != Z_STREAM_END) return -1;
+        if (rc == Z_OK && stream->avail_in == 0 && stream->avail_out > 0) return -1;  // Stream cortado
+    }
+    if (stream->avail_in != 0) return -1;
+
+    size_t offset = inflated->len - produced;
+    while (offset < inflated->len) {
+        if (inflated->len - offset < FRAME_HEADER_SIZE) return -1;
+        size_t frame_len = frame_read_header(inflated->data + offset);
+        if (frame_len > FRAME_MAX_SIZE || inflated->len - offset - FRAME_HEADER_SIZE < frame_len) return -1;
+        offset += FRAME_HEADER_SIZE + frame_len;
+    }
+    return 0;
+}
+
+/*
+Funcion que, si el siguiente frame de un buffer de lectura está completo y comprimido, infla sus frames al final
+de inflated y lo consume. El llamador entrega primero los frames de inflated y después sigue con in.
+Retornos:
+    * int: 1 si infló un frame, 0 si el siguiente no está comprimido o aún no llega completo, y -1 si es
+      inválido (errno EPROTO)
+*/
+int decompress_next(frame_buffer_t *in, frame_buffer_t *inflated) {
+    size_t available = in->len - in->start;
+    if (available < FRAME_HEADER_SIZE) return 0;
+    size_t header = frame_read_header(in->data + in->start);
+    if (!(header & FRAME_COMPRESSED)) return 0;
+    size_t len = header & ~(size_t)FRAME_COMPRESSED;
+    if (len > FRAME_MAX_SIZE) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (available < FRAME_HEADER_SIZE + len) return 0;
+    if (inflate_frames(in->data + in->start + FRAME_HEADER_SIZE, len, inflated) != 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    frame_buffer_consume(in, FRAME_HEADER_SIZE + len);
+    return 1;
+}
+
+/*
+Funcion que indica si el frame pendiente declara una longitud inválida, aceptando frames comprimidos
+(el equivalente de frame_buffer_invalid para una conexión con compresión).
+*/
+bool decompress_invalid(const frame_buffer_t *in) {
+    if (in->len - in->start < FRAME_HEADER_SIZE) return false;
+    return (frame_read_header(in->data + in->start) & ~(size_t)FRAME_COMPRESSED) > FRAME_MAX_SIZE;
+}
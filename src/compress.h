@@ -0,0 +1,32 @@
+/*
+    * compress.h
+    * Per-connection payload compression (COMPRESSION_DEFLATE in chat.proto), negotiated at registration.
+    * The server packs one or more complete frames (headers included) into a raw deflate stream primed with a preset
+    * dictionary of chat traffic, and sends it as a single frame whose length header has FRAME_COMPRESSED set. The
+    * dictionary lets even a lone message reuse the protobuf tags, status texts and common words it already contains.
+    * Every compressed frame is an independent stream, so the same bytes can be shared by every recipient of a broadcast
+    * and a receiver never needs state from an earlier frame. Only frames of at least the server's threshold are
+    * compressed, and a group that does not shrink goes out as it was.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "frame.h"
+
+#define COMPRESS_MIN_BYTES 512  // Umbral por defecto: lo más chico sale sin comprimir
+#define COMPRESS_MAX_INFLATED (FRAME_HEADER_SIZE + FRAME_MAX_SIZE)  // Frames que caben en un frame comprimido
+#define COMPRESS_LEVEL 1
+#define COMPRESS_WINDOW_BITS 12  // Ventana de 4 KB: los frames son chicos y el servidor tiene un deflater por thread
+#define COMPRESS_MEM_LEVEL 6
+
+int compress_frame(const uint8_t *payload, size_t len, frame_out_t *out);
+int compress_frames(const uint8_t *frames, size_t len, frame_out_t *out);
+int decompress_next(frame_buffer_t *in, frame_buffer_t *inflated);
+bool decompress_invalid(const frame_buffer_t *in);
+
+#endif
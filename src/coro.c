@@ -0,0 +1,702 @@
+/*
+    * coro.c
+    * Coroutine runtime: worker threads that each run their coroutines over an epoll set, with pooled stacks, and
+    * share the tasks of their deques by stealing.
+    * Switching uses swapcontext, which also saves the signal mask; the mask is the same for every coroutine.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "coro.h"
+
+typedef enum {
+    CORO_READY,    // En la cola de su worker
+    CORO_RUNNING,
+    CORO_WAITING,  // Suspendida en coro_poll
+    CORO_DONE
+} coro_state_t;
+
+typedef struct worker worker_t;
+
+// Descriptor registrado en el epoll del worker por una espera; es el data.ptr del evento
+typedef struct {
+    coro_t *co;
+    uint32_t events;  // Lo que epoll reportó
+} coro_wait_t;
+
+// Paso de un handler que corre en el pool; vive en el stack de la corrutina, que espera a que termine
+typedef struct {
+    coro_fn fn;
+    void *arg;
+    coro_t *waiter;
+    bool done;  // Protegido por el lock del worker de waiter
+} coro_task_t;
+
+struct coro {
+    worker_t *worker;
+    ucontext_t context;
+    uint8_t *stack;        // Inicio del mapeo, con la página de guarda
+    coro_fn fn;
+    void *arg;
+    coro_state_t state;    // Protegido por worker->lock
+    bool started;          // Ya tiene contexto; se crea en su worker para que sea él quien toque el stack primero
+    bool interrupted;      // Protegido por worker->lock
+    uint64_t deadline;     // Fin de la espera en curso (0 sin plazo), en ns de CLOCK_MONOTONIC
+    coro_t *next;          // Cola de listas del worker
+    coro_t *timed_prev;    // Lista de esperas con plazo (solo la toca el worker)
+    coro_t *timed_next;
+    coro_wait_t waits[CORO_MAX_FDS];
+    int watched[CORO_MAX_WATCHES];          // Descriptores de coro_watch, -1 en los libres (solo los toca su worker)
+    coro_wait_t watches[CORO_MAX_WATCHES];  // Sus eventos se acumulan hasta que una espera los ve
+};
+
+struct worker {
+    pthread_t thread;
+    int epfd;
+    int wakefd;            // eventfd: otro thread dejó una corrutina en la cola
+    ucontext_t scheduler;
+    coro_t *current;
+    pthread_mutex_t lock;  // Cola de listas, estado de las corrutinas y pool de stacks
+    coro_t *ready_head;
+    coro_t *ready_tail;
+    bool notified;         // wakefd ya tiene un aviso sin leer
+    coro_t *timed;
+    uint8_t *stacks[CORO_STACK_POOL];
+    int n_stacks;
+    atomic_size_t count;   // Corrutinas vivas del worker
+    atomic_bool sleeping;  // Bloqueado en epoll_wait sin nada que correr: una tarea nueva lo despierta
+
+    // Deque de tareas: el dueño agrega y toma por abajo (la más nueva), los demás roban por arriba (la más vieja)
+    pthread_mutex_t task_lock;
+    coro_task_t **tasks;
+    size_t task_top;       // Índice de la tarea más vieja en el arreglo circular
+    size_t task_count;
+    size_t task_cap;
+    unsigned victim;       // Próximo worker al que se intenta robar
+} __attribute__((aligned(64)));  // Cada worker en sus propias líneas de caché: los locks de uno no rebotan en otro
+
+void (*coro_worker_start)(int index) = NULL;
+
+static worker_t *workers;
+static int n_workers;
+static size_t page_size;
+static atomic_size_t stack_bytes;
+static atomic_size_t queued_tasks;  // Tareas en todos los deques, para no buscar qué robar si no hay nada
+static atomic_uint_fast64_t tasks_run;
+static atomic_uint_fast64_t tasks_stolen;
+static __thread worker_t *self_worker;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint8_t *stack_alloc(worker_t *w) {
+    pthread_mutex_lock(&w->lock);
+    uint8_t *stack = w->n_stacks > 0 ? w->stacks[--w->n_stacks] : NULL;
+    pthread_mutex_unlock(&w->lock);
+    if (stack) return stack;
+    // MAP_NORESERVE: el stack solo ocupa memoria en las páginas que se tocan
+    size_t len = page_size + CORO_STACK_SIZE;
+    stack = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) return NULL;
+    if (mprotect(stack, page_size, PROT_NONE) != 0) {
+        munmap(stack, len);
+        return NULL;
+    }
+    atomic_fetch_add(&stack_bytes, len);
+    return stack;
+}
+
+static void stack_release(worker_t *w, uint8_t *stack) {
+    pthread_mutex_lock(&w->lock);
+    if (w->n_stacks < CORO_STACK_POOL) {
+        w->stacks[w->n_stacks++] = stack;
+        stack = NULL;
+    }
+    pthread_mutex_unlock(&w->lock);
+    if (stack) {
+        munmap(stack, page_size + CORO_STACK_SIZE);
+        atomic_fetch_sub(&stack_bytes, page_size + CORO_STACK_SIZE);
+    }
+}
+
+/*
+Funcion que pone una corrutina en la cola de su worker (con worker->lock) y lo despierta si está en otro thread.
+*/
+static void ready_locked(worker_t *w, coro_t *co) {
+    co->state = CORO_READY;
+    co->next = NULL;
+    if (w->ready_tail) {
+        w->ready_tail->next = co;
+    } else {
+        w->ready_head = co;
+    }
+    w->ready_tail = co;
+    if (self_worker != w && !w->notified) {
+        w->notified = true;
+        uint64_t one = 1;
+        if (write(w->wakefd, &one, sizeof(one)) < 0) {
+            // El contador del eventfd no se puede llenar con un aviso por vuelta
+        }
+    }
+}
+
+/*
+Funcion que despierta a una corrutina si está suspendida; si está corriendo no hace nada (salvo marcar la
+interrupción, que su próxima espera ve).
+*/
+static void wake(coro_t *co, bool interrupt) {
+    worker_t *w = co->worker;
+    pthread_mutex_lock(&w->lock);
+    if (interrupt) co->interrupted = true;
+    if (co->state == CORO_WAITING) ready_locked(w, co);
+    pthread_mutex_unlock(&w->lock);
+}
+
+static bool take_interrupt(coro_t *co) {
+    pthread_mutex_lock(&co->worker->lock);
+    bool interrupted = co->interrupted;
+    co->interrupted = false;
+    pthread_mutex_unlock(&co->worker->lock);
+    return interrupted;
+}
+
+static void coro_entry(void) {
+    coro_t *co = self_worker->current;
+    co->fn(co->arg);
+    // Un evento de un descriptor que sigue abierto no puede apuntar a la corrutina ya liberada
+    for (int i = 0; i < CORO_MAX_WATCHES; i++) coro_unwatch(co->watched[i]);
+    pthread_mutex_lock(&co->worker->lock);
+    co->state = CORO_DONE;
+    pthread_mutex_unlock(&co->worker->lock);
+    // uc_link vuelve al scheduler
+}
+
+static void run(worker_t *w, coro_t *co) {
+    if (!co->started) {
+        // Con el worker fijo en un CPU, las páginas del stack salen de la memoria de su nodo NUMA
+        co->started = true;
+        getcontext(&co->context);
+        co->context.uc_stack.ss_sp = co->stack + page_size;
+        co->context.uc_stack.ss_size = CORO_STACK_SIZE;
+        co->context.uc_link = &w->scheduler;
+        makecontext(&co->context, coro_entry, 0);
+    }
+    pthread_mutex_lock(&w->lock);
+    co->state = CORO_RUNNING;
+    pthread_mutex_unlock(&w->lock);
+    w->current = co;
+    swapcontext(&w->scheduler, &co->context);
+    w->current = NULL;
+    if (co->state == CORO_DONE) {
+        stack_release(w, co->stack);
+        atomic_fetch_sub(&w->count, 1);
+        free(co);
+    }
+}
+
+static void timed_insert(worker_t *w, coro_t *co) {
+    co->timed_prev = NULL;
+    co->timed_next = w->timed;
+    if (w->timed) w->timed->timed_prev = co;
+    w->timed = co;
+}
+
+static void timed_remove(worker_t *w, coro_t *co) {
+    if (co->timed_prev) {
+        co->timed_prev->timed_next = co->timed_next;
+    } else {
+        w->timed = co->timed_next;
+    }
+    if (co->timed_next) co->timed_next->timed_prev = co->timed_prev;
+}
+
+/*
+Funcion que calcula cuánto puede esperar epoll_wait hasta el plazo más cercano.
+Retornos:
+    * int: milisegundos (redondeados hacia arriba), -1 si ninguna espera tiene plazo
+*/
+static int next_timeout(worker_t *w) {
+    if (!w->timed) return -1;
+    uint64_t first = UINT64_MAX;
+    for (coro_t *co = w->timed; co; co = co->timed_next) {
+        if (co->deadline < first) first = co->deadline;
+    }
+    uint64_t now = now_ns();
+    return first <= now ? 0 : (int)((first - now + 999999) / 1000000);
+}
+
+static void expire_timers(worker_t *w) {
+    uint64_t now = now_ns();
+    for (coro_t *co = w->timed; co; co = co->timed_next) {
+        if (co->deadline <= now) wake(co, false);
+    }
+}
+
+/*
+Funcion que agrega una tarea abajo del deque del worker y, si hay workers dormidos, despierta a uno para que la robe.
+Retornos:
+    * int: 0 para exito y -1 si no hubo memoria para crecer el deque
+*/
+static int task_push(worker_t *w, coro_task_t *task) {
+    pthread_mutex_lock(&w->task_lock);
+    if (w->task_count == w->task_cap) {
+        size_t cap = w->task_cap ? 2 * w->task_cap : 64;
+        coro_task_t **grown = malloc(cap * sizeof(*grown));
+        if (!grown) {
+            pthread_mutex_unlock(&w->task_lock);
+            return -1;
+        }
+        for (size_t i = 0; i < w->task_count; i++) {
+            grown[i] = w->tasks[(w->task_top + i) % w->task_cap];
+        }
+        free(w->tasks);
+        w->tasks = grown;
+        w->task_top = 0;
+        w->task_cap = cap;
+    }
+    w->tasks[(w->task_top + w->task_count) % w->task_cap] = task;
+    w->task_count++;
+    pthread_mutex_unlock(&w->task_lock);
+    atomic_fetch_add(&queued_tasks, 1);
+
+    for (int i = 0; i < n_workers; i++) {
+        worker_t *idle = &workers[i];
+        if (idle == w || !atomic_load(&idle->sleeping)) continue;
+        pthread_mutex_lock(&idle->lock);
+        if (!idle->notified) {
+            idle->notified = true;
+            uint64_t one = 1;
+            if (write(idle->wakefd, &one, sizeof(one)) < 0) {
+                // El contador del eventfd no se puede llenar con un aviso por vuelta
+            }
+        }
+        pthread_mutex_unlock(&idle->lock);
+        break;
+    }
+    return 0;
+}
+
+static coro_task_t *task_pop(worker_t *w) {
+    coro_task_t *task = NULL;
+    pthread_mutex_lock(&w->task_lock);
+    if (w->task_count > 0) {
+        w->task_count--;
+        task = w->tasks[(w->task_top + w->task_count) % w->task_cap];
+    }
+    pthread_mutex_unlock(&w->task_lock);
+    if (task) atomic_fetch_sub(&queued_tasks, 1);
+    return task;
+}
+
+/*
+Funcion que roba la tarea más vieja del deque de otro worker, empezando por el que sigue al último que se revisó.
+*/
+static coro_task_t *task_steal(worker_t *w) {
+    if (atomic_load(&queued_tasks) == 0) return NULL;
+    for (int i = 0; i < n_workers; i++) {
+        worker_t *victim = &workers[w->victim++ % n_workers];
+        if (victim == w) continue;
+        coro_task_t *task = NULL;
+        pthread_mutex_lock(&victim->task_lock);
+        if (victim->task_count > 0) {
+            task = victim->tasks[victim->task_top];
+            victim->task_top = (victim->task_top + 1) % victim->task_cap;
+            victim->task_count--;
+        }
+        pthread_mutex_unlock(&victim->task_lock);
+        if (task) {
+            atomic_fetch_sub(&queued_tasks, 1);
+            atomic_fetch_add(&tasks_stolen, 1);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/*
+Funcion que corre una tarea en el thread del worker (fuera de cualquier corrutina) y despierta a quien la espera.
+Después de soltar el lock ya no se toca la tarea: la corrutina puede seguir y su stack cambiar.
+*/
+static void task_run(coro_task_t *task) {
+    task->fn(task->arg);
+    atomic_fetch_add(&tasks_run, 1);
+    coro_t *co = task->waiter;
+    worker_t *w = co->worker;
+    pthread_mutex_lock(&w->lock);
+    task->done = true;
+    if (co->state == CORO_WAITING) ready_locked(w, co);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*
+Funcion que corre hasta CORO_TASK_BATCH tareas: las del propio deque y, cuando se acaban, las que pueda robar.
+*/
+static void run_tasks(worker_t *w) {
+    for (int i = 0; i < CORO_TASK_BATCH; i++) {
+        coro_task_t *task = task_pop(w);
+        if (!task) task = task_steal(w);
+        if (!task) return;
+        task_run(task);
+    }
+}
+
+/*
+Thread de un worker: corre las corrutinas listas y las tareas de los deques, y espera en su epoll a que alguna
+corrutina pueda seguir. Las que se despiertan mientras corre una tanda quedan para la siguiente, después de revisar
+el epoll. Antes de dormir se marca como dormido y vuelve a buscar tareas, así que una que llegue mientras tanto
+se ve aquí o lo despierta.
+*/
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    self_worker = w;
+    if (coro_worker_start) coro_worker_start((int)(w - workers));
+    w->victim = (unsigned)(w - workers) + 1;
+    struct epoll_event events[CORO_MAX_EVENTS];
+    while (1) {
+        pthread_mutex_lock(&w->lock);
+        coro_t *batch = w->ready_head;
+        w->ready_head = w->ready_tail = NULL;
+        pthread_mutex_unlock(&w->lock);
+        while (batch) {
+            coro_t *co = batch;
+            batch = co->next;
+            run(w, co);
+        }
+        run_tasks(w);
+
+        pthread_mutex_lock(&w->lock);
+        bool pending = w->ready_head != NULL;
+        pthread_mutex_unlock(&w->lock);
+        if (!pending) {
+            atomic_store(&w->sleeping, true);
+            pending = atomic_load(&queued_tasks) > 0;
+        }
+        int n = epoll_wait(w->epfd, events, CORO_MAX_EVENTS, pending ? 0 : next_timeout(w));
+        atomic_store(&w->sleeping, false);
+        for (int i = 0; i < n; i++) {
+            coro_wait_t *waiting = events[i].data.ptr;
+            if (!waiting) {
+                uint64_t value;
+                if (read(w->wakefd, &value, sizeof(value)) < 0) {
+                    // Otro aviso ya lo vació
+                }
+                pthread_mutex_lock(&w->lock);
+                w->notified = false;
+                pthread_mutex_unlock(&w->lock);
+                continue;
+            }
+            waiting->events |= events[i].events;
+            wake(waiting->co, false);
+        }
+        expire_timers(w);
+    }
+    return NULL;
+}
+
+/*
+Funcion que arranca los workers. Sin llamarla coro_spawn falla y coro_poll es poll().
+Parametros:
+    * int count: cantidad de workers (threads)
+Retornos:
+    * int: 0 para exito y -1 si no se pudo crear ninguno
+*/
+int coro_start(int count) {
+    if (count < 1) count = 1;
+    if (count > CORO_MAX_WORKERS) count = CORO_MAX_WORKERS;
+    page_size = sysconf(_SC_PAGESIZE);
+    workers = aligned_alloc(_Alignof(worker_t), count * sizeof(worker_t));
+    if (!workers) return -1;
+    memset(workers, 0, count * sizeof(worker_t));
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        worker_t *w = &workers[i];
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_mutex_init(&w->task_lock, NULL);
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        w->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        if (w->epfd < 0 || w->wakefd < 0 || epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakefd, &ev) != 0 ||
+            pthread_create(&w->thread, NULL, &worker_main, w) != 0) {
+            break;
+        }
+        started++;
+    }
+    n_workers = started;
+    return started > 0 ? 0 : -1;
+}
+
+/*
+Funcion que indica cuántos workers corren (0 si el runtime no arrancó).
+*/
+int coro_workers(void) {
+    return n_workers;
+}
+
+/*
+Funcion que crea una corrutina en el worker con menos corrutinas; empieza a correr en cuanto el worker la toma.
+Parametros:
+    * coro_fn fn: función de la corrutina; cuando retorna la corrutina termina y su stack vuelve al pool
+    * void *arg: argumento de fn
+Retornos:
+    * coro_t *: la corrutina, NULL si el runtime no arrancó o no hubo memoria
+*/
+coro_t *coro_spawn(coro_fn fn, void *arg) {
+    if (n_workers == 0) return NULL;
+    worker_t *w = &workers[0];
+    for (int i = 1; i < n_workers; i++) {
+        if (atomic_load(&workers[i].count) < atomic_load(&w->count)) w = &workers[i];
+    }
+    coro_t *co = calloc(1, sizeof(coro_t));
+    if (!co) return NULL;
+    co->stack = stack_alloc(w);
+    if (!co->stack) {
+        free(co);
+        return NULL;
+    }
+    co->worker = w;
+    co->fn = fn;
+    co->arg = arg;
+    for (int i = 0; i < CORO_MAX_WATCHES; i++) co->watched[i] = -1;
+    atomic_fetch_add(&w->count, 1);
+    pthread_mutex_lock(&w->lock);
+    ready_locked(w, co);
+    pthread_mutex_unlock(&w->lock);
+    return co;
+}
+
+/*
+Funcion que retorna la corrutina que está corriendo, NULL si se llama desde un thread normal.
+*/
+coro_t *coro_self(void) {
+    return self_worker ? self_worker->current : NULL;
+}
+
+static uint32_t to_epoll(short events) {
+    return (events & POLLIN ? EPOLLIN : 0) | (events & POLLOUT ? EPOLLOUT : 0) | (events & POLLPRI ? EPOLLPRI : 0);
+}
+
+static short to_poll(uint32_t events) {
+    return (events & EPOLLIN ? POLLIN : 0) | (events & EPOLLOUT ? POLLOUT : 0) | (events & EPOLLPRI ? POLLPRI : 0) |
+           (events & EPOLLERR ? POLLERR : 0) | (events & EPOLLHUP ? POLLHUP : 0);
+}
+
+/*
+Funcion que retorna el registro de coro_watch que sirve para esperar un descriptor: solo si es de lectura, que es lo
+que se vigila.
+*/
+static coro_wait_t *watch_for(coro_t *co, const struct pollfd *pfd) {
+    if (pfd->fd < 0 || (pfd->events & ~POLLIN) != 0) return NULL;
+    for (int i = 0; i < CORO_MAX_WATCHES; i++) {
+        if (co->watched[i] == pfd->fd) return &co->watches[i];
+    }
+    return NULL;
+}
+
+// Los eventos los acumula el thread del worker, que es el mismo que corre la corrutina
+static uint32_t take_events(coro_wait_t *watch) {
+    uint32_t events = watch->events;
+    watch->events = 0;
+    return (events & (EPOLLIN | EPOLLRDHUP) ? EPOLLIN : 0) | (events & (EPOLLERR | EPOLLHUP));
+}
+
+/*
+Funcion que suspende a la corrutina hasta que algún descriptor esté listo, llegue el plazo o la interrumpan.
+Los descriptores vigilados con coro_watch no se registran: si ya llegó algo desde la última espera no se suspende.
+Si un descriptor no se puede registrar (ya está en el epoll por otra corrutina del worker, o son demasiados)
+la corrutina revisa con poll cada milisegundo.
+Retornos:
+    * int: descriptores listos (con revents), 0 si ninguno y -1 si falló el poll de revisión
+*/
+static int suspend(worker_t *w, coro_t *co, struct pollfd *fds, nfds_t nfds, uint64_t deadline) {
+    bool polling = nfds > CORO_MAX_FDS;
+    bool pending = false;
+    nfds_t registered = 0;
+    for (; registered < nfds && !polling; registered++) {
+        fds[registered].revents = 0;
+        co->waits[registered] = (coro_wait_t){ .co = co, .events = 0 };
+        if (fds[registered].fd < 0) continue;
+        coro_wait_t *watch = watch_for(co, &fds[registered]);
+        if (watch) {
+            if (watch->events) pending = true;
+            continue;
+        }
+        struct epoll_event ev = { .events = to_epoll(fds[registered].events), .data.ptr = &co->waits[registered] };
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fds[registered].fd, &ev) != 0) polling = true;
+    }
+    if (polling && registered > 0) registered--;  // El que falló no quedó registrado
+
+    uint64_t wake_at = deadline;
+    if (polling) {
+        uint64_t tick = now_ns() + 1000000;
+        if (!wake_at || tick < wake_at) wake_at = tick;
+    }
+    co->deadline = wake_at;
+    if (wake_at) timed_insert(w, co);
+    pthread_mutex_lock(&w->lock);
+    bool interrupted = co->interrupted;
+    if (!interrupted && !pending) co->state = CORO_WAITING;
+    pthread_mutex_unlock(&w->lock);
+    // Quien la despierte solo la pone en la cola: el worker la retoma después de este cambio, nunca antes
+    if (!interrupted && !pending) swapcontext(&co->context, &w->scheduler);
+    if (wake_at) timed_remove(w, co);
+
+    int ready = 0;
+    for (nfds_t i = 0; i < registered; i++) {
+        if (fds[i].fd < 0) continue;
+        coro_wait_t *watch = watch_for(co, &fds[i]);
+        uint32_t events = watch ? take_events(watch) : co->waits[i].events;
+        if (!watch) epoll_ctl(w->epfd, EPOLL_CTL_DEL, fds[i].fd, NULL);
+        fds[i].revents = to_poll(events) & (fds[i].events | POLLERR | POLLHUP);
+        if (fds[i].revents) ready++;
+    }
+    if (polling) ready = poll(fds, nfds, 0);
+    return ready;
+}
+
+/*
+Funcion con la semántica de poll() que, dentro de una corrutina, la suspende en lugar de bloquear al worker.
+Fuera de una corrutina es poll(). coro_interrupt hace que la espera retorne -1 con errno EINTR, como una señal
+sin SA_RESTART a un thread bloqueado en poll.
+Parametros:
+    * struct pollfd *fds: descriptores (puede ser NULL con nfds 0 para solo esperar timeout)
+    * nfds_t nfds: cantidad de descriptores
+    * int timeout: milisegundos, -1 sin límite
+Retornos:
+    * int: descriptores listos, 0 si se cumplió el plazo y -1 para errores o interrupciones
+*/
+int coro_poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+    coro_t *co = coro_self();
+    if (!co || timeout == 0) return poll(fds, nfds, timeout);
+    worker_t *w = co->worker;
+    uint64_t deadline = timeout > 0 ? now_ns() + (uint64_t)timeout * 1000000ull : 0;
+    while (1) {
+        if (take_interrupt(co)) {
+            errno = EINTR;
+            return -1;
+        }
+        int ready = suspend(w, co, fds, nfds, deadline);
+        if (ready != 0) return ready;
+        if (deadline && now_ns() >= deadline) {
+            if (take_interrupt(co)) {
+                errno = EINTR;
+                return -1;
+            }
+            return 0;
+        }
+    }
+}
+
+/*
+Funcion que deja un descriptor registrado en el epoll del worker mientras la corrutina viva, en modo edge-triggered:
+sus esperas de lectura con coro_poll ya no lo agregan ni lo quitan. Como un evento solo llega cuando entra algo nuevo,
+sirve para un descriptor que se lee hasta EAGAIN antes de cada espera (como el socket de un handler).
+Fuera de una corrutina no hace nada.
+Retornos:
+    * int: 0 si quedó vigilado (o no hay corrutina) y -1 si no se pudo (sus esperas lo registran cada vez)
+*/
+int coro_watch(int fd) {
+    coro_t *co = coro_self();
+    if (!co || fd < 0) return 0;
+    for (int i = 0; i < CORO_MAX_WATCHES; i++) {
+        if (co->watched[i] >= 0) continue;
+        co->watches[i] = (coro_wait_t){ .co = co, .events = 0 };
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | EPOLLET, .data.ptr = &co->watches[i] };
+        if (epoll_ctl(co->worker->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) return -1;
+        co->watched[i] = fd;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+Funcion que quita un descriptor de coro_watch de la corrutina que corre; si no lo vigila no hace nada.
+Hay que llamarla antes de cerrarlo: si el descriptor sigue abierto en otro lado (por ejemplo, traspasado a otro
+proceso) el registro no se iría solo, y con el número reutilizado ya no se podría quitar.
+*/
+void coro_unwatch(int fd) {
+    coro_t *co = coro_self();
+    if (!co || fd < 0) return;
+    for (int i = 0; i < CORO_MAX_WATCHES; i++) {
+        if (co->watched[i] != fd) continue;
+        epoll_ctl(co->worker->epfd, EPOLL_CTL_DEL, fd, NULL);
+        co->watched[i] = -1;
+    }
+}
+
+/*
+Funcion que interrumpe la espera en curso de una corrutina, o la siguiente si no está esperando.
+Se puede llamar desde cualquier thread mientras la corrutina exista.
+*/
+void coro_interrupt(coro_t *co) {
+    if (co) wake(co, true);
+}
+
+/*
+Funcion que corre un paso pesado de un handler en el pool y espera a que termine: lo corre el propio worker si
+nadie lo roba antes. La corrutina sigue suspendida mientras tanto (una interrupción no la despierta antes de tiempo),
+así que los pasos de una conexión se siguen haciendo en orden.
+Fuera de una corrutina, o si no hay memoria para encolarlo, fn corre ahí mismo.
+Parametros:
+    * coro_fn fn: paso a correr; no debe esperar con coro_poll (corre en un thread, fuera de la corrutina)
+    * void *arg: argumento de fn
+*/
+void coro_run_task(coro_fn fn, void *arg) {
+    coro_t *co = coro_self();
+    coro_task_t task = { .fn = fn, .arg = arg, .waiter = co, .done = false };
+    if (!co || task_push(co->worker, &task) != 0) {
+        fn(arg);
+        return;
+    }
+    worker_t *w = co->worker;
+    pthread_mutex_lock(&w->lock);
+    while (!task.done) {
+        co->state = CORO_WAITING;
+        pthread_mutex_unlock(&w->lock);
+        swapcontext(&co->context, &w->scheduler);
+        pthread_mutex_lock(&w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*
+Funcion que cuenta las corrutinas vivas de todos los workers.
+*/
+size_t coro_count(void) {
+    size_t count = 0;
+    for (int i = 0; i < n_workers; i++) {
+        count += atomic_load(&workers[i].count);
+    }
+    return count;
+}
+
+/*
+Funcion que retorna el espacio de direcciones reservado para stacks, incluidos los del pool y sus páginas de guarda.
+*/
+size_t coro_stack_bytes(void) {
+    return atomic_load(&stack_bytes);
+}
+
+/*
+Funcion que cuenta las tareas que terminaron, y de ellas las que corrió un worker distinto al de su corrutina.
+*/
+uint64_t coro_tasks_run(void) {
+    return atomic_load(&tasks_run);
+}
+
+uint64_t coro_tasks_stolen(void) {
+    return atomic_load(&tasks_stolen);
+}
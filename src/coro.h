@@ -0,0 +1,64 @@
+/*
+    * coro.h
+    * Stackful coroutines (ucontext) run by a few worker threads, so every connection keeps its sequential handler
+    * (recv -> unpack -> switch -> send) without a thread of its own.
+    * A coroutine that would block waiting for a socket or an eventfd is suspended instead: coro_poll registers the
+    * descriptors in the epoll of its worker and switches to the next ready coroutine. The descriptor a coroutine reads
+    * all the time (its client's socket) is registered once with coro_watch, edge-triggered, so waiting on it costs no
+    * epoll_ctl; only the rarer extra descriptors (doorbells, eventfds) are added and removed on every wait. A coroutine never moves to another
+    * worker, so thread-local state (the per-thread deflater, metric shards) stays consistent across a suspension.
+    * Each stack is CORO_STACK_SIZE of address space over a guard page; only the pages a handler touches become
+    * resident, and the stacks of finished coroutines stay in a pool of their worker, already faulted in.
+    * A coroutine must not suspend while it holds a mutex that another coroutine of the same worker may take: that
+    * would block the worker with the holder inside it.
+    * Nor may a handler block the thread in any other way. In the server the waits a handler can reach are the next
+    * frame, the backlog of stream recipients and the pause of a hot restart, all through coro_poll; its sends only
+    * queue in the output lanes (a full control lane closes the connection instead of waiting), and a connection
+    * without lanes gets a thread of its own. Resuming a session waits on a condition, but only in the acceptor.
+    * The workers are also a work-stealing pool for heavy steps of a handler (coro_run_task): the task goes to the
+    * bottom of its worker's deque and the coroutine waits for it. The owner takes the newest task of its deque, while
+    * a worker with nothing to run steals the oldest task of another one. Coroutines themselves never move, since an
+    * event of their worker's epoll may still point at them, but their tasks run on whichever core is free.
+    * A task runs on the scheduler stack of a worker, so it must not wait either; the server's tasks hold their writes
+    * (lanes_hold), so an idle connection still gets a direct non-blocking write and whatever has to queue is written by
+    * the coroutine once coro_run_task returns. Their fan-outs only copy the recipients under the registry lock, so
+    * tasks stolen by different workers run at the same time.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef CORO_H
+#define CORO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <poll.h>
+
+#define CORO_STACK_SIZE (64 * 1024)  // Espacio de direcciones por corrutina, sin contar la página de guarda
+#define CORO_STACK_POOL 256  // Stacks libres que guarda cada worker para reutilizarlos
+#define CORO_MAX_WORKERS 64
+#define CORO_MAX_FDS 4  // Descriptores que coro_poll registra en el epoll; con más espera revisando cada milisegundo
+#define CORO_MAX_WATCHES 2  // Descriptores que una corrutina puede dejar registrados con coro_watch
+#define CORO_MAX_EVENTS 64
+#define CORO_TASK_BATCH 64  // Tareas que un worker corre seguidas antes de volver a sus corrutinas y su epoll
+
+typedef struct coro coro_t;
+typedef void (*coro_fn)(void *arg);
+
+// Se llama al empezar cada worker, en su thread y antes de correr nada (por ejemplo, para fijarlo a un CPU)
+extern void (*coro_worker_start)(int index);
+
+int coro_start(int workers);
+int coro_workers(void);
+coro_t *coro_spawn(coro_fn fn, void *arg);
+coro_t *coro_self(void);
+int coro_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+int coro_watch(int fd);
+void coro_unwatch(int fd);
+void coro_interrupt(coro_t *co);
+void coro_run_task(coro_fn fn, void *arg);
+size_t coro_count(void);
+size_t coro_stack_bytes(void);
+uint64_t coro_tasks_run(void);
+uint64_t coro_tasks_stolen(void);
+
+#endif
@@ -0,0 +1,621 @@
+/*
+    * federation.c
+    * Implementation of the inter-node links and the replicated user directory of the federation.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "chat.pb-c.h"
+#include "metrics.h"
+#include "membudget.h"
+#include "transport.h"
+#include "hashring.h"
+#include "federation.h"
+
+// Enlace de salida hacia otro nodo; solo su thread escribe en el socket
+typedef struct {
+    uint32_t node_id;
+    char host[64];
+    int port;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    frame_buffer_t queue;    // Elementos de un NodeBatch esperando el próximo frame (protegido por lock)
+    frame_buffer_t sending;  // Frame que el thread está enviando; se intercambia con queue (protegido por lock)
+    size_t queued_events;    // Eventos en queue
+    size_t mem_queues;       // Lo registrado en el presupuesto de memoria por queue y sending
+    bool connected;          // Mientras no lo está, los eventos se descartan
+
+    // Miembro del anillo mientras tenga un enlace de entrada vivo y no haya avisado que se va (protegido por ring_lock)
+    int inbound_links;
+    bool leaving;
+    uint32_t client_port;    // Puerto de clientes del nodo, para las redirecciones (llega en HELLO)
+} peer_t;
+
+typedef struct directory_entry {
+    federation_user_t user;
+    uint64_t link;  // Enlace de entrada por el que llegó; cuando ese enlace cae el usuario se olvida
+    struct directory_entry *next;
+} directory_entry_t;
+
+uint32_t federation_node_id = 0;
+
+static peer_t peers[FEDERATION_MAX_PEERS];
+static int n_peers = 0;
+static federation_callbacks_t callbacks;
+static uint32_t client_port;
+
+static hashring_t ring;  // Nodos vivos, incluido este mientras no se esté yendo
+static bool self_leaving = false;
+static pthread_rwlock_t ring_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static directory_entry_t *directory[FEDERATION_DIRECTORY_BUCKETS];
+static size_t directory_size = 0;
+static pthread_mutex_t directory_mutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_uint_fast64_t last_link = 0;
+
+// FNV-1a del nombre
+static size_t directory_bucket(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash % FEDERATION_DIRECTORY_BUCKETS;
+}
+
+// Debe llamarse con directory_mutex bloqueado
+static directory_entry_t *directory_find(const char *name, size_t len) {
+    for (directory_entry_t *e = directory[directory_bucket(name, len)]; e; e = e->next) {
+        if (strlen(e->user.username) == len && memcmp(e->user.username, name, len) == 0) return e;
+    }
+    return NULL;
+}
+
+/*
+Funcion que agrega un usuario de otro nodo al directorio, o actualiza su estado si ya estaba.
+Un usuario que se registra en otro nodo reemplaza al anterior: el enlace nuevo pasa a ser el dueño.
+*/
+static void directory_put(const char *name, uint32_t node_id, int status, uint64_t link) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= sizeof(((federation_user_t *)0)->username)) return;
+    pthread_mutex_lock(&directory_mutex);
+    directory_entry_t *e = directory_find(name, len);
+    if (!e && (e = calloc(1, sizeof(*e)))) {
+        memcpy(e->user.username, name, len + 1);
+        size_t bucket = directory_bucket(name, len);
+        e->next = directory[bucket];
+        directory[bucket] = e;
+        directory_size++;
+        mem_charge(MEM_CLIENTS, sizeof(*e));
+    }
+    if (e) {
+        e->user.node_id = node_id;
+        e->user.status = status;
+        e->link = link;
+    }
+    pthread_mutex_unlock(&directory_mutex);
+}
+
+/*
+Funcion que borra del directorio los usuarios que llegaron por un enlace.
+Parametros:
+    * const char *name: usuario a borrar, o NULL para todos los del enlace
+    * uint64_t link: enlace de entrada que avisa; un usuario que ya se registró en otro nodo no se toca
+*/
+static void directory_remove(const char *name, uint64_t link) {
+    pthread_mutex_lock(&directory_mutex);
+    size_t first = name ? directory_bucket(name, strlen(name)) : 0;
+    size_t last = name ? first : FEDERATION_DIRECTORY_BUCKETS - 1;
+    for (size_t bucket = first; bucket <= last; bucket++) {
+        directory_entry_t **prev = &directory[bucket];
+        while (*prev) {
+            directory_entry_t *e = *prev;
+            if (e->link == link && (!name || strcmp(e->user.username, name) == 0)) {
+                *prev = e->next;
+                free(e);
+                directory_size--;
+                mem_charge(MEM_CLIENTS, -(int64_t)sizeof(*e));
+            } else {
+                prev = &e->next;
+            }
+        }
+    }
+    pthread_mutex_unlock(&directory_mutex);
+}
+
+/*
+Funcion que busca un usuario de otro nodo en el directorio.
+Parametros:
+    * const char *username: nombre del usuario
+    * federation_user_t *user: copia de la entrada (puede ser NULL)
+Retornos:
+    * bool: true si el usuario está registrado en otro nodo
+*/
+bool federation_lookup(const char *username, federation_user_t *user) {
+    if (federation_node_id == 0) return false;
+    pthread_mutex_lock(&directory_mutex);
+    directory_entry_t *e = directory_find(username, strlen(username));
+    if (e && user) *user = e->user;
+    pthread_mutex_unlock(&directory_mutex);
+    return e != NULL;
+}
+
+/*
+Funcion que copia el directorio completo, para listar los usuarios de todo el cluster.
+Parametros:
+    * federation_user_t **users: arreglo reservado con malloc que el llamador debe liberar (NULL si está vacío)
+Retornos:
+    * size_t: cantidad de usuarios
+*/
+size_t federation_users(federation_user_t **users) {
+    *users = NULL;
+    if (federation_node_id == 0) return 0;
+    pthread_mutex_lock(&directory_mutex);
+    size_t count = 0;
+    if (directory_size > 0 && (*users = malloc(directory_size * sizeof(federation_user_t)))) {
+        for (size_t bucket = 0; bucket < FEDERATION_DIRECTORY_BUCKETS; bucket++) {
+            for (directory_entry_t *e = directory[bucket]; e; e = e->next) {
+                (*users)[count++] = e->user;
+            }
+        }
+    }
+    pthread_mutex_unlock(&directory_mutex);
+    return count;
+}
+
+// Debe llamarse con el lock del peer bloqueado
+static bool queue_event(peer_t *peer, const codec_node_event_t *event) {
+    size_t size = codec_node_batch_entry_size(event);
+    if (peer->queue.len - peer->queue.start + size > FEDERATION_QUEUE_MAX_BYTES) return false;
+    uint8_t *out = frame_buffer_reserve(&peer->queue, size);
+    if (!out) return false;
+    codec_encode_node_batch_entry(event, out);
+    if (peer->queued_events++ == 0) pthread_cond_signal(&peer->cond);
+    mem_resize(MEM_QUEUES, &peer->mem_queues, peer->queue.cap + peer->sending.cap);
+    return true;
+}
+
+/*
+Funcion que agrega un evento a la cola de un peer; el thread del enlace lo envía en su próximo frame.
+Retornos:
+    * bool: false si el enlace está caído o la cola llena (el evento se descarta)
+*/
+static bool peer_enqueue(peer_t *peer, const codec_node_event_t *event) {
+    pthread_mutex_lock(&peer->lock);
+    bool queued = peer->connected && queue_event(peer, event);
+    pthread_mutex_unlock(&peer->lock);
+    return queued;
+}
+
+static peer_t *find_peer(uint32_t node_id) {
+    for (int i = 0; i < n_peers; i++) {
+        if (peers[i].node_id == node_id) return &peers[i];
+    }
+    return NULL;
+}
+
+// Debe llamarse con ring_lock bloqueado para escritura
+static void rebuild_ring(void) {
+    uint32_t nodes[FEDERATION_MAX_PEERS + 1];
+    size_t n_nodes = 0;
+    if (!self_leaving) nodes[n_nodes++] = federation_node_id;
+    for (int i = 0; i < n_peers; i++) {
+        if (peers[i].inbound_links > 0 && !peers[i].leaving) nodes[n_nodes++] = peers[i].node_id;
+    }
+    hashring_t next;
+    if (hashring_build(&next, nodes, n_nodes) != 0) return;
+    hashring_free(&ring);
+    ring = next;
+    printf("\033[33m\n(*) Federation: %zu nodes in the ring\n\033[0m", n_nodes);
+}
+
+/*
+Funcion que busca el nodo dueño de un nombre si no es este.
+Parametros:
+    * const char *username: nombre del usuario
+    * federation_node_t *node: id, IPv4 (la de --peer) y puerto de clientes del dueño
+Retornos:
+    * bool: true si el nombre es de otro nodo vivo
+*/
+bool federation_redirect(const char *username, federation_node_t *node) {
+    if (federation_node_id == 0) return false;
+    pthread_rwlock_rdlock(&ring_lock);
+    uint32_t owner = hashring_owner(&ring, username, strlen(username));
+    peer_t *peer = owner != federation_node_id ? find_peer(owner) : NULL;
+    if (peer) {
+        node->node_id = owner;
+        snprintf(node->address, sizeof(node->address), "%s", peer->host);
+        node->port = peer->client_port;
+    }
+    pthread_rwlock_unlock(&ring_lock);
+    return peer != NULL;
+}
+
+/*
+Funcion que envía una sesión reanudable a su nuevo dueño, si ya no es este nodo.
+Debe llamarse con clients_mutex bloqueado; si retorna true el servidor debe soltar la sesión (y cerrar su conexión).
+Parametros:
+    * const federation_session_t *session: estado de la sesión
+    * uint32_t *node_id: nodo al que se envió
+Retornos:
+    * bool: true si la sesión quedó en la cola del enlace hacia su dueño
+*/
+bool federation_migrate(const federation_session_t *session, uint32_t *node_id) {
+    federation_node_t owner;
+    if (!federation_redirect(session->username, &owner)) return false;
+    codec_node_event_t event = {
+        .type = CHAT__NODE_EVENT_TYPE__NODE_SESSION,
+        .username = codec_str(session->username),
+        .status = session->status,
+        .session_token = codec_str(session->session_token),
+        .next_sequence = session->next_sequence,
+        .replay_first = session->replay_first,
+        .replay = { (const char *)session->replay, session->replay_len }
+    };
+    peer_t *peer = find_peer(owner.node_id);
+    if (!peer || !peer_enqueue(peer, &event)) return false;
+    *node_id = owner.node_id;
+    return true;
+}
+
+static void enqueue_all(const codec_node_event_t *event, bool delivery) {
+    for (int i = 0; i < n_peers; i++) {
+        if (!peer_enqueue(&peers[i], event) && delivery) {
+            metrics_count(METRIC_FEDERATION_EVENTS_DROPPED, 1);
+        }
+    }
+}
+
+static void user_event(int type, const char *username, int status) {
+    if (federation_node_id == 0) return;
+    codec_node_event_t event = { .type = type, .username = codec_str(username), .status = status };
+    enqueue_all(&event, false);
+}
+
+/*
+Funciones que replican en los demás nodos los cambios de los usuarios locales.
+Deben llamarse con clients_mutex bloqueado, así los eventos de un usuario salen en el mismo orden en que pasaron
+y no se cruzan con la lista de usuarios que se manda al abrir un enlace.
+*/
+void federation_user_joined(const char *username, int status) {
+    user_event(CHAT__NODE_EVENT_TYPE__NODE_USER_JOINED, username, status);
+}
+
+void federation_user_left(const char *username) {
+    user_event(CHAT__NODE_EVENT_TYPE__NODE_USER_LEFT, username, 0);
+}
+
+void federation_user_status(const char *username, int status) {
+    user_event(CHAT__NODE_EVENT_TYPE__NODE_USER_STATUS, username, status);
+}
+
+/*
+Funcion que reenvía un broadcast de un usuario local a todos los demás nodos, que lo entregan a sus usuarios.
+*/
+void federation_broadcast(codec_str_t sender, codec_str_t content) {
+    if (federation_node_id == 0) return;
+    codec_node_event_t event = { .type = CHAT__NODE_EVENT_TYPE__NODE_BROADCAST, .sender = sender, .content = content };
+    enqueue_all(&event, true);
+}
+
+/*
+Funcion que envía un mensaje directo al nodo dueño del destinatario.
+Parametros:
+    * codec_str_t sender: usuario local que lo envía
+    * codec_str_t recipient: destinatario
+    * codec_str_t content: contenido
+    * int *status: estado del destinatario según el directorio (con OFFLINE el mensaje no se envía)
+Retornos:
+    * bool: true si el destinatario está registrado en otro nodo
+*/
+bool federation_direct(codec_str_t sender, codec_str_t recipient, codec_str_t content, int *status) {
+    if (federation_node_id == 0) return false;
+    pthread_mutex_lock(&directory_mutex);
+    directory_entry_t *e = directory_find(recipient.data, recipient.len);
+    federation_user_t user;
+    if (e) user = e->user;
+    pthread_mutex_unlock(&directory_mutex);
+    if (!e) return false;
+
+    *status = user.status;
+    if (user.status == CHAT__USER_STATUS__OFFLINE) return true;
+    codec_node_event_t event = {
+        .type = CHAT__NODE_EVENT_TYPE__NODE_DIRECT,
+        .username = recipient,
+        .sender = sender,
+        .content = content
+    };
+    bool queued = false;
+    for (int i = 0; i < n_peers && !queued; i++) {
+        if (peers[i].node_id == user.node_id) queued = peer_enqueue(&peers[i], &event);
+    }
+    if (!queued) metrics_count(METRIC_FEDERATION_EVENTS_DROPPED, 1);
+    return true;
+}
+
+static void emit_joined(void *ctx, const char *username, int status) {
+    codec_node_event_t event = {
+        .type = CHAT__NODE_EVENT_TYPE__NODE_USER_JOINED,
+        .username = codec_str(username),
+        .status = status
+    };
+    peer_enqueue(ctx, &event);
+}
+
+/*
+Funcion del thread de un enlace de salida: se conecta al peer (reintentando mientras esté caído), empieza con HELLO
+y los usuarios locales, y después envía en un solo frame todo lo que se acumuló en la cola mientras enviaba el anterior.
+*/
+static void *peer_writer(void *arg) {
+    peer_t *peer = arg;
+    bool reported = false;
+    while (1) {
+        int fd = transport_connect(peer->host, peer->port);
+        if (fd < 0) {
+            if (!reported) {
+                printf("\033[33m\n(*) Federation: node %u (%s:%d) unreachable, retrying\n\033[0m", peer->node_id, peer->host, peer->port);
+                reported = true;
+            }
+            sleep(FEDERATION_RECONNECT_SECONDS);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        reported = false;
+        printf("\033[32m\n(*) Federation: linked to node %u (%s:%d)\n\033[0m", peer->node_id, peer->host, peer->port);
+
+        // HELLO tiene que ser lo primero del enlace; los cambios de usuarios que se encolen mientras se arma la
+        // lista llegan después de ella y el directorio del otro nodo termina igual que clients[]
+        codec_node_event_t hello = {
+            .type = CHAT__NODE_EVENT_TYPE__NODE_HELLO,
+            .node_id = federation_node_id,
+            .client_port = client_port
+        };
+        pthread_mutex_lock(&peer->lock);
+        peer->queue.start = peer->queue.len = 0;
+        peer->queued_events = 0;
+        peer->connected = queue_event(peer, &hello);
+        pthread_mutex_unlock(&peer->lock);
+        callbacks.local_users(emit_joined, peer);
+        callbacks.rebalance();  // Las sesiones que no pudieron migrar mientras el enlace estaba caído
+
+        int rc = 0;
+        while (rc == 0) {
+            pthread_mutex_lock(&peer->lock);
+            while (peer->queued_events == 0) {
+                pthread_cond_wait(&peer->cond, &peer->lock);
+            }
+            frame_buffer_t batch = peer->queue;
+            peer->queue = peer->sending;
+            peer->sending = batch;
+            size_t events = peer->queued_events;
+            peer->queued_events = 0;
+            pthread_mutex_unlock(&peer->lock);
+
+            rc = send_frame(fd, peer->sending.data + peer->sending.start, peer->sending.len - peer->sending.start);
+            if (rc == 0) {
+                metrics_count(METRIC_FEDERATION_EVENTS_SENT, events);
+                metrics_count(METRIC_FEDERATION_BATCHES_SENT, 1);
+            } else {
+                metrics_count(METRIC_FEDERATION_EVENTS_DROPPED, events);
+            }
+            pthread_mutex_lock(&peer->lock);
+            peer->sending.start = peer->sending.len = 0;
+            pthread_mutex_unlock(&peer->lock);
+        }
+
+        pthread_mutex_lock(&peer->lock);
+        peer->connected = false;
+        metrics_count(METRIC_FEDERATION_EVENTS_DROPPED, peer->queued_events);
+        peer->queue.start = peer->queue.len = 0;
+        peer->queued_events = 0;
+        pthread_mutex_unlock(&peer->lock);
+        close(fd);
+        printf("\033[91m\n(*) Federation: link to node %u lost\n\033[0m", peer->node_id);
+        sleep(FEDERATION_RECONNECT_SECONDS);
+    }
+    return NULL;
+}
+
+// Actualiza la membresía de un nodo en el anillo; retorna true si el nodo es un peer configurado
+static bool update_member(uint32_t node_id, int links, bool leaving, uint32_t port) {
+    pthread_rwlock_wrlock(&ring_lock);
+    peer_t *peer = find_peer(node_id);
+    if (peer) {
+        peer->inbound_links += links;
+        peer->leaving = leaving;
+        if (port) peer->client_port = port;
+        rebuild_ring();
+    }
+    pthread_rwlock_unlock(&ring_lock);
+    return peer != NULL;
+}
+
+/*
+Funcion del thread de un enlace de entrada: aplica los eventos de cada NodeBatch que manda el otro nodo.
+Al cerrarse el enlace se olvidan los usuarios que ese nodo había anunciado por él y sale del anillo.
+*/
+static void *peer_reader(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    uint64_t link = atomic_fetch_add(&last_link, 1) + 1;
+    uint32_t node_id = 0;
+    bool member = false;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    while ((len = recv_frame(fd, &buffer, &capacity)) > 0 || (len < 0 && errno == EINTR)) {
+        if (len < 0) continue;
+        Chat__NodeBatch *batch = chat__node_batch__unpack(NULL, len, buffer);
+        if (!batch) break;
+        metrics_count(METRIC_FEDERATION_EVENTS_RECEIVED, batch->n_events);
+        bool ring_changed = false;
+        for (size_t i = 0; i < batch->n_events; i++) {
+            Chat__NodeEvent *event = batch->events[i];
+            if (event->type == CHAT__NODE_EVENT_TYPE__NODE_HELLO) {
+                if (node_id != 0 || event->node_id == 0 || event->node_id == federation_node_id) break;
+                node_id = event->node_id;
+                member = update_member(node_id, 1, false, event->client_port);
+                ring_changed = member;
+                printf("\033[32m\n(*) Federation: node %u connected\n\033[0m", node_id);
+                continue;
+            }
+            if (node_id == 0) continue;  // Todo enlace empieza con HELLO
+            switch (event->type) {
+                case CHAT__NODE_EVENT_TYPE__NODE_USER_JOINED:
+                case CHAT__NODE_EVENT_TYPE__NODE_USER_STATUS:
+                    directory_put(event->username, node_id, event->status, link);
+                    break;
+                case CHAT__NODE_EVENT_TYPE__NODE_USER_LEFT:
+                    directory_remove(event->username, link);
+                    break;
+                case CHAT__NODE_EVENT_TYPE__NODE_BROADCAST:
+                    callbacks.deliver_broadcast(event->sender, event->content);
+                    break;
+                case CHAT__NODE_EVENT_TYPE__NODE_DIRECT:
+                    callbacks.deliver_direct(event->sender, event->username, event->content);
+                    break;
+                case CHAT__NODE_EVENT_TYPE__NODE_LEAVING:
+                    printf("\033[33m\n(*) Federation: node %u is leaving\n\033[0m", node_id);
+                    ring_changed = member && update_member(node_id, 0, true, 0);
+                    break;
+                case CHAT__NODE_EVENT_TYPE__NODE_SESSION: {
+                    federation_session_t session = {
+                        .username = event->username,
+                        .status = event->status,
+                        .session_token = event->session_token,
+                        .next_sequence = event->next_sequence,
+                        .replay_first = event->replay_first,
+                        .replay = event->replay.data,
+                        .replay_len = event->replay.len
+                    };
+                    callbacks.adopt_session(&session);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        chat__node_batch__free_unpacked(batch, NULL);
+        if (ring_changed) callbacks.rebalance();
+    }
+    directory_remove(NULL, link);
+    if (member) {
+        update_member(node_id, -1, false, 0);
+        callbacks.rebalance();
+    }
+    free(buffer);
+    close(fd);
+    if (node_id != 0) {
+        printf("\033[91m\n(*) Federation: node %u disconnected\n\033[0m", node_id);
+    }
+    return NULL;
+}
+
+static void *accept_peers(void *arg) {
+    int listenfd = (int)(intptr_t)arg;
+    while (1) {
+        int fd = accept(listenfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) sleep(1);
+            continue;
+        }
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, &peer_reader, (void *)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+    return NULL;
+}
+
+/*
+Funcion que agrega un nodo a la federación.
+Parametros:
+    * const char *spec: "<id>@<IPv4>:<puerto>", con el puerto de enlaces (--node-port) del otro nodo
+Retornos:
+    * int: 0 para exito y -1 si spec no es válido o ya hay FEDERATION_MAX_PEERS
+*/
+int federation_add_peer(const char *spec) {
+    if (n_peers == FEDERATION_MAX_PEERS) return -1;
+    char *end;
+    unsigned long node_id = strtoul(spec, &end, 10);
+    const char *colon = strrchr(spec, ':');
+    if (node_id == 0 || node_id > UINT32_MAX || *end != '@' || !colon || colon < end) return -1;
+    size_t host_len = colon - (end + 1);
+    int port = atoi(colon + 1);
+    if (host_len == 0 || host_len >= sizeof(peers[0].host) || port <= 0 || port > 65535) return -1;
+
+    peer_t *peer = &peers[n_peers];
+    memset(peer, 0, sizeof(*peer));
+    peer->node_id = node_id;
+    memcpy(peer->host, end + 1, host_len);
+    peer->port = port;
+    pthread_mutex_init(&peer->lock, NULL);
+    pthread_cond_init(&peer->cond, NULL);
+    frame_buffer_init(&peer->queue);
+    frame_buffer_init(&peer->sending);
+    n_peers++;
+    return 0;
+}
+
+/*
+Funcion que abre el puerto de enlaces y los threads que se conectan a cada peer.
+federation_node_id debe estar asignado (distinto de 0 y único en el cluster).
+Parametros:
+    * int node_port: puerto TCP donde los demás nodos abren sus enlaces hacia este
+    * int port: puerto de clientes de este nodo, al que los demás redirigen sus usuarios
+    * const federation_callbacks_t *cb: entrega local y lista de usuarios del servidor
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escuchar en node_port
+*/
+int federation_start(int node_port, int port, const federation_callbacks_t *cb) {
+    callbacks = *cb;
+    client_port = port;
+    pthread_rwlock_wrlock(&ring_lock);
+    rebuild_ring();
+    pthread_rwlock_unlock(&ring_lock);
+    int listenfd = transport_listen_tcp(node_port, SOMAXCONN);
+    if (listenfd < 0) return -1;
+    pthread_t tid;
+    pthread_create(&tid, NULL, &accept_peers, (void *)(intptr_t)listenfd);
+    pthread_detach(tid);
+    for (int i = 0; i < n_peers; i++) {
+        pthread_create(&tid, NULL, &peer_writer, &peers[i]);
+        pthread_detach(tid);
+    }
+    return 0;
+}
+
+/*
+Funcion que saca a este nodo de la federación antes de terminar: avisa a los demás que se va, migra las sesiones
+reanudables a sus nuevos dueños y espera (hasta FEDERATION_LEAVE_TIMEOUT_MS) a que los enlaces las terminen de enviar.
+*/
+void federation_leave(void) {
+    codec_node_event_t leaving = { .type = CHAT__NODE_EVENT_TYPE__NODE_LEAVING };
+    enqueue_all(&leaving, false);
+    pthread_rwlock_wrlock(&ring_lock);
+    self_leaving = true;
+    rebuild_ring();
+    pthread_rwlock_unlock(&ring_lock);
+    callbacks.rebalance();
+
+    for (int waited = 0; waited < FEDERATION_LEAVE_TIMEOUT_MS; waited += 10) {
+        bool pending = false;
+        for (int i = 0; i < n_peers; i++) {
+            pthread_mutex_lock(&peers[i].lock);
+            pending |= peers[i].connected && (peers[i].queued_events > 0 || peers[i].sending.len > peers[i].sending.start);
+            pthread_mutex_unlock(&peers[i].lock);
+        }
+        if (!pending) break;
+        usleep(10000);
+    }
+}
@@ -0,0 +1,87 @@
+/*
+    * federation.h
+    * Multi-node federation: several server processes serve one chat. Every node keeps its own clients[]; a replicated
+    * directory maps the username of every user of the other nodes to the node that owns it, broadcasts are forwarded
+    * to every node and direct messages only to the recipient's node.
+    * Each ordered pair of nodes uses one TCP link in one direction: a node dials every --peer to send its events and
+    * accepts the peers' links on --node-port to receive theirs. Each frame of a link is one NodeBatch (chat.proto) with
+    * every event queued for that peer since the previous frame, so under load a frame carries many messages.
+    * A link starts with HELLO and a USER_JOINED per local user, which rebuilds that node's part of the receiver's
+    * directory; when the link drops the receiver forgets the users it learned through it.
+    * Usernames are placed by consistent hashing (hashring.h) over the live nodes: a node whose link to us is up and
+    * that did not announce it is leaving. A REGISTER_USER for a username owned by another node is answered with a
+    * Redirect, and when the membership changes every node migrates the resumable sessions it no longer owns (name,
+    * status, token and replay window) to their new owner, then closes their connection so the client reconnects
+    * there. A node that receives SIGTERM or SIGINT announces it is leaving and hands over its sessions before exiting.
+    * The links are not authenticated: they must only be reachable by the other nodes (loopback or a private network).
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef FEDERATION_H
+#define FEDERATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "codec.h"
+#include "frame.h"
+
+#define FEDERATION_MAX_PEERS 32
+#define FEDERATION_DIRECTORY_BUCKETS 4096
+#define FEDERATION_QUEUE_MAX_BYTES FRAME_MAX_SIZE  // Eventos pendientes por peer (un frame); lo que no cabe se descarta
+#define FEDERATION_RECONNECT_SECONDS 1  // Espera entre intentos de conectar con un peer caído
+#define FEDERATION_LEAVE_TIMEOUT_MS 3000  // Espera máxima para que las sesiones migradas salgan antes de terminar
+
+// Sesión reanudable que pasa de un nodo a otro
+typedef struct {
+    const char *username;
+    int status;
+    const char *session_token;
+    uint64_t next_sequence;
+    uint64_t replay_first;
+    const uint8_t *replay;  // Ventana de reenvío: INCOMING_MESSAGE numerados, cada uno con su header de frame
+    size_t replay_len;
+} federation_session_t;
+
+// Nodo dueño de un nombre, para redirigir al cliente
+typedef struct {
+    uint32_t node_id;
+    char address[64];
+    int port;
+} federation_node_t;
+
+// Lo que la federación necesita del servidor; se llama desde los threads de los enlaces
+typedef struct {
+    void (*deliver_broadcast)(const char *sender, const char *content);
+    void (*deliver_direct)(const char *sender, const char *recipient, const char *content);
+    // Llama a emit por cada usuario local, con un estado consistente del registro de clientes
+    void (*local_users)(void (*emit)(void *ctx, const char *username, int status), void *ctx);
+    // Cambiaron los miembros del anillo: migrar las sesiones que ahora son de otro nodo (con federation_migrate)
+    void (*rebalance)(void);
+    // Llegó una sesión migrada desde otro nodo
+    void (*adopt_session)(const federation_session_t *session);
+} federation_callbacks_t;
+
+// Usuario de otro nodo, según el directorio
+typedef struct {
+    char username[32];
+    uint32_t node_id;
+    int status;
+} federation_user_t;
+
+extern uint32_t federation_node_id;  // Id de este nodo, 0 si el servidor corre solo
+
+int federation_add_peer(const char *spec);
+int federation_start(int node_port, int client_port, const federation_callbacks_t *callbacks);
+void federation_leave(void);
+void federation_user_joined(const char *username, int status);
+void federation_user_left(const char *username);
+void federation_user_status(const char *username, int status);
+void federation_broadcast(codec_str_t sender, codec_str_t content);
+bool federation_direct(codec_str_t sender, codec_str_t recipient, codec_str_t content, int *status);
+bool federation_lookup(const char *username, federation_user_t *user);
+bool federation_redirect(const char *username, federation_node_t *node);
+bool federation_migrate(const federation_session_t *session, uint32_t *node_id);
+size_t federation_users(federation_user_t **users);
+
+#endif
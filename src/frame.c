@@ -0,0 +1,387 @@
+/*
+    * frame.c
+    * Implementation of the length-prefixed framing shared by the server, the client and the tools.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "frame.h"
+
+int (*frame_wait)(struct pollfd *fds, nfds_t nfds, int timeout) = poll;
+
+void frame_write_header(uint8_t *out, size_t len) {
+    out[0] = (uint8_t)(len >> 24);
+    out[1] = (uint8_t)(len >> 16);
+    out[2] = (uint8_t)(len >> 8);
+    out[3] = (uint8_t)len;
+}
+
+size_t frame_read_header(const uint8_t *in) {
+    return ((size_t)in[0] << 24) | ((size_t)in[1] << 16) | ((size_t)in[2] << 8) | (size_t)in[3];
+}
+
+/*
+Funcion que retorna los bytes que ocupa en el socket un frame ya armado, header incluido, esté comprimido o no.
+Solo para frames que armó el mismo proceso (la cola de salida de una conexión).
+*/
+size_t frame_wire_size(const uint8_t *in) {
+    return FRAME_HEADER_SIZE + (frame_read_header(in) & ~(size_t)FRAME_COMPRESSED);
+}
+
+/*
+Funcion que envía un mensaje empaquetado precedido por su longitud.
+Reintenta los envíos parciales hasta que el frame completo sale por el socket.
+Parametros:
+    * int sockfd: socket descriptor
+    * const uint8_t *data: mensaje empaquetado
+    * size_t len: longitud del mensaje
+Retornos:
+    * int: 0 para exito y -1 si el socket falló
+*/
+int send_frame(int sockfd, const uint8_t *data, size_t len) {
+    return send_frame_fds(sockfd, data, len, NULL, 0);
+}
+
+/*
+Funcion que envía un frame junto con descriptores de archivo (SCM_RIGHTS, solo en sockets Unix).
+Los descriptores viajan con el primer byte del frame; el receptor los obtiene con recv_frame_fds.
+Parametros:
+    * const int *fds: descriptores a enviar (pueden ser NULL si n_fds es 0)
+    * int n_fds: cantidad de descriptores (a lo más FRAME_MAX_FDS)
+Retornos:
+    * int: 0 para exito y -1 si el socket falló
+*/
+int send_frame_fds(int sockfd, const uint8_t *data, size_t len, const int *fds, int n_fds) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_write_header(header, len);
+
+    struct iovec iov[2] = {
+        { .iov_base = header, .iov_len = sizeof(header) },
+        { .iov_base = (void *)data, .iov_len = len }
+    };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+    size_t remaining = sizeof(header) + len;
+
+    union {
+        char buf[CMSG_SPACE(FRAME_MAX_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    if (n_fds > 0) {
+        if (n_fds > FRAME_MAX_FDS) {
+            errno = EINVAL;
+            return -1;
+        }
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = CMSG_SPACE(n_fds * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(n_fds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, n_fds * sizeof(int));
+    }
+
+    while (remaining > 0) {
+        ssize_t sent = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Los descriptores ya salieron con el primer envío
+        msg.msg_control = NULL;
+        msg.msg_controllen = 0;
+        remaining -= sent;
+        // Avanzar los iovec sobre lo que ya se envió
+        while (msg.msg_iovlen > 0 && (size_t)sent >= msg.msg_iov[0].iov_len) {
+            sent -= msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov[0].iov_base = (uint8_t *)msg.msg_iov[0].iov_base + sent;
+            msg.msg_iov[0].iov_len -= sent;
+        }
+    }
+    return 0;
+}
+
+/*
+Funcion que espera con frame_wait a que el socket tenga algo para leer.
+Retornos:
+    * int: 0 si se puede leer y -1 si la espera falló o se interrumpió (errno EINTR)
+*/
+static int wait_readable(int sockfd) {
+    struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+    return frame_wait(&pfd, 1, -1) < 0 ? -1 : 0;
+}
+
+static int recv_exact(int sockfd, uint8_t *out, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(sockfd, out + got, len - got, MSG_DONTWAIT);
+        if (n == 0) return 0;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (wait_readable(sockfd) == 0 || errno == EINTR) continue;
+            }
+            return -1;
+        }
+        got += n;
+    }
+    return 1;
+}
+
+/*
+Funcion que recibe un frame completo de un socket, esperando con frame_wait mientras no lleguen datos.
+El buffer crece según haga falta y se reutiliza entre llamadas.
+Una señal sin SA_RESTART que llega antes del primer byte interrumpe la espera (-1 con errno EINTR), para que el
+llamador pueda detenerse justo en el borde entre dos frames; una vez empezado, el frame se lee completo.
+Parametros:
+    * int sockfd: socket descriptor
+    * uint8_t **buffer: buffer del llamador (puede empezar en NULL)
+    * size_t *capacity: capacidad actual del buffer
+Retornos:
+    * ssize_t: longitud del mensaje, 0 si el otro extremo cerró y -1 para errores o frames inválidos
+*/
+ssize_t recv_frame(int sockfd, uint8_t **buffer, size_t *capacity) {
+    int n_fds;
+    return recv_frame_fds(sockfd, buffer, capacity, NULL, 0, &n_fds);
+}
+
+/*
+Funcion que recibe un frame como recv_frame y además los descriptores que hayan llegado con él (SCM_RIGHTS).
+Los descriptores que no caben en fds se cierran.
+Parametros:
+    * int *fds: arreglo donde quedan los descriptores recibidos (puede ser NULL si max_fds es 0)
+    * int max_fds: tamaño de fds
+    * int *n_fds: cantidad de descriptores recibidos
+Retornos:
+    * ssize_t: igual que recv_frame; con 0 o -1 los descriptores recibidos igual quedan en fds
+*/
+ssize_t recv_frame_fds(int sockfd, uint8_t **buffer, size_t *capacity, int *fds, int max_fds, int *n_fds) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    size_t len = 0;
+    *n_fds = 0;
+    // Los mensajes vacíos (todos los campos en su valor por defecto) se saltan; en un ciclo y no recursivamente,
+    // porque un cliente puede mandar tantos como quiera y el stack de una corrutina es chico
+    while (len == 0) {
+        size_t got = 0;
+        while (got < sizeof(header)) {
+            union {
+                char buf[CMSG_SPACE(FRAME_MAX_FDS * sizeof(int))];
+                struct cmsghdr align;
+            } control;
+            struct iovec iov = { .iov_base = header + got, .iov_len = sizeof(header) - got };
+            struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+            ssize_t n = recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+            if (n == 0) return 0;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait_readable(sockfd) == 0) continue;
+            if (n < 0) {
+                if (errno == EINTR && got > 0) continue;
+                return -1;
+            }
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+                int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (int i = 0; i < count; i++) {
+                    int fd;
+                    memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                    if (*n_fds < max_fds) {
+                        fds[(*n_fds)++] = fd;
+                    } else {
+                        close(fd);
+                    }
+                }
+            }
+            got += n;
+        }
+
+        len = frame_read_header(header);
+        if (len > FRAME_MAX_SIZE) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+    }
+    if (*capacity < len) {
+        uint8_t *grown = realloc(*buffer, len);
+        if (!grown) return -1;
+        *buffer = grown;
+        *capacity = len;
+    }
+    int rc = recv_exact(sockfd, *buffer, len);
+    if (rc <= 0) return rc < 0 ? -1 : 0;
+    return len;
+}
+
+void frame_buffer_init(frame_buffer_t *fb) {
+    fb->data = NULL;
+    fb->start = 0;
+    fb->len = 0;
+    fb->cap = 0;
+}
+
+void frame_buffer_free(frame_buffer_t *fb) {
+    free(fb->data);
+    frame_buffer_init(fb);
+}
+
+/*
+Funcion que lee todo lo disponible en un socket no bloqueante hacia el buffer.
+Retornos:
+    * ssize_t: bytes leídos, 0 si el otro extremo cerró, -2 si no había nada que leer (EAGAIN) y -1 para errores
+*/
+ssize_t frame_buffer_fill(frame_buffer_t *fb, int sockfd) {
+    ssize_t total = 0;
+
+    // Compactar lo ya consumido antes de leer más
+    if (fb->start > 0) {
+        memmove(fb->data, fb->data + fb->start, fb->len - fb->start);
+        fb->len -= fb->start;
+        fb->start = 0;
+    }
+    while (1) {
+        if (fb->cap - fb->len < 4096) {
+            size_t cap = fb->cap ? fb->cap * 2 : 16384;
+            uint8_t *grown = realloc(fb->data, cap);
+            if (!grown) return -1;
+            fb->data = grown;
+            fb->cap = cap;
+        }
+        ssize_t n = recv(sockfd, fb->data + fb->len, fb->cap - fb->len, 0);
+        if (n > 0) {
+            fb->len += n;
+            total += n;
+            continue;
+        }
+        if (n == 0) return total > 0 ? total : 0;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return total > 0 ? total : -2;
+        return -1;
+    }
+}
+
+/*
+Funcion que obtiene el siguiente frame completo del buffer sin copiarlo.
+El llamador debe invocar frame_buffer_consume con FRAME_HEADER_SIZE + len cuando termine de usarlo.
+Retornos:
+    * bool: true si había un frame completo
+*/
+bool frame_buffer_next(frame_buffer_t *fb, const uint8_t **payload, size_t *len) {
+    size_t available = fb->len - fb->start;
+    if (available < FRAME_HEADER_SIZE) return false;
+    size_t frame_len = frame_read_header(fb->data + fb->start);
+    if (available < FRAME_HEADER_SIZE + frame_len) return false;
+    *payload = fb->data + fb->start + FRAME_HEADER_SIZE;
+    *len = frame_len;
+    return true;
+}
+
+void frame_buffer_consume(frame_buffer_t *fb, size_t len) {
+    fb->start += len;
+    if (fb->start == fb->len) {
+        fb->start = 0;
+        fb->len = 0;
+    }
+}
+
+/*
+Funcion que agrega len bytes al final del buffer para que el llamador los escriba.
+Lo ya consumido se compacta antes de crecer; el buffer queda al menos al doble de lo que guarda, así que
+la compactación cuesta O(1) amortizado por byte agregado.
+Retornos:
+    * uint8_t *: dónde escribir los len bytes, NULL si no hubo memoria
+*/
+uint8_t *frame_buffer_reserve(frame_buffer_t *fb, size_t len) {
+    if (fb->len + len > fb->cap) {
+        size_t used = fb->len - fb->start;
+        if (used + len > fb->cap / 2) {
+            size_t cap = fb->cap ? fb->cap : 4096;
+            while (used + len > cap / 2) cap *= 2;
+            uint8_t *grown = malloc(cap);
+            if (!grown) return NULL;
+            if (used) memcpy(grown, fb->data + fb->start, used);
+            free(fb->data);
+            fb->data = grown;
+            fb->cap = cap;
+        } else {
+            memmove(fb->data, fb->data + fb->start, used);
+        }
+        fb->start = 0;
+        fb->len = used;
+    }
+    uint8_t *out = fb->data + fb->len;
+    fb->len += len;
+    return out;
+}
+
+/*
+Funcion que indica si el frame pendiente declara una longitud inválida.
+*/
+bool frame_buffer_invalid(const frame_buffer_t *fb) {
+    if (fb->len - fb->start < FRAME_HEADER_SIZE) return false;
+    return frame_read_header(fb->data + fb->start) > FRAME_MAX_SIZE;
+}
+
+void frame_out_init(frame_out_t *out) {
+    out->data = NULL;
+    out->len = 0;
+    out->cap = 0;
+    out->frames = 0;
+}
+
+void frame_out_free(frame_out_t *out) {
+    free(out->data);
+    frame_out_init(out);
+}
+
+// Vacía el buffer conservando la memoria para los siguientes frames
+void frame_out_reset(frame_out_t *out) {
+    out->len = 0;
+    out->frames = 0;
+}
+
+/*
+Funcion que agrega un mensaje empaquetado, con su header, al final del buffer de salida.
+Retornos:
+    * int: 0 para exito y -1 si no hubo memoria
+*/
+int frame_out_append(frame_out_t *out, const uint8_t *payload, size_t len) {
+    size_t needed = out->len + FRAME_HEADER_SIZE + len;
+    if (needed > out->cap) {
+        size_t cap = out->cap ? out->cap : 1024;
+        while (cap < needed) cap *= 2;
+        uint8_t *grown = realloc(out->data, cap);
+        if (!grown) return -1;
+        out->data = grown;
+        out->cap = cap;
+    }
+    frame_write_header(out->data + out->len, len);
+    memcpy(out->data + out->len + FRAME_HEADER_SIZE, payload, len);
+    out->len = needed;
+    out->frames++;
+    return 0;
+}
+
+/*
+Funcion que envía bytes que ya contienen uno o más frames completos.
+Retornos:
+    * int: 0 para exito y -1 si el socket falló
+*/
+int send_frames(int sockfd, const uint8_t *frames, size_t len) {
+    size_t offset = 0;
+    while (offset < len) {
+        ssize_t sent = send(sockfd, frames + offset, len - offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        offset += sent;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+    * frame.h
+    * Length-prefixed framing for the chat protocol.
+    * Every Chat__Request / Chat__Response travels as a 4-byte big-endian length followed by the packed message,
+    * so several messages can share one TCP segment (or one recv) without being merged or cut.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <poll.h>
+
+#define FRAME_HEADER_SIZE 4
+#define FRAME_MAX_SIZE (1 << 20)
+#define FRAME_MAX_FDS 8  // Descriptores que pueden viajar con un frame (SCM_RIGHTS)
+#define FRAME_COMPRESSED 0x80000000u  // Bit del header: el payload son frames comprimidos (ver compress.h)
+
+// Buffer de lectura incremental para sockets no bloqueantes
+typedef struct {
+    uint8_t *data;
+    size_t start;
+    size_t len;
+    size_t cap;
+} frame_buffer_t;
+
+// Espera de recv_frame y de las lecturas de un ring cuando no hay datos: poll() por defecto. El servidor pone
+// coro_poll, para que esperar el siguiente frame suspenda solo la corrutina de la conexión (ver coro.h)
+extern int (*frame_wait)(struct pollfd *fds, nfds_t nfds, int timeout);
+
+void frame_write_header(uint8_t *out, size_t len);
+size_t frame_read_header(const uint8_t *in);
+size_t frame_wire_size(const uint8_t *in);
+int send_frame(int sockfd, const uint8_t *data, size_t len);
+int send_frame_fds(int sockfd, const uint8_t *data, size_t len, const int *fds, int n_fds);
+ssize_t recv_frame(int sockfd, uint8_t **buffer, size_t *capacity);
+ssize_t recv_frame_fds(int sockfd, uint8_t **buffer, size_t *capacity, int *fds, int max_fds, int *n_fds);
+
+void frame_buffer_init(frame_buffer_t *fb);
+void frame_buffer_free(frame_buffer_t *fb);
+ssize_t frame_buffer_fill(frame_buffer_t *fb, int sockfd);
+bool frame_buffer_next(frame_buffer_t *fb, const uint8_t **payload, size_t *len);
+void frame_buffer_consume(frame_buffer_t *fb, size_t len);
+uint8_t *frame_buffer_reserve(frame_buffer_t *fb, size_t len);
+bool frame_buffer_invalid(const frame_buffer_t *fb);
+
+// Buffer de salida con varios frames completos, para enviarlos con un solo send
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    size_t frames;
+} frame_out_t;
+
+void frame_out_init(frame_out_t *out);
+void frame_out_free(frame_out_t *out);
+void frame_out_reset(frame_out_t *out);
+int frame_out_append(frame_out_t *out, const uint8_t *payload, size_t len);
+int send_frames(int sockfd, const uint8_t *frames, size_t len);
+
+#endif
@@ -0,0 +1,106 @@
+/*
+    * handoff.c
+    * Implementation of the hot restart records exchanged between the old and the new server.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "frame.h"
+#include "transport.h"
+#include "handoff.h"
+
+void handoff_record_init(handoff_record_t *rec, handoff_kind_t kind) {
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = HANDOFF_MAGIC;
+    rec->version = HANDOFF_VERSION;
+    rec->kind = kind;
+}
+
+/*
+Funcion que envía un registro junto con sus descriptores.
+Retornos:
+    * int: 0 para exito y -1 si el socket falló
+*/
+int handoff_send(int fd, const handoff_record_t *rec, const int *fds, int n_fds) {
+    return send_frame_fds(fd, (const uint8_t *)rec, sizeof(*rec), fds, n_fds);
+}
+
+/*
+Funcion que recibe el siguiente registro y valida que sea del tipo esperado.
+Parametros:
+    * handoff_kind_t kind: tipo de registro que debe llegar (HANDOFF_END también se acepta en lugar de HANDOFF_CLIENT)
+    * int *fds: arreglo de HANDOFF_MAX_FDS para los descriptores recibidos
+    * int *n_fds: cantidad de descriptores recibidos
+    * int timeout_ms: espera máxima por el registro
+Retornos:
+    * int: 0 para exito y -1 si el otro proceso se fue, tardó demasiado o mandó algo inválido (los fds recibidos se cierran)
+*/
+int handoff_recv(int fd, handoff_record_t *rec, handoff_kind_t kind, int *fds, int *n_fds, int timeout_ms) {
+    *n_fds = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int ready;
+    while ((ready = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR);
+    if (ready <= 0) {
+        if (ready == 0) errno = ETIMEDOUT;
+        return -1;
+    }
+
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    while ((len = recv_frame_fds(fd, &buffer, &capacity, fds, HANDOFF_MAX_FDS, n_fds)) < 0 && errno == EINTR && *n_fds == 0);
+    bool valid = len == (ssize_t)sizeof(*rec);
+    if (valid) {
+        memcpy(rec, buffer, sizeof(*rec));
+        valid = rec->magic == HANDOFF_MAGIC && rec->version == HANDOFF_VERSION &&
+                (rec->kind == kind || (kind == HANDOFF_CLIENT && rec->kind == HANDOFF_END));
+    }
+    free(buffer);
+    if (!valid) {
+        for (int i = 0; i < *n_fds; i++) close(fds[i]);
+        *n_fds = 0;
+        if (len >= 0) errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+Funcion que verifica que el otro extremo del socket de control corra con el mismo usuario (o root).
+Quien se conecta se lleva todas las conexiones de los clientes, así que no basta con poder abrir el socket.
+*/
+bool handoff_peer_allowed(int fd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) return false;
+    return cred.uid == geteuid() || cred.uid == 0;
+}
+
+/*
+Funcion que se conecta al socket de control del servidor en ejecución y pide el traspaso.
+Parametros:
+    * const char *path: ruta del socket de control, o @nombre en el namespace abstracto
+Retornos:
+    * int: socket conectado después de enviar HELLO, -1 si falló
+*/
+int handoff_connect(const char *path) {
+    char address[128];
+    snprintf(address, sizeof(address), "%s%s", TRANSPORT_UNIX_PREFIX, path);
+    int fd = transport_connect(address, 0);
+    if (fd < 0) return -1;
+
+    handoff_record_t hello;
+    handoff_record_init(&hello, HANDOFF_HELLO);
+    if (!handoff_peer_allowed(fd) || handoff_send(fd, &hello, NULL, 0) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
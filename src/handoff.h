@@ -0,0 +1,70 @@
+/*
+    * handoff.h
+    * Hot restart: the running server hands its listening sockets, every client connection and the state of each
+    * client_t to a new server binary over a Unix control socket (SCM_RIGHTS), so a deploy does not drop anyone.
+    * Each record travels as one frame with its descriptors attached:
+    *   new -> old  HELLO
+    *   old -> new  LISTENERS (TCP, Unix, control), one CLIENT per connection or resumable session, END
+    * A CLIENT with replay_len > 0 is followed by one plain frame holding the session's replay window.
+    *   new -> old  ACK, after which the old process exits
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HANDOFF_MAGIC 0x43484f56u  // "CHOV"
+#define HANDOFF_VERSION 2
+#define HANDOFF_MAX_FDS 6  // Socket del cliente más los descriptores de sus rings de memoria compartida
+#define HANDOFF_TIMEOUT_MS 10000  // Espera máxima por el otro proceso en cada paso
+
+typedef enum {
+    HANDOFF_HELLO = 1,
+    HANDOFF_LISTENERS = 2,
+    HANDOFF_CLIENT = 3,
+    HANDOFF_END = 4,
+    HANDOFF_ACK = 5
+} handoff_kind_t;
+
+// Sockets que acompañan a HANDOFF_LISTENERS, en este orden
+#define HANDOFF_LISTEN_TCP 0x1
+#define HANDOFF_LISTEN_UNIX 0x2
+#define HANDOFF_LISTEN_CONTROL 0x4
+
+// Flags de HANDOFF_CLIENT
+#define HANDOFF_CLIENT_SHM 0x1       // Trae los rings de memoria compartida
+#define HANDOFF_CLIENT_SESSION 0x2   // Sesión reanudable
+#define HANDOFF_CLIENT_DETACHED 0x4  // Sesión sin conexión: no trae descriptores
+#define HANDOFF_CLIENT_COMPRESSED 0x8  // La conexión negoció compresión
+
+// Registro de tamaño fijo; solo se intercambia entre procesos de la misma máquina
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t kind;
+    int32_t uid;          // LISTENERS: siguiente uid a asignar; CLIENT: uid del cliente (-1 si aún no se registra); END: clientes enviados
+    int32_t status;       // ClientStatus
+    int64_t last_active;
+    uint32_t flags;       // LISTENERS: HANDOFF_LISTEN_*; CLIENT: HANDOFF_CLIENT_*
+    uint32_t addr;        // IPv4 en orden de red
+    uint16_t port;        // En orden de red
+    uint16_t family;      // AF_INET o AF_UNIX
+    char name[32];
+    // Sesión reanudable (CLIENT con HANDOFF_CLIENT_SESSION)
+    uint64_t next_sequence;
+    uint64_t replay_first;
+    int64_t detached_at;
+    uint32_t replay_len;  // Bytes del frame con la ventana de reenvío que sigue al registro
+    char session_token[36];
+} handoff_record_t;
+
+void handoff_record_init(handoff_record_t *rec, handoff_kind_t kind);
+int handoff_send(int fd, const handoff_record_t *rec, const int *fds, int n_fds);
+int handoff_recv(int fd, handoff_record_t *rec, handoff_kind_t kind, int *fds, int *n_fds, int timeout_ms);
+bool handoff_peer_allowed(int fd);
+int handoff_connect(const char *path);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+    * hashring.c
+    * Implementation of the consistent hash ring.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdlib.h>
+#include "hashring.h"
+
+/*
+Funcion que calcula el hash de 64 bits de un bloque: FNV-1a seguido del mezclador final de MurmurHash3,
+para que nombres parecidos ("user1", "user2") queden repartidos por todo el anillo.
+*/
+uint64_t hashring_hash(const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static int compare_points(const void *a, const void *b) {
+    const hashring_point_t *pa = a, *pb = b;
+    if (pa->hash != pb->hash) return pa->hash < pb->hash ? -1 : 1;
+    return pa->node_id < pb->node_id ? -1 : pa->node_id > pb->node_id;
+}
+
+/*
+Funcion que arma el anillo de un conjunto de nodos. El resultado solo depende del conjunto (no del orden),
+así que todos los nodos que ven los mismos miembros ubican cada nombre en el mismo nodo.
+Parametros:
+    * hashring_t *ring: anillo resultante, se libera con hashring_free
+    * const uint32_t *nodes: ids de los nodos
+    * size_t n_nodes: cantidad de nodos (0 deja el anillo vacío)
+Retornos:
+    * int: 0 para exito y -1 si no hubo memoria
+*/
+int hashring_build(hashring_t *ring, const uint32_t *nodes, size_t n_nodes) {
+    ring->points = NULL;
+    ring->n_points = 0;
+    if (n_nodes == 0) return 0;
+    ring->points = malloc(n_nodes * HASHRING_VNODES * sizeof(hashring_point_t));
+    if (!ring->points) return -1;
+    for (size_t i = 0; i < n_nodes; i++) {
+        for (uint32_t vnode = 0; vnode < HASHRING_VNODES; vnode++) {
+            uint32_t key[2] = { nodes[i], vnode };
+            ring->points[ring->n_points].hash = hashring_hash(key, sizeof(key));
+            ring->points[ring->n_points].node_id = nodes[i];
+            ring->n_points++;
+        }
+    }
+    qsort(ring->points, ring->n_points, sizeof(hashring_point_t), compare_points);
+    return 0;
+}
+
+/*
+Funcion que retorna el nodo dueño de una clave: el del primer punto con hash mayor o igual (búsqueda binaria),
+o el del primer punto del anillo si la clave cae después del último.
+Retornos:
+    * uint32_t: id del nodo, 0 si el anillo está vacío
+*/
+uint32_t hashring_owner(const hashring_t *ring, const char *key, size_t len) {
+    if (ring->n_points == 0) return 0;
+    uint64_t hash = hashring_hash(key, len);
+    size_t low = 0, high = ring->n_points;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (ring->points[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return ring->points[low == ring->n_points ? 0 : low].node_id;
+}
+
+void hashring_free(hashring_t *ring) {
+    free(ring->points);
+    ring->points = NULL;
+    ring->n_points = 0;
+}
@@ -0,0 +1,32 @@
+/*
+    * hashring.h
+    * Consistent hashing with virtual nodes, used to place every username on one node of the federation.
+    * Each node owns HASHRING_VNODES points of a 64-bit ring and a username belongs to the first point at or after
+    * its hash, so when a node joins or leaves only about 1/N of the usernames change owner.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef HASHRING_H
+#define HASHRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASHRING_VNODES 128  // Puntos de cada nodo en el anillo
+
+typedef struct {
+    uint64_t hash;
+    uint32_t node_id;
+} hashring_point_t;
+
+typedef struct {
+    hashring_point_t *points;  // Ordenados por hash
+    size_t n_points;
+} hashring_t;
+
+uint64_t hashring_hash(const void *data, size_t len);
+int hashring_build(hashring_t *ring, const uint32_t *nodes, size_t n_nodes);
+uint32_t hashring_owner(const hashring_t *ring, const char *key, size_t len);
+void hashring_free(hashring_t *ring);
+
+#endif
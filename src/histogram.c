@@ -0,0 +1,78 @@
+/*
+    * histogram.c
+    * Implementation of the log-linear latency histogram.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <string.h>
+#include "histogram.h"
+
+#define SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+
+void histogram_init(histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+/*
+Funcion que calcula el bucket de un valor.
+Los valores menores a SUB_BUCKETS son exactos; los demás se agrupan por potencia de dos y por los siguientes bits más significativos.
+*/
+int histogram_bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) return (int)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + (int)((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+// Valor más alto que cae dentro del bucket (se reporta el peor caso del bucket)
+uint64_t histogram_bucket_upper(int index) {
+    if (index < SUB_BUCKETS) return (uint64_t)index;
+    int shift = (index >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + (index & (SUB_BUCKETS - 1))) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void histogram_record(histogram_t *h, uint64_t value) {
+    h->counts[histogram_bucket_index(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+void histogram_merge(histogram_t *dst, const histogram_t *src) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+/*
+Funcion que obtiene el percentil pedido.
+Parametros:
+    * const histogram_t *h: histograma
+    * double percentile: percentil entre 0 y 100 (por ejemplo 99.9)
+Retornos:
+    * uint64_t: límite superior del bucket donde cae el percentil, 0 si el histograma está vacío
+*/
+uint64_t histogram_percentile(const histogram_t *h, double percentile) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)((percentile / 100.0) * h->total + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > h->total) rank = h->total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = histogram_bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+double histogram_mean(const histogram_t *h) {
+    return h->total ? (double)h->sum / h->total : 0.0;
+}
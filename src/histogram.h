@@ -0,0 +1,31 @@
+/*
+    * histogram.h
+    * Log-linear latency histogram (HDR style): each power of two is split in 2^HISTOGRAM_SUB_BITS buckets,
+    * so any recorded value is reported with ~3% relative error using a fixed 16 KB table and no allocation.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_BUCKETS (64 << HISTOGRAM_SUB_BITS)
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} histogram_t;
+
+void histogram_init(histogram_t *h);
+void histogram_record(histogram_t *h, uint64_t value);
+void histogram_merge(histogram_t *dst, const histogram_t *src);
+uint64_t histogram_percentile(const histogram_t *h, double percentile);
+double histogram_mean(const histogram_t *h);
+int histogram_bucket_index(uint64_t value);
+uint64_t histogram_bucket_upper(int index);
+
+#endif
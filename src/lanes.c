@@ -0,0 +1,617 @@
+/*
+    * lanes.c
+    * Per-connection priority lanes, the non-blocking writer that drains them and the flusher thread that resumes
+    * the drain of connections whose socket filled up.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "lanes.h"
+#include "metrics.h"
+#include "membudget.h"
+
+static int epfd = -1;
+// Colas indexadas por socket. Quien las busca aquí toma q->lock antes de soltar registry_mutex (así lanes_close no
+// las libera en medio) y suelta registry_mutex antes de escribir, para no detener a los demás mientras tanto.
+static lanes_t **registry;
+static size_t registry_size;  // Descriptores que caben en registry
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread lanes_held_t *holding;  // Mientras no es NULL, lo que este thread envía solo se encola
+
+static int drain(lanes_t *q);
+static void notify_waiters(lanes_t *q);
+
+/*
+Funcion que busca las colas de un socket y las devuelve con q->lock bloqueado, o NULL si ya no tiene.
+*/
+static lanes_t *lookup_locked(int sockfd) {
+    pthread_mutex_lock(&registry_mutex);
+    lanes_t *q = registry[sockfd];
+    if (q) pthread_mutex_lock(&q->lock);
+    pthread_mutex_unlock(&registry_mutex);
+    return q;
+}
+
+static size_t queued_bytes(const lanes_t *q, lane_t lane) {
+    return q->lanes[lane].len - q->lanes[lane].start;
+}
+
+static bool empty(const lanes_t *q) {
+    return q->wire.len == q->wire.start &&
+           q->frames[LANE_CONTROL] + q->frames[LANE_DIRECT] + q->frames[LANE_BROADCAST] == 0;
+}
+
+// Debe llamarse con q->lock bloqueado
+static void account(lanes_t *q) {
+    size_t size = sizeof(lanes_t) + q->wire.cap;
+    for (int i = 0; i < LANE_COUNT; i++) size += q->lanes[i].cap;
+    mem_resize(MEM_QUEUES, &q->mem, size);
+}
+
+/*
+Thread que retoma la escritura de las conexiones cuyo socket se llenó, cuando el kernel avisa que acepta más.
+*/
+static void *lanes_flusher(void *arg) {
+    (void)arg;
+    struct epoll_event events[LANES_MAX_EVENTS];
+    while (1) {
+        int n = epoll_wait(epfd, events, LANES_MAX_EVENTS, -1);
+        for (int i = 0; i < n; i++) {
+            lanes_t *q = lookup_locked(events[i].data.fd);
+            if (!q) continue;
+            q->waiting = false;
+            if (q->writing) {
+                // El que escribe vuelve a registrar la conexión si el socket se llena de nuevo
+                pthread_mutex_unlock(&q->lock);
+            } else {
+                q->writing = true;
+                drain(q);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+Funcion que crea el registro de colas, el epoll y el thread que retoman las escrituras pendientes.
+Parametros:
+    * size_t max_fds: descriptores que caben en el registro (el límite de descriptores del proceso); uno mayor
+      no tiene colas
+Retornos:
+    * int: 0 para exito y -1 si no se pudo (las conexiones escriben entonces sin colas)
+*/
+int lanes_start(size_t max_fds) {
+    // calloc: las páginas del registro que nunca se usan no ocupan memoria
+    registry = calloc(max_fds, sizeof(lanes_t *));
+    if (!registry) return -1;
+    registry_size = max_fds;
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    pthread_t tid;
+    if (epfd < 0 || pthread_create(&tid, NULL, &lanes_flusher, NULL) != 0) {
+        if (epfd >= 0) close(epfd);
+        epfd = -1;
+        registry_size = 0;
+        free(registry);
+        registry = NULL;
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+/*
+Funcion que crea las colas de salida de una conexión y las registra para su socket.
+En un socket TCP limita con TCP_NOTSENT_LOWAT lo que el kernel guarda sin enviar; en otros sockets no tiene efecto.
+Parametros:
+    * int sockfd: socket del cliente
+    * lanes_write_fn write: función que escribe sin bloquear en la conexión
+Retornos:
+    * lanes_t *: las colas, NULL si no se inició el flusher, el socket está fuera de rango o no hubo memoria
+*/
+lanes_t *lanes_create(int sockfd, lanes_write_fn write) {
+    if (epfd < 0 || sockfd < 0 || (size_t)sockfd >= registry_size) return NULL;
+    lanes_t *q = calloc(1, sizeof(lanes_t));
+    if (!q) return NULL;
+    q->sockfd = sockfd;
+    q->wait_fd = sockfd;
+    q->write = write;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->drained, NULL);
+    for (int i = 0; i < LANE_COUNT; i++) frame_buffer_init(&q->lanes[i]);
+    frame_buffer_init(&q->wire);
+    int lowat = LANE_NOTSENT_LOWAT;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+    account(q);
+    pthread_mutex_lock(&registry_mutex);
+    registry[sockfd] = q;
+    pthread_mutex_unlock(&registry_mutex);
+    return q;
+}
+
+lanes_t *lanes_for(int sockfd) {
+    return sockfd >= 0 && (size_t)sockfd < registry_size ? registry[sockfd] : NULL;
+}
+
+/*
+Funcion que hace que el flusher espere un doorbell (eventfd) en lugar de que el socket acepte más: para una conexión
+que escribe en un ring de memoria compartida, cuyo write deja armado el doorbell cuando el ring se llena.
+Debe llamarse antes de que la conexión escriba.
+*/
+void lanes_wait_on(lanes_t *q, int doorbell_fd) {
+    q->wait_fd = doorbell_fd;
+}
+
+static void lanes_free(lanes_t *q) {
+    pthread_cond_destroy(&q->drained);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+}
+
+/*
+Funcion que cierra las colas de un socket antes de cerrarlo; lo que quedaba sin enviar se descarta.
+Si otro thread está escribiendo espera a que termine esa escritura (nunca bloquea), así el socket se puede cerrar
+al volver. Quien todavía las tenga retenidas (lanes_retain) solo ve la conexión fallida; la última referencia las
+libera.
+*/
+void lanes_close(int sockfd) {
+    if (sockfd < 0 || (size_t)sockfd >= registry_size) return;
+    pthread_mutex_lock(&registry_mutex);
+    lanes_t *q = registry[sockfd];
+    registry[sockfd] = NULL;
+    pthread_mutex_unlock(&registry_mutex);
+    if (!q) return;
+    pthread_mutex_lock(&q->lock);
+    q->failed = true;
+    q->closed = true;
+    while (q->writing) pthread_cond_wait(&q->drained, &q->lock);
+    if (q->registered) epoll_ctl(epfd, EPOLL_CTL_DEL, q->wait_fd, NULL);
+    q->registered = false;
+    for (int i = 0; i < LANE_COUNT; i++) {
+        q->frames[i] = 0;
+        frame_buffer_free(&q->lanes[i]);
+    }
+    frame_buffer_free(&q->wire);
+    mem_resize(MEM_QUEUES, &q->mem, 0);
+    notify_waiters(q);
+    bool last = q->refs == 0;
+    pthread_mutex_unlock(&q->lock);
+    if (last) lanes_free(q);
+}
+
+/*
+Funcion que retiene las colas de una conexión para enviarle después sin el lock que las mantiene vivas (por ejemplo,
+con un destinatario tomado de clients[] con clients_mutex). Se suelta con lanes_put.
+*/
+lanes_t *lanes_retain(lanes_t *q) {
+    pthread_mutex_lock(&q->lock);
+    q->refs++;
+    pthread_mutex_unlock(&q->lock);
+    return q;
+}
+
+void lanes_put(lanes_t *q) {
+    pthread_mutex_lock(&q->lock);
+    bool last = --q->refs == 0 && q->closed;
+    pthread_mutex_unlock(&q->lock);
+    if (last) lanes_free(q);
+}
+
+/*
+Funcion que avisa a quienes esperan con lanes_wait_below cuya cola ya bajó de su umbral (o si la conexión falló, que
+ya no va a bajar) y los saca de la lista. Debe llamarse con q->lock bloqueado.
+*/
+static void notify_waiters(lanes_t *q) {
+    if (!q->waiters) return;
+    size_t queued = q->failed ? 0 : queued_bytes(q, LANE_DIRECT) + queued_bytes(q, LANE_BROADCAST);
+    lanes_waiter_t **link = &q->waiters;
+    while (*link) {
+        lanes_waiter_t *waiter = *link;
+        if (queued > waiter->below) {
+            link = &waiter->next;
+            continue;
+        }
+        *link = waiter->next;
+        uint64_t one = 1;
+        if (write(waiter->fd, &one, sizeof(one)) < 0) {
+            // El contador del eventfd no se llena con un aviso por espera
+        }
+    }
+}
+
+// Debe llamarse con q->lock bloqueado
+static void discard_all(lanes_t *q) {
+    size_t dropped = 0;
+    for (int i = 0; i < LANE_COUNT; i++) {
+        dropped += q->frames[i];
+        q->frames[i] = 0;
+        frame_buffer_free(&q->lanes[i]);
+    }
+    frame_buffer_free(&q->wire);
+    if (dropped > 0) metrics_count(METRIC_SEND_DROPS, dropped);
+    notify_waiters(q);
+}
+
+/*
+Funcion que pasa a wire los frames siguientes de la clase más urgente con frames en cola: frames completos hasta
+LANE_CHUNK_BYTES (al menos uno, aunque sea más grande). Debe llamarse con q->lock bloqueado y wire vacío.
+Retornos:
+    * bool: false si todas las clases están vacías o no hubo memoria
+*/
+static bool take_chunk(lanes_t *q) {
+    int lane = 0;
+    while (lane < LANE_COUNT && q->frames[lane] == 0) lane++;
+    if (lane == LANE_COUNT) return false;
+
+    frame_buffer_t *fb = &q->lanes[lane];
+    const uint8_t *start = fb->data + fb->start;
+    size_t available = fb->len - fb->start;
+    size_t len = 0;
+    size_t frames = 0;
+    while (len < available) {
+        size_t frame_len = frame_wire_size(start + len);
+        if (frames > 0 && len + frame_len > LANE_CHUNK_BYTES) break;
+        len += frame_len;
+        frames++;
+    }
+    uint8_t *out = frame_buffer_reserve(&q->wire, len);
+    if (!out) return false;
+    memcpy(out, start, len);
+    frame_buffer_consume(fb, len);
+    q->frames[lane] -= frames;
+    return true;
+}
+
+/*
+Funcion que registra la conexión en el epoll del flusher para seguir escribiendo cuando el socket acepte más.
+Debe llamarse con q->lock bloqueado.
+*/
+static void wait_writable(lanes_t *q) {
+    // data.fd es siempre el socket, que es con lo que el flusher busca las colas
+    uint32_t ready = q->wait_fd == q->sockfd ? EPOLLOUT : EPOLLIN;
+    struct epoll_event ev = { .events = ready | EPOLLONESHOT, .data.fd = q->sockfd };
+    int rc = epoll_ctl(epfd, q->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, q->wait_fd, &ev);
+    if (rc == 0) {
+        q->registered = true;
+        if (!q->waiting) q->blocked_since = metrics_now();
+        q->waiting = true;
+    } else {
+        q->failed = true;
+    }
+}
+
+/*
+Funcion que escribe lo que hay en cola tomando siempre primero la clase más urgente, hasta vaciar todas las clases o
+hasta que el socket se llene (entonces deja la conexión esperando en el flusher). Como toma de a LANE_CHUNK_BYTES,
+una respuesta de control que llega en medio de una ráfaga de broadcasts sale después del bloque en curso y no al
+final de la ráfaga. Se llama con q->lock bloqueado y q->writing activo; libera ambos.
+Retornos:
+    * int: 0 para exito y -1 si la conexión falló
+*/
+static int drain(lanes_t *q) {
+    while (!q->failed && !q->waiting) {
+        if (q->wire.len == q->wire.start) {
+            if (!take_chunk(q)) break;
+            notify_waiters(q);
+        }
+        const uint8_t *data = q->wire.data + q->wire.start;
+        size_t len = q->wire.len - q->wire.start;
+        // Solo el que escribe toca wire, así que se puede escribir sin el lock
+        pthread_mutex_unlock(&q->lock);
+        ssize_t n = q->write(q->sockfd, NULL, data, len);
+        pthread_mutex_lock(&q->lock);
+        if (n < 0) {
+            q->failed = true;
+            break;
+        }
+        metrics_count(METRIC_BYTES_OUT, n);
+        frame_buffer_consume(&q->wire, n);
+        if ((size_t)n < len) wait_writable(q);
+    }
+    if (q->failed || !q->waiting) {
+        // Tras un error, o si no hubo memoria para wire, lo que quedó en cola ya no sale.
+        // Sin nada pendiente los buffers no se guardan: la mayoría de las conexiones nunca encola.
+        discard_all(q);
+    }
+    q->writing = false;
+    pthread_cond_broadcast(&q->drained);
+    int rc = q->failed ? -1 : 0;
+    account(q);
+    pthread_mutex_unlock(&q->lock);
+    return rc;
+}
+
+/*
+Funcion que agrega frames a una clase. Debe llamarse con q->lock bloqueado.
+Parametros:
+    * const uint8_t *header: header del frame si data es un payload suelto, NULL si data ya son frames completos
+Retornos:
+    * int: 0 para exito y -1 si se descartaron
+*/
+static int enqueue(lanes_t *q, lane_t lane, const uint8_t *header, const uint8_t *data, size_t len, size_t count) {
+    size_t total = (header ? FRAME_HEADER_SIZE : 0) + len;
+    if (lane != LANE_CONTROL && queued_bytes(q, LANE_DIRECT) + queued_bytes(q, LANE_BROADCAST) + total > LANE_MAX_BYTES) {
+        return -1;
+    }
+    uint8_t *out = frame_buffer_reserve(&q->lanes[lane], total);
+    if (!out) return -1;
+    if (header) {
+        memcpy(out, header, FRAME_HEADER_SIZE);
+        out += FRAME_HEADER_SIZE;
+    }
+    memcpy(out, data, len);
+    q->frames[lane] += count;
+    for (int i = lane + 1; i < LANE_COUNT; i++) {
+        if (q->frames[i] > 0) {
+            metrics_count(METRIC_LANE_OVERTAKES, count);
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+Funcion que encola frames de un thread que retiene sus escrituras. Si nadie está escribiendo en la conexión la anota
+en su lista, salvo que ya esté en la de alguien (quien la libere escribe también estos). Se llama con q->lock
+bloqueado; lo libera.
+Retornos:
+    * int: 0 si quedaron en cola, -1 si se descartaron
+*/
+static int hold(lanes_t *q, lane_t lane, const uint8_t *header, const uint8_t *data, size_t len, size_t count) {
+    if (enqueue(q, lane, header, data, len, count) != 0) {
+        pthread_mutex_unlock(&q->lock);
+        metrics_count(METRIC_SEND_DROPS, count);
+        return -1;
+    }
+    if (q->writing || q->waiting) {
+        // El que escribe, o el flusher cuando el socket acepte más, se lleva también estos
+        account(q);
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    if (!q->held && holding->count == holding->cap) {
+        size_t cap = holding->cap ? holding->cap * 2 : 16;
+        int *fds = realloc(holding->fds, cap * sizeof(int));
+        if (fds) {
+            holding->fds = fds;
+            holding->cap = cap;
+        }
+    }
+    if (!q->held && holding->count < holding->cap) {
+        holding->fds[holding->count++] = q->sockfd;
+        q->held = true;
+    } else if (!q->held) {
+        // Sin memoria para la lista se escribe ahora, como si no se retuviera
+        q->writing = true;
+        return drain(q);
+    }
+    account(q);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+/*
+Funcion que escribe en la conexión o, si otro thread está escribiendo o el socket está lleno, encola en una clase.
+Si nadie escribe y el socket acepta datos las colas están vacías, así que se escribe directo desde el buffer del
+llamador (salvo varios frames de más de un bloque, que pasan por las colas para poder intercalar el control).
+Nunca espera. Si el thread retiene sus escrituras (lanes_hold) igual escribe directo en una conexión libre y con las
+colas vacías, pero no vacía colas: lo que no puede salir así se encola para quien las libere.
+Una respuesta de control no se descarta sola: si no cabe en LANE_CONTROL_MAX_BYTES el cliente lleva demasiadas
+respuestas sin leer, así que la conexión falla entera y se corta (el handler ve el cierre y la libera).
+Parametros:
+    * const uint8_t *header: header del frame si data es un payload suelto, NULL si data ya son frames completos
+    * size_t count: cantidad de frames
+*/
+static int lane_write(lanes_t *q, lane_t lane, const uint8_t *header, const uint8_t *data, size_t len, size_t count) {
+    size_t total = (header ? FRAME_HEADER_SIZE : 0) + len;
+    pthread_mutex_lock(&q->lock);
+    if (lane == LANE_CONTROL && !q->failed && queued_bytes(q, LANE_CONTROL) + total > LANE_CONTROL_MAX_BYTES) {
+        q->failed = true;
+        shutdown(q->sockfd, SHUT_RDWR);
+        if (!q->writing) {
+            discard_all(q);
+            account(q);
+        }
+    }
+    if (q->failed) {
+        pthread_mutex_unlock(&q->lock);
+        metrics_count(METRIC_SEND_DROPS, count);
+        return -1;
+    }
+    // Con frames retenidos en cola el nuevo no puede salir antes que ellos
+    if (!q->writing && !q->waiting && empty(q) && (header || len <= LANE_CHUNK_BYTES)) {
+        q->writing = true;
+        pthread_mutex_unlock(&q->lock);
+        ssize_t n = q->write(q->sockfd, header, data, len);
+        pthread_mutex_lock(&q->lock);
+        if (n < 0) {
+            metrics_count(METRIC_SEND_DROPS, count);
+            q->failed = true;
+        } else if ((size_t)n < total) {
+            // Lo que no entró va primero a wire: el resto del frame tiene que seguir a lo ya escrito
+            size_t skip = (size_t)n;
+            uint8_t *out = frame_buffer_reserve(&q->wire, total - skip);
+            if (!out) {
+                q->failed = true;
+            } else {
+                if (header && skip < FRAME_HEADER_SIZE) {
+                    memcpy(out, header + skip, FRAME_HEADER_SIZE - skip);
+                    out += FRAME_HEADER_SIZE - skip;
+                    skip = 0;
+                } else if (header) {
+                    skip -= FRAME_HEADER_SIZE;
+                }
+                memcpy(out, data + skip, len - skip);
+                wait_writable(q);
+            }
+            metrics_count(METRIC_BYTES_OUT, n);
+        } else {
+            metrics_count(METRIC_BYTES_OUT, n);
+        }
+        return drain(q);
+    }
+    if (holding) return hold(q, lane, header, data, len, count);
+    if (enqueue(q, lane, header, data, len, count) != 0) {
+        pthread_mutex_unlock(&q->lock);
+        metrics_count(METRIC_SEND_DROPS, count);
+        return -1;
+    }
+    if (!q->writing && !q->waiting) {
+        q->writing = true;
+        return drain(q);
+    }
+    account(q);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+/*
+Funcion que envía frames completos a la conexión en una clase.
+Parametros:
+    * lanes_t *q: colas de la conexión
+    * lane_t lane: clase de los frames
+    * const uint8_t *frames: frames completos, con sus headers
+    * size_t count: cantidad de frames
+Retornos:
+    * int: 0 si se escribieron o quedaron en cola, -1 si se descartaron o la conexión falló
+*/
+int lanes_send_frames(lanes_t *q, lane_t lane, const uint8_t *frames, size_t len, size_t count) {
+    return lane_write(q, lane, NULL, frames, len, count);
+}
+
+/*
+Funcion que envía un mensaje empaquetado a la conexión en una clase, como un frame.
+Retornos:
+    * int: 0 si se escribió o quedó en cola, -1 si se descartó o la conexión falló
+*/
+int lanes_send(lanes_t *q, lane_t lane, const uint8_t *payload, size_t len) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_write_header(header, len);
+    return lane_write(q, lane, header, payload, len, 1);
+}
+
+/*
+Funcion que indica cuántos mensajes directos y broadcasts tiene en cola la conexión y desde cuándo su socket está
+lleno sin aceptar nada. Quien reenvía un stream la usa para esperar a un lector lento en lugar de llenar su cola,
+pero no a uno que dejó de leer.
+Parametros:
+    * uint64_t *blocked_since: metrics_now() desde el que el socket no acepta datos, 0 si está escribiendo
+Retornos:
+    * size_t: bytes en cola, sin las respuestas de control
+*/
+size_t lanes_backlog(lanes_t *q, uint64_t *blocked_since) {
+    pthread_mutex_lock(&q->lock);
+    size_t queued = queued_bytes(q, LANE_DIRECT) + queued_bytes(q, LANE_BROADCAST);
+    *blocked_since = q->waiting ? q->blocked_since : 0;
+    pthread_mutex_unlock(&q->lock);
+    return queued;
+}
+
+/*
+Funcion que pide un aviso para cuando los mensajes directos y broadcasts en cola de la conexión bajen a below bytes
+o menos, o la conexión falle: se escribe el eventfd fd (una vez) y la espera se quita sola. Así quien reenvía un
+stream espera a un lector lento sin revisar su cola a cada rato. El llamador mantiene vivas las colas (lanes_retain)
+y quita la espera con lanes_unwait antes de soltarlas o de reutilizar waiter.
+Retornos:
+    * bool: true si quedó esperando, false si la cola ya estaba bajo el umbral (no habrá aviso)
+*/
+bool lanes_wait_below(lanes_t *q, lanes_waiter_t *waiter, int fd, size_t below) {
+    pthread_mutex_lock(&q->lock);
+    size_t queued = q->failed ? 0 : queued_bytes(q, LANE_DIRECT) + queued_bytes(q, LANE_BROADCAST);
+    bool armed = queued > below;
+    if (armed) {
+        waiter->fd = fd;
+        waiter->below = below;
+        waiter->next = q->waiters;
+        q->waiters = waiter;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return armed;
+}
+
+// Quita una espera de lanes_wait_below; si ya se avisó no hace nada
+void lanes_unwait(lanes_t *q, lanes_waiter_t *waiter) {
+    pthread_mutex_lock(&q->lock);
+    for (lanes_waiter_t **link = &q->waiters; *link; link = &(*link)->next) {
+        if (*link == waiter) {
+            *link = waiter->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+/*
+Funcion que espera a que salga todo lo que la conexión tiene en cola, como mucho timeout_ms.
+Se usa antes de entregar el socket a otro proceso, que no tiene las colas de este.
+Retornos:
+    * int: 0 si no quedó nada pendiente, -1 si se agotó el tiempo o la conexión falló
+*/
+int lanes_flush(lanes_t *q, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&q->lock);
+    if (!q->failed && !q->writing && !q->waiting && !empty(q)) {
+        // Frames retenidos que nadie liberó todavía
+        q->writing = true;
+        drain(q);
+        pthread_mutex_lock(&q->lock);
+    }
+    int rc = 0;
+    while (!q->failed && !(empty(q) && !q->writing)) {
+        if (pthread_cond_timedwait(&q->drained, &q->lock, &deadline) == ETIMEDOUT) {
+            rc = -1;
+            break;
+        }
+    }
+    if (q->failed) rc = -1;
+    pthread_mutex_unlock(&q->lock);
+    return rc;
+}
+
+/*
+Funcion que hace que lo que el thread que la llama envía a partir de ahora solo se encole, sin escribir en ninguna
+conexión: las conexiones que reciben algo quedan en held. Con NULL el thread vuelve a escribir directo.
+Parametros:
+    * lanes_held_t *held: lista vacía (inicializada en cero) donde anotar las conexiones
+*/
+void lanes_hold(lanes_held_t *held) {
+    holding = held;
+}
+
+/*
+Funcion que escribe lo que quedó retenido en las conexiones de una lista, sin esperar (lo que no entra sigue con el
+flusher, como cualquier escritura), y vacía la lista. Puede llamarse desde otro thread que el que retuvo.
+Una conexión que se cerró mientras tanto ya no tiene colas y se salta.
+*/
+void lanes_release(lanes_held_t *held) {
+    for (size_t i = 0; i < held->count; i++) {
+        lanes_t *q = lookup_locked(held->fds[i]);
+        if (!q) continue;
+        q->held = false;
+        if (q->writing || q->waiting || empty(q)) {
+            // El que escribe o el flusher se llevan también lo retenido
+            pthread_mutex_unlock(&q->lock);
+        } else {
+            q->writing = true;
+            drain(q);
+        }
+    }
+    free(held->fds);
+    held->fds = NULL;
+    held->count = held->cap = 0;
+}
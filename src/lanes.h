@@ -0,0 +1,101 @@
+/*
+    * lanes.h
+    * Priority lanes in the output path of each connection: control responses (acknowledgements, errors, user lists,
+    * delivery reports) go out before direct messages, and both before queued broadcasts.
+    * Writes never block. A thread that finds the connection idle writes directly; threads that find a writer active, or
+    * the socket full, queue their frames in their class and return. Whoever writes drains the lanes, always taking the
+    * most urgent class next and at most LANE_CHUNK_BYTES at a time; when the socket fills up the connection is parked
+    * in the flusher's epoll set and the flusher thread resumes the drain once the socket accepts more.
+    * TCP_NOTSENT_LOWAT keeps the kernel from holding more than LANE_NOTSENT_LOWAT unsent bytes, so the backlog of a
+    * slow reader stays in the lanes, where a later control response can still go ahead of it.
+    * A thread can also hold its writes (lanes_hold): an idle connection with empty lanes is still written directly,
+    * but nothing is drained; frames that have to queue are written later by whoever calls lanes_release, so a task
+    * of the coroutine pool never spends its time draining other connections' backlogs.
+    * The registry lock is never held across a write: lookups take the connection's lock and drop the registry's.
+    * Whoever waits for a slow reader (a stream sender) asks for an eventfd write once the backlog falls under a
+    * threshold (lanes_wait_below) instead of polling it.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef LANES_H
+#define LANES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "frame.h"
+
+#define LANE_CHUNK_BYTES (16 * 1024)  // Lo que se toma de una clase antes de volver a mirar las más urgentes
+#define LANE_MAX_BYTES (4 << 20)  // Directos y broadcasts en cola por conexión; lo que no cabe se descarta
+#define LANE_CONTROL_MAX_BYTES (1 << 20)  // Respuestas en cola; pasarlas corta la conexión (el cliente no las lee)
+#define LANE_NOTSENT_LOWAT (64 * 1024)  // Bytes sin enviar que el kernel acepta en un socket TCP
+#define LANES_MAX_EVENTS 64
+
+typedef enum {
+    LANE_CONTROL = 0,    // Respuestas a las solicitudes del propio cliente
+    LANE_DIRECT = 1,     // Mensajes directos, multicast y batch de otros usuarios
+    LANE_BROADCAST = 2   // Broadcasts
+} lane_t;
+
+#define LANE_COUNT 3
+
+/*
+Escribe sin bloquear en la conexión (socket o ring de memoria compartida) un frame formado por header y data, o
+frames completos si header es NULL. Retorna los bytes escritos (0 si el socket está lleno) o -1 si la conexión falló.
+*/
+typedef ssize_t (*lanes_write_fn)(int sockfd, const uint8_t *header, const uint8_t *data, size_t len);
+
+// Espera de lanes_wait_below: el eventfd que se escribe cuando la cola de la conexión baja de below
+typedef struct lanes_waiter {
+    int fd;
+    size_t below;
+    struct lanes_waiter *next;
+} lanes_waiter_t;
+
+typedef struct {
+    int sockfd;
+    int wait_fd;      // Avisa que se puede seguir escribiendo: el socket (EPOLLOUT) o el doorbell de un ring (EPOLLIN)
+    lanes_write_fn write;
+    pthread_mutex_t lock;
+    pthread_cond_t drained;  // Avisa cada vez que alguien deja de escribir
+    frame_buffer_t lanes[LANE_COUNT];  // Frames completos, con sus headers
+    size_t frames[LANE_COUNT];
+    frame_buffer_t wire;  // Bytes ya tomados de las clases, en orden: un frame empezado no se puede reordenar
+    bool writing;     // Un thread está escribiendo; los demás solo encolan
+    bool waiting;     // El socket se llenó: el flusher sigue cuando acepte más
+    bool registered;  // sockfd ya está en el epoll del flusher
+    bool failed;      // La conexión falló: todo lo nuevo se descarta
+    bool held;        // Tiene frames retenidos y ya está en la lista de un lanes_held_t
+    bool closed;      // lanes_close ya la sacó del registro; la última referencia la libera
+    unsigned refs;    // Quienes la retienen para enviarle fuera de clients_mutex (lanes_retain)
+    lanes_waiter_t *waiters;  // Esperan que baje la cola de mensajes directos y broadcasts
+    uint64_t blocked_since;  // metrics_now() desde el que el socket está lleno sin avanzar (válido con waiting)
+    size_t mem;       // Registrado en el presupuesto de memoria
+} lanes_t;
+
+// Conexiones con frames que un thread encoló sin escribir, para escribirlas con lanes_release
+typedef struct {
+    int *fds;
+    size_t count;
+    size_t cap;
+} lanes_held_t;
+
+int lanes_start(size_t max_fds);
+lanes_t *lanes_create(int sockfd, lanes_write_fn write);
+lanes_t *lanes_for(int sockfd);
+void lanes_wait_on(lanes_t *q, int doorbell_fd);
+void lanes_close(int sockfd);
+lanes_t *lanes_retain(lanes_t *q);
+void lanes_put(lanes_t *q);
+int lanes_send(lanes_t *q, lane_t lane, const uint8_t *payload, size_t len);
+int lanes_send_frames(lanes_t *q, lane_t lane, const uint8_t *frames, size_t len, size_t count);
+int lanes_flush(lanes_t *q, int timeout_ms);
+size_t lanes_backlog(lanes_t *q, uint64_t *blocked_since);
+bool lanes_wait_below(lanes_t *q, lanes_waiter_t *waiter, int fd, size_t below);
+void lanes_unwait(lanes_t *q, lanes_waiter_t *waiter);
+void lanes_hold(lanes_held_t *held);
+void lanes_release(lanes_held_t *held);
+
+#endif
@@ -0,0 +1,633 @@
+/*
+    * loadgen.c
+    * Headless load generator and benchmark harness for the chat server.
+    * Opens many connections, registers one user per connection and drives a configurable mix of broadcasts,
+    * direct messages, status updates and user list requests at a target rate.
+    * Every message carries its send timestamp so end-to-end latency is measured where it is delivered.
+    * Results (throughput and p50/p99/p999 latency) are printed as CSV or JSON.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "chat.pb-c.h"
+#include "frame.h"
+#include "histogram.h"
+#include "transport.h"
+#include "compress.h"
+
+#define MAX_EVENTS 256
+#define MAX_BURST 1000
+#define DRAIN_SECONDS 1
+
+typedef enum {
+    OP_BROADCAST = 0,
+    OP_DIRECT = 1,
+    OP_STATUS = 2,
+    OP_USERS = 3,
+    OP_COUNT = 4
+} lg_op_t;
+
+static const char *op_names[OP_COUNT] = {"broadcast", "direct", "status", "users"};
+
+typedef struct {
+    int fd;
+    int index;
+    char name[32];
+    frame_buffer_t in;
+    bool compressed;  // El servidor aceptó comprimir (-z)
+    frame_buffer_t inflated;
+    uint8_t *out;
+    size_t out_len;
+    size_t out_cap;
+    bool want_write;
+    // FIFO de timestamps de solicitudes que esperan respuesta (DM, status, users)
+    uint64_t *pending;
+    size_t pending_head;
+    size_t pending_count;
+    size_t pending_cap;
+    lg_op_t *pending_ops;
+} lg_conn_t;
+
+typedef struct {
+    uint64_t sent[OP_COUNT];
+    uint64_t delivered_broadcast;
+    uint64_t delivered_direct;
+    uint64_t errors;
+    uint64_t disconnects;
+    histogram_t e2e_broadcast;
+    histogram_t e2e_direct;
+    histogram_t rtt[OP_COUNT];
+} lg_stats_t;
+
+typedef struct {
+    int id;
+    int first_index;
+    int n_conns;
+    lg_conn_t *conns;
+    int epfd;
+    double rate;
+    unsigned int seed;
+    lg_stats_t stats;
+    pthread_t tid;
+} lg_worker_t;
+
+typedef struct {
+    const char *server_ip;
+    int port;
+    int connections;
+    int threads;
+    int duration;
+    double rate;
+    int payload_size;
+    int mix[OP_COUNT];
+    int mix_total;
+    const char *format;
+    char prefix[16];
+    bool compress;
+} lg_config_t;
+
+static lg_config_t config;
+static pthread_barrier_t start_barrier;
+static volatile bool sending = true;
+static volatile bool running = true;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <server_ip|unix:path> <server_port> [options]\n", prog);
+    fprintf(stderr, "  -c <n>     connections (default 100)\n");
+    fprintf(stderr, "  -t <n>     worker threads (default 4)\n");
+    fprintf(stderr, "  -d <sec>   test duration in seconds (default 10)\n");
+    fprintf(stderr, "  -r <n>     target rate in requests/s across all connections (default 1000)\n");
+    fprintf(stderr, "  -s <bytes> message payload size (default 64)\n");
+    fprintf(stderr, "  -m <mix>   weights broadcast:direct:status:users (default 60:30:5:5)\n");
+    fprintf(stderr, "  -o <fmt>   output format: csv or json (default csv)\n");
+    fprintf(stderr, "  -p <name>  username prefix (default lg<pid>_)\n");
+    fprintf(stderr, "  -z         ask the server to compress what it sends (TCP only)\n");
+}
+
+static int parse_mix(const char *text) {
+    int values[OP_COUNT];
+    if (sscanf(text, "%d:%d:%d:%d", &values[0], &values[1], &values[2], &values[3]) != OP_COUNT) return -1;
+    config.mix_total = 0;
+    for (int i = 0; i < OP_COUNT; i++) {
+        if (values[i] < 0) return -1;
+        config.mix[i] = values[i];
+        config.mix_total += values[i];
+    }
+    return config.mix_total > 0 ? 0 : -1;
+}
+
+static void user_name(int index, char *out, size_t size) {
+    snprintf(out, size, "%s%d", config.prefix, index);
+}
+
+static void pending_push(lg_conn_t *conn, lg_op_t op, uint64_t ts) {
+    if (conn->pending_count == conn->pending_cap) {
+        size_t cap = conn->pending_cap ? conn->pending_cap * 2 : 16;
+        uint64_t *pending = malloc(cap * sizeof(uint64_t));
+        lg_op_t *ops = malloc(cap * sizeof(lg_op_t));
+        for (size_t i = 0; i < conn->pending_count; i++) {
+            size_t j = (conn->pending_head + i) % (conn->pending_cap ? conn->pending_cap : 1);
+            pending[i] = conn->pending[j];
+            ops[i] = conn->pending_ops[j];
+        }
+        free(conn->pending);
+        free(conn->pending_ops);
+        conn->pending = pending;
+        conn->pending_ops = ops;
+        conn->pending_head = 0;
+        conn->pending_cap = cap;
+    }
+    size_t tail = (conn->pending_head + conn->pending_count) % conn->pending_cap;
+    conn->pending[tail] = ts;
+    conn->pending_ops[tail] = op;
+    conn->pending_count++;
+}
+
+static bool pending_pop(lg_conn_t *conn, lg_op_t *op, uint64_t *ts) {
+    if (conn->pending_count == 0) return false;
+    *ts = conn->pending[conn->pending_head];
+    *op = conn->pending_ops[conn->pending_head];
+    conn->pending_head = (conn->pending_head + 1) % conn->pending_cap;
+    conn->pending_count--;
+    return true;
+}
+
+/*
+Funcion que vacía el buffer de salida de una conexión sin bloquear.
+Si el socket no acepta todo, se pide EPOLLOUT y el resto se envía cuando haya espacio.
+Retornos:
+    * int: 0 para exito y -1 si la conexión falló
+*/
+static int flush_conn(lg_worker_t *worker, lg_conn_t *conn) {
+    size_t offset = 0;
+    while (offset < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + offset, conn->out_len - offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        offset += n;
+    }
+    memmove(conn->out, conn->out + offset, conn->out_len - offset);
+    conn->out_len -= offset;
+
+    bool want_write = conn->out_len > 0;
+    if (want_write != conn->want_write) {
+        struct epoll_event ev = { .events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = conn };
+        epoll_ctl(worker->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->want_write = want_write;
+    }
+    return 0;
+}
+
+static void queue_request(lg_conn_t *conn, const Chat__Request *request) {
+    size_t len = chat__request__get_packed_size(request);
+    size_t needed = conn->out_len + FRAME_HEADER_SIZE + len;
+    if (needed > conn->out_cap) {
+        size_t cap = conn->out_cap ? conn->out_cap : 4096;
+        while (cap < needed) cap *= 2;
+        conn->out = realloc(conn->out, cap);
+        conn->out_cap = cap;
+    }
+    frame_write_header(conn->out + conn->out_len, len);
+    chat__request__pack(request, conn->out + conn->out_len + FRAME_HEADER_SIZE);
+    conn->out_len = needed;
+}
+
+static lg_op_t pick_op(lg_worker_t *worker) {
+    int roll = rand_r(&worker->seed) % config.mix_total;
+    for (int i = 0; i < OP_COUNT; i++) {
+        if (roll < config.mix[i]) return (lg_op_t)i;
+        roll -= config.mix[i];
+    }
+    return OP_BROADCAST;
+}
+
+/*
+Funcion que genera una solicitud del tipo indicado sobre una conexión del worker.
+El contenido de los mensajes inicia con el timestamp de envío para medir la latencia extremo a extremo.
+*/
+static void issue_request(lg_worker_t *worker, lg_conn_t *conn, lg_op_t op) {
+    uint64_t ts = now_ns();
+
+    Chat__Request request = CHAT__REQUEST__INIT;
+    Chat__SendMessageRequest send_message = CHAT__SEND_MESSAGE_REQUEST__INIT;
+    Chat__UpdateStatusRequest update_status = CHAT__UPDATE_STATUS_REQUEST__INIT;
+    Chat__UserListRequest get_users = CHAT__USER_LIST_REQUEST__INIT;
+    char content[config.payload_size + 32];
+    char recipient[32];
+
+    switch (op) {
+        case OP_BROADCAST:
+        case OP_DIRECT: {
+            int written = snprintf(content, sizeof(content), "%llu|", (unsigned long long)ts);
+            while (written < config.payload_size) content[written++] = 'x';
+            content[written] = '\0';
+            send_message.content = content;
+            if (op == OP_DIRECT && config.connections > 1) {
+                int target;
+                do {
+                    target = rand_r(&worker->seed) % config.connections;
+                } while (target == conn->index);
+                user_name(target, recipient, sizeof(recipient));
+                send_message.recipient = recipient;
+            } else {
+                op = OP_BROADCAST;
+            }
+            request.operation = CHAT__OPERATION__SEND_MESSAGE;
+            request.payload_case = CHAT__REQUEST__PAYLOAD_SEND_MESSAGE;
+            request.send_message = &send_message;
+            break;
+        }
+        case OP_STATUS:
+            update_status.username = conn->name;
+            update_status.new_status = CHAT__USER_STATUS__ONLINE;
+            request.operation = CHAT__OPERATION__UPDATE_STATUS;
+            request.payload_case = CHAT__REQUEST__PAYLOAD_UPDATE_STATUS;
+            request.update_status = &update_status;
+            break;
+        case OP_USERS:
+        default:
+            request.operation = CHAT__OPERATION__GET_USERS;
+            request.payload_case = CHAT__REQUEST__PAYLOAD_GET_USERS;
+            request.get_users = &get_users;
+            break;
+    }
+
+    queue_request(conn, &request);
+    if (op != OP_BROADCAST) {
+        pending_push(conn, op, ts);
+    }
+    worker->stats.sent[op]++;
+    if (flush_conn(worker, conn) != 0) {
+        worker->stats.errors++;
+    }
+}
+
+/*
+Funcion que clasifica una respuesta del servidor y registra su latencia.
+    * INCOMING_MESSAGE de otro usuario: entrega de broadcast o DM (latencia extremo a extremo)
+    * INCOMING_MESSAGE propio o de "Server": confirmación de un DM enviado por esta conexión
+    * Cualquier otra respuesta: confirmación de status o lista de usuarios
+*/
+static void handle_response(lg_worker_t *worker, lg_conn_t *conn, const uint8_t *data, size_t len) {
+    uint64_t now = now_ns();
+    Chat__Response *response = chat__response__unpack(NULL, len, data);
+    if (!response) {
+        worker->stats.errors++;
+        return;
+    }
+
+    if (response->result_case == CHAT__RESPONSE__RESULT_INCOMING_MESSAGE) {
+        Chat__IncomingMessageResponse *msg = response->incoming_message;
+        bool ack = strcmp(msg->sender, conn->name) == 0 || strcmp(msg->sender, "Server") == 0;
+        if (!ack) {
+            uint64_t sent_ts = strtoull(msg->content, NULL, 10);
+            uint64_t latency = now > sent_ts ? now - sent_ts : 0;
+            if (msg->type == CHAT__MESSAGE_TYPE__DIRECT) {
+                worker->stats.delivered_direct++;
+                histogram_record(&worker->stats.e2e_direct, latency);
+            } else {
+                worker->stats.delivered_broadcast++;
+                histogram_record(&worker->stats.e2e_broadcast, latency);
+            }
+            chat__response__free_unpacked(response, NULL);
+            return;
+        }
+    }
+
+    lg_op_t op;
+    uint64_t sent_ts;
+    if (pending_pop(conn, &op, &sent_ts)) {
+        histogram_record(&worker->stats.rtt[op], now - sent_ts);
+    }
+    if (response->status_code != CHAT__STATUS_CODE__OK) {
+        worker->stats.errors++;
+    }
+    chat__response__free_unpacked(response, NULL);
+}
+
+static void handle_readable(lg_worker_t *worker, lg_conn_t *conn) {
+    ssize_t n = frame_buffer_fill(&conn->in, conn->fd);
+    const uint8_t *payload;
+    size_t len;
+    int rc = 0;
+    do {
+        // Los frames de un frame comprimido van antes que lo que sigue en el socket
+        while (frame_buffer_next(&conn->inflated, &payload, &len)) {
+            handle_response(worker, conn, payload, len);
+            frame_buffer_consume(&conn->inflated, FRAME_HEADER_SIZE + len);
+        }
+        while ((rc = conn->compressed ? decompress_next(&conn->in, &conn->inflated) : 0) == 0 &&
+               frame_buffer_next(&conn->in, &payload, &len)) {
+            handle_response(worker, conn, payload, len);
+            frame_buffer_consume(&conn->in, FRAME_HEADER_SIZE + len);
+        }
+    } while (rc > 0);
+    bool invalid = rc < 0 || (conn->compressed ? decompress_invalid(&conn->in) : frame_buffer_invalid(&conn->in));
+    if (n == 0 || n == -1 || invalid) {
+        worker->stats.disconnects++;
+        epoll_ctl(worker->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+        close(conn->fd);
+        conn->fd = -1;
+    }
+}
+
+/*
+Funcion que abre una conexión y registra su usuario de forma síncrona.
+Retornos:
+    * int: 0 para exito y -1 si la conexión o el registro fallaron
+*/
+static int connect_and_register(lg_conn_t *conn) {
+    conn->fd = transport_connect(config.server_ip, config.port);
+    if (conn->fd < 0) return -1;
+
+    Chat__Request request = CHAT__REQUEST__INIT;
+    Chat__NewUserRequest new_user = CHAT__NEW_USER_REQUEST__INIT;
+    new_user.username = conn->name;
+    new_user.compression = config.compress ? CHAT__COMPRESSION__COMPRESSION_DEFLATE : CHAT__COMPRESSION__COMPRESSION_NONE;
+    request.operation = CHAT__OPERATION__REGISTER_USER;
+    request.payload_case = CHAT__REQUEST__PAYLOAD_REGISTER_USER;
+    request.register_user = &new_user;
+
+    size_t len = chat__request__get_packed_size(&request);
+    uint8_t *buffer = malloc(len);
+    chat__request__pack(&request, buffer);
+    int rc = send_frame(conn->fd, buffer, len);
+    free(buffer);
+
+    uint8_t *reply = NULL;
+    size_t capacity = 0;
+    ssize_t received = rc == 0 ? recv_frame(conn->fd, &reply, &capacity) : -1;
+    bool ok = false;
+    if (received > 0) {
+        Chat__Response *response = chat__response__unpack(NULL, received, reply);
+        ok = response && response->status_code == CHAT__STATUS_CODE__OK;
+        conn->compressed = ok && response->compression == CHAT__COMPRESSION__COMPRESSION_DEFLATE;
+        chat__response__free_unpacked(response, NULL);
+    }
+    free(reply);
+    if (!ok) {
+        close(conn->fd);
+        conn->fd = -1;
+        return -1;
+    }
+
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    lg_worker_t *worker = (lg_worker_t *)arg;
+    worker->epfd = epoll_create1(0);
+
+    for (int i = 0; i < worker->n_conns; i++) {
+        lg_conn_t *conn = &worker->conns[i];
+        conn->index = worker->first_index + i;
+        user_name(conn->index, conn->name, sizeof(conn->name));
+        frame_buffer_init(&conn->in);
+        frame_buffer_init(&conn->inflated);
+        if (connect_and_register(conn) != 0) {
+            fprintf(stderr, "loadgen: failed to register %s\n", conn->name);
+            worker->stats.errors++;
+            continue;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+        epoll_ctl(worker->epfd, EPOLL_CTL_ADD, conn->fd, &ev);
+    }
+
+    pthread_barrier_wait(&start_barrier);
+
+    uint64_t interval = worker->rate > 0 ? (uint64_t)(1e9 / worker->rate) : 0;
+    uint64_t next_send = now_ns();
+    struct epoll_event events[MAX_EVENTS];
+
+    while (running) {
+        uint64_t now = now_ns();
+        int burst = 0;
+        while (sending && interval > 0 && next_send <= now && burst < MAX_BURST) {
+            lg_conn_t *conn = &worker->conns[rand_r(&worker->seed) % worker->n_conns];
+            if (conn->fd >= 0) {
+                issue_request(worker, conn, pick_op(worker));
+            }
+            next_send += interval;
+            burst++;
+        }
+
+        int timeout = 1;
+        if (sending && interval > 0 && next_send > now) {
+            timeout = (int)((next_send - now) / 1000000);
+        }
+        int n = epoll_wait(worker->epfd, events, MAX_EVENTS, timeout);
+        for (int i = 0; i < n; i++) {
+            lg_conn_t *conn = (lg_conn_t *)events[i].data.ptr;
+            if (conn->fd < 0) continue;
+            if (events[i].events & EPOLLOUT) {
+                if (flush_conn(worker, conn) != 0) worker->stats.errors++;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                handle_readable(worker, conn);
+            }
+        }
+    }
+
+    for (int i = 0; i < worker->n_conns; i++) {
+        lg_conn_t *conn = &worker->conns[i];
+        if (conn->fd >= 0) close(conn->fd);
+        frame_buffer_free(&conn->in);
+        frame_buffer_free(&conn->inflated);
+        free(conn->out);
+        free(conn->pending);
+        free(conn->pending_ops);
+    }
+    close(worker->epfd);
+    return NULL;
+}
+
+static void raise_fd_limit(int connections) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)connections + 64) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void print_row(bool json, bool *first, const char *metric, uint64_t count, double seconds, const histogram_t *h) {
+    double rate = seconds > 0 ? count / seconds : 0;
+    if (json) {
+        printf("%s\n    {\"metric\": \"%s\", \"count\": %llu, \"throughput_per_s\": %.1f", *first ? "" : ",", metric, (unsigned long long)count, rate);
+        if (h) {
+            printf(", \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f, \"mean_us\": %.1f",
+                   histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 99) / 1e3, histogram_percentile(h, 99.9) / 1e3,
+                   h->max / 1e3, histogram_mean(h) / 1e3);
+        }
+        printf("}");
+    } else {
+        printf("%s,%llu,%.1f", metric, (unsigned long long)count, rate);
+        if (h) {
+            printf(",%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                   histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 99) / 1e3, histogram_percentile(h, 99.9) / 1e3,
+                   h->max / 1e3, histogram_mean(h) / 1e3);
+        } else {
+            printf(",,,,,\n");
+        }
+    }
+    *first = false;
+}
+
+/*
+Funcion que combina las estadísticas de todos los workers e imprime el reporte final.
+*/
+static void report(lg_worker_t *workers, double seconds) {
+    lg_stats_t *total = calloc(1, sizeof(lg_stats_t));
+    for (int w = 0; w < config.threads; w++) {
+        lg_stats_t *stats = &workers[w].stats;
+        for (int op = 0; op < OP_COUNT; op++) {
+            total->sent[op] += stats->sent[op];
+            histogram_merge(&total->rtt[op], &stats->rtt[op]);
+        }
+        total->delivered_broadcast += stats->delivered_broadcast;
+        total->delivered_direct += stats->delivered_direct;
+        total->errors += stats->errors;
+        total->disconnects += stats->disconnects;
+        histogram_merge(&total->e2e_broadcast, &stats->e2e_broadcast);
+        histogram_merge(&total->e2e_direct, &stats->e2e_direct);
+    }
+
+    bool json = strcmp(config.format, "json") == 0;
+    bool first = true;
+    char metric[64];
+    if (json) {
+        printf("{\n  \"connections\": %d,\n  \"threads\": %d,\n  \"duration_s\": %.3f,\n  \"target_rate\": %.1f,\n  \"payload_size\": %d,\n",
+               config.connections, config.threads, seconds, config.rate, config.payload_size);
+        printf("  \"errors\": %llu,\n  \"disconnects\": %llu,\n  \"results\": [",
+               (unsigned long long)total->errors, (unsigned long long)total->disconnects);
+    } else {
+        printf("metric,count,throughput_per_s,p50_us,p99_us,p999_us,max_us,mean_us\n");
+    }
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        snprintf(metric, sizeof(metric), "sent_%s", op_names[op]);
+        print_row(json, &first, metric, total->sent[op], seconds, NULL);
+    }
+    print_row(json, &first, "delivery_broadcast", total->delivered_broadcast, seconds, &total->e2e_broadcast);
+    print_row(json, &first, "delivery_direct", total->delivered_direct, seconds, &total->e2e_direct);
+    for (int op = OP_DIRECT; op < OP_COUNT; op++) {
+        snprintf(metric, sizeof(metric), "rtt_%s", op_names[op]);
+        print_row(json, &first, metric, total->rtt[op].total, seconds, &total->rtt[op]);
+    }
+
+    if (json) {
+        printf("\n  ]\n}\n");
+    } else {
+        printf("errors,%llu,,,,,,\n", (unsigned long long)total->errors);
+        printf("disconnects,%llu,,,,,,\n", (unsigned long long)total->disconnects);
+    }
+    free(total);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    config.server_ip = argv[1];
+    config.port = atoi(argv[2]);
+    config.connections = 100;
+    config.threads = 4;
+    config.duration = 10;
+    config.rate = 1000;
+    config.payload_size = 64;
+    config.format = "csv";
+    snprintf(config.prefix, sizeof(config.prefix), "lg%d_", (int)getpid() % 100000);
+    parse_mix("60:30:5:5");
+
+    int opt;
+    optind = 3;
+    while ((opt = getopt(argc, argv, "c:t:d:r:s:m:o:p:z")) != -1) {
+        switch (opt) {
+            case 'c': config.connections = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'd': config.duration = atoi(optarg); break;
+            case 'r': config.rate = atof(optarg); break;
+            case 's': config.payload_size = atoi(optarg); break;
+            case 'm':
+                if (parse_mix(optarg) != 0) {
+                    fprintf(stderr, "Invalid mix '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o': config.format = optarg; break;
+            case 'p': snprintf(config.prefix, sizeof(config.prefix), "%s", optarg); break;
+            case 'z': config.compress = true; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (config.connections < 1 || config.threads < 1 || config.duration < 1 || config.payload_size < 24) {
+        fprintf(stderr, "Invalid options (payload size must be at least 24 bytes to hold the timestamp)\n");
+        return 1;
+    }
+    if (config.threads > config.connections) config.threads = config.connections;
+
+    raise_fd_limit(config.connections);
+    pthread_barrier_init(&start_barrier, NULL, config.threads + 1);
+
+    lg_worker_t *workers = calloc(config.threads, sizeof(lg_worker_t));
+    lg_conn_t *conns = calloc(config.connections, sizeof(lg_conn_t));
+    int assigned = 0;
+    for (int w = 0; w < config.threads; w++) {
+        lg_worker_t *worker = &workers[w];
+        worker->id = w;
+        worker->first_index = assigned;
+        worker->n_conns = config.connections / config.threads + (w < config.connections % config.threads ? 1 : 0);
+        worker->conns = &conns[assigned];
+        worker->rate = config.rate / config.threads;
+        worker->seed = (unsigned int)(time(NULL) ^ (w * 7919));
+        for (int op = 0; op < OP_COUNT; op++) histogram_init(&worker->stats.rtt[op]);
+        histogram_init(&worker->stats.e2e_broadcast);
+        histogram_init(&worker->stats.e2e_direct);
+        assigned += worker->n_conns;
+        pthread_create(&worker->tid, NULL, worker_main, worker);
+    }
+
+    // Esperar a que todas las conexiones estén registradas antes de medir
+    pthread_barrier_wait(&start_barrier);
+    fprintf(stderr, "loadgen: %d connections registered, running for %d s\n", config.connections, config.duration);
+    uint64_t start = now_ns();
+    sleep(config.duration);
+    sending = false;
+    double seconds = (now_ns() - start) / 1e9;
+    sleep(DRAIN_SECONDS);
+    running = false;
+
+    for (int w = 0; w < config.threads; w++) {
+        pthread_join(workers[w].tid, NULL);
+    }
+    report(workers, seconds);
+
+    free(conns);
+    free(workers);
+    pthread_barrier_destroy(&start_barrier);
+    return 0;
+}
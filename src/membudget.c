@@ -0,0 +1,56 @@
+/*
+    * membudget.c
+    * Implementation of the global memory accounting and the admission thresholds.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include "membudget.h"
+
+uint64_t mem_budget = 0;
+
+static int64_t usage[MEM_CATEGORIES];
+
+static const char *category_names[MEM_CATEGORIES] = {
+    "clients", "buffers", "queues", "history", "shared_memory"
+};
+
+const char *mem_category_name(mem_category_t category) {
+    return category_names[category];
+}
+
+void mem_charge(mem_category_t category, int64_t bytes) {
+    if (bytes) __atomic_fetch_add(&usage[category], bytes, __ATOMIC_RELAXED);
+}
+
+/*
+Funcion que registra el tamaño actual de un buffer, cobrando solo la diferencia con lo ya registrado.
+Parametros:
+    * size_t *accounted: lo registrado para este buffer; se actualiza
+    * size_t size: capacidad actual (0 cuando se libera)
+*/
+void mem_resize(mem_category_t category, size_t *accounted, size_t size) {
+    if (size == *accounted) return;
+    mem_charge(category, (int64_t)size - (int64_t)*accounted);
+    *accounted = size;
+}
+
+uint64_t mem_usage(mem_category_t category) {
+    int64_t value = __atomic_load_n(&usage[category], __ATOMIC_RELAXED);
+    return value > 0 ? (uint64_t)value : 0;
+}
+
+uint64_t mem_used(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < MEM_CATEGORIES; i++) total += mem_usage(i);
+    return total;
+}
+
+// Hay lugar para un usuario nuevo
+bool mem_admitting(void) {
+    return mem_budget == 0 || mem_used() * 100 < mem_budget * MEM_ADMIT_PERCENT;
+}
+
+// El uso está tan cerca del presupuesto que se descartan los broadcasts
+bool mem_shedding(void) {
+    return mem_budget != 0 && mem_used() * 100 >= mem_budget * MEM_SHED_PERCENT;
+}
@@ -0,0 +1,39 @@
+/*
+    * membudget.h
+    * Global memory accounting of the server: every long-lived allocation (client records, request buffers,
+    * outgoing queues, replay windows, shared-memory rings) is charged to a category, and admission control
+    * compares the total against a configured budget so a host can be packed with a predictable footprint.
+    * Counters are relaxed atomics; callers charge the difference when a buffer grows or is freed.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef MEMBUDGET_H
+#define MEMBUDGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MEM_ADMIT_PERCENT 85  // Sobre este uso del presupuesto se rechazan registros nuevos
+#define MEM_SHED_PERCENT 95   // Sobre este uso se rechazan broadcasts
+
+typedef enum {
+    MEM_CLIENTS = 0,  // client_t de usuarios conectados y sesiones sin conexión
+    MEM_BUFFERS,      // Buffers de lectura de las conexiones
+    MEM_QUEUES,       // Broadcasts esperando la ventana de coalescencia y colas de salida por prioridad
+    MEM_HISTORY,      // Ventanas de reenvío de las sesiones reanudables
+    MEM_SHM,          // Rings de memoria compartida mapeados
+    MEM_CATEGORIES
+} mem_category_t;
+
+extern uint64_t mem_budget;  // Bytes; 0 es sin límite
+
+const char *mem_category_name(mem_category_t category);
+void mem_charge(mem_category_t category, int64_t bytes);
+void mem_resize(mem_category_t category, size_t *accounted, size_t size);
+uint64_t mem_usage(mem_category_t category);
+uint64_t mem_used(void);
+bool mem_admitting(void);
+bool mem_shedding(void);
+
+#endif
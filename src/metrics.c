@@ -0,0 +1,381 @@
+/*
+    * metrics.c
+    * Implementation of the per-thread metrics and the Prometheus stats endpoint.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "chat.pb-c.h"
+#include "histogram.h"
+#include "metrics.h"
+#include "membudget.h"
+#include "coro.h"
+
+typedef struct metrics_block {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    uint64_t operations[METRICS_MAX_OPERATIONS];
+    uint64_t rate_limited[RATE_KINDS];
+    histogram_t histograms[METRIC_HISTOGRAM_COUNT];
+    struct metrics_block *prev;
+    struct metrics_block *next;
+} metrics_block_t;
+
+static const char *counter_names[METRIC_COUNTER_COUNT] = {
+    "chat_connections_accepted_total",
+    "chat_connections_closed_total",
+    "chat_registrations_total",
+    "chat_registrations_rejected_total",
+    "chat_decode_errors_total",
+    "chat_messages_delivered_total",
+    "chat_send_drops_total",
+    "chat_bytes_received_total",
+    "chat_bytes_sent_total",
+    "chat_coalesced_writes_total",
+    "chat_sessions_resumed_total",
+    "chat_messages_replayed_total",
+    "chat_broadcasts_shed_total",
+    "chat_federation_events_sent_total",
+    "chat_federation_events_received_total",
+    "chat_federation_events_dropped_total",
+    "chat_federation_batches_sent_total",
+    "chat_registrations_redirected_total",
+    "chat_sessions_migrated_total",
+    "chat_priority_overtakes_total",
+    "chat_compression_input_bytes_total",
+    "chat_compression_output_bytes_total",
+    "chat_stream_bytes_total",
+    "chat_streams_aborted_total",
+    "chat_handler_thread_fallbacks_total"
+};
+
+static const char *counter_help[METRIC_COUNTER_COUNT] = {
+    "Accepted TCP connections.",
+    "Closed client connections.",
+    "Successful user registrations.",
+    "Rejected user registrations.",
+    "Frames that could not be decoded as a Request.",
+    "Incoming messages written to recipients.",
+    "Responses that could not be written to a client socket.",
+    "Framed request bytes read from clients.",
+    "Framed response bytes written to clients.",
+    "Writes that flushed coalesced broadcasts to one client.",
+    "Resumable sessions picked up again by a reconnecting client.",
+    "Messages replayed from a session's replay window on resume.",
+    "Broadcasts rejected because memory usage was near the budget.",
+    "Events written to the links to other federation nodes.",
+    "Events received from other federation nodes.",
+    "Events for another node dropped because its link was down or its queue was full.",
+    "NodeBatch frames written to the links to other federation nodes.",
+    "Registrations answered with a redirect to the node that owns the username.",
+    "Resumable sessions handed over to the node that now owns the username.",
+    "Frames queued ahead of lower-priority frames already waiting for the same connection.",
+    "Framed response bytes handed to the compressor for connections that negotiated compression.",
+    "Bytes the compressor produced from them (what went to the socket instead).",
+    "Stream content bytes relayed from senders (counted once, whatever the number of recipients).",
+    "Streams stopped before their end: cancelled by the sender, rejected chunks, lost recipients or disconnects.",
+    "Client handlers started on a thread of their own although coroutine workers run (no output lanes or no memory)."
+};
+
+static const char *histogram_names[METRIC_HISTOGRAM_COUNT] = {
+    "chat_request_decode_seconds",
+    "chat_queue_delay_seconds",
+    "chat_broadcast_fanout_seconds",
+    "chat_request_duration_seconds"
+};
+
+static const char *histogram_help[METRIC_HISTOGRAM_COUNT] = {
+    "Time spent unpacking a Request.",
+    "Time a request waits for the client registry before being processed.",
+    "Time to fan out one broadcast to every recipient.",
+    "Time from frame arrival to the end of its handler."
+};
+
+static pthread_mutex_t blocks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t block_key;
+static metrics_block_t *blocks = NULL;
+static metrics_block_t retired;   // Totales de threads que ya terminaron
+static __thread metrics_block_t *local_block = NULL;
+
+static inline void relaxed_add(uint64_t *target, uint64_t amount) {
+    // Solo el thread dueño escribe en su bloque, por lo que no hace falta una suma atómica con lock
+    __atomic_store_n(target, __atomic_load_n(target, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+static void merge_block(metrics_block_t *dst, const metrics_block_t *src) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        dst->counters[i] += __atomic_load_n(&src->counters[i], __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < METRICS_MAX_OPERATIONS; i++) {
+        dst->operations[i] += __atomic_load_n(&src->operations[i], __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < RATE_KINDS; i++) {
+        dst->rate_limited[i] += __atomic_load_n(&src->rate_limited[i], __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        histogram_merge(&dst->histograms[i], &src->histograms[i]);
+    }
+}
+
+// Al terminar un thread sus valores pasan al bloque de retirados para no perderlos
+static void retire_block(void *arg) {
+    metrics_block_t *block = (metrics_block_t *)arg;
+    pthread_mutex_lock(&blocks_mutex);
+    merge_block(&retired, block);
+    if (block->prev) block->prev->next = block->next;
+    else blocks = block->next;
+    if (block->next) block->next->prev = block->prev;
+    pthread_mutex_unlock(&blocks_mutex);
+    free(block);
+}
+
+static void create_key(void) {
+    pthread_key_create(&block_key, retire_block);
+}
+
+static metrics_block_t *get_block(void) {
+    if (local_block) return local_block;
+
+    pthread_once(&key_once, create_key);
+    metrics_block_t *block = calloc(1, sizeof(metrics_block_t));
+    pthread_mutex_lock(&blocks_mutex);
+    block->next = blocks;
+    if (blocks) blocks->prev = block;
+    blocks = block;
+    pthread_mutex_unlock(&blocks_mutex);
+    pthread_setspecific(block_key, block);
+    local_block = block;
+    return block;
+}
+
+uint64_t metrics_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void metrics_count(metric_counter_t counter, uint64_t amount) {
+    relaxed_add(&get_block()->counters[counter], amount);
+}
+
+void metrics_count_operation(int operation) {
+    if (operation < 0 || operation >= METRICS_MAX_OPERATIONS) return;
+    relaxed_add(&get_block()->operations[operation], 1);
+}
+
+void metrics_count_rate_limited(rate_kind_t kind) {
+    relaxed_add(&get_block()->rate_limited[kind], 1);
+}
+
+void metrics_observe(metric_histogram_t histogram, uint64_t nanoseconds) {
+    histogram_t *h = &get_block()->histograms[histogram];
+    relaxed_add(&h->counts[histogram_bucket_index(nanoseconds)], 1);
+    relaxed_add(&h->total, 1);
+    relaxed_add(&h->sum, nanoseconds);
+    if (nanoseconds > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->max, nanoseconds, __ATOMIC_RELAXED);
+    }
+}
+
+static const char *operation_name(int operation) {
+    for (unsigned i = 0; i < chat__operation__descriptor.n_values; i++) {
+        if (chat__operation__descriptor.values[i].value == operation) {
+            return chat__operation__descriptor.values[i].name;
+        }
+    }
+    return NULL;
+}
+
+/*
+Funcion que genera el texto de métricas en formato Prometheus.
+Parametros:
+    * char **out: recibe el texto (el llamador debe liberarlo con free)
+Retornos:
+    * size_t: longitud del texto
+*/
+size_t metrics_render(char **out) {
+    metrics_block_t *total = calloc(1, sizeof(metrics_block_t));
+    pthread_mutex_lock(&blocks_mutex);
+    merge_block(total, &retired);
+    for (metrics_block_t *block = blocks; block; block = block->next) {
+        merge_block(total, block);
+    }
+    pthread_mutex_unlock(&blocks_mutex);
+
+    size_t len = 0;
+    FILE *stream = open_memstream(out, &len);
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(stream, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", counter_names[i], counter_help[i],
+                counter_names[i], counter_names[i], (unsigned long long)total->counters[i]);
+    }
+
+    uint64_t accepted = total->counters[METRIC_CONNECTIONS_ACCEPTED];
+    uint64_t closed = total->counters[METRIC_CONNECTIONS_CLOSED];
+    fprintf(stream, "# HELP chat_connections Currently open client connections.\n# TYPE chat_connections gauge\n");
+    fprintf(stream, "chat_connections %llu\n", (unsigned long long)(accepted > closed ? accepted - closed : 0));
+    fprintf(stream, "# HELP chat_coroutines Client handlers running as coroutines.\n# TYPE chat_coroutines gauge\n");
+    fprintf(stream, "chat_coroutines %llu\n", (unsigned long long)coro_count());
+    fprintf(stream, "# HELP chat_coroutine_stack_bytes Address space mapped for coroutine stacks, pooled ones included (resident is only what was touched).\n# TYPE chat_coroutine_stack_bytes gauge\n");
+    fprintf(stream, "chat_coroutine_stack_bytes %llu\n", (unsigned long long)coro_stack_bytes());
+    fprintf(stream, "# HELP chat_tasks_run_total Heavy request steps run as tasks of the worker pool.\n# TYPE chat_tasks_run_total counter\n");
+    fprintf(stream, "chat_tasks_run_total %llu\n", (unsigned long long)coro_tasks_run());
+    fprintf(stream, "# HELP chat_tasks_stolen_total Tasks run by a worker other than the one of their coroutine.\n# TYPE chat_tasks_stolen_total counter\n");
+    fprintf(stream, "chat_tasks_stolen_total %llu\n", (unsigned long long)coro_tasks_stolen());
+
+    fprintf(stream, "# HELP chat_requests_total Requests handled, by operation.\n# TYPE chat_requests_total counter\n");
+    for (int op = 0; op < METRICS_MAX_OPERATIONS; op++) {
+        const char *name = operation_name(op);
+        if (name) {
+            fprintf(stream, "chat_requests_total{operation=\"%s\"} %llu\n", name, (unsigned long long)total->operations[op]);
+        }
+    }
+
+    fprintf(stream, "# HELP chat_rate_limited_total Requests rejected by the per-client rate limits, by kind.\n# TYPE chat_rate_limited_total counter\n");
+    for (int kind = 0; kind < RATE_KINDS; kind++) {
+        fprintf(stream, "chat_rate_limited_total{kind=\"%s\"} %llu\n", rate_kind_name(kind), (unsigned long long)total->rate_limited[kind]);
+    }
+
+    fprintf(stream, "# HELP chat_memory_budget_bytes Configured memory budget (0 if unlimited).\n# TYPE chat_memory_budget_bytes gauge\n");
+    fprintf(stream, "chat_memory_budget_bytes %llu\n", (unsigned long long)mem_budget);
+    fprintf(stream, "# HELP chat_memory_used_bytes Memory accounted against the budget, by category.\n# TYPE chat_memory_used_bytes gauge\n");
+    for (int i = 0; i < MEM_CATEGORIES; i++) {
+        fprintf(stream, "chat_memory_used_bytes{category=\"%s\"} %llu\n", mem_category_name(i), (unsigned long long)mem_usage(i));
+    }
+
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        const histogram_t *h = &total->histograms[i];
+        fprintf(stream, "# HELP %s %s\n# TYPE %s summary\n", histogram_names[i], histogram_help[i], histogram_names[i]);
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            fprintf(stream, "%s{quantile=\"%g\"} %.9f\n", histogram_names[i], quantiles[q],
+                    histogram_percentile(h, quantiles[q] * 100) / 1e9);
+        }
+        fprintf(stream, "%s_sum %.9f\n%s_count %llu\n", histogram_names[i], h->sum / 1e9,
+                histogram_names[i], (unsigned long long)h->total);
+    }
+    fclose(stream);
+    free(total);
+    return len;
+}
+
+// Responde una solicitud HTTP mínima (o una conexión sin solicitud en el socket Unix) con las métricas
+static void serve_connection(int fd) {
+    char request[1024];
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, 200) > 0) {
+        // El contenido de la solicitud no importa: cualquier ruta devuelve las métricas
+        recv(fd, request, sizeof(request), MSG_DONTWAIT);
+    }
+
+    char *body = NULL;
+    size_t body_len = metrics_render(&body);
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                              body_len);
+    send(fd, header, header_len, MSG_NOSIGNAL);
+    size_t sent = 0;
+    while (sent < body_len) {
+        ssize_t n = send(fd, body + sent, body_len - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
+    }
+    free(body);
+    close(fd);
+}
+
+static void *metrics_server_main(void *arg) {
+    int *fds = (int *)arg;
+    struct pollfd pfds[2];
+    int nfds = 0;
+    for (int i = 0; i < 2; i++) {
+        if (fds[i] >= 0) {
+            pfds[nfds].fd = fds[i];
+            pfds[nfds].events = POLLIN;
+            nfds++;
+        }
+    }
+    free(fds);
+
+    while (1) {
+        if (poll(pfds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("metrics poll");
+            break;
+        }
+        for (int i = 0; i < nfds; i++) {
+            if (pfds[i].revents & POLLIN) {
+                int fd = accept(pfds[i].fd, NULL, NULL);
+                if (fd >= 0) serve_connection(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+Funcion que inicia el endpoint de métricas en un thread propio.
+Parametros:
+    * int port: puerto TCP en 127.0.0.1 (0 para no usarlo)
+    * const char *socket_path: ruta del socket Unix (NULL para no usarlo)
+Retornos:
+    * int: 0 para exito y -1 si no se pudo abrir ningún listener pedido
+*/
+int metrics_start_server(int port, const char *socket_path) {
+    int *fds = malloc(2 * sizeof(int));
+    fds[0] = -1;
+    fds[1] = -1;
+
+    if (port > 0) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+            perror("Metrics: can't listen on stats port");
+            close(fd);
+            free(fds);
+            return -1;
+        }
+        fds[0] = fd;
+    }
+
+    if (socket_path) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr = {0};
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+        unlink(socket_path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+            perror("Metrics: can't listen on stats socket");
+            close(fd);
+            if (fds[0] >= 0) close(fds[0]);
+            free(fds);
+            return -1;
+        }
+        fds[1] = fd;
+    }
+
+    if (fds[0] < 0 && fds[1] < 0) {
+        free(fds);
+        return 0;
+    }
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, metrics_server_main, fds);
+    pthread_detach(tid);
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+    * metrics.h
+    * Server metrics: per-thread counters and latency histograms exported in Prometheus text format.
+    * Each thread writes only to its own block (no locks, relaxed atomics), the stats endpoint sums all blocks.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "ratelimit.h"
+
+#define METRICS_MAX_OPERATIONS 32
+
+typedef enum {
+    METRIC_CONNECTIONS_ACCEPTED = 0,
+    METRIC_CONNECTIONS_CLOSED,
+    METRIC_REGISTRATIONS,
+    METRIC_REGISTRATIONS_REJECTED,
+    METRIC_DECODE_ERRORS,
+    METRIC_MESSAGES_DELIVERED,
+    METRIC_SEND_DROPS,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_COALESCED_WRITES,
+    METRIC_SESSIONS_RESUMED,
+    METRIC_MESSAGES_REPLAYED,
+    METRIC_BROADCASTS_SHED,
+    METRIC_FEDERATION_EVENTS_SENT,
+    METRIC_FEDERATION_EVENTS_RECEIVED,
+    METRIC_FEDERATION_EVENTS_DROPPED,
+    METRIC_FEDERATION_BATCHES_SENT,
+    METRIC_REGISTRATIONS_REDIRECTED,
+    METRIC_SESSIONS_MIGRATED,
+    METRIC_LANE_OVERTAKES,
+    METRIC_COMPRESSION_IN_BYTES,
+    METRIC_COMPRESSION_OUT_BYTES,
+    METRIC_STREAM_BYTES,
+    METRIC_STREAMS_ABORTED,
+    METRIC_HANDLER_THREADS,
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+typedef enum {
+    METRIC_DECODE_TIME = 0,   // Tiempo de chat__request__unpack
+    METRIC_QUEUE_DELAY,       // Espera por el registro de clientes antes de atender la solicitud
+    METRIC_FANOUT_TIME,       // Duración de un broadcast completo
+    METRIC_REQUEST_TIME,      // Desde que llega el frame hasta que termina el handler
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_t;
+
+void metrics_count(metric_counter_t counter, uint64_t amount);
+void metrics_count_operation(int operation);
+void metrics_count_rate_limited(rate_kind_t kind);
+void metrics_observe(metric_histogram_t histogram, uint64_t nanoseconds);
+uint64_t metrics_now(void);
+
+int metrics_start_server(int port, const char *socket_path);
+size_t metrics_render(char **out);
+
+#endif
@@ -0,0 +1,50 @@
+/*
+    * probes.h
+    * USDT (sys/sdt.h) static tracepoints on the request lifecycle, under the "chat" provider.
+    * A disabled probe is a single nop in the binary, so they stay compiled in production; they are
+    * attached at runtime with perf or bpftrace, e.g. bpftrace -e 'usdt:./server:chat:fanout_end { @[arg0] = hist(arg1); }'.
+    * Without <sys/sdt.h> (or with -DCHAT_NO_SDT) the macros expand to nothing.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#if !defined(CHAT_NO_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CHAT_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef CHAT_HAVE_SDT
+#define CHAT_PROBE1(name, a) DTRACE_PROBE1(chat, name, a)
+#define CHAT_PROBE2(name, a, b) DTRACE_PROBE2(chat, name, a, b)
+#define CHAT_PROBE3(name, a, b, c) DTRACE_PROBE3(chat, name, a, b, c)
+#define CHAT_PROBE4(name, a, b, c, d) DTRACE_PROBE4(chat, name, a, b, c, d)
+#else
+#define CHAT_PROBE1(name, a) do { } while (0)
+#define CHAT_PROBE2(name, a, b) do { } while (0)
+#define CHAT_PROBE3(name, a, b, c) do { } while (0)
+#define CHAT_PROBE4(name, a, b, c, d) do { } while (0)
+#endif
+
+/*
+Probes disponibles (argumentos en orden):
+    * accept(fd)
+    * register(uid, username, accepted)
+    * request_decode(uid, frame_len, operation, decode_ns)
+    * op_get_users(uid, single_user)
+    * op_update_status(uid, new_status)
+    * op_direct_message(uid, recipient, content_len)
+    * op_broadcast(uid, content_len)
+    * op_send_batch(uid, messages)
+    * op_multicast(uid, recipients, content_len)
+    * op_stream_chunk(uid, phase, data_len)
+    * request_done(uid, operation, duration_ns)
+    * fanout_start(sender, content_len)
+    * fanout_end(recipients, duration_ns)
+    * disconnect(uid, username)
+*/
+
+#endif
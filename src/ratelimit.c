@@ -0,0 +1,72 @@
+/*
+    * ratelimit.c
+    * Implementation of the per-client token buckets.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ratelimit.h"
+
+rate_limit_t rate_limits[RATE_KINDS];
+
+static const char *kind_names[RATE_KINDS] = {
+    "broadcast", "direct", "status", "users", "batch", "multicast"
+};
+
+const char *rate_kind_name(rate_kind_t kind) {
+    return kind >= 0 && kind < RATE_KINDS ? kind_names[kind] : "unknown";
+}
+
+/*
+Funcion que configura el límite de un tipo de solicitud a partir de una opción de línea de comandos.
+Parametros:
+    * const char *spec: "<tipo>=<tokens por segundo>[/<burst>]", por ejemplo "broadcast=50/200";
+      sin burst se permite un segundo de solicitudes seguidas
+Retornos:
+    * int: 0 para exito y -1 si el tipo o los números no son válidos
+*/
+int rate_limit_parse(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq) return -1;
+    for (int kind = 0; kind < RATE_KINDS; kind++) {
+        if (strlen(kind_names[kind]) != (size_t)(eq - spec) || strncmp(spec, kind_names[kind], eq - spec) != 0) continue;
+        char *end;
+        double rate = strtod(eq + 1, &end);
+        double burst = rate < 1 ? 1 : rate;
+        if (*end == '/') burst = strtod(end + 1, &end);
+        if (*end != '\0' || rate < 0 || burst < 1) return -1;
+        rate_limits[kind].rate = rate;
+        rate_limits[kind].burst = burst;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+Funcion que cobra una solicitud del bucket de un cliente, recargándolo según el tiempo transcurrido.
+Una solicitud más cara que el burst (un batch grande) pasa si el bucket está lleno y lo deja en deuda,
+así que se cobra igual pero no queda bloqueada para siempre.
+Parametros:
+    * rate_bucket_t *bucket: bucket del cliente para este tipo
+    * rate_kind_t kind: tipo de solicitud
+    * double cost: tokens que cuesta la solicitud
+    * uint64_t now: tiempo actual en nanosegundos (metrics_now)
+Retornos:
+    * bool: true si la solicitud se atiende, false si excede el límite
+*/
+bool rate_allow(rate_bucket_t *bucket, rate_kind_t kind, double cost, uint64_t now) {
+    const rate_limit_t *limit = &rate_limits[kind];
+    if (limit->rate <= 0) return true;
+    if (bucket->updated == 0) {
+        bucket->tokens = limit->burst;
+    } else if (now > bucket->updated) {
+        bucket->tokens += (now - bucket->updated) * 1e-9 * limit->rate;
+        if (bucket->tokens > limit->burst) bucket->tokens = limit->burst;
+    }
+    bucket->updated = now;
+    if (bucket->tokens < (cost < limit->burst ? cost : limit->burst)) return false;
+    bucket->tokens -= cost;
+    return true;
+}
@@ -0,0 +1,41 @@
+/*
+    * ratelimit.h
+    * Token buckets that limit how fast each client can issue each kind of request.
+    * Every client_t owns one bucket per kind and only its handler thread touches them, so a check needs no lock.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Tipos de solicitud con límite propio; los broadcasts y los DMs comparten operación pero no bucket
+typedef enum {
+    RATE_BROADCAST = 0,
+    RATE_DIRECT,
+    RATE_STATUS,
+    RATE_USERS,
+    RATE_BATCH,      // Cada mensaje del batch cuesta un token
+    RATE_MULTICAST,  // Cada destinatario cuesta un token
+    RATE_KINDS
+} rate_kind_t;
+
+typedef struct {
+    double rate;   // Tokens por segundo; 0 es sin límite
+    double burst;  // Capacidad del bucket
+} rate_limit_t;
+
+typedef struct {
+    double tokens;
+    uint64_t updated;  // metrics_now() del último cálculo; 0 mientras el bucket está lleno sin usar
+} rate_bucket_t;
+
+extern rate_limit_t rate_limits[RATE_KINDS];
+
+const char *rate_kind_name(rate_kind_t kind);
+int rate_limit_parse(const char *spec);
+bool rate_allow(rate_bucket_t *bucket, rate_kind_t kind, double cost, uint64_t now);
+
+#endif
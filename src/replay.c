@@ -0,0 +1,280 @@
+/*
+    * replay.c
+    * Replays a traffic capture written by the server with --capture against another server.
+    * Opens one connection per captured connection and sends each captured request at its original offset from the
+    * start of the capture, divided by the speed factor (or as fast as possible), so a load spike recorded in
+    * production can be reproduced offline for profiling and regression benchmarks. Responses are read and discarded.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "frame.h"
+#include "transport.h"
+#include "capture.h"
+
+#define MAX_EVENTS 256
+#define DRAIN_SECONDS 1
+#define REPLAY_MAX_PENDING (4 << 20)  // Bytes sin enviar en una conexión antes de esperar al servidor
+#define POLL_EVERY 64  // Registros entre lecturas de respuestas cuando se envía sin esperar (-s 0)
+
+typedef struct {
+    int fd;
+    bool closed;  // La cerró la captura, el servidor o un error: el resto de sus registros se descarta
+    uint8_t *out;
+    size_t out_len;
+    size_t out_cap;
+    bool want_write;
+} rp_conn_t;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t skipped;  // Registros de conexiones ya cerradas
+    uint64_t connections;
+    uint64_t connect_errors;
+    uint64_t disconnects;  // Conexiones que cerró el servidor
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t max_lag_ns;  // Mayor atraso respecto a la hora programada de un registro
+} rp_stats_t;
+
+static const char *server_ip;
+static int server_port;
+static double speed = 1.0;
+static int epfd;
+static rp_conn_t *conns;
+static rp_stats_t stats;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <capture> <server_ip|unix:path> <server_port> [options]\n", prog);
+    fprintf(stderr, "  -s <x>     speed factor: 1 original timing, 10 ten times faster, 0 as fast as possible (default 1)\n");
+    fprintf(stderr, "  -o <fmt>   output format: csv or json (default csv)\n");
+}
+
+static void close_conn(rp_conn_t *conn, bool by_server) {
+    if (conn->fd >= 0) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+        close(conn->fd);
+        conn->fd = -1;
+        if (by_server) stats.disconnects++;
+    }
+    conn->closed = true;
+    free(conn->out);
+    conn->out = NULL;
+    conn->out_len = conn->out_cap = 0;
+}
+
+static void flush_conn(rp_conn_t *conn) {
+    size_t offset = 0;
+    while (offset < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + offset, conn->out_len - offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            close_conn(conn, true);
+            return;
+        }
+        offset += n;
+    }
+    memmove(conn->out, conn->out + offset, conn->out_len - offset);
+    conn->out_len -= offset;
+
+    bool want_write = conn->out_len > 0;
+    if (want_write != conn->want_write) {
+        struct epoll_event ev = { .events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = conn };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->want_write = want_write;
+    }
+}
+
+static void handle_readable(rp_conn_t *conn) {
+    static uint8_t discard[64 * 1024];
+    while (1) {
+        ssize_t n = recv(conn->fd, discard, sizeof(discard), 0);
+        if (n > 0) {
+            stats.bytes_received += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        close_conn(conn, true);
+        return;
+    }
+}
+
+/*
+Funcion que atiende las conexiones listas durante a lo más timeout_ms: descarta respuestas y envía lo pendiente.
+*/
+static void poll_conns(int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(epfd, events, MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        rp_conn_t *conn = events[i].data.ptr;
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) handle_readable(conn);
+        if (conn->fd >= 0 && (events[i].events & EPOLLOUT)) flush_conn(conn);
+    }
+}
+
+static bool open_conn(rp_conn_t *conn) {
+    conn->fd = transport_connect(server_ip, server_port);
+    if (conn->fd < 0) {
+        stats.connect_errors++;
+        conn->closed = true;
+        return false;
+    }
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, conn->fd, &ev);
+    stats.connections++;
+    return true;
+}
+
+static void queue_frame(rp_conn_t *conn, const uint8_t *payload, size_t len) {
+    size_t needed = conn->out_len + FRAME_HEADER_SIZE + len;
+    if (needed > conn->out_cap) {
+        size_t cap = conn->out_cap ? conn->out_cap : 4096;
+        while (cap < needed) cap *= 2;
+        conn->out = realloc(conn->out, cap);
+        conn->out_cap = cap;
+    }
+    frame_write_header(conn->out + conn->out_len, len);
+    memcpy(conn->out + conn->out_len + FRAME_HEADER_SIZE, payload, len);
+    conn->out_len = needed;
+    stats.bytes_sent += FRAME_HEADER_SIZE + len;
+}
+
+/*
+Funcion que espera hasta la hora programada de un registro atendiendo las conexiones mientras tanto.
+*/
+static void wait_until(uint64_t due) {
+    uint64_t now;
+    while ((now = now_ns()) < due) {
+        poll_conns((int)((due - now + 999999) / 1000000));
+    }
+    if (now - due > stats.max_lag_ns) stats.max_lag_ns = now - due;
+}
+
+static void raise_fd_limit(uint32_t connections) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)connections + 64) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void report(bool json, const capture_map_t *map, double seconds) {
+    double capture_seconds = map->duration_ns / 1e9;
+    double rate = seconds > 0 ? stats.requests / seconds : 0;
+    if (json) {
+        printf("{\n  \"records\": %llu,\n  \"capture_duration_s\": %.3f,\n  \"speed\": %g,\n  \"duration_s\": %.3f,\n",
+               (unsigned long long)map->records, capture_seconds, speed, seconds);
+        printf("  \"requests\": %llu,\n  \"throughput_per_s\": %.1f,\n  \"skipped\": %llu,\n  \"connections\": %llu,\n",
+               (unsigned long long)stats.requests, rate, (unsigned long long)stats.skipped, (unsigned long long)stats.connections);
+        printf("  \"connect_errors\": %llu,\n  \"disconnects\": %llu,\n  \"bytes_sent\": %llu,\n  \"bytes_received\": %llu,\n",
+               (unsigned long long)stats.connect_errors, (unsigned long long)stats.disconnects,
+               (unsigned long long)stats.bytes_sent, (unsigned long long)stats.bytes_received);
+        printf("  \"max_lag_ms\": %.3f\n}\n", stats.max_lag_ns / 1e6);
+    } else {
+        printf("metric,value\n");
+        printf("records,%llu\ncapture_duration_s,%.3f\nspeed,%g\nduration_s,%.3f\n",
+               (unsigned long long)map->records, capture_seconds, speed, seconds);
+        printf("requests,%llu\nthroughput_per_s,%.1f\nskipped,%llu\nconnections,%llu\n",
+               (unsigned long long)stats.requests, rate, (unsigned long long)stats.skipped, (unsigned long long)stats.connections);
+        printf("connect_errors,%llu\ndisconnects,%llu\nbytes_sent,%llu\nbytes_received,%llu\nmax_lag_ms,%.3f\n",
+               (unsigned long long)stats.connect_errors, (unsigned long long)stats.disconnects,
+               (unsigned long long)stats.bytes_sent, (unsigned long long)stats.bytes_received, stats.max_lag_ns / 1e6);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    server_ip = argv[2];
+    server_port = atoi(argv[3]);
+    const char *format = "csv";
+
+    int opt;
+    optind = 4;
+    while ((opt = getopt(argc, argv, "s:o:")) != -1) {
+        switch (opt) {
+            case 's': speed = atof(optarg); break;
+            case 'o': format = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (speed < 0 || transport_is_shm(server_ip)) {
+        fprintf(stderr, "Invalid options (speed must be 0 or more; shared memory is not supported, use unix:)\n");
+        return 1;
+    }
+
+    capture_map_t map;
+    if (capture_map_open(path, &map) != 0) {
+        fprintf(stderr, "replay: can't open capture %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    conns = calloc((size_t)map.max_conn_id + 1, sizeof(rp_conn_t));
+    for (uint32_t i = 0; i <= map.max_conn_id; i++) conns[i].fd = -1;
+    raise_fd_limit(map.max_conn_id);
+    epfd = epoll_create1(0);
+    fprintf(stderr, "replay: %llu records, %u connections, %.3f s captured\n",
+            (unsigned long long)map.records, map.max_conn_id, map.duration_ns / 1e9);
+
+    capture_record_t record;
+    const uint8_t *payload;
+    uint64_t start = now_ns();
+    uint64_t index = 0;
+    while (capture_map_next(&map, &record, &payload)) {
+        if (speed > 0) {
+            wait_until(start + (uint64_t)(record.time_ns / speed));
+        } else if (++index % POLL_EVERY == 0) {
+            poll_conns(0);
+        }
+        rp_conn_t *conn = &conns[record.conn_id];
+        if (record.len == CAPTURE_CLOSE) {
+            // Lo pendiente sale antes del cierre, igual que en la conexión original
+            while (conn->fd >= 0 && conn->out_len > 0) poll_conns(10);
+            close_conn(conn, false);
+            continue;
+        }
+        if (conn->closed || (conn->fd < 0 && !open_conn(conn))) {
+            stats.skipped++;
+            continue;
+        }
+        queue_frame(conn, payload, record.len);
+        stats.requests++;
+        flush_conn(conn);
+        while (conn->fd >= 0 && conn->out_len > REPLAY_MAX_PENDING) poll_conns(10);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    // Respuestas y envíos pendientes antes de cerrar
+    uint64_t drain_until = now_ns() + DRAIN_SECONDS * 1000000000ull;
+    while (now_ns() < drain_until) poll_conns(10);
+    for (uint32_t i = 0; i <= map.max_conn_id; i++) close_conn(&conns[i], false);
+    report(strcmp(format, "json") == 0, &map, seconds);
+
+    free(conns);
+    close(epfd);
+    capture_map_close(&map);
+    return 0;
+}
@@ -14,18 +14,31 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/random.h>
+#include <sys/eventfd.h>
 #include "chat.pb-c.h"
-
-#define MAX_CLIENTS 100
-#define INACTIVITY_TIMEOUT 300
-
-typedef enum {
-    ACTIVO = 0,   // En línea y disponible para recibir mensajes
-    OCUPADO = 1,  // En línea pero marcado como ocupado, puede no responder de inmediato
-    INACTIVO = 2  // Desconectado y no puede recibir mensajes
-} ClientStatus;
+#include "frame.h"
+#include "metrics.h"
+#include "probes.h"
+#include "server.h"
+#include "transport.h"
+#include "shm_ring.h"
+#include "handoff.h"
+#include "membudget.h"
+#include "federation.h"
+#include "snapshot.h"
+#include "capture.h"
+#include "compress.h"
+#include "coro.h"
+#include "affinity.h"
 
 const char* get_status_name(ClientStatus status) {
     switch (status) {
@@ -36,32 +49,236 @@ const char* get_status_name(ClientStatus status) {
     }
 }
 
-typedef struct {
-    struct sockaddr_in address;
-    int sockfd;
-    int uid;
-    char name[32];
-    time_t last_active;
-    ClientStatus status;
-} client_t;
-
 client_t *clients[MAX_CLIENTS];
 int uid = 10;
 pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+codec_kind_t server_codec = CODEC_NATIVE;
+unsigned coalesce_window_us = 0;     // 0: cada broadcast se envía de inmediato
+unsigned coalesce_max_delay_us = 0;  // Retraso máximo de un broadcast coalescido
+size_t compress_min_bytes = COMPRESS_MIN_BYTES;  // 0: no se ofrece compresión
+int handler_workers = -1;  // Workers de las corrutinas de los clientes: -1 uno por CPU, 0 un thread por conexión
+bool offload_requests = true;  // Las solicitudes pesadas corren como tareas que los workers se roban
 
+// Estado de la ventana de coalescencia, protegido por clients_mutex
+static uint64_t coalesce_first = 0;  // Llegada del broadcast pendiente más antiguo (0 si no hay)
+static uint64_t coalesce_last = 0;   // Llegada del broadcast pendiente más reciente
+static pthread_cond_t coalesce_cond = PTHREAD_COND_INITIALIZER;
 
-bool username_exists(const char* username) {
+// Avisa (con clients_mutex) que un thread soltó la conexión de su sesión, para que otra conexión la reanude
+static pthread_cond_t session_cond = PTHREAD_COND_INITIALIZER;
+
+// Descriptores que caben en las tablas indexadas por socket: el RLIMIT_NOFILE con que arrancó el servidor
+static size_t fd_table_size = 0;
+
+// Rings de memoria compartida indexados por el socket Unix del cliente (NULL para las conexiones normales)
+static shm_conn_t **shm_conns;
+
+// Conexiones que negociaron compresión al registrarse, indexadas por socket
+static bool *compressed_conns;
+
+static bool fd_in_table(int sockfd) {
+    return sockfd >= 0 && (size_t)sockfd < fd_table_size;
+}
+
+static shm_conn_t *shm_conn_for(int sockfd) {
+    return fd_in_table(sockfd) ? shm_conns[sockfd] : NULL;
+}
+
+/*
+Funcion que indica si un frame (o grupo de frames) de len bytes se comprime para la conexión.
+*/
+static bool compress_wanted(int sockfd, size_t len) {
+    return compress_min_bytes > 0 && len >= compress_min_bytes && fd_in_table(sockfd) && compressed_conns[sockfd];
+}
+
+// Reinicio en caliente: mientras handoff_pending está activo los threads se detienen en el borde entre dos frames
+static atomic_bool handoff_pending;
+static pthread_mutex_t handoff_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t handoff_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+Funcion que detiene al thread (o la corrutina) que la llama mientras otro proceso toma las conexiones.
+Solo se llama entre dos frames, así que el proceso nuevo sigue leyendo los sockets justo donde este quedó.
+Una corrutina no puede esperar en handoff_cond sin bloquear a su worker: se suspende hasta que resume_everyone
+la interrumpa.
+Parametros:
+    * bool *parked: marca que el thread del traspaso revisa para saber que este ya se detuvo
+Retornos: vuelve solo si el reinicio se cancela (si termina bien este proceso sale)
+*/
+static void park_for_handoff(bool *parked) {
+    pthread_mutex_lock(&handoff_mutex);
+    if (atomic_load(&handoff_pending)) {
+        *parked = true;
+        while (atomic_load(&handoff_pending)) {
+            if (coro_self()) {
+                pthread_mutex_unlock(&handoff_mutex);
+                coro_poll(NULL, 0, -1);
+                pthread_mutex_lock(&handoff_mutex);
+            } else {
+                pthread_cond_wait(&handoff_cond, &handoff_mutex);
+            }
+        }
+        *parked = false;
+    }
+    pthread_mutex_unlock(&handoff_mutex);
+}
+
+/*
+Funcion que bloquea el registro de clientes midiendo cuánto se esperó por él.
+En este servidor cada conexión tiene su propio handler, así que la espera por el mutex es la cola que ve una solicitud.
+*/
+void lock_clients(void) {
+    uint64_t start = metrics_now();
     pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; ++i) {
-        if (clients[i] && strcmp(clients[i]->name, username) == 0) {
-            pthread_mutex_unlock(&clients_mutex);
-            return true;
+    metrics_observe(METRIC_QUEUE_DELAY, metrics_now() - start);
+}
+
+/*
+Funcion que envía frames ya listos para el socket (comprimidos o no) en una clase de prioridad.
+Parametros:
+    * size_t original: bytes de los frames antes de comprimirlos, para las métricas de compresión
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escribir o se descartaron
+*/
+static int send_wire(int sockfd, lane_t lane, const frame_out_t *out, size_t original) {
+    if (original != out->len) {
+        metrics_count(METRIC_COMPRESSION_IN_BYTES, original);
+        metrics_count(METRIC_COMPRESSION_OUT_BYTES, out->len);
+    }
+    lanes_t *lanes = lanes_for(sockfd);
+    if (lanes) return lanes_send_frames(lanes, lane, out->data, out->len, out->frames);
+    shm_conn_t *shm = shm_conn_for(sockfd);
+    if ((shm ? shm_conn_send_frames(shm, out->data, out->len, sockfd) : send_frames(sockfd, out->data, out->len)) != 0) {
+        metrics_count(METRIC_SEND_DROPS, out->frames);
+        return -1;
+    }
+    metrics_count(METRIC_BYTES_OUT, out->len);
+    return 0;
+}
+
+/*
+Funcion que envía un mensaje empaquetado a un cliente en una clase de prioridad y registra las métricas de salida.
+Si otro thread está escribiendo en la conexión o su socket está lleno, el mensaje queda en la cola de su clase.
+Las conexiones sin colas (fuera del servidor, como en bench) escriben directo y bloquean como siempre.
+Si el cliente usa memoria compartida el frame va a su ring en lugar del socket, y si negoció compresión un
+mensaje grande sale comprimido.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escribir o se descartó
+*/
+int send_packed_lane(int sockfd, lane_t lane, const uint8_t *buffer, size_t len) {
+    if (compress_wanted(sockfd, len)) {
+        frame_out_t compressed;
+        frame_out_init(&compressed);
+        int rc = -1;
+        if (compress_frame(buffer, len, &compressed) == 0) {
+            rc = send_wire(sockfd, lane, &compressed, FRAME_HEADER_SIZE + len);
+        } else {
+            metrics_count(METRIC_SEND_DROPS, 1);
         }
+        frame_out_free(&compressed);
+        return rc;
+    }
+    lanes_t *lanes = lanes_for(sockfd);
+    if (lanes) return lanes_send(lanes, lane, buffer, len);
+    shm_conn_t *shm = shm_conn_for(sockfd);
+    if ((shm ? shm_conn_send(shm, buffer, len, sockfd) : send_frame(sockfd, buffer, len)) != 0) {
+        metrics_count(METRIC_SEND_DROPS, 1);
+        return -1;
+    }
+    metrics_count(METRIC_BYTES_OUT, FRAME_HEADER_SIZE + len);
+    return 0;
+}
+
+/*
+Funcion que envía una respuesta a una solicitud del cliente, por la clase de control.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escribir en el socket
+*/
+int send_packed(int sockfd, const uint8_t *buffer, size_t len) {
+    return send_packed_lane(sockfd, LANE_CONTROL, buffer, len);
+}
+
+/*
+Funcion que envía de una vez todos los frames acumulados para un cliente, en una clase de prioridad.
+Si la conexión negoció compresión y son suficientes bytes, salen comprimidos juntos.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escribir o se descartaron
+*/
+int send_packed_frames(int sockfd, lane_t lane, const frame_out_t *out) {
+    if (!compress_wanted(sockfd, out->len)) return send_wire(sockfd, lane, out, out->len);
+    frame_out_t compressed;
+    frame_out_init(&compressed);
+    int rc = -1;
+    if (compress_frames(out->data, out->len, &compressed) == 0) {
+        rc = send_wire(sockfd, lane, &compressed, out->len);
+    } else {
+        metrics_count(METRIC_SEND_DROPS, out->frames);
+    }
+    frame_out_free(&compressed);
+    return rc;
+}
+
+/*
+Funcion que recibe la siguiente solicitud de un cliente, por su socket o por su ring de memoria compartida.
+*/
+static ssize_t recv_request(int sockfd, uint8_t **buffer, size_t *capacity) {
+    shm_conn_t *shm = shm_conn_for(sockfd);
+    return shm ? shm_ring_recv_frame(&shm->requests, buffer, capacity, sockfd) : recv_frame(sockfd, buffer, capacity);
+}
+
+/*
+Funcion que cierra la conexión de un cliente y libera sus colas de salida y su ring de memoria compartida, si tiene.
+Se quitan de sus tablas (y del epoll del worker, si la corrutina que llama lo vigila) antes del close para que un
+socket nuevo con el mismo número no los herede.
+*/
+void close_connection(int sockfd) {
+    coro_unwatch(sockfd);
+    lanes_close(sockfd);
+    if (fd_in_table(sockfd)) compressed_conns[sockfd] = false;
+    shm_conn_t *shm = shm_conn_for(sockfd);
+    if (shm) {
+        shm_conns[sockfd] = NULL;
+        shm_conn_close(shm);
+        mem_charge(MEM_SHM, -2 * (int64_t)SHM_RING_CAPACITY);
+    }
+    close(sockfd);
+}
+
+/*
+Funcion que asocia al socket los rings que un cliente local mandó con su registro.
+Toma posesión de los descriptores recibidos.
+Retornos:
+    * bool: true si los rings son válidos
+*/
+bool attach_shm(int sockfd, const int *fds, int n_fds) {
+    if (n_fds != SHM_RING_FDS || !fd_in_table(sockfd)) {
+        for (int i = 0; i < n_fds; i++) close(fds[i]);
+        return false;
+    }
+    shm_conn_t *shm = shm_conn_attach(fds);
+    if (!shm) return false;
+    shm_conns[sockfd] = shm;
+    lanes_t *lanes = lanes_for(sockfd);
+    if (lanes) lanes_wait_on(lanes, shm->responses.space_fd);
+    mem_charge(MEM_SHM, 2 * (int64_t)SHM_RING_CAPACITY);  // Un ring por dirección
+    return true;
+}
+
+// Debe llamarse con clients_mutex bloqueado
+static bool username_exists_locked(const char *username) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients[i] && strcmp(clients[i]->name, username) == 0) return true;
     }
-    pthread_mutex_unlock(&clients_mutex);
     return false;
 }
 
+bool username_exists(const char* username) {
+    lock_clients();
+    bool exists = username_exists_locked(username);
+    pthread_mutex_unlock(&clients_mutex);
+    return exists;
+}
+
 void send_response(int sockfd, Chat__StatusCode status_code, const char *message) {
     Chat__Response response = CHAT__RESPONSE__INIT;
     response.status_code = status_code;
@@ -69,13 +286,42 @@ void send_response(int sockfd, Chat__StatusCode status_code, const char *message
     size_t len = chat__response__get_packed_size(&response);
     uint8_t *buffer = malloc(len);
     chat__response__pack(&response, buffer);
-    send(sockfd, buffer, len, 0);
+    send_packed(sockfd, buffer, len);
     free(buffer);
     free(response.message);
 }
 
+/*
+Funcion que retorna cómo se muestra el origen de un cliente: su IP, "unix" si se conectó por el socket Unix
+o "shm" si además usa memoria compartida.
+*/
+const char *client_host(const client_t *cl) {
+    if (shm_conn_for(cl->sockfd)) return "shm";
+    return cl->address.sin_family == AF_UNIX ? "unix" : inet_ntoa(cl->address.sin_addr);
+}
+
+/*
+Funcion que actualiza en el presupuesto de memoria las colas y la ventana de reenvío de un cliente.
+Debe llamarse con clients_mutex bloqueado (o con el cliente fuera de clients[]) después de que crecen o se liberan.
+*/
+static void account_client(client_t *cl) {
+    mem_resize(MEM_QUEUES, &cl->mem_queues, cl->coalesced.cap);
+    mem_resize(MEM_HISTORY, &cl->mem_history, cl->replay.cap);
+}
+
+/*
+Funcion que libera un client_t que ya no está en clients[] y descuenta su memoria del presupuesto.
+*/
+void release_client(client_t *cl) {
+    frame_out_free(&cl->coalesced);
+    frame_buffer_free(&cl->replay);
+    account_client(cl);
+    mem_charge(MEM_CLIENTS, -(int64_t)sizeof(client_t));
+    free(cl);
+}
+
 void add_client(client_t *cl) {
-    pthread_mutex_lock(&clients_mutex);
+    lock_clients();
     for (int i = 0; i < MAX_CLIENTS; ++i) {
         if (!clients[i]) {
             clients[i] = cl;
@@ -86,10 +332,15 @@ void add_client(client_t *cl) {
 }
 
 void remove_client(int uid) {
-    pthread_mutex_lock(&clients_mutex);
+    lock_clients();
     for (int i = 0; i < MAX_CLIENTS; ++i) {
         if (clients[i] && clients[i]->uid == uid) {
-            printf("\033[91m\n(*) Client disconnected: %s (IP: %s)\n\033[0m", clients[i]->name, inet_ntoa(clients[i]->address.sin_addr));
+            CHAT_PROBE2(disconnect, uid, clients[i]->name);
+            printf("\033[91m\n(*) Client disconnected: %s (IP: %s)\n\033[0m", clients[i]->name, client_host(clients[i]));
+            frame_out_free(&clients[i]->coalesced);  // Los broadcasts pendientes se descartan
+            frame_buffer_free(&clients[i]->replay);
+            account_client(clients[i]);
+            federation_user_left(clients[i]->name);
             clients[i] = NULL;
             break;
         } 
@@ -97,49 +348,75 @@ void remove_client(int uid) {
     pthread_mutex_unlock(&clients_mutex);
 }
 
+// Usuario local copiado del registro, para armar la respuesta de GET_USERS después de soltarlo
+typedef struct {
+    char name[32];
+    char host[INET_ADDRSTRLEN];
+    int status;
+} listed_user_t;
+
 /*
 Función para enviar la lista de usuarios conectados a un cliente específico.
 Si se proporciona un nombre de usuario, se envía solo la información de ese usuario.
 De lo contrario, se envía la lista completa de usuarios.
+Con clients_mutex solo se copian los nombres; la respuesta se arma y se empaqueta después de soltarlo, así varias
+listas se pueden armar a la vez en el pool de corrutinas.
 Parametros:
     * int sockfd: socket descriptor
     * Chat__UserListRequest *request: detalles de la solicitud, puede incluir un username específico
 */
 void send_user_list(int sockfd, Chat__UserListRequest *request) {
-    pthread_mutex_lock(&clients_mutex);
-    size_t num_users = 0;
-    Chat__User **users = NULL;
+    bool single = request != NULL && request->username != NULL && strlen(request->username) > 0;
+    listed_user_t *local = malloc((single ? 1 : MAX_CLIENTS) * sizeof(listed_user_t));
+    size_t num_local = 0;
 
-    if (request != NULL && request->username != NULL && strlen(request->username) > 0) {
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (clients[i] && strcmp(clients[i]->name, request->username) == 0) {
-                users = malloc(sizeof(Chat__User*));
-                users[0] = malloc(sizeof(Chat__User));
-                chat__user__init(users[0]);
-                char full_name[64];
-                sprintf(full_name, "%s@%s", clients[i]->name, inet_ntoa(clients[i]->address.sin_addr));
-                users[0]->username = strdup(full_name);
-                users[0]->status = clients[i]->status;
-                num_users = 1;
-                break;
-            }
+    lock_clients();
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (!clients[i]) continue;
+        if (single && strcmp(clients[i]->name, request->username) != 0) continue;
+        listed_user_t *user = &local[num_local++];
+        memcpy(user->name, clients[i]->name, sizeof(user->name));
+        snprintf(user->host, sizeof(user->host), "%s", client_host(clients[i]));
+        user->status = clients[i]->status;
+        if (single) break;
+    }
+    pthread_mutex_unlock(&clients_mutex);
+
+    federation_user_t *remote = NULL;
+    size_t num_remote = 0;
+    if (single) {
+        federation_user_t user;
+        if (num_local == 0 && federation_lookup(request->username, &user)) {
+            remote = malloc(sizeof(user));
+            remote[0] = user;
+            num_remote = 1;
         }
     } else {
-        users = malloc(MAX_CLIENTS * sizeof(Chat__User*));
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (clients[i]) {
-                users[num_users] = malloc(sizeof(Chat__User));
-                chat__user__init(users[num_users]);
-                char full_name[64];
-                sprintf(full_name, "%s@%s", clients[i]->name, inet_ntoa(clients[i]->address.sin_addr));
-                users[num_users]->username = strdup(full_name);
-                users[num_users]->status = clients[i]->status;
-                num_users++;
-            }
-        }
+        num_remote = federation_users(&remote);
     }
 
-    pthread_mutex_unlock(&clients_mutex);
+    // Usuarios de este nodo con su IP y los de los demás nodos de la federación, con el nodo en lugar de la IP
+    size_t num_users = 0;
+    Chat__User *entries = malloc((num_local + num_remote + 1) * sizeof(Chat__User));
+    Chat__User **users = malloc((num_local + num_remote + 1) * sizeof(Chat__User*));
+    char (*full_names)[64] = malloc((num_local + num_remote + 1) * sizeof(*full_names));
+    for (size_t i = 0; i < num_local; i++, num_users++) {
+        snprintf(full_names[num_users], sizeof(full_names[num_users]), "%s@%s", local[i].name, local[i].host);
+        chat__user__init(&entries[num_users]);
+        entries[num_users].username = full_names[num_users];
+        entries[num_users].status = local[i].status;
+        users[num_users] = &entries[num_users];
+    }
+    for (size_t i = 0; i < num_remote; i++, num_users++) {
+        snprintf(full_names[num_users], sizeof(full_names[num_users]), "%s@node%u", remote[i].username,
+                 remote[i].node_id);
+        chat__user__init(&entries[num_users]);
+        entries[num_users].username = full_names[num_users];
+        entries[num_users].status = remote[i].status;
+        users[num_users] = &entries[num_users];
+    }
+    free(remote);
+    free(local);
 
     // Empaquetar y enviar la respuesta
     Chat__UserListResponse user_list_response = CHAT__USER_LIST_RESPONSE__INIT;
@@ -156,268 +433,2743 @@ void send_user_list(int sockfd, Chat__UserListRequest *request) {
     size_t len = chat__response__get_packed_size(&response);
     uint8_t *buffer = malloc(len);
     chat__response__pack(&response, buffer);
-    send(sockfd, buffer, len, 0);
+    send_packed(sockfd, buffer, len);
     free(buffer);
 
     // Liberar recursos
-    for (int i = 0; i < num_users; i++) {
-        free(users[i]->username);
-        free(users[i]);
-    }
+    free(full_names);
+    free(entries);
     free(users);
 }
 
-void broadcast_message(char *sender_name, char *message_content) {
-    pthread_mutex_lock(&clients_mutex);
-
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        // Agregar la verificación de que el cliente está en línea
-        if (clients[i] && strcmp(clients[i]->name, sender_name) != 0 && clients[i]->status != INACTIVO) {
-            char formatted_message[1024];
-
-            // Crear la estructura del mensaje entrante
-            Chat__IncomingMessageResponse msg = CHAT__INCOMING_MESSAGE_RESPONSE__INIT;
-            msg.sender = sender_name;
-            msg.content = message_content;
-            msg.type = CHAT__MESSAGE_TYPE__BROADCAST;
-
-            Chat__Response response = CHAT__RESPONSE__INIT;
-            response.operation = CHAT__OPERATION__INCOMING_MESSAGE;
-            response.status_code = CHAT__STATUS_CODE__OK;
-            response.result_case = CHAT__RESPONSE__RESULT_INCOMING_MESSAGE;
-            response.incoming_message = &msg;
+/*
+Funcion que responde GET_MEMORY con la memoria registrada en el presupuesto, por categoría.
+Parametros:
+    * int sockfd: socket descriptor
+*/
+void send_memory_usage(int sockfd) {
+    Chat__MemoryUsage memory = CHAT__MEMORY_USAGE__INIT;
+    memory.budget = mem_budget;
+    memory.used = mem_used();
+    memory.clients = mem_usage(MEM_CLIENTS);
+    memory.buffers = mem_usage(MEM_BUFFERS);
+    memory.queues = mem_usage(MEM_QUEUES);
+    memory.history = mem_usage(MEM_HISTORY);
+    memory.shared_memory = mem_usage(MEM_SHM);
+    memory.admitting = mem_admitting();
+    memory.shedding = mem_shedding();
 
-            // Serializar y enviar el mensaje
-            size_t len = chat__response__get_packed_size(&response);
-            uint8_t *buf = malloc(len);
-            chat__response__pack(&response, buf);
-            send(clients[i]->sockfd, buf, len, 0);
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = CHAT__OPERATION__GET_MEMORY;
+    response.status_code = CHAT__STATUS_CODE__OK;
+    response.result_case = CHAT__RESPONSE__RESULT_MEMORY;
+    response.memory = &memory;
+    size_t len = chat__response__get_packed_size(&response);
+    uint8_t *buffer = malloc(len);
+    chat__response__pack(&response, buffer);
+    send_packed(sockfd, buffer, len);
+    free(buffer);
+}
 
-            // Liberar el buffer
-            free(buf);
-        }
+/*
+Funcion que empaqueta un Response de INCOMING_MESSAGE con el codec seleccionado.
+Con protobuf-c los strings del mensaje deben terminar en '\0'; siempre es así porque en ese modo
+vienen de chat__request__unpack o son literales (las vistas sin terminar solo salen del codec nativo).
+Parametros:
+    * const codec_incoming_message_t *msg: mensaje a empaquetar
+    * uint8_t *local: buffer del llamador, usado por el codec nativo si el mensaje cabe
+    * size_t local_size: tamaño de local
+    * size_t *len: largo del mensaje empaquetado
+Retornos:
+    * uint8_t *: local o un buffer de malloc que el llamador libera si es distinto de local
+*/
+uint8_t *pack_incoming_message(const codec_incoming_message_t *msg, uint8_t *local, size_t local_size, size_t *len) {
+    if (server_codec == CODEC_NATIVE) {
+        *len = codec_incoming_message_size(msg);
+        uint8_t *buf = *len <= local_size ? local : malloc(*len);
+        codec_encode_incoming_message(msg, buf);
+        return buf;
     }
 
-    pthread_mutex_unlock(&clients_mutex);
-}
+    Chat__IncomingMessageResponse incoming = CHAT__INCOMING_MESSAGE_RESPONSE__INIT;
+    incoming.sender = (char *)msg->sender.data;
+    incoming.content = (char *)msg->content.data;
+    incoming.type = msg->type;
 
-void send_direct_message_to_client(client_t *cli, const char *recipient, const char *message_content) {
-    bool found = false;
-    bool sent = false;
     Chat__Response response = CHAT__RESPONSE__INIT;
-    Chat__IncomingMessageResponse msg = CHAT__INCOMING_MESSAGE_RESPONSE__INIT;
+    response.operation = CHAT__OPERATION__INCOMING_MESSAGE;
+    response.status_code = msg->status_code;
+    response.result_case = CHAT__RESPONSE__RESULT_INCOMING_MESSAGE;
+    response.incoming_message = &incoming;
 
-    pthread_mutex_lock(&clients_mutex);  // Bloquear el mutex para acceder a la lista de clientes
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i] && strcmp(clients[i]->name, recipient) == 0) {
-            found = true;  // Marcamos que hemos encontrado al usuario
-            if (clients[i]->status != INACTIVO) {
-                // Preparar el mensaje de chat directo
-                msg.sender = cli->name;
-                msg.content = message_content;
-                msg.type = CHAT__MESSAGE_TYPE__DIRECT;
-
-                response.operation = CHAT__OPERATION__INCOMING_MESSAGE;
-                response.status_code = CHAT__STATUS_CODE__OK;
-                response.result_case = CHAT__RESPONSE__RESULT_INCOMING_MESSAGE;
-                response.incoming_message = &msg;
-
-                // Serializar y enviar el mensaje
-                size_t len = chat__response__get_packed_size(&response);
-                uint8_t *buf = malloc(len);
-                chat__response__pack(&response, buf);
-                send(clients[i]->sockfd, buf, len, 0);
-                free(buf);
+    *len = chat__response__get_packed_size(&response);
+    uint8_t *buf = malloc(*len);
+    chat__response__pack(&response, buf);
+    return buf;
+}
 
-                sent = true;
-                break;
-            }
-        }
+/*
+Funcion que envía con un solo send los broadcasts que un cliente tiene pendientes.
+Debe llamarse con clients_mutex bloqueado; también se usa antes de enviarle un mensaje directo a una sesión
+reanudable, para que no adelante a los broadcasts que llegaron antes.
+*/
+void flush_coalesced(client_t *cl) {
+    if (cl->coalesced.len == 0) return;
+    if (send_packed_frames(cl->sockfd, LANE_BROADCAST, &cl->coalesced) == 0) {
+        metrics_count(METRIC_MESSAGES_DELIVERED, cl->coalesced.frames);
+        metrics_count(METRIC_COALESCED_WRITES, 1);
     }
-    pthread_mutex_unlock(&clients_mutex);  // Desbloquear el mutex
+    frame_out_reset(&cl->coalesced);
+}
 
-    // Configurar la respuesta dependiendo del resultado del envío
-    if (!found) {
-        response.status_code = CHAT__STATUS_CODE__BAD_REQUEST;
-        msg.sender = "Server";
-        msg.content = "User not found.";
-        msg.type = CHAT__MESSAGE_TYPE__DIRECT;
-    } else if (!sent) {
-        response.status_code = CHAT__STATUS_CODE__BAD_REQUEST;
-        msg.sender = "Server";
-        msg.content = "User is offline.";
-        msg.type = CHAT__MESSAGE_TYPE__DIRECT;
+/*
+Funcion que elige la clase de prioridad de un mensaje directo (DM, multicast, batch o de otro nodo) para un cliente.
+A una sesión reanudable le llega numerado y el cliente descarta lo que llega fuera de orden, así que va por la clase
+de los broadcasts, después de los coalescidos (que ya están numerados). A los demás se les adelanta a los broadcasts.
+Debe llamarse con clients_mutex bloqueado.
+*/
+static lane_t direct_lane(client_t *cl) {
+    if (!cl->resumable) return LANE_DIRECT;
+    flush_coalesced(cl);
+    return LANE_BROADCAST;
+}
+
+/*
+Funcion que agrega un broadcast ya empaquetado a los pendientes de un cliente.
+Si los pendientes superan COALESCE_FLUSH_BYTES se envían sin esperar la ventana.
+*/
+static void coalesce_append(client_t *cl, const uint8_t *buf, size_t len) {
+    if (frame_out_append(&cl->coalesced, buf, len) != 0) {
+        metrics_count(METRIC_SEND_DROPS, 1);
+        return;
     }
+    account_client(cl);
+    if (cl->coalesced.len >= COALESCE_FLUSH_BYTES) {
+        flush_coalesced(cl);
+    }
+}
 
-    response.operation = CHAT__OPERATION__INCOMING_MESSAGE;
-    response.result_case = CHAT__RESPONSE__RESULT_INCOMING_MESSAGE;
-    response.incoming_message = &msg;
+/*
+Funcion que numera un INCOMING_MESSAGE para la sesión reanudable de un cliente y lo guarda en su ventana de reenvío.
+El número va en el campo sequence del Response, que es el último, así que se agrega al final del mensaje ya
+empaquetado (compartido entre destinatarios) sin volver a empaquetarlo. Los clientes sin sesión reanudable
+reciben el mismo buffer de siempre. Debe llamarse con clients_mutex bloqueado.
+Parametros:
+    * client_t *cl: destinatario
+    * const uint8_t *buf: mensaje empaquetado
+    * size_t *len: largo del mensaje; se actualiza con el del mensaje numerado
+Retornos:
+    * const uint8_t *: mensaje a enviar (buf, o la copia numerada dentro de la ventana, válida hasta el siguiente
+      mensaje de la sesión); NULL si la sesión está sin conexión y el mensaje solo queda guardado
+*/
+static const uint8_t *session_stamp(client_t *cl, const uint8_t *buf, size_t *len) {
+    if (!cl->resumable) return buf;
+    uint64_t sequence = cl->next_sequence++;
+    uint8_t trailer[CODEC_SEQUENCE_MAX_SIZE];
+    size_t trailer_len = codec_encode_sequence(sequence, trailer);
+    size_t stamped_len = *len + trailer_len;
 
-    // Serializar y enviar la respuesta al emisor
-    size_t final_len = chat__response__get_packed_size(&response);
-    uint8_t *final_buf = malloc(final_len);
-    chat__response__pack(&response, final_buf);
-    send(cli->sockfd, final_buf, final_len, 0);
-    free(final_buf);
+    // Se descartan los más antiguos hasta que el nuevo quepa en la ventana
+    const uint8_t *oldest;
+    size_t oldest_len;
+    while (frame_buffer_next(&cl->replay, &oldest, &oldest_len) &&
+           (sequence - cl->replay_first >= SESSION_REPLAY_MESSAGES ||
+            cl->replay.len - cl->replay.start + FRAME_HEADER_SIZE + stamped_len > SESSION_REPLAY_BYTES)) {
+        frame_buffer_consume(&cl->replay, FRAME_HEADER_SIZE + oldest_len);
+        cl->replay_first++;
+    }
+    uint8_t *frame = frame_buffer_reserve(&cl->replay, FRAME_HEADER_SIZE + stamped_len);
+    if (!frame) {
+        // Sin memoria el mensaje igual se envía, pero no se podrá reenviar
+        frame_buffer_free(&cl->replay);
+        account_client(cl);
+        cl->replay_first = cl->next_sequence;
+        return cl->sockfd < 0 ? NULL : buf;
+    }
+    account_client(cl);
+    frame_write_header(frame, stamped_len);
+    memcpy(frame + FRAME_HEADER_SIZE, buf, *len);
+    memcpy(frame + FRAME_HEADER_SIZE + *len, trailer, trailer_len);
+    *len = stamped_len;
+    return cl->sockfd < 0 ? NULL : frame + FRAME_HEADER_SIZE;
 }
 
-
-void* check_inactivity(void* arg) {
-    while (1) {
-        sleep(1);
-        time_t now = time(NULL);
-        pthread_mutex_lock(&clients_mutex);
-        for (int i = 0; i < MAX_CLIENTS; ++i) {
-            if (clients[i] && difftime(now, clients[i]->last_active) > INACTIVITY_TIMEOUT) {
-                if (clients[i]->status != INACTIVO) {
-                    clients[i]->status = INACTIVO;
-                    printf("\033[34m%s has been set OFFLINE due to inactivity.\n\033[0m", clients[i]->name);
-                    char message[256];
-                    sprintf(message, "\033[34mYour status has been changed to OFFLINE due to inactivity.\033[0m");
-                    send_response(clients[i]->sockfd, CHAT__STATUS_CODE__OK, message);
-                }
-            }
-        }
-        pthread_mutex_unlock(&clients_mutex);
+static void flush_all_coalesced(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) flush_coalesced(clients[i]);
     }
-    return NULL;
+    coalesce_first = 0;
+    coalesce_last = 0;
 }
 
-void *handle_client(void *arg) {
-    client_t *cli = (client_t *)arg;
-    cli->last_active = time(NULL);
-    uint8_t buffer[1024];
-    int len;
+/*
+Funcion que envía de inmediato todos los broadcasts pendientes, sin esperar la ventana.
+*/
+void flush_coalesced_broadcasts(void) {
+    lock_clients();
+    flush_all_coalesced();
+    pthread_mutex_unlock(&clients_mutex);
+}
 
-    while ((len = recv(cli->sockfd, buffer, sizeof(buffer), 0)) > 0) {
-        cli->last_active = time(NULL);
-        Chat__Request *req = chat__request__unpack(NULL, len, buffer);
-        if (req == NULL) {
-            fprintf(stderr, "Error unpacking incoming message\n");
+/*
+Thread que vacía los broadcasts coalescidos.
+La ventana se extiende con cada broadcast nuevo (se envía cuando pasan coalesce_window_us sin broadcasts),
+pero ningún broadcast espera más de coalesce_max_delay_us desde el más antiguo pendiente.
+*/
+void *coalesce_flusher(void *arg) {
+    (void)arg;
+    affinity_pin(AFFINITY_TIMER, -1);
+    pthread_mutex_lock(&clients_mutex);
+    while (1) {
+        if (coalesce_first == 0) {
+            pthread_cond_wait(&coalesce_cond, &clients_mutex);
             continue;
         }
 
-        switch (req->operation) {
-            case CHAT__OPERATION__GET_USERS:
-                if (req->payload_case == CHAT__REQUEST__PAYLOAD_GET_USERS) {
-                    // Se envía la solicitud completa
-                    send_user_list(cli->sockfd, req->get_users);
-                    printf("\033[34m\nUser list sent to [%s]\n\033[0m", cli->name);
-                } else {
-                    // En caso de que no haya detalles = NULL
-                    send_user_list(cli->sockfd, NULL);
-                }
-                break;
-            
-            // Cambiar el estado de un usuario
-            case CHAT__OPERATION__UPDATE_STATUS: {
-                if (req->update_status && username_exists(req->update_status->username)) {
-                    for (int i = 0; i < MAX_CLIENTS; ++i) {
-                        if (clients[i] && strcmp(clients[i]->name, req->update_status->username) == 0) {
-                            ClientStatus old_status = clients[i]->status; // Guarda el estado antiguo
-                            clients[i]->status = req->update_status->new_status; // Actualiza al nuevo estado
-                            send_response(cli->sockfd, CHAT__STATUS_CODE__OK, "\n\033[32mStatus updated successfully!\033[0m");
-                            printf("\033[34m\nUpdated status for %s from %s to %s\n\033[0m", clients[i]->name, get_status_name(old_status), get_status_name(clients[i]->status));
-                            break;
-                        }
-                    }
-                } else {
-                    send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, "\033[31mUser not found\033[0m");
-                }
-                break;
-            }
-            case CHAT__OPERATION__SEND_MESSAGE:
-                if (req->send_message) {
-                    if (strlen(req->send_message->recipient) > 0) {
-                        // Enviar a un usuario específico
-                        send_direct_message_to_client(cli, req->send_message->recipient, req->send_message->content);
-                        printf("\033[34m\nDirect Message sent from [%s] to [%s]\n\033[0m", cli->name, req->send_message->recipient);
-                    } else {
-                        // Broadcast message
-                        broadcast_message(cli->name, req->send_message->content);
-                        printf("\033[34m\nBroadcast message sent by [%s]\n\033[0m", cli->name);
-                    }
-                }
-                break;
+        uint64_t deadline = coalesce_last + coalesce_window_us * 1000ull;
+        uint64_t max_deadline = coalesce_first + coalesce_max_delay_us * 1000ull;
+        if (max_deadline < deadline) deadline = max_deadline;
+        uint64_t now = metrics_now();
+        if (now < deadline) {
+            // pthread_cond_timedwait usa CLOCK_REALTIME; el plazo se calcula con el reloj monotónico
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            uint64_t wake = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec + (deadline - now);
+            ts.tv_sec = wake / 1000000000ull;
+            ts.tv_nsec = wake % 1000000000ull;
+            pthread_cond_timedwait(&coalesce_cond, &clients_mutex, &ts);
+            continue;
         }
-
-        chat__request__free_unpacked(req, NULL);
-    }
-
-    if (len <= 0) {
-        remove_client(cli->uid);
-        close(cli->sockfd);
-        free(cli);
-        pthread_detach(pthread_self());
+        flush_all_coalesced();
     }
     return NULL;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Uso: %s <port>\n", argv[0]);
-        return 1;
-    }
-
-    int port = atoi(argv[1]);
-    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
-    struct sockaddr_in serv_addr = {0};
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_addr.s_addr = INADDR_ANY;
-    serv_addr.sin_port = htons(port);
-
-    int opt = 1;
-    // Configuración para reutilizar la dirección IP y puerto
-    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+// Destinatario al que se le envía después de soltar clients_mutex: sus colas retenidas y cómo enviarle
+typedef struct {
+    lanes_t *lanes;
+    lane_t lane;
+    bool compress;  // Negoció compresión y lo que se le envía alcanza para comprimirlo
+    int slot;       // Posición en clients[] cuando se anotó (send_message_batch guarda sus frames por posición)
+} recipient_t;
 
-    bind(listenfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+typedef struct {
+    recipient_t *list;
+    size_t count;
+    size_t cap;
+} recipients_t;
 
-    // Agregamos la llamada a listen()
-    if (listen(listenfd, 10) < 0) {
-        perror("Server: can't listen on port");
-        exit(1);
+/*
+Funcion que anota un destinatario para enviarle después de soltar clients_mutex, así un fan-out grande no retiene
+el registro mientras escribe y varios pueden correr a la vez en el pool de corrutinas. Solo se anotan conexiones
+con colas: lanes_retain las mantiene vivas aunque el cliente se desconecte antes del envío.
+Debe llamarse con clients_mutex bloqueado.
+Parametros:
+    * size_t len: bytes a enviarle, para decidir la compresión
+Retornos:
+    * recipient_t *: el destinatario anotado, o NULL si hay que enviarle ahora (sin colas o sin memoria)
+*/
+static recipient_t *defer_recipient(recipients_t *deferred, client_t *cl, lane_t lane, size_t len) {
+    lanes_t *lanes = lanes_for(cl->sockfd);
+    if (!lanes) return NULL;
+    if (deferred->count == deferred->cap) {
+        size_t cap = deferred->cap ? deferred->cap * 2 : 64;
+        recipient_t *list = realloc(deferred->list, cap * sizeof(recipient_t));
+        if (!list) return NULL;
+        deferred->list = list;
+        deferred->cap = cap;
     }
+    recipient_t *r = &deferred->list[deferred->count++];
+    r->lanes = lanes_retain(lanes);
+    r->lane = lane;
+    r->compress = compress_wanted(cl->sockfd, len);
+    r->slot = -1;
+    return r;
+}
 
-    printf("\033[32mServer started on port %d\n\033[0m", port); 
-    pthread_t tid_inactivity;
-    pthread_create(&tid_inactivity, NULL, &check_inactivity, NULL); 
+/*
+Funcion que envía a un destinatario anotado con defer_recipient, ya sin clients_mutex, y suelta sus colas.
+Parametros:
+    * const uint8_t *data: un payload suelto, o frames completos si frames > 0
+    * size_t frames: cantidad de frames en data, 0 si es un payload
+    * frame_out_t *compressed: lo mismo ya comprimido, o vacío para comprimirlo aquí si el destinatario lo pide (queda
+      hecho para los siguientes destinatarios del mismo mensaje)
+*/
+static void send_deferred(recipient_t *r, const uint8_t *data, size_t len, size_t frames, frame_out_t *compressed) {
+    size_t count = frames ? frames : 1;
+    size_t original = frames ? len : FRAME_HEADER_SIZE + len;
+    int rc = -1;
+    if (!r->compress) {
+        rc = frames ? lanes_send_frames(r->lanes, r->lane, data, len, frames) : lanes_send(r->lanes, r->lane, data, len);
+    } else if (compressed->len == 0 &&
+               (frames ? compress_frames(data, len, compressed) : compress_frame(data, len, compressed)) != 0) {
+        metrics_count(METRIC_SEND_DROPS, count);  // Como en send_packed_lane
+    } else {
+        metrics_count(METRIC_COMPRESSION_IN_BYTES, original);
+        metrics_count(METRIC_COMPRESSION_OUT_BYTES, compressed->len);
+        rc = lanes_send_frames(r->lanes, r->lane, compressed->data, compressed->len, compressed->frames);
+    }
+    if (rc == 0) metrics_count(METRIC_MESSAGES_DELIVERED, count);
+    lanes_put(r->lanes);
+}
 
-    while (1) {
-        client_t *cli = malloc(sizeof(client_t));
-        socklen_t clilen = sizeof(cli->address);
-        cli->sockfd = accept(listenfd, (struct sockaddr*)&cli->address, &clilen);
+/*
+Funcion que envía un broadcast a todos los clientes en línea menos el emisor.
+Con clients_mutex solo se decide a quién va: las sesiones reanudables se numeran (y se les envía ahí mismo para que
+los números salgan en orden) y los coalescidos se acumulan; al resto se le envía después de soltarlo.
+*/
+void broadcast_message(const char *sender_name, codec_str_t message_content) {
+    // El mensaje es el mismo para todos los destinatarios: se serializa una sola vez
+    codec_incoming_message_t msg = {
+        .status_code = CHAT__STATUS_CODE__OK,
+        .sender = codec_str(sender_name),
+        .content = message_content,
+        .type = CHAT__MESSAGE_TYPE__BROADCAST
+    };
+    uint8_t local[PACK_STACK_SIZE];
+    size_t len;
+    uint8_t *buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+    // Versión comprimida del mismo mensaje, que se hace con el primer destinatario que la necesita
+    frame_out_t compressed;
+    frame_out_init(&compressed);
+    recipients_t deferred = {0};
 
-        if (cli->sockfd < 0) {
-            perror("Accept failed");
-            free(cli);
-            continue;
-        }
+    lock_clients();
+    uint64_t fanout_start = metrics_now();
+    int recipients = 0;
+    CHAT_PROBE2(fanout_start, sender_name, message_content.len);
 
-        uint8_t buffer[1024];
-        int len = recv(cli->sockfd, buffer, sizeof(buffer), 0);
-        if (len > 0) {
-            Chat__Request *req = chat__request__unpack(NULL, len, buffer);
-            if (req && req->payload_case == CHAT__REQUEST__PAYLOAD_REGISTER_USER) {
-                if (!username_exists(req->register_user->username)) {
-                    strcpy(cli->name, req->register_user->username);
-                    cli->uid = uid++;
-                    printf("\033[32m\n(*) New connection: %s (IP: %s)\n\033[0m", cli->name, inet_ntoa(cli->address.sin_addr));
-                    add_client(cli);
-                    send_response(cli->sockfd, CHAT__STATUS_CODE__OK, "\033[32mRegistration successful\033[0m");
-                    pthread_t tid;
-                    pthread_create(&tid, NULL, &handle_client, (void*)cli);
-                } else {
-                    send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, "\n\033[31m(!) User is already connected\033[0m");
-                    close(cli->sockfd);
-                    free(cli);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        // Agregar la verificación de que el cliente está en línea
+        if (clients[i] && strcmp(clients[i]->name, sender_name) != 0 && clients[i]->status != INACTIVO) {
+            size_t out_len = len;
+            const uint8_t *out = session_stamp(clients[i], buf, &out_len);
+            if (!out) {
+                // Sesión sin conexión: el mensaje queda en su ventana de reenvío
+            } else if (coalesce_window_us > 0) {
+                coalesce_append(clients[i], out, out_len);
+            } else if (out == buf && defer_recipient(&deferred, clients[i], LANE_BROADCAST, len)) {
+                // Se le envía al soltar el registro
+            } else if (out == buf && compress_wanted(clients[i]->sockfd, len)) {
+                if (compressed.len == 0 && compress_frame(buf, len, &compressed) != 0) {
+                    metrics_count(METRIC_SEND_DROPS, 1);  // Como en send_packed_lane
+                } else if (send_wire(clients[i]->sockfd, LANE_BROADCAST, &compressed, FRAME_HEADER_SIZE + len) == 0) {
+                    metrics_count(METRIC_MESSAGES_DELIVERED, 1);
                 }
+            } else if (send_packed_lane(clients[i]->sockfd, LANE_BROADCAST, out, out_len) == 0) {
+                metrics_count(METRIC_MESSAGES_DELIVERED, 1);
             }
-            chat__request__free_unpacked(req, NULL);
-        } else {
-            close(cli->sockfd);
-            free(cli);
+            recipients++;
+        }
+    }
+    if (coalesce_window_us > 0 && recipients > 0) {
+        uint64_t now = metrics_now();
+        if (coalesce_first == 0) {
+            coalesce_first = now;
+            pthread_cond_signal(&coalesce_cond);
         }
+        coalesce_last = now;
+    }
+    pthread_mutex_unlock(&clients_mutex);
+
+    for (size_t i = 0; i < deferred.count; i++) {
+        send_deferred(&deferred.list[i], buf, len, 0, &compressed);
+    }
+    uint64_t fanout_time = metrics_now() - fanout_start;
+    metrics_observe(METRIC_FANOUT_TIME, fanout_time);
+    CHAT_PROBE2(fanout_end, recipients, fanout_time);
+
+    // Liberar el buffer
+    if (buf != local) free(buf);
+    frame_out_free(&compressed);
+    free(deferred.list);
+}
+
+void send_direct_message_to_client(client_t *cli, codec_str_t recipient, codec_str_t message_content) {
+    bool found = false;
+    bool sent = false;
+    codec_incoming_message_t msg = {
+        .status_code = CHAT__STATUS_CODE__OK,
+        .sender = codec_str(cli->name),
+        .content = message_content,
+        .type = CHAT__MESSAGE_TYPE__DIRECT
+    };
+    uint8_t local[PACK_STACK_SIZE];
+    size_t len;
+    uint8_t *buf = NULL;
+
+    lock_clients();  // Bloquear el mutex para acceder a la lista de clientes
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] && codec_str_equals(recipient, clients[i]->name)) {
+            found = true;  // Marcamos que hemos encontrado al usuario
+            if (clients[i]->status != INACTIVO) {
+                // Serializar y enviar el mensaje (a una sesión sin conexión le queda para cuando la reanude)
+                buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+                size_t out_len = len;
+                const uint8_t *out = session_stamp(clients[i], buf, &out_len);
+                if (out && send_packed_lane(clients[i]->sockfd, direct_lane(clients[i]), out, out_len) == 0) {
+                    metrics_count(METRIC_MESSAGES_DELIVERED, 1);
+                }
+                sent = true;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&clients_mutex);  // Desbloquear el mutex
+
+    // Si no es un usuario local puede estar en otro nodo de la federación
+    int remote_status;
+    if (!found && federation_direct(codec_str(cli->name), recipient, message_content, &remote_status)) {
+        found = true;
+        sent = remote_status != INACTIVO;
+        if (sent) buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+    }
+
+    // Configurar la respuesta dependiendo del resultado del envío
+    if (!found) {
+        msg.status_code = CHAT__STATUS_CODE__BAD_REQUEST;
+        msg.sender = codec_str("Server");
+        msg.content = codec_str("User not found.");
+    } else if (!sent) {
+        msg.status_code = CHAT__STATUS_CODE__BAD_REQUEST;
+        msg.sender = codec_str("Server");
+        msg.content = codec_str("User is offline.");
+    }
+
+    // Al emisor le llega el mismo mensaje como confirmación, o el error
+    if (!sent) {
+        buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+    }
+    send_packed(cli->sockfd, buf, len);
+    if (buf != local) free(buf);
+}
+
+/*
+Funcion que responde un SEND_MESSAGE_BATCH o un SEND_MESSAGE_MULTICAST con un DeliveryReport.
+Los errores también van en un DeliveryReport (sin bitmap) para que el cliente los asocie a su solicitud.
+Parametros:
+    * int sockfd: socket del emisor
+    * Chat__Operation operation: operación que se responde
+    * Chat__StatusCode status_code: OK, o BAD_REQUEST si la solicitud no se procesó
+    * const char *message: detalle del error, NULL si no hay
+    * const uint8_t *bitmap: un bit por mensaje o destinatario, NULL si no se procesó
+    * size_t count: cantidad de mensajes o destinatarios de la solicitud
+    * uint32_t delivered: cuántos se entregaron
+*/
+void send_delivery_report(int sockfd, Chat__Operation operation, Chat__StatusCode status_code, const char *message,
+                          const uint8_t *bitmap, size_t count, uint32_t delivered) {
+    Chat__DeliveryReport report = CHAT__DELIVERY_REPORT__INIT;
+    report.delivered = delivered;
+    report.failed = count - delivered;
+    report.status_bitmap.data = (uint8_t *)bitmap;
+    report.status_bitmap.len = bitmap ? (count + 7) / 8 : 0;
+
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = operation;
+    response.status_code = status_code;
+    if (message) response.message = (char *)message;
+    response.result_case = CHAT__RESPONSE__RESULT_DELIVERY_REPORT;
+    response.delivery_report = &report;
+
+    size_t len = chat__response__get_packed_size(&response);
+    uint8_t *buffer = malloc(len);
+    chat__response__pack(&response, buffer);
+    send_packed(sockfd, buffer, len);
+    free(buffer);
+}
+
+/*
+Funcion que procesa un SEND_MESSAGE_BATCH en una sola pasada.
+Cada mensaje se serializa una vez, el registro de clientes se bloquea una sola vez para todo el batch y cada
+destinatario recibe todos sus mensajes del batch con un solo send. En lugar de una confirmación por DM,
+al emisor se le responde con un DeliveryReport.
+Parametros:
+    * client_t *cli: emisor
+    * const codec_send_message_t *messages: mensajes en orden; recipient vacío significa broadcast
+    * size_t count: cantidad de mensajes (a lo más BATCH_MAX_MESSAGES)
+*/
+void send_message_batch(client_t *cli, const codec_send_message_t *messages, size_t count) {
+    size_t bitmap_len = (count + 7) / 8;
+    uint8_t *bitmap = calloc(bitmap_len ? bitmap_len : 1, 1);
+    frame_out_t *outs = calloc(MAX_CLIENTS, sizeof(frame_out_t));  // Uno por posición de clients[]
+    recipients_t deferred = {0};
+    uint32_t delivered = 0;
+
+    lock_clients();
+    uint64_t fanout_start = metrics_now();
+    for (size_t m = 0; m < count; m++) {
+        bool direct = messages[m].recipient.len > 0;
+        codec_incoming_message_t msg = {
+            .status_code = CHAT__STATUS_CODE__OK,
+            .sender = codec_str(cli->name),
+            .content = messages[m].content,
+            .type = direct ? CHAT__MESSAGE_TYPE__DIRECT : CHAT__MESSAGE_TYPE__BROADCAST
+        };
+        uint8_t local[PACK_STACK_SIZE];
+        size_t len;
+        uint8_t *buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+
+        bool sent = !direct;  // Un broadcast no falla aunque no haya nadie conectado
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (!clients[i] || clients[i]->status == INACTIVO) continue;
+            if (direct ? !codec_str_equals(messages[m].recipient, clients[i]->name) : clients[i] == cli) continue;
+            size_t out_len = len;
+            const uint8_t *out = session_stamp(clients[i], buf, &out_len);
+            if (out) frame_out_append(&outs[i], out, out_len);
+            if (direct) {
+                sent = true;
+                break;
+            }
+        }
+        if (sent) {
+            bitmap[m / 8] |= 1 << (m % 8);
+            delivered++;
+        }
+        if (buf != local) free(buf);
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (outs[i].len == 0) continue;
+        // Los frames numerados de una sesión reanudable salen con el registro bloqueado, para que salgan en orden
+        recipient_t *r = NULL;
+        if (!clients[i]->resumable) r = defer_recipient(&deferred, clients[i], LANE_DIRECT, outs[i].len);
+        if (r) {
+            r->slot = i;
+            continue;
+        }
+        if (send_packed_frames(clients[i]->sockfd, direct_lane(clients[i]), &outs[i]) == 0) {
+            metrics_count(METRIC_MESSAGES_DELIVERED, outs[i].frames);
+        }
+        frame_out_free(&outs[i]);
+    }
+    pthread_mutex_unlock(&clients_mutex);
+
+    for (size_t i = 0; i < deferred.count; i++) {
+        frame_out_t *out = &outs[deferred.list[i].slot];
+        frame_out_t compressed;
+        frame_out_init(&compressed);
+        send_deferred(&deferred.list[i], out->data, out->len, out->frames, &compressed);
+        frame_out_free(&compressed);
+        frame_out_free(out);
+    }
+    metrics_observe(METRIC_FANOUT_TIME, metrics_now() - fanout_start);
+    free(deferred.list);
+    free(outs);
+
+    send_delivery_report(cli->sockfd, CHAT__OPERATION__SEND_MESSAGE_BATCH, CHAT__STATUS_CODE__OK, NULL, bitmap, count, delivered);
+    free(bitmap);
+}
+
+// Destinatario de un multicast: el nombre y su posición en la solicitud (su bit en el DeliveryReport)
+typedef struct {
+    codec_str_t name;
+    size_t index;
+} multicast_target_t;
+
+static int compare_names(codec_str_t a, codec_str_t b) {
+    int cmp = memcmp(a.data, b.data, a.len < b.len ? a.len : b.len);
+    if (cmp != 0) return cmp;
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+static int compare_targets(const void *a, const void *b) {
+    const multicast_target_t *x = a;
+    const multicast_target_t *y = b;
+    int cmp = compare_names(x->name, y->name);
+    return cmp != 0 ? cmp : (x->index > y->index) - (x->index < y->index);
+}
+
+/*
+Funcion que envía el mismo mensaje directo a una lista de usuarios.
+Los destinatarios se ordenan por nombre para resolverlos todos en una sola pasada por el registro de clientes
+(búsqueda binaria por cliente), el mensaje se serializa una sola vez y al emisor se le responde con un
+DeliveryReport con un bit por destinatario. Los nombres repetidos reciben el mensaje una sola vez.
+Parametros:
+    * client_t *cli: emisor
+    * const codec_str_t *recipients: nombres de los destinatarios, en orden
+    * size_t count: cantidad de destinatarios (a lo más MULTICAST_MAX_RECIPIENTS)
+    * codec_str_t message_content: contenido del mensaje
+*/
+void send_multicast_message(client_t *cli, const codec_str_t *recipients, size_t count, codec_str_t message_content) {
+    size_t bitmap_len = (count + 7) / 8;
+    uint8_t *bitmap = calloc(bitmap_len ? bitmap_len : 1, 1);
+    multicast_target_t *targets = calloc(count ? count : 1, sizeof(multicast_target_t));
+    for (size_t j = 0; j < count; j++) {
+        targets[j].name = recipients[j];
+        targets[j].index = j;
+    }
+    qsort(targets, count, sizeof(multicast_target_t), compare_targets);
+
+    codec_incoming_message_t msg = {
+        .status_code = CHAT__STATUS_CODE__OK,
+        .sender = codec_str(cli->name),
+        .content = message_content,
+        .type = CHAT__MESSAGE_TYPE__DIRECT
+    };
+    uint8_t local[PACK_STACK_SIZE];
+    size_t len;
+    uint8_t *buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+    uint32_t delivered = 0;
+    recipients_t deferred = {0};
+    frame_out_t compressed;
+    frame_out_init(&compressed);
+
+    lock_clients();
+    uint64_t fanout_start = metrics_now();
+    int sent_to = 0;
+    CHAT_PROBE2(fanout_start, cli->name, message_content.len);
+
+    for (int i = 0; i < MAX_CLIENTS && count > 0; i++) {
+        if (!clients[i] || clients[i]->status == INACTIVO) continue;
+
+        // Primer destinatario con el nombre del cliente; los repetidos quedan seguidos
+        codec_str_t name = codec_str(clients[i]->name);
+        size_t lo = 0, hi = count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (compare_names(targets[mid].name, name) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo == count || compare_names(targets[lo].name, name) != 0) continue;
+        if (bitmap[targets[lo].index / 8] & (1 << (targets[lo].index % 8))) continue;  // Ya entregado a otro cliente con el mismo nombre
+
+        size_t out_len = len;
+        const uint8_t *out = session_stamp(clients[i], buf, &out_len);
+        if (!out || (out == buf && defer_recipient(&deferred, clients[i], LANE_DIRECT, len))) {
+            // Sesión sin conexión (queda en su ventana de reenvío) o se le envía al soltar el registro
+        } else if (send_packed_lane(clients[i]->sockfd, direct_lane(clients[i]), out, out_len) == 0) {
+            metrics_count(METRIC_MESSAGES_DELIVERED, 1);
+        }
+        sent_to++;
+        for (; lo < count && compare_names(targets[lo].name, name) == 0; lo++) {
+            bitmap[targets[lo].index / 8] |= 1 << (targets[lo].index % 8);
+            delivered++;
+        }
+    }
+
+    pthread_mutex_unlock(&clients_mutex);
+
+    for (size_t i = 0; i < deferred.count; i++) {
+        send_deferred(&deferred.list[i], buf, len, 0, &compressed);
+    }
+    uint64_t fanout_time = metrics_now() - fanout_start;
+    metrics_observe(METRIC_FANOUT_TIME, fanout_time);
+    CHAT_PROBE2(fanout_end, sent_to, fanout_time);
+
+    if (buf != local) free(buf);
+    frame_out_free(&compressed);
+    free(deferred.list);
+    free(targets);
+
+    send_delivery_report(cli->sockfd, CHAT__OPERATION__SEND_MESSAGE_MULTICAST, CHAT__STATUS_CODE__OK, NULL, bitmap, count, delivered);
+    free(bitmap);
+}
+
+/*
+Funcion que empaqueta un chunk de stream en un Response: INCOMING_STREAM para los destinatarios o SEND_STREAM
+para el emisor.
+Retornos:
+    * uint8_t *: buffer de malloc que el llamador libera
+*/
+static uint8_t *pack_stream_response(Chat__Operation operation, Chat__StatusCode status_code, const char *message,
+                                     const Chat__StreamChunk *chunk, size_t *len) {
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = operation;
+    response.status_code = status_code;
+    if (message) response.message = (char *)message;
+    response.result_case = CHAT__RESPONSE__RESULT_STREAM;
+    response.stream = (Chat__StreamChunk *)chunk;
+    *len = chat__response__get_packed_size(&response);
+    uint8_t *buf = malloc(*len);
+    chat__response__pack(&response, buf);
+    return buf;
+}
+
+/*
+Funcion que le responde al emisor cómo terminó un stream: OK si lo cerró él (END o ABORT), o BAD_REQUEST con el
+motivo por el que el servidor lo detuvo.
+*/
+static void send_stream_result(int sockfd, uint32_t stream_id, Chat__StreamPhase phase, uint64_t offset,
+                               Chat__StatusCode status_code, const char *message) {
+    Chat__StreamChunk result = CHAT__STREAM_CHUNK__INIT;
+    result.stream_id = stream_id;
+    result.phase = phase;
+    result.offset = offset;
+    size_t len;
+    uint8_t *buf = pack_stream_response(CHAT__OPERATION__SEND_STREAM, status_code, message, &result, &len);
+    send_packed(sockfd, buf, len);
+    free(buf);
+}
+
+/*
+Funcion que reenvía un chunk a los destinatarios de un stream, empaquetado (y comprimido) una sola vez para todos.
+Los chunks van por la clase de los broadcasts: un stream grande no retrasa a los mensajes directos ni a las
+respuestas, y sus chunks se intercalan con los broadcasts en el orden en que llegan. Si el chunk de un destinatario
+se descarta (su cola está llena) se le avisa por la clase de control que el stream se cortó; el aviso puede
+adelantarse a chunks anteriores y el cliente descarta lo que llegue del stream después.
+Debe llamarse con clients_mutex bloqueado.
+Parametros:
+    * const char *sender: usuario que envía el stream
+    * const open_stream_t *stream: stream, con el offset del chunk
+    * Chat__StreamPhase phase: fase del chunk
+    * ProtobufCBinaryData data: datos del chunk
+    * uint64_t total_size: tamaño anunciado (solo en START)
+Retornos:
+    * int: destinatarios a los que se envió (en un stream directo, 0 si el destinatario ya no está)
+*/
+static int fanout_stream_chunk(const char *sender, const open_stream_t *stream, Chat__StreamPhase phase,
+                               ProtobufCBinaryData data, uint64_t total_size) {
+    bool direct = stream->recipient[0] != '\0';
+    Chat__StreamChunk chunk = CHAT__STREAM_CHUNK__INIT;
+    chunk.stream_id = stream->id;
+    chunk.phase = phase;
+    chunk.data = data;
+    chunk.offset = stream->offset;
+    chunk.total_size = total_size;
+    chunk.sender = (char *)sender;
+    chunk.type = direct ? CHAT__MESSAGE_TYPE__DIRECT : CHAT__MESSAGE_TYPE__BROADCAST;
+    size_t len;
+    uint8_t *buf = pack_stream_response(CHAT__OPERATION__INCOMING_STREAM, CHAT__STATUS_CODE__OK, NULL, &chunk, &len);
+    uint8_t *abort_buf = NULL;
+    size_t abort_len = 0;
+    frame_out_t compressed;
+    frame_out_init(&compressed);
+
+    int delivered = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        client_t *cl = clients[i];
+        if (!cl || cl->sockfd < 0 || cl->status == INACTIVO) continue;
+        if (direct ? strcmp(cl->name, stream->recipient) != 0 : strcmp(cl->name, sender) == 0) continue;
+        int rc;
+        if (compress_wanted(cl->sockfd, len)) {
+            rc = compressed.len > 0 || compress_frame(buf, len, &compressed) == 0
+                 ? send_wire(cl->sockfd, LANE_BROADCAST, &compressed, FRAME_HEADER_SIZE + len) : -1;
+        } else {
+            rc = send_packed_lane(cl->sockfd, LANE_BROADCAST, buf, len);
+        }
+        if (rc == 0) {
+            delivered++;
+        } else if (phase != CHAT__STREAM_PHASE__STREAM_ABORT && phase != CHAT__STREAM_PHASE__STREAM_END) {
+            if (!abort_buf) {
+                chunk.phase = CHAT__STREAM_PHASE__STREAM_ABORT;
+                chunk.data.len = 0;
+                chunk.total_size = 0;
+                abort_buf = pack_stream_response(CHAT__OPERATION__INCOMING_STREAM, CHAT__STATUS_CODE__OK, NULL, &chunk, &abort_len);
+            }
+            send_packed_lane(cl->sockfd, LANE_CONTROL, abort_buf, abort_len);
+        }
+        if (direct) break;
+    }
+    free(buf);
+    free(abort_buf);
+    frame_out_free(&compressed);
+    return delivered;
+}
+
+// Destinatario de un stream con demasiado en cola: sus colas retenidas y su aviso de que la cola bajó
+typedef struct {
+    lanes_t *lanes;
+    lanes_waiter_t waiter;
+} stream_backlog_t;
+
+/*
+Funcion que indica si un destinatario todavía frena al stream: tiene más de STREAM_BACKLOG_BYTES en cola y su socket
+no lleva STREAM_STALL_MS sin aceptar nada.
+Parametros:
+    * int *timeout: se baja a los milisegundos que le quedan para dejar de frenar, si su socket está lleno
+*/
+static bool stream_backlogged(lanes_t *lanes, uint64_t now, int *timeout) {
+    uint64_t blocked_since;
+    if (lanes_backlog(lanes, &blocked_since) <= STREAM_BACKLOG_BYTES) return false;
+    if (blocked_since == 0) return true;
+    uint64_t stall_at = blocked_since + STREAM_STALL_MS * 1000000ull;
+    if (now >= stall_at) return false;
+    int left = (int)((stall_at - now + 999999) / 1000000);
+    if (left < *timeout) *timeout = left;
+    return true;
+}
+
+/*
+Funcion que frena al emisor de un stream mientras algún destinatario tenga más de STREAM_BACKLOG_BYTES en cola.
+Mientras espera, su thread no lee el socket, así que el control de flujo de TCP llega hasta el outbox del emisor:
+un lector más lento que el emisor recibe el stream completo en lugar de perder chunks, y un broadcast que llega a
+la mitad espera detrás de a lo más STREAM_BACKLOG_BYTES del stream. Un destinatario que lleva STREAM_STALL_MS sin
+aceptar nada ya no frena a los demás: sus chunks se descartan y se le corta el stream.
+El registro se recorre una vez para anotar a los destinatarios atrasados; después se espera en un eventfd que sus
+colas escriben al bajar del umbral (lanes_wait_below) y solo se revisan esos.
+Se llama y retorna con clients_mutex bloqueado, pero lo suelta mientras espera.
+*/
+static void wait_stream_recipients(const char *sender, const char *recipient) {
+    stream_backlog_t *backlog = NULL;
+    size_t count = 0, cap = 0;
+    uint64_t now = metrics_now();
+    int timeout = STREAM_STALL_MS;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        client_t *cl = clients[i];
+        if (!cl || cl->sockfd < 0 || cl->status == INACTIVO) continue;
+        if (recipient[0] ? strcmp(cl->name, recipient) != 0 : strcmp(cl->name, sender) == 0) continue;
+        lanes_t *lanes = lanes_for(cl->sockfd);
+        if (!lanes || !stream_backlogged(lanes, now, &timeout)) continue;
+        if (count == cap) {
+            cap = cap ? 2 * cap : 8;
+            stream_backlog_t *grown = realloc(backlog, cap * sizeof(stream_backlog_t));
+            if (!grown) break;  // Se espera a los que ya se anotaron
+            backlog = grown;
+        }
+        backlog[count++].lanes = lanes_retain(lanes);
+    }
+    if (count == 0) {
+        free(backlog);
+        return;
+    }
+
+    // Sin eventfd se revisa cada milisegundo, como si ninguna cola avisara
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pthread_mutex_unlock(&clients_mutex);
+    while (count > 0) {
+        // Los que ya no frenan se sueltan; a los demás se les pide el aviso (uno que bajó justo ahora tampoco frena)
+        now = metrics_now();
+        timeout = STREAM_STALL_MS;
+        for (size_t i = 0; i < count;) {
+            stream_backlog_t *entry = &backlog[i];
+            if (stream_backlogged(entry->lanes, now, &timeout) &&
+                (efd < 0 || lanes_wait_below(entry->lanes, &entry->waiter, efd, STREAM_BACKLOG_BYTES))) {
+                i++;
+                continue;
+            }
+            lanes_put(entry->lanes);
+            *entry = backlog[--count];
+        }
+        if (count == 0) break;
+        // Dentro de una corrutina el worker sigue con las demás mientras tanto
+        struct pollfd pfd = { .fd = efd, .events = POLLIN };
+        coro_poll(efd < 0 ? NULL : &pfd, efd < 0 ? 0 : 1, efd < 0 ? 1 : timeout);
+        uint64_t value;
+        if (efd >= 0 && read(efd, &value, sizeof(value)) < 0) {
+            // Ningún aviso todavía: se cumplió el plazo de algún destinatario
+        }
+        for (size_t i = 0; i < count && efd >= 0; i++) lanes_unwait(backlog[i].lanes, &backlog[i].waiter);
+    }
+    if (efd >= 0) close(efd);
+    free(backlog);
+    lock_clients();
+}
+
+/*
+Funcion que cierra un stream del emisor: si lo detuvo el servidor (reason no es NULL) avisa a los destinatarios con
+un ABORT y al emisor con el motivo. Debe llamarse con clients_mutex bloqueado.
+*/
+static void close_stream(client_t *cli, open_stream_t *stream, const char *reason) {
+    if (reason) {
+        ProtobufCBinaryData none = { 0, NULL };
+        fanout_stream_chunk(cli->name, stream, CHAT__STREAM_PHASE__STREAM_ABORT, none, 0);
+        metrics_count(METRIC_STREAMS_ABORTED, 1);
+        if (cli->sockfd >= 0) {
+            send_stream_result(cli->sockfd, stream->id, CHAT__STREAM_PHASE__STREAM_ABORT, stream->offset,
+                               CHAT__STATUS_CODE__BAD_REQUEST, reason);
+        }
+    }
+    stream->open = false;
+}
+
+/*
+Funcion que detiene todos los streams abiertos de un cliente (su conexión se cerró o se traspasa a otro proceso).
+Debe llamarse con clients_mutex bloqueado, desde el thread del cliente o con ese thread detenido.
+*/
+void abort_streams(client_t *cli, const char *reason) {
+    for (int i = 0; i < STREAM_MAX_OPEN; i++) {
+        if (cli->streams[i].open) close_stream(cli, &cli->streams[i], reason);
+    }
+}
+
+/*
+Funcion que revisa si un chunk puede seguir al stream. Debe llamarse con clients_mutex bloqueado.
+Retornos:
+    * const char *: motivo por el que se detiene el stream, NULL si el chunk es válido
+*/
+static const char *stream_chunk_error(const open_stream_t *stream, const Chat__StreamChunk *chunk) {
+    if (chunk->phase == CHAT__STREAM_PHASE__STREAM_ABORT) return NULL;
+    if (chunk->data.len > STREAM_CHUNK_MAX_BYTES) return "\033[31mChunk too large\033[0m";
+    if (chunk->offset != stream->offset) return "\033[31mChunk out of order\033[0m";
+    if (stream->recipient[0] == '\0' && mem_shedding()) {
+        // Como un broadcast: cada chunk crece las colas de todos los destinatarios
+        metrics_count(METRIC_BROADCASTS_SHED, 1);
+        return "\033[31mServer is low on memory, stream dropped\033[0m";
+    }
+    return NULL;
+}
+
+/*
+Funcion que atiende un chunk de SEND_STREAM: lo valida contra el stream abierto y lo reenvía de inmediato, sin
+guardar el contenido. Solo la usa el thread del emisor, que es el único que toca cli->streams.
+El emisor recibe respuesta cuando el stream termina (END o ABORT) o cuando el servidor lo detiene; los chunks de un
+stream que ya no existe se ignoran, salvo el END, que recibe el error.
+*/
+void relay_stream_chunk(client_t *cli, const Chat__StreamChunk *chunk) {
+    open_stream_t *stream = NULL;
+    open_stream_t *free_slot = NULL;
+    for (int i = 0; i < STREAM_MAX_OPEN; i++) {
+        if (cli->streams[i].open && cli->streams[i].id == chunk->stream_id) stream = &cli->streams[i];
+        if (!cli->streams[i].open && !free_slot) free_slot = &cli->streams[i];
+    }
+    bool starting = chunk->phase == CHAT__STREAM_PHASE__STREAM_START;
+    const char *error = NULL;
+    if (starting && stream) {
+        error = "\033[31mStream already open\033[0m";
+    } else if (starting && !free_slot) {
+        error = "\033[31mToo many open streams\033[0m";
+    } else if (!starting && !stream) {
+        if (chunk->phase == CHAT__STREAM_PHASE__STREAM_END) {
+            send_stream_result(cli->sockfd, chunk->stream_id, CHAT__STREAM_PHASE__STREAM_ABORT, chunk->offset,
+                               CHAT__STATUS_CODE__BAD_REQUEST, "\033[31mUnknown stream\033[0m");
+        }
+        return;
+    }
+    if (error) {
+        send_stream_result(cli->sockfd, chunk->stream_id, CHAT__STREAM_PHASE__STREAM_ABORT, 0,
+                           CHAT__STATUS_CODE__BAD_REQUEST, error);
+        return;
+    }
+
+    lock_clients();
+    if (starting) {
+        stream = free_slot;
+        memset(stream, 0, sizeof(*stream));
+        stream->id = chunk->stream_id;
+        snprintf(stream->recipient, sizeof(stream->recipient), "%s", chunk->recipient);
+        stream->open = true;
+        federation_user_t remote;
+        if (stream->recipient[0]) {
+            client_t *to = NULL;
+            for (int i = 0; i < MAX_CLIENTS && !to; i++) {
+                if (clients[i] && strcmp(clients[i]->name, stream->recipient) == 0) to = clients[i];
+            }
+            if (!to && federation_lookup(stream->recipient, &remote)) {
+                error = "\033[31mStreams do not reach users on other nodes\033[0m";
+            } else if (!to) {
+                error = "User not found.";
+            } else if (to->sockfd < 0 || to->status == INACTIVO) {
+                error = "User is offline.";
+            }
+        }
+    }
+
+    bool broadcast = stream->recipient[0] == '\0';
+    if (!error) error = stream_chunk_error(stream, chunk);
+    if (error && starting) {
+        // Un START rechazado no llegó a nadie: no hay destinatarios a los que avisar
+        stream->open = false;
+        pthread_mutex_unlock(&clients_mutex);
+        send_stream_result(cli->sockfd, chunk->stream_id, CHAT__STREAM_PHASE__STREAM_ABORT, 0,
+                           CHAT__STATUS_CODE__BAD_REQUEST, error);
+        return;
+    }
+    if (error) {
+        close_stream(cli, stream, error);
+        pthread_mutex_unlock(&clients_mutex);
+        return;
+    }
+
+    ProtobufCBinaryData data = chunk->data;
+    if (chunk->phase == CHAT__STREAM_PHASE__STREAM_ABORT) {
+        data.len = 0;
+    } else {
+        wait_stream_recipients(cli->name, stream->recipient);
+    }
+    int delivered = fanout_stream_chunk(cli->name, stream, chunk->phase, data, chunk->total_size);
+    stream->offset += data.len;
+    metrics_count(METRIC_STREAM_BYTES, data.len);
+    if (!broadcast && delivered == 0 && chunk->phase != CHAT__STREAM_PHASE__STREAM_ABORT) {
+        close_stream(cli, stream, "\033[31mRecipient went offline or is not keeping up\033[0m");
+    } else if (chunk->phase == CHAT__STREAM_PHASE__STREAM_END || chunk->phase == CHAT__STREAM_PHASE__STREAM_ABORT) {
+        if (chunk->phase == CHAT__STREAM_PHASE__STREAM_ABORT) metrics_count(METRIC_STREAMS_ABORTED, 1);
+        send_stream_result(cli->sockfd, stream->id, chunk->phase, stream->offset, CHAT__STATUS_CODE__OK,
+                           chunk->phase == CHAT__STREAM_PHASE__STREAM_END ? "Stream delivered" : "Stream cancelled");
+        stream->open = false;
+    }
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+/*
+Funcion que atiende un SEND_MESSAGE, venga del codec nativo o de protobuf-c.
+*/
+static void handle_send_message(client_t *cli, codec_str_t recipient, codec_str_t content) {
+    if (recipient.len > 0) {
+        // Enviar a un usuario específico
+        CHAT_PROBE3(op_direct_message, cli->uid, recipient.data, content.len);
+        send_direct_message_to_client(cli, recipient, content);
+        printf("\033[34m\nDirect Message sent from [%s] to [%.*s]\n\033[0m", cli->name, (int)recipient.len, recipient.data);
+    } else {
+        // Broadcast message; cerca del presupuesto de memoria se descarta, porque cada uno llena las colas de todos
+        if (mem_shedding()) {
+            metrics_count(METRIC_BROADCASTS_SHED, 1);
+            send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, "\033[31mServer is low on memory, broadcast dropped\033[0m");
+            return;
+        }
+        CHAT_PROBE2(op_broadcast, cli->uid, content.len);
+        broadcast_message(cli->name, content);
+        federation_broadcast(codec_str(cli->name), content);
+        printf("\033[34m\nBroadcast message sent by [%s]\n\033[0m", cli->name);
+    }
+}
+
+/*
+Funcion que reporta en el log la memoria registrada en el presupuesto: cada MEM_LOG_INTERVAL segundos y cada vez
+que el servidor deja de aceptar registros o empieza a descartar broadcasts (y cuando vuelve a la normalidad).
+*/
+static void log_memory(time_t now) {
+    static bool admitting = true;
+    static bool shedding = false;
+    static time_t last_report = 0;
+    if (mem_budget == 0) return;
+    bool now_admitting = mem_admitting();
+    bool now_shedding = mem_shedding();
+    if (now_admitting == admitting && now_shedding == shedding && difftime(now, last_report) < MEM_LOG_INTERVAL) return;
+    admitting = now_admitting;
+    shedding = now_shedding;
+    last_report = now;
+    const double mb = 1024.0 * 1024.0;
+    printf("\033[33m\n(*) Memory: %.1f of %.1f MB (clients %.1f, buffers %.1f, queues %.1f, history %.1f, shm %.1f)%s%s\n\033[0m",
+           mem_used() / mb, mem_budget / mb, mem_usage(MEM_CLIENTS) / mb, mem_usage(MEM_BUFFERS) / mb,
+           mem_usage(MEM_QUEUES) / mb, mem_usage(MEM_HISTORY) / mb, mem_usage(MEM_SHM) / mb,
+           admitting ? "" : ", rejecting registrations", shedding ? ", dropping broadcasts" : "");
+}
+
+void* check_inactivity(void* arg) {
+    affinity_pin(AFFINITY_TIMER, -1);
+    while (1) {
+        sleep(1);
+        time_t now = time(NULL);
+        log_memory(now);
+        lock_clients();
+        for (int i = 0; i < MAX_CLIENTS; ++i) {
+            if (clients[i] && clients[i]->sockfd < 0) {
+                // Sesión sin conexión que nadie reanudó a tiempo
+                if (difftime(now, clients[i]->detached_at) > SESSION_RESUME_TIMEOUT) {
+                    printf("\033[91m\n(*) Session expired: %s\n\033[0m", clients[i]->name);
+                    federation_user_left(clients[i]->name);
+                    release_client(clients[i]);
+                    clients[i] = NULL;
+                }
+                continue;
+            }
+            if (clients[i] && difftime(now, clients[i]->last_active) > INACTIVITY_TIMEOUT) {
+                if (clients[i]->status != INACTIVO) {
+                    clients[i]->status = INACTIVO;
+                    federation_user_status(clients[i]->name, INACTIVO);
+                    printf("\033[34m%s has been set OFFLINE due to inactivity.\n\033[0m", clients[i]->name);
+                    char message[256];
+                    sprintf(message, "\033[34mYour status has been changed to OFFLINE due to inactivity.\033[0m");
+                    send_response(clients[i]->sockfd, CHAT__STATUS_CODE__OK, message);
+                }
+            }
+        }
+        pthread_mutex_unlock(&clients_mutex);
+    }
+    return NULL;
+}
+
+/*
+Funcion que aplica los límites de solicitudes del cliente y, si se excede, responde BAD_REQUEST con la forma
+que espera cada operación (el cliente empareja las respuestas por tipo). Los buckets son del cliente y solo
+los toca su handler, así que no se bloquea nada.
+Parametros:
+    * client_t *cli: cliente que hizo la solicitud
+    * int operation: operación decodificada
+    * bool direct: el SEND_MESSAGE tiene destinatario
+    * size_t cost: mensajes del batch o destinatarios del multicast (1 para el resto)
+    * uint64_t now: llegada de la solicitud
+Retornos:
+    * bool: true si la solicitud se rechazó
+*/
+static bool over_rate_limit(client_t *cli, int operation, bool direct, size_t cost, uint64_t now) {
+    rate_kind_t kind;
+    switch (operation) {
+        case CHAT__OPERATION__SEND_MESSAGE: kind = direct ? RATE_DIRECT : RATE_BROADCAST; break;
+        case CHAT__OPERATION__UPDATE_STATUS: kind = RATE_STATUS; break;
+        case CHAT__OPERATION__GET_USERS: kind = RATE_USERS; break;
+        case CHAT__OPERATION__SEND_MESSAGE_BATCH: kind = RATE_BATCH; break;
+        case CHAT__OPERATION__SEND_MESSAGE_MULTICAST: kind = RATE_MULTICAST; break;
+        default: return false;
+    }
+    if (rate_allow(&cli->rate_buckets[kind], kind, cost, now)) return false;
+    metrics_count_rate_limited(kind);
+
+    const char *message = "\033[31mRate limit exceeded\033[0m";
+    switch (kind) {
+        case RATE_DIRECT: {
+            // Igual que el error de un DM a un usuario que no existe
+            codec_incoming_message_t msg = {
+                .status_code = CHAT__STATUS_CODE__BAD_REQUEST,
+                .sender = codec_str("Server"),
+                .content = codec_str("Rate limit exceeded."),
+                .type = CHAT__MESSAGE_TYPE__DIRECT
+            };
+            uint8_t local[PACK_STACK_SIZE];
+            size_t len;
+            uint8_t *buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+            send_packed(cli->sockfd, buf, len);
+            if (buf != local) free(buf);
+            break;
+        }
+        case RATE_USERS: {
+            Chat__UserListResponse user_list = CHAT__USER_LIST_RESPONSE__INIT;
+            Chat__Response response = CHAT__RESPONSE__INIT;
+            response.operation = CHAT__OPERATION__GET_USERS;
+            response.status_code = CHAT__STATUS_CODE__BAD_REQUEST;
+            response.message = (char *)message;
+            response.result_case = CHAT__RESPONSE__RESULT_USER_LIST;
+            response.user_list = &user_list;
+            size_t len = chat__response__get_packed_size(&response);
+            uint8_t *buffer = malloc(len);
+            chat__response__pack(&response, buffer);
+            send_packed(cli->sockfd, buffer, len);
+            free(buffer);
+            break;
+        }
+        case RATE_BATCH:
+        case RATE_MULTICAST:
+            send_delivery_report(cli->sockfd, kind == RATE_BATCH ? CHAT__OPERATION__SEND_MESSAGE_BATCH : CHAT__OPERATION__SEND_MESSAGE_MULTICAST,
+                                 CHAT__STATUS_CODE__BAD_REQUEST, message, NULL, cost, 0);
+            break;
+        default:
+            send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, message);
+            break;
+    }
+    return true;
+}
+
+/*
+Funcion que separa la sesión reanudable de un cliente de su conexión caída. El client_t sigue registrado con
+sockfd -1 y acumula los mensajes en su ventana de reenvío hasta que el cliente la reanude o expire.
+Parametros:
+    * client_t *cli: cliente cuyo thread está terminando
+Retornos:
+    * bool: true si la sesión quedó guardada (el client_t ya no pertenece al thread), false si hay que eliminarlo
+*/
+static bool detach_session(client_t *cli) {
+    lock_clients();
+    bool kept = cli->resumable && !cli->migrated;
+    if (kept) {
+        frame_out_reset(&cli->coalesced);  // Ya están numerados en la ventana de reenvío
+        pthread_mutex_lock(&handoff_mutex);
+        cli->sockfd = -1;
+        cli->started = false;
+        pthread_mutex_unlock(&handoff_mutex);
+        cli->detached_at = time(NULL);
+        printf("\033[91m\n(*) Connection lost: %s, session kept for %d s\n\033[0m", cli->name, SESSION_RESUME_TIMEOUT);
+        pthread_cond_broadcast(&session_cond);
+    }
+    pthread_mutex_unlock(&clients_mutex);
+    return kept;
+}
+
+// Solicitud decodificada que atiende process_request, en la corrutina del cliente o en una tarea del pool
+typedef struct {
+    client_t *cli;
+    int operation;
+    Chat__Request *req;                         // NULL si la decodificó el codec nativo
+    const codec_send_message_t *send_message;  // SEND_MESSAGE del codec nativo
+    const codec_send_message_t *batch;
+    size_t batch_count;
+    lanes_held_t held;  // Conexiones con la salida que armó la tarea, para que la escriba la corrutina
+} request_t;
+
+/*
+Funcion que decide si una solicitud se atiende en el pool de tareas de los workers: las que recorren a todos los
+clientes o a muchos destinatarios (lista de usuarios, broadcast, lotes y multicast). Los mensajes directos, estados
+y streams son cortos, o esperan a sus destinatarios, y siguen en la corrutina.
+*/
+static bool heavy_request(int operation, bool direct) {
+    switch (operation) {
+        case CHAT__OPERATION__GET_USERS:
+        case CHAT__OPERATION__SEND_MESSAGE_BATCH:
+        case CHAT__OPERATION__SEND_MESSAGE_MULTICAST:
+            return true;
+        case CHAT__OPERATION__SEND_MESSAGE:
+            return !direct;
+        default:
+            return false;
+    }
+}
+
+/*
+Funcion que atiende una solicitud ya decodificada y que no excedió su límite.
+Parametros:
+    * void *arg: request_t de la solicitud
+*/
+static void process_request(void *arg) {
+    const request_t *request = (const request_t *)arg;
+    client_t *cli = request->cli;
+    Chat__Request *req = request->req;
+    const codec_send_message_t *send_message = request->send_message;
+    const codec_send_message_t *batch = request->batch;
+    size_t batch_count = request->batch_count;
+    switch (request->operation) {
+        case CHAT__OPERATION__GET_USERS:
+            CHAT_PROBE2(op_get_users, cli->uid, req->payload_case == CHAT__REQUEST__PAYLOAD_GET_USERS && strlen(req->get_users->username) > 0);
+            if (req->payload_case == CHAT__REQUEST__PAYLOAD_GET_USERS) {
+                // Se envía la solicitud completa
+                send_user_list(cli->sockfd, req->get_users);
+                printf("\033[34m\nUser list sent to [%s]\n\033[0m", cli->name);
+            } else {
+                // En caso de que no haya detalles = NULL
+                send_user_list(cli->sockfd, NULL);
+            }
+            break;
+        
+        // Cambiar el estado de un usuario
+        case CHAT__OPERATION__UPDATE_STATUS: {
+            CHAT_PROBE2(op_update_status, cli->uid, req->update_status ? (int)req->update_status->new_status : -1);
+            if (req->update_status && username_exists(req->update_status->username)) {
+                lock_clients();
+                for (int i = 0; i < MAX_CLIENTS; ++i) {
+                    if (clients[i] && strcmp(clients[i]->name, req->update_status->username) == 0) {
+                        ClientStatus old_status = clients[i]->status; // Guarda el estado antiguo
+                        clients[i]->status = req->update_status->new_status; // Actualiza al nuevo estado
+                        federation_user_status(clients[i]->name, clients[i]->status);
+                        send_response(cli->sockfd, CHAT__STATUS_CODE__OK, "\n\033[32mStatus updated successfully!\033[0m");
+                        printf("\033[34m\nUpdated status for %s from %s to %s\n\033[0m", clients[i]->name, get_status_name(old_status), get_status_name(clients[i]->status));
+                        break;
+                    }
+                }
+                pthread_mutex_unlock(&clients_mutex);
+            } else {
+                send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, "\033[31mUser not found\033[0m");
+            }
+            break;
+        }
+        case CHAT__OPERATION__SEND_MESSAGE:
+            if (req == NULL) {
+                handle_send_message(cli, send_message->recipient, send_message->content);
+            } else if (req->send_message) {
+                handle_send_message(cli, codec_str(req->send_message->recipient), codec_str(req->send_message->content));
+            }
+            break;
+
+        case CHAT__OPERATION__SEND_MESSAGE_BATCH:
+            CHAT_PROBE2(op_send_batch, cli->uid, batch_count);
+            if (batch) {
+                send_message_batch(cli, batch, batch_count);
+                printf("\033[34m\nBatch of %zu messages sent by [%s]\n\033[0m", batch_count, cli->name);
+            } else if (batch_count > BATCH_MAX_MESSAGES) {
+                send_delivery_report(cli->sockfd, CHAT__OPERATION__SEND_MESSAGE_BATCH, CHAT__STATUS_CODE__BAD_REQUEST,
+                                     "\033[31mToo many messages in the batch\033[0m", NULL, batch_count, 0);
+            }
+            break;
+
+        case CHAT__OPERATION__SEND_MESSAGE_MULTICAST: {
+            if (req->payload_case != CHAT__REQUEST__PAYLOAD_SEND_MULTICAST) break;
+            Chat__MulticastMessageRequest *multicast = req->send_multicast;
+            CHAT_PROBE3(op_multicast, cli->uid, multicast->n_recipients, strlen(multicast->content));
+            if (multicast->n_recipients > MULTICAST_MAX_RECIPIENTS) {
+                send_delivery_report(cli->sockfd, CHAT__OPERATION__SEND_MESSAGE_MULTICAST, CHAT__STATUS_CODE__BAD_REQUEST,
+                                     "\033[31mToo many recipients\033[0m", NULL, multicast->n_recipients, 0);
+                break;
+            }
+            codec_str_t *recipients = malloc((multicast->n_recipients ? multicast->n_recipients : 1) * sizeof(codec_str_t));
+            for (size_t i = 0; i < multicast->n_recipients; i++) {
+                recipients[i] = codec_str(multicast->recipients[i]);
+            }
+            send_multicast_message(cli, recipients, multicast->n_recipients, codec_str(multicast->content));
+            printf("\033[34m\nMulticast message sent from [%s] to %zu recipients\n\033[0m", cli->name, multicast->n_recipients);
+            free(recipients);
+            break;
+        }
+
+        case CHAT__OPERATION__GET_MEMORY:
+            send_memory_usage(cli->sockfd);
+            break;
+
+        case CHAT__OPERATION__SEND_STREAM:
+            if (req->payload_case != CHAT__REQUEST__PAYLOAD_STREAM) break;
+            CHAT_PROBE3(op_stream_chunk, cli->uid, req->stream->phase, req->stream->data.len);
+            relay_stream_chunk(cli, req->stream);
+            break;
+
+        // Cierre voluntario: la sesión reanudable se descarta junto con la conexión
+        case CHAT__OPERATION__UNREGISTER_USER:
+            lock_clients();
+            cli->resumable = false;
+            pthread_mutex_unlock(&clients_mutex);
+            break;
+    }
+}
+
+/*
+Funcion que atiende una solicitud en una tarea del pool. La tarea solo arma la salida: lo que envía queda retenido
+en las colas de cada conexión y la corrutina lo escribe cuando coro_run_task vuelve, así que ninguna escritura
+ocurre en el stack del worker que corre la tarea.
+Parametros:
+    * void *arg: request_t de la solicitud
+*/
+static void process_offloaded(void *arg) {
+    request_t *request = (request_t *)arg;
+    lanes_hold(&request->held);
+    process_request(request);
+    lanes_hold(NULL);
+}
+
+/*
+Funcion que pasa un client_t a memoria del thread que lo va a atender. El acceptor (o el traspaso) lo crea, pero con
+--affinity el worker puede estar en otro nodo NUMA, y Linux asigna cada página en el nodo del thread que la toca
+primero: la copia que hace el worker, con su ventana de reenvío, queda en el suyo. Los demás threads llegan al
+cliente por clients[] con clients_mutex, así que basta con cambiar el puntero ahí. Si ya no está en clients[] (la
+sesión migró mientras tanto) se queda donde estaba.
+Retornos:
+    * client_t *: el cliente que el handler usa desde ahora
+*/
+static client_t *adopt_client(client_t *cli) {
+    client_t *local = malloc(sizeof(client_t));
+    if (!local) return cli;
+    lock_clients();
+    pthread_mutex_lock(&handoff_mutex);
+    int slot = -1;
+    for (int i = 0; i < MAX_CLIENTS && slot < 0; i++) {
+        if (clients[i] == cli) slot = i;
+    }
+    if (slot >= 0) {
+        memcpy(local, cli, sizeof(client_t));
+        size_t pending = cli->replay.len - cli->replay.start;
+        frame_buffer_init(&local->replay);
+        uint8_t *out = pending > 0 ? frame_buffer_reserve(&local->replay, pending) : NULL;
+        if (out) {
+            memcpy(out, cli->replay.data + cli->replay.start, pending);
+            frame_buffer_free(&cli->replay);
+        } else {
+            local->replay = cli->replay;  // Vacía, o sin memoria para copiarla
+        }
+        clients[slot] = local;
+        account_client(local);
+    }
+    pthread_mutex_unlock(&handoff_mutex);
+    pthread_mutex_unlock(&clients_mutex);
+    if (slot < 0) {
+        free(local);
+        return cli;
+    }
+    free(cli);
+    return local;
+}
+
+void *handle_client(void *arg) {
+    client_t *cli = (client_t *)arg;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    size_t accounted = 0;  // Capacidad de buffer registrada en el presupuesto de memoria
+    ssize_t len;
+
+    coro_t *coro = coro_self();
+    if (!coro) affinity_pin(AFFINITY_WORKERS, -1);  // Un thread por conexión: todos comparten los CPUs de los workers
+    if (affinity_cpus(AFFINITY_WORKERS) > 0) cli = adopt_client(cli);
+    pthread_mutex_lock(&handoff_mutex);
+    cli->thread = pthread_self();
+    cli->coro = coro;
+    cli->started = true;
+    pthread_mutex_unlock(&handoff_mutex);
+    // El socket queda en el epoll del worker hasta close_connection, en lugar de agregarse en cada espera
+    if (coro) coro_watch(cli->sockfd);
+
+    while (1) {
+        // Un reinicio en caliente detiene al thread aquí; la señal del traspaso corta la espera del siguiente frame
+        if (atomic_load(&handoff_pending)) park_for_handoff(&cli->parked);
+        len = recv_request(cli->sockfd, &buffer, &capacity);
+        if (len < 0 && errno == EINTR) continue;
+        if (len <= 0) break;
+        mem_resize(MEM_BUFFERS, &accounted, capacity);
+        uint64_t arrival = metrics_now();
+        cli->last_active = time(NULL);
+        metrics_count(METRIC_BYTES_IN, FRAME_HEADER_SIZE + len);
+        capture_request(cli->conn_id, buffer, len);
+
+        // Los SEND_MESSAGE se decodifican sin copias con el codec nativo; el resto pasa por protobuf-c
+        Chat__Request *req = NULL;
+        codec_send_message_t send_message;
+        codec_send_message_t *batch = NULL;
+        size_t batch_count = 0;
+        int operation = -1;
+        if (server_codec == CODEC_NATIVE && codec_decode_send_message(buffer, len, &send_message)) {
+            operation = CHAT__OPERATION__SEND_MESSAGE;
+        } else if (server_codec == CODEC_NATIVE && codec_decode_send_message_batch(buffer, len, NULL, 0, &batch_count)) {
+            // La primera pasada solo cuenta los mensajes; la segunda llena el arreglo
+            operation = CHAT__OPERATION__SEND_MESSAGE_BATCH;
+            if (batch_count <= BATCH_MAX_MESSAGES) {
+                batch = malloc((batch_count ? batch_count : 1) * sizeof(codec_send_message_t));
+                codec_decode_send_message_batch(buffer, len, batch, batch_count, &batch_count);
+            }
+        } else if ((req = chat__request__unpack(NULL, len, buffer)) != NULL) {
+            operation = req->operation;
+            if (req->payload_case == CHAT__REQUEST__PAYLOAD_SEND_MESSAGE_BATCH) {
+                batch_count = req->send_message_batch->n_messages;
+                if (batch_count <= BATCH_MAX_MESSAGES) {
+                    batch = malloc((batch_count ? batch_count : 1) * sizeof(codec_send_message_t));
+                    for (size_t i = 0; i < batch_count; i++) {
+                        batch[i].recipient = codec_str(req->send_message_batch->messages[i]->recipient);
+                        batch[i].content = codec_str(req->send_message_batch->messages[i]->content);
+                    }
+                }
+            }
+        }
+        uint64_t decode_time = metrics_now() - arrival;
+        metrics_observe(METRIC_DECODE_TIME, decode_time);
+        CHAT_PROBE4(request_decode, cli->uid, len, operation, decode_time);
+        if (operation < 0) {
+            metrics_count(METRIC_DECODE_ERRORS, 1);
+            fprintf(stderr, "Error unpacking incoming message\n");
+            continue;
+        }
+
+        metrics_count_operation(operation);
+        bool direct = false;
+        if (operation == CHAT__OPERATION__SEND_MESSAGE) {
+            direct = req ? req->payload_case == CHAT__REQUEST__PAYLOAD_SEND_MESSAGE && req->send_message->recipient[0]
+                         : send_message.recipient.len > 0;
+        }
+        size_t cost = operation == CHAT__OPERATION__SEND_MESSAGE_BATCH ? batch_count :
+                      req && req->payload_case == CHAT__REQUEST__PAYLOAD_SEND_MULTICAST ? req->send_multicast->n_recipients : 1;
+        // Una solicitud que excede su límite ya se respondió y no llega a ningún caso
+        if (!over_rate_limit(cli, operation, direct, cost, arrival)) {
+            request_t request = {
+                .cli = cli,
+                .operation = operation,
+                .req = req,
+                .send_message = req ? NULL : &send_message,
+                .batch = batch,
+                .batch_count = batch_count,
+                .held = {0}
+            };
+            if (offload_requests && heavy_request(operation, direct)) {
+                coro_run_task(&process_offloaded, &request);
+                lanes_release(&request.held);
+            } else {
+                process_request(&request);
+            }
+        }
+
+        free(batch);
+        if (req) chat__request__free_unpacked(req, NULL);
+        uint64_t request_time = metrics_now() - arrival;
+        metrics_observe(METRIC_REQUEST_TIME, request_time);
+        CHAT_PROBE3(request_done, cli->uid, operation, request_time);
+    }
+
+    free(buffer);
+    mem_resize(MEM_BUFFERS, &accounted, 0);
+    if (len <= 0) {
+        metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+        capture_close(cli->conn_id);  // Antes de soltar la sesión: al reanudarla cambia de conexión
+        lock_clients();
+        abort_streams(cli, "\033[31mConnection closed\033[0m");
+        pthread_mutex_unlock(&clients_mutex);
+        int sockfd = cli->sockfd;
+        if (!detach_session(cli)) {
+            remove_client(cli->uid);
+            release_client(cli);
+        }
+        close_connection(sockfd);
+        if (!coro) pthread_detach(pthread_self());
+    }
+    return NULL;
+}
+
+#ifndef SERVER_NO_MAIN
+#define HANDOFF_SIGNAL SIGUSR2  // Interrumpe las esperas de los threads para que se detengan antes del traspaso
+#define HANDOFF_FLUSH_MS 3000  // Espera total por las colas de salida de todos los clientes (menos que HANDOFF_TIMEOUT_MS)
+
+// Threads que aceptan conexiones: acceptors[0] para el puerto TCP y acceptors[1] para el socket Unix
+typedef struct {
+    int listenfd;
+    pthread_t thread;
+    bool parked;             // Protegido por handoff_mutex
+    client_t *registering;   // Conexión aceptada que todavía no manda su registro (se traspasa tal cual)
+} acceptor_t;
+
+static acceptor_t acceptors[2] = { { .listenfd = -1 }, { .listenfd = -1 } };
+static int controlfd = -1;  // Socket de control del reinicio en caliente (--upgrade-socket)
+
+/*
+Funcion que escribe sin bloquear en la conexión de un cliente (lanes_write_fn), por su socket o su ring.
+Parametros:
+    * const uint8_t *header: header del frame si data es un mensaje, NULL si data son frames completos
+Retornos:
+    * ssize_t: bytes escritos (0 si el socket está lleno) y -1 si la conexión falló
+*/
+static ssize_t write_connection(int sockfd, const uint8_t *header, const uint8_t *data, size_t len) {
+    shm_conn_t *shm = shm_conn_for(sockfd);
+    if (shm) return shm_conn_try_send(shm, header, data, len);
+    struct iovec iov[2];
+    int n_iov = 0;
+    if (header) iov[n_iov++] = (struct iovec){ .iov_base = (void *)header, .iov_len = FRAME_HEADER_SIZE };
+    iov[n_iov++] = (struct iovec){ .iov_base = (void *)data, .iov_len = len };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = n_iov };
+    while (1) {
+        ssize_t sent = sendmsg(sockfd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent >= 0) return sent;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+// coro_worker_start: el worker i queda en el CPU i de --affinity workers
+static void pin_worker(int index) {
+    affinity_pin(AFFINITY_WORKERS, index);
+}
+
+static void client_coroutine(void *arg) {
+    handle_client(arg);
+}
+
+/*
+Funcion que pone a correr el handler de un cliente: como corrutina de un worker o, con --workers 0 (o si no se pudo
+crear la corrutina), en un thread propio.
+Una conexión sin colas de salida (el descriptor no entra en el registro de las colas o no hubo memoria) escribe
+bloqueando, así que también va a un thread: dentro de una corrutina ese envío detendría a todo su worker. Eso se
+cuenta en las métricas y se avisa en el log la primera vez.
+*/
+static void start_client(client_t *cli) {
+    static atomic_bool fallback_logged;
+    if (lanes_for(cli->sockfd) && coro_spawn(&client_coroutine, cli)) return;
+    if (coro_workers() > 0) {
+        metrics_count(METRIC_HANDLER_THREADS, 1);
+        if (!atomic_exchange(&fallback_logged, true)) {
+            printf("\033[31m\n(!) Client on socket %d runs on a thread of its own (no output lanes or no memory for a "
+                   "coroutine); see chat_handler_thread_fallbacks_total\n\033[0m", cli->sockfd);
+        }
+    }
+    pthread_t tid;
+    pthread_create(&tid, NULL, &handle_client, (void *)cli);
+}
+
+static client_t *new_client(int sockfd) {
+    client_t *cli = calloc(1, sizeof(client_t));
+    cli->sockfd = sockfd;
+    cli->conn_id = capture_new_conn();
+    lanes_create(sockfd, &write_connection);
+    frame_out_init(&cli->coalesced);
+    mem_charge(MEM_CLIENTS, sizeof(client_t));
+    return cli;
+}
+
+/*
+Funcion que elige la compresión de una conexión que se registra: deflate si el cliente la puede leer, el servidor
+la tiene habilitada y la conexión no usa memoria compartida (ahí comprimir solo gastaría CPU).
+*/
+static Chat__Compression negotiate_compression(int sockfd, const Chat__NewUserRequest *reg) {
+    if (reg->compression != CHAT__COMPRESSION__COMPRESSION_DEFLATE || compress_min_bytes == 0 ||
+        !fd_in_table(sockfd) || shm_conn_for(sockfd)) {
+        return CHAT__COMPRESSION__COMPRESSION_NONE;
+    }
+    return CHAT__COMPRESSION__COMPRESSION_DEFLATE;
+}
+
+/*
+Funcion que responde un REGISTER_USER aceptado: con la compresión elegida y, si pidió sesión reanudable, con el
+token y lo que se reenvía. La compresión empieza después de esta respuesta, que el cliente lee sin inflar.
+Parametros:
+    * const client_t *cl: cliente registrado
+    * bool resumed: true si se reanudó una sesión existente
+    * uint64_t replayed: mensajes que se reenvían justo después de esta respuesta
+    * uint64_t missed: mensajes que el cliente no recibió y ya salieron de la ventana de reenvío
+    * Chat__Compression compression: compresión de los frames que siguen
+*/
+static void send_registration_response(const client_t *cl, bool resumed, uint64_t replayed, uint64_t missed,
+                                       Chat__Compression compression) {
+    Chat__SessionInfo session = CHAT__SESSION_INFO__INIT;
+    session.token = (char *)cl->session_token;
+    session.resumed = resumed;
+    session.replayed = replayed;
+    session.missed = missed;
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = CHAT__OPERATION__REGISTER_USER;
+    response.status_code = CHAT__STATUS_CODE__OK;
+    response.message = resumed ? "\033[32mSession resumed\033[0m" : "\033[32mRegistration successful\033[0m";
+    if (cl->resumable) {
+        response.result_case = CHAT__RESPONSE__RESULT_SESSION;
+        response.session = &session;
+    }
+    response.compression = compression;
+    size_t len = chat__response__get_packed_size(&response);
+    uint8_t *buffer = malloc(len);
+    chat__response__pack(&response, buffer);
+    send_packed(cl->sockfd, buffer, len);
+    free(buffer);
+    if (fd_in_table(cl->sockfd)) {
+        compressed_conns[cl->sockfd] = compression == CHAT__COMPRESSION__COMPRESSION_DEFLATE;
+    }
+}
+
+/*
+Funcion que registra un usuario nuevo si su nombre no está en uso.
+La verificación y el alta se hacen con el registro bloqueado, porque el puerto TCP y el socket Unix
+aceptan conexiones en threads distintos. La respuesta también sale con el registro bloqueado, para que
+ningún mensaje para el usuario nuevo llegue antes que ella.
+Parametros:
+    * client_t *cli: conexión que se registra
+    * const Chat__NewUserRequest *reg: nombre y, si se pide, sesión reanudable
+Retornos:
+    * bool: true si se registró, false si el nombre ya existe o no hay lugar
+*/
+static bool register_client(client_t *cli, const Chat__NewUserRequest *reg) {
+    cli->uid = -1;
+    if (federation_lookup(reg->username, NULL)) return false;  // Ya está registrado en otro nodo
+    lock_clients();
+    int free_slot = -1;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients[i] && strcmp(clients[i]->name, reg->username) == 0) {
+            pthread_mutex_unlock(&clients_mutex);
+            return false;
+        }
+        if (!clients[i] && free_slot < 0) free_slot = i;
+    }
+    if (free_slot >= 0) {
+        snprintf(cli->name, sizeof(cli->name), "%s", reg->username);
+        cli->uid = uid++;
+        cli->last_active = time(NULL);
+        uint8_t secret[SESSION_TOKEN_LEN / 2];
+        if (reg->resumable && getrandom(secret, sizeof(secret), 0) == sizeof(secret)) {
+            cli->resumable = true;
+            for (size_t i = 0; i < sizeof(secret); i++) {
+                sprintf(cli->session_token + 2 * i, "%02x", secret[i]);
+            }
+            cli->next_sequence = 1;
+            cli->replay_first = 1;
+            frame_buffer_init(&cli->replay);
+        }
+        clients[free_slot] = cli;
+        federation_user_joined(cli->name, cli->status);
+        send_registration_response(cli, false, 0, 0, negotiate_compression(cli->sockfd, reg));
+    }
+    pthread_mutex_unlock(&clients_mutex);
+    return free_slot >= 0;
+}
+
+static client_t *find_session(const char *username, const char *token) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients[i] && clients[i]->resumable && strcmp(clients[i]->name, username) == 0 &&
+            strcmp(clients[i]->session_token, token) == 0) {
+            return clients[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+Funcion que reanuda la sesión de un cliente cuya conexión se cayó: la conexión nueva toma el lugar de la
+anterior en el mismo client_t y recibe los mensajes numerados después del último que el cliente recibió.
+Si la conexión anterior sigue abierta (el cliente notó la caída antes que el servidor) se cierra y se espera
+a que su thread suelte la sesión.
+Parametros:
+    * client_t *carrier: conexión nueva; se libera si la sesión se reanuda
+    * const Chat__NewUserRequest *reg: registro con el token y el último número recibido
+Retornos:
+    * bool: true si se reanudó, false si el token no corresponde a ninguna sesión
+*/
+static bool resume_session(client_t *carrier, const Chat__NewUserRequest *reg) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 5;
+    bool kicked = false;
+    client_t *cl;
+    lock_clients();
+    while ((cl = find_session(reg->username, reg->session_token)) && cl->sockfd >= 0) {
+        if (!kicked) {
+            shutdown(cl->sockfd, SHUT_RDWR);
+            kicked = true;
+        }
+        if (pthread_cond_timedwait(&session_cond, &clients_mutex, &deadline) == ETIMEDOUT) {
+            cl = NULL;
+            break;
+        }
+    }
+    if (!cl) {
+        pthread_mutex_unlock(&clients_mutex);
+        return false;
+    }
+
+    pthread_mutex_lock(&handoff_mutex);
+    cl->sockfd = carrier->sockfd;
+    cl->conn_id = carrier->conn_id;
+    cl->address = carrier->address;
+    cl->started = false;
+    cl->parked = false;
+    pthread_mutex_unlock(&handoff_mutex);
+    cl->last_active = time(NULL);
+    cl->detached_at = 0;
+
+    // Se saltan los mensajes de la ventana que el cliente ya recibió
+    uint64_t from = reg->last_sequence + 1;
+    uint64_t missed = from < cl->replay_first ? cl->replay_first - from : 0;
+    uint64_t seq = cl->replay_first;
+    size_t offset = cl->replay.start;
+    while (seq < from && offset < cl->replay.len) {
+        offset += FRAME_HEADER_SIZE + frame_read_header(cl->replay.data + offset);
+        seq++;
+    }
+    frame_out_t tail = { .data = cl->replay.data + offset, .len = cl->replay.len - offset,
+                         .frames = offset < cl->replay.len ? cl->next_sequence - seq : 0 };
+    send_registration_response(cl, true, tail.frames, missed, negotiate_compression(cl->sockfd, reg));
+    if (tail.frames > 0 && send_packed_frames(cl->sockfd, LANE_BROADCAST, &tail) == 0) {
+        metrics_count(METRIC_MESSAGES_REPLAYED, tail.frames);
+    }
+    metrics_count(METRIC_SESSIONS_RESUMED, 1);
+    printf("\033[32m\n(*) Session resumed: %s (IP: %s), %lu messages replayed, %lu missed\n\033[0m",
+           cl->name, client_host(cl), (unsigned long)tail.frames, (unsigned long)missed);
+    pthread_mutex_unlock(&clients_mutex);
+
+    release_client(carrier);
+    start_client(cl);
+    return true;
+}
+
+/*
+Funcion que responde un REGISTER_USER con el nodo dueño del nombre y cierra la conexión; la librería del cliente
+se vuelve a conectar a ese nodo.
+*/
+static void redirect_connection(client_t *cli, const char *username, const federation_node_t *owner) {
+    Chat__Redirect redirect = CHAT__REDIRECT__INIT;
+    redirect.address = (char *)owner->address;
+    redirect.port = owner->port;
+    redirect.node_id = owner->node_id;
+    char message[192];
+    snprintf(message, sizeof(message), "\n\033[33m(!) %.32s belongs to node %u, reconnect to %s:%d\033[0m",
+             username, owner->node_id, owner->address, owner->port);
+    Chat__Response response = CHAT__RESPONSE__INIT;
+    response.operation = CHAT__OPERATION__REGISTER_USER;
+    response.status_code = CHAT__STATUS_CODE__BAD_REQUEST;
+    response.message = message;
+    response.result_case = CHAT__RESPONSE__RESULT_REDIRECT;
+    response.redirect = &redirect;
+    size_t len = chat__response__get_packed_size(&response);
+    uint8_t *buffer = malloc(len);
+    chat__response__pack(&response, buffer);
+    send_packed(cli->sockfd, buffer, len);
+    free(buffer);
+
+    metrics_count(METRIC_REGISTRATIONS_REDIRECTED, 1);
+    metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+    printf("\033[33m\n(*) %s redirected to node %u\n\033[0m", username, owner->node_id);
+    close_connection(cli->sockfd);
+    release_client(cli);
+}
+
+/*
+Funcion que recibe el registro de una conexión recién aceptada y le asigna su thread, o la cierra.
+Si un reinicio en caliente llega mientras se espera el registro, el acceptor se detiene con la conexión
+pendiente y el proceso nuevo la termina de registrar.
+*/
+static void register_connection(acceptor_t *acc, client_t *cli) {
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    int fds[SHM_RING_FDS];
+    int n_fds;
+    ssize_t len;
+    acc->registering = cli;
+    while ((len = recv_frame_fds(cli->sockfd, &buffer, &capacity, fds, SHM_RING_FDS, &n_fds)) < 0 && errno == EINTR && n_fds == 0) {
+        park_for_handoff(&acc->parked);
+    }
+    acc->registering = NULL;
+    // Un cliente local que manda los descriptores de sus rings con el registro pasa a usar memoria compartida
+    if (n_fds > 0 && !attach_shm(cli->sockfd, fds, n_fds)) {
+        len = -1;
+    }
+    if (len > 0) {
+        metrics_count(METRIC_BYTES_IN, FRAME_HEADER_SIZE + len);
+        capture_request(cli->conn_id, buffer, len);
+        Chat__Request *req = chat__request__unpack(NULL, len, buffer);
+        federation_node_t owner;
+        if (req && req->payload_case == CHAT__REQUEST__PAYLOAD_REGISTER_USER && req->register_user->session_token[0]) {
+            // Reanudar una sesión: si ya expiró el cliente debe registrarse de nuevo; si migró, está en su nodo dueño
+            metrics_count_operation(req->operation);
+            if (resume_session(cli, req->register_user)) {
+                // La conexión quedó con la sesión
+            } else if (federation_redirect(req->register_user->username, &owner)) {
+                redirect_connection(cli, req->register_user->username, &owner);
+            } else {
+                metrics_count(METRIC_REGISTRATIONS_REJECTED, 1);
+                metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+                send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, "\n\033[31m(!) Session expired\033[0m");
+                close_connection(cli->sockfd);
+                release_client(cli);
+            }
+        } else if (req && req->payload_case == CHAT__REQUEST__PAYLOAD_REGISTER_USER &&
+                   federation_redirect(req->register_user->username, &owner)) {
+            // El nombre le toca a otro nodo de la federación
+            metrics_count_operation(req->operation);
+            redirect_connection(cli, req->register_user->username, &owner);
+        } else if (req && req->payload_case == CHAT__REQUEST__PAYLOAD_REGISTER_USER && !mem_admitting()) {
+            // Cerca del presupuesto de memoria no entran usuarios nuevos (las sesiones existentes sí se reanudan)
+            metrics_count_operation(req->operation);
+            metrics_count(METRIC_REGISTRATIONS_REJECTED, 1);
+            metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+            printf("\033[31m\n(!) Registration of %s rejected: memory budget nearly used (%.1f MB)\n\033[0m",
+                   req->register_user->username, mem_used() / (1024.0 * 1024.0));
+            send_response(cli->sockfd, CHAT__STATUS_CODE__INTERNAL_SERVER_ERROR, "\n\033[31m(!) Server is at capacity, try again later\033[0m");
+            close_connection(cli->sockfd);
+            release_client(cli);
+        } else if (req && req->payload_case == CHAT__REQUEST__PAYLOAD_REGISTER_USER) {
+            metrics_count_operation(req->operation);
+            bool accepted = register_client(cli, req->register_user);
+            CHAT_PROBE3(register, cli->uid, req->register_user->username, accepted);
+            if (accepted) {
+                metrics_count(METRIC_REGISTRATIONS, 1);
+                printf("\033[32m\n(*) New connection: %s (IP: %s)\n\033[0m", cli->name, client_host(cli));
+                start_client(cli);
+            } else {
+                metrics_count(METRIC_REGISTRATIONS_REJECTED, 1);
+                metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+                send_response(cli->sockfd, CHAT__STATUS_CODE__BAD_REQUEST, "\n\033[31m(!) User is already connected\033[0m");
+                close_connection(cli->sockfd);
+                release_client(cli);
+            }
+        } else {
+            // La primera solicitud de una conexión debe ser el registro
+            metrics_count(req ? METRIC_REGISTRATIONS_REJECTED : METRIC_DECODE_ERRORS, 1);
+            metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+            close_connection(cli->sockfd);
+            release_client(cli);
+        }
+        chat__request__free_unpacked(req, NULL);
+    } else {
+        metrics_count(METRIC_CONNECTIONS_CLOSED, 1);
+        close_connection(cli->sockfd);
+        release_client(cli);
+    }
+    free(buffer);
+}
+
+/*
+Funcion que acepta conexiones de un socket que escucha (TCP o Unix) y registra a cada usuario.
+Corre en el thread principal para el puerto TCP y en su propio thread para el socket Unix.
+Parametros:
+    * void *arg: acceptor_t con el socket que escucha
+*/
+static void *accept_clients(void *arg) {
+    acceptor_t *acc = (acceptor_t *)arg;
+    affinity_pin(AFFINITY_IO, -1);
+    while (1) {
+        if (atomic_load(&handoff_pending)) park_for_handoff(&acc->parked);
+        // Una conexión heredada de un reinicio en caliente que todavía no se registra va primero
+        client_t *cli = acc->registering;
+        if (cli) {
+            register_connection(acc, cli);
+            continue;
+        }
+
+        struct sockaddr_storage peer;
+        socklen_t peer_len = sizeof(peer);
+        int sockfd = accept(acc->listenfd, (struct sockaddr*)&peer, &peer_len);
+        if (sockfd < 0) {
+            if (errno != EINTR) perror("Accept failed");
+            continue;
+        }
+        cli = new_client(sockfd);
+        // Los clientes del socket Unix no tienen IP: se marcan con la familia AF_UNIX
+        if (peer.ss_family == AF_INET) {
+            memcpy(&cli->address, &peer, sizeof(cli->address));
+        } else {
+            cli->address.sin_family = AF_UNIX;
+        }
+        metrics_count(METRIC_CONNECTIONS_ACCEPTED, 1);
+        CHAT_PROBE1(accept, cli->sockfd);
+        register_connection(acc, cli);
+    }
+
+    return NULL;
+}
+
+static void handoff_signal(int sig) {
+    (void)sig;  // Solo interrumpe la llamada bloqueante en curso
+}
+
+/*
+Funcion que detiene todos los threads que leen sockets: los de cada cliente y los acceptors.
+Cada thread se detiene solo entre dos frames; la señal se repite hasta que todos lo hagan, porque puede
+llegar justo antes de que el thread entre a esperar.
+Retornos:
+    * bool: true con clients_mutex bloqueado si todos se detuvieron, false si alguno no lo hizo a tiempo
+*/
+static bool park_everyone(void) {
+    atomic_store(&handoff_pending, true);
+    uint64_t deadline = metrics_now() + HANDOFF_TIMEOUT_MS * 1000000ull;
+    while (1) {
+        int running = 0;
+        lock_clients();
+        pthread_mutex_lock(&handoff_mutex);
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            client_t *cl = clients[i];
+            if (!cl || cl->parked || cl->sockfd < 0) continue;  // Las sesiones sin conexión no tienen thread
+            running++;
+            if (cl->started && cl->coro) {
+                coro_interrupt(cl->coro);
+            } else if (cl->started) {
+                pthread_kill(cl->thread, HANDOFF_SIGNAL);
+            }
+        }
+        for (int i = 0; i < 2; i++) {
+            if (acceptors[i].listenfd < 0 || acceptors[i].parked) continue;
+            running++;
+            pthread_kill(acceptors[i].thread, HANDOFF_SIGNAL);
+        }
+        pthread_mutex_unlock(&handoff_mutex);
+        if (running == 0) return true;
+        pthread_mutex_unlock(&clients_mutex);
+        if (metrics_now() > deadline) return false;
+        usleep(1000);
+    }
+}
+
+static void resume_everyone(void) {
+    lock_clients();
+    pthread_mutex_lock(&handoff_mutex);
+    atomic_store(&handoff_pending, false);
+    pthread_cond_broadcast(&handoff_cond);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] && clients[i]->parked && clients[i]->coro) coro_interrupt(clients[i]->coro);
+    }
+    pthread_mutex_unlock(&handoff_mutex);
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+/*
+Funcion que envía un cliente (registrado o todavía registrándose) con su socket y sus rings.
+Parametros:
+    * uint64_t flush_deadline: metrics_now() hasta el que se espera a que salgan las colas de salida, compartido por
+      todo el traspaso; después las colas que queden se descartan sin esperar
+*/
+static int send_client(int fd, const client_t *cl, int acceptor, uint64_t flush_deadline) {
+    handoff_record_t rec;
+    handoff_record_init(&rec, HANDOFF_CLIENT);
+    rec.uid = acceptor < 0 ? cl->uid : -1;
+    rec.status = acceptor < 0 ? (int32_t)cl->status : acceptor;
+    rec.last_active = cl->last_active;
+    rec.addr = cl->address.sin_addr.s_addr;
+    rec.port = cl->address.sin_port;
+    rec.family = cl->address.sin_family;
+    memcpy(rec.name, cl->name, sizeof(rec.name));
+
+    size_t replay_len = 0;
+    if (acceptor < 0 && cl->resumable) {
+        rec.flags |= HANDOFF_CLIENT_SESSION;
+        memcpy(rec.session_token, cl->session_token, sizeof(cl->session_token));
+        rec.detached_at = cl->detached_at;
+        replay_len = cl->replay.len - cl->replay.start;
+        // Una ventana que no cabe en un frame (un solo mensaje enorme) no se traspasa
+        rec.next_sequence = cl->next_sequence;
+        rec.replay_first = replay_len <= FRAME_MAX_SIZE ? cl->replay_first : cl->next_sequence;
+        rec.replay_len = replay_len <= FRAME_MAX_SIZE ? replay_len : 0;
+    }
+
+    // El proceso nuevo no tiene las colas de este: lo pendiente sale antes de entregar el socket
+    // Las colas de todos se vacían a la vez en el flusher, así que esperar una tras otra no suma sus tiempos
+    lanes_t *lanes = lanes_for(cl->sockfd);
+    uint64_t now = metrics_now();
+    int remaining_ms = flush_deadline > now ? (int)((flush_deadline - now + 999999) / 1000000) : 0;
+    if (lanes && lanes_flush(lanes, remaining_ms) != 0) {
+        fprintf(stderr, "Hot restart: output of %s not flushed, pending messages dropped\n", cl->name);
+    }
+
+    int fds[HANDOFF_MAX_FDS] = { cl->sockfd };
+    int n_fds = 1;
+    shm_conn_t *shm = shm_conn_for(cl->sockfd);
+    if (cl->sockfd < 0) {
+        rec.flags |= HANDOFF_CLIENT_DETACHED;
+        n_fds = 0;
+    } else if (shm) {
+        rec.flags |= HANDOFF_CLIENT_SHM;
+        memcpy(fds + 1, shm->fds, sizeof(shm->fds));
+        n_fds += SHM_RING_FDS;
+    } else if (fd_in_table(cl->sockfd) && compressed_conns[cl->sockfd]) {
+        rec.flags |= HANDOFF_CLIENT_COMPRESSED;
+    }
+    int rc = handoff_send(fd, &rec, fds, n_fds);
+    if (rc == 0 && rec.replay_len > 0) {
+        rc = send_frame(fd, cl->replay.data + cl->replay.start, rec.replay_len);
+    }
+    return rc;
+}
+
+/*
+Funcion que copia la ventana de reenvío de una sesión que llega de otro proceso (reinicio en caliente o migración).
+Parametros:
+    * const uint8_t *data: INCOMING_MESSAGE numerados, cada uno con su header de frame
+    * uint64_t expected: mensajes que indica la numeración de la sesión
+Retornos:
+    * bool: true si cada mensaje es un frame completo y son tantos como los esperados
+*/
+static bool load_replay(client_t *cli, const uint8_t *data, size_t len, uint64_t expected) {
+    frame_buffer_init(&cli->replay);
+    if (len > 0) {
+        uint8_t *window = frame_buffer_reserve(&cli->replay, len);
+        if (!window) return false;
+        memcpy(window, data, len);
+    }
+    uint64_t frames = 0;
+    const uint8_t *payload;
+    size_t payload_len;
+    frame_buffer_t walk = cli->replay;
+    while (frame_buffer_next(&walk, &payload, &payload_len)) {
+        frame_buffer_consume(&walk, FRAME_HEADER_SIZE + payload_len);
+        frames++;
+    }
+    return walk.start == walk.len && frames == expected;
+}
+
+/*
+Funcion que recibe la ventana de reenvío de una sesión traspasada y verifica que tenga los mensajes anunciados.
+Retornos:
+    * bool: true si la ventana es válida
+*/
+static bool receive_replay(int fd, client_t *cli, const handoff_record_t *rec) {
+    frame_buffer_init(&cli->replay);
+    if (rec->replay_len == 0) return rec->replay_first == rec->next_sequence;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    ssize_t len = recv_frame(fd, &buffer, &capacity);
+    bool valid = len == (ssize_t)rec->replay_len && load_replay(cli, buffer, len, rec->next_sequence - rec->replay_first);
+    free(buffer);
+    return valid;
+}
+
+/*
+Funcion que entrega los sockets y los clientes al proceso nuevo conectado al socket de control.
+Retornos:
+    * int: 0 si el proceso nuevo confirmó (se retorna con clients_mutex bloqueado), -1 si se canceló
+*/
+static int hand_over(int fd) {
+    if (!park_everyone()) {
+        resume_everyone();
+        return -1;
+    }
+    // Lo pendiente de la ventana de coalescencia sale antes de soltar los sockets
+    flush_all_coalesced();
+    // El proceso nuevo no sabe qué streams estaban abiertos: se cortan aquí, con los threads detenidos
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) abort_streams(clients[i], "\033[31mServer restarting, stream dropped\033[0m");
+    }
+
+    handoff_record_t rec;
+    handoff_record_init(&rec, HANDOFF_LISTENERS);
+    rec.uid = uid;
+    int fds[HANDOFF_MAX_FDS];
+    int n_fds = 0;
+    if (acceptors[0].listenfd >= 0) {
+        rec.flags |= HANDOFF_LISTEN_TCP;
+        fds[n_fds++] = acceptors[0].listenfd;
+    }
+    if (acceptors[1].listenfd >= 0) {
+        rec.flags |= HANDOFF_LISTEN_UNIX;
+        fds[n_fds++] = acceptors[1].listenfd;
+    }
+    rec.flags |= HANDOFF_LISTEN_CONTROL;
+    fds[n_fds++] = controlfd;
+    int rc = handoff_send(fd, &rec, fds, n_fds);
+
+    int count = 0;
+    uint64_t flush_deadline = metrics_now() + HANDOFF_FLUSH_MS * 1000000ull;
+    for (int i = 0; i < MAX_CLIENTS && rc == 0; i++) {
+        if (!clients[i]) continue;
+        rc = send_client(fd, clients[i], -1, flush_deadline);
+        count++;
+    }
+    for (int i = 0; i < 2 && rc == 0; i++) {
+        if (!acceptors[i].registering) continue;
+        rc = send_client(fd, acceptors[i].registering, i, flush_deadline);
+        count++;
+    }
+    if (rc == 0) {
+        handoff_record_init(&rec, HANDOFF_END);
+        rec.uid = count;
+        rc = handoff_send(fd, &rec, NULL, 0);
+    }
+    if (rc == 0) {
+        rc = handoff_recv(fd, &rec, HANDOFF_ACK, fds, &n_fds, HANDOFF_TIMEOUT_MS);
+    }
+    if (rc != 0) {
+        pthread_mutex_unlock(&clients_mutex);
+        resume_everyone();
+        return -1;
+    }
+    printf("\033[33m\n(*) Hot restart: %d connections handed over, exiting\n\033[0m", count);
+    return 0;
+}
+
+/*
+Thread que atiende el socket de control: cada proceso nuevo que se conecta recibe todo el estado.
+Si el traspaso falla (el proceso nuevo murió o tardó demasiado) este proceso sigue atendiendo como si nada.
+*/
+static void *serve_handoffs(void *arg) {
+    (void)arg;
+    affinity_pin(AFFINITY_IO, -1);
+    while (1) {
+        int fd = accept(controlfd, NULL, NULL);
+        if (fd < 0) continue;
+        handoff_record_t hello;
+        int fds[HANDOFF_MAX_FDS];
+        int n_fds;
+        if (!handoff_peer_allowed(fd) || handoff_recv(fd, &hello, HANDOFF_HELLO, fds, &n_fds, HANDOFF_TIMEOUT_MS) != 0) {
+            close(fd);
+            continue;
+        }
+        printf("\033[33m\n(*) Hot restart requested, handing over connections\n\033[0m");
+        if (hand_over(fd) == 0) {
+            capture_flush();
+            fflush(stdout);
+            _exit(0);
+        }
+        printf("\033[31m\n(!) Hot restart aborted, still serving\n\033[0m");
+        close(fd);
+    }
+    return NULL;
+}
+
+/*
+Funcion que toma los sockets y los clientes de un servidor en ejecución (reinicio en caliente).
+Los clientes quedan en clients[] y las conexiones sin registrar en su acceptor; sus threads se crean después.
+Si algo falla este proceso debe terminar: el anterior ve la conexión cerrada y sigue atendiendo.
+Parametros:
+    * const char *path: socket de control del servidor en ejecución
+    * int *listenfd, int *unixfd: sockets que escuchan recibidos (-1 si el proceso anterior no tenía)
+Retornos:
+    * int: conexión de control, que se cierra cuando el proceso anterior termina; -1 si falló
+*/
+static int take_over(const char *path, int *listenfd, int *unixfd) {
+    int fd = handoff_connect(path);
+    if (fd < 0) return -1;
+
+    handoff_record_t rec;
+    int fds[HANDOFF_MAX_FDS];
+    int n_fds;
+    if (handoff_recv(fd, &rec, HANDOFF_LISTENERS, fds, &n_fds, HANDOFF_TIMEOUT_MS) != 0) return -1;
+    int expected = __builtin_popcount(rec.flags & (HANDOFF_LISTEN_TCP | HANDOFF_LISTEN_UNIX | HANDOFF_LISTEN_CONTROL));
+    if (n_fds != expected || !(rec.flags & HANDOFF_LISTEN_CONTROL)) return -1;
+    int k = 0;
+    *listenfd = rec.flags & HANDOFF_LISTEN_TCP ? fds[k++] : -1;
+    *unixfd = rec.flags & HANDOFF_LISTEN_UNIX ? fds[k++] : -1;
+    controlfd = fds[k];
+    uid = rec.uid;
+
+    int count = 0;
+    int slot = 0;
+    while (1) {
+        if (handoff_recv(fd, &rec, HANDOFF_CLIENT, fds, &n_fds, HANDOFF_TIMEOUT_MS) != 0) return -1;
+        if (rec.kind == HANDOFF_END) break;
+        count++;
+        int expected_fds = rec.flags & HANDOFF_CLIENT_DETACHED ? 0 : rec.flags & HANDOFF_CLIENT_SHM ? 1 + SHM_RING_FDS : 1;
+        if (n_fds != expected_fds) return -1;
+
+        client_t *cli = new_client(n_fds > 0 ? fds[0] : -1);
+        if (rec.flags & HANDOFF_CLIENT_SHM && !attach_shm(cli->sockfd, fds + 1, SHM_RING_FDS)) return -1;
+        // El cliente lee frames comprimidos y sin comprimir, así que con --compress-min 0 basta con dejar de comprimir
+        if (rec.flags & HANDOFF_CLIENT_COMPRESSED && fd_in_table(cli->sockfd)) compressed_conns[cli->sockfd] = true;
+        if (rec.flags & HANDOFF_CLIENT_SESSION) {
+            if (rec.uid < 0 || rec.replay_first > rec.next_sequence || !receive_replay(fd, cli, &rec)) return -1;
+            cli->resumable = true;
+            memcpy(cli->session_token, rec.session_token, sizeof(cli->session_token));
+            cli->session_token[SESSION_TOKEN_LEN] = '\0';
+            cli->next_sequence = rec.next_sequence;
+            cli->replay_first = rec.replay_first;
+            cli->detached_at = rec.detached_at;
+            account_client(cli);
+        } else if (rec.flags & HANDOFF_CLIENT_DETACHED) {
+            return -1;
+        }
+        cli->uid = rec.uid;
+        cli->status = rec.status;
+        cli->last_active = rec.last_active;
+        cli->address.sin_family = rec.family;
+        cli->address.sin_addr.s_addr = rec.addr;
+        cli->address.sin_port = rec.port;
+        memcpy(cli->name, rec.name, sizeof(cli->name));
+        cli->name[sizeof(cli->name) - 1] = '\0';
+        if (rec.uid < 0) {
+            // Conexión que aún no se registraba: la termina el acceptor equivalente
+            if (rec.status < 0 || rec.status > 1 || acceptors[rec.status].registering) return -1;
+            acceptors[rec.status].registering = cli;
+            continue;
+        }
+        if (rec.status < ACTIVO || rec.status > INACTIVO) return -1;
+        while (slot < MAX_CLIENTS && clients[slot]) slot++;
+        if (slot == MAX_CLIENTS) return -1;
+        clients[slot] = cli;
+    }
+    if (rec.uid != count) return -1;
+
+    handoff_record_init(&rec, HANDOFF_ACK);
+    if (handoff_send(fd, &rec, NULL, 0) != 0) return -1;
+    return fd;
+}
+
+/*
+Funciones que la federación usa para entregar a los usuarios de este nodo lo que llega de los demás nodos,
+y para anunciarles los usuarios de este nodo cuando se abre un enlace.
+*/
+static void federation_deliver_broadcast(const char *sender, const char *content) {
+    broadcast_message(sender, codec_str(content));
+}
+
+static void federation_deliver_direct(const char *sender, const char *recipient, const char *content) {
+    codec_incoming_message_t msg = {
+        .status_code = CHAT__STATUS_CODE__OK,
+        .sender = codec_str(sender),
+        .content = codec_str(content),
+        .type = CHAT__MESSAGE_TYPE__DIRECT
+    };
+    uint8_t local[PACK_STACK_SIZE];
+    size_t len;
+    uint8_t *buf = pack_incoming_message(&msg, local, sizeof(local), &len);
+
+    lock_clients();
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] && strcmp(clients[i]->name, recipient) == 0) {
+            if (clients[i]->status != INACTIVO) {
+                size_t out_len = len;
+                const uint8_t *out = session_stamp(clients[i], buf, &out_len);
+                if (out && send_packed_lane(clients[i]->sockfd, direct_lane(clients[i]), out, out_len) == 0) {
+                    metrics_count(METRIC_MESSAGES_DELIVERED, 1);
+                }
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&clients_mutex);
+    if (buf != local) free(buf);
+}
+
+static void federation_local_users(void (*emit)(void *ctx, const char *username, int status), void *ctx) {
+    lock_clients();
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) emit(ctx, clients[i]->name, clients[i]->status);
+    }
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+/*
+Funcion que entrega a su nuevo dueño cada sesión reanudable cuyo nombre ahora es de otro nodo.
+Las conexiones sin sesión se quedan en este nodo hasta que se cierran: no hay cómo moverlas sin perder mensajes.
+*/
+static void federation_rebalance(void) {
+    lock_clients();
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        client_t *cl = clients[i];
+        if (!cl || !cl->resumable) continue;
+        federation_session_t session = {
+            .username = cl->name,
+            .status = cl->status,
+            .session_token = cl->session_token,
+            .next_sequence = cl->next_sequence,
+            .replay_first = cl->replay_first,
+            .replay = cl->replay.data + cl->replay.start,
+            .replay_len = cl->replay.len - cl->replay.start
+        };
+        uint32_t node_id;
+        if (!federation_migrate(&session, &node_id)) continue;
+
+        metrics_count(METRIC_SESSIONS_MIGRATED, 1);
+        printf("\033[33m\n(*) Session of %s migrated to node %u\n\033[0m", cl->name, node_id);
+        federation_user_left(cl->name);
+        clients[i] = NULL;
+        frame_out_reset(&cl->coalesced);  // Ya están numerados en la ventana que se llevó el otro nodo
+        if (cl->sockfd >= 0) {
+            // Su thread termina y lo libera; el cliente se reconecta y lo redirigen al nuevo dueño
+            cl->migrated = true;
+            shutdown(cl->sockfd, SHUT_RDWR);
+        } else {
+            release_client(cl);
+        }
+    }
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+/*
+Funcion que recibe una sesión migrada desde otro nodo. Queda sin conexión, como una sesión cuyo cliente se
+desconectó, hasta que el cliente la reanude con su token.
+*/
+static void federation_adopt_session(const federation_session_t *session) {
+    client_t *cl = new_client(-1);
+    bool valid = strlen(session->username) > 0 && strlen(session->username) < sizeof(cl->name) &&
+                 strlen(session->session_token) == SESSION_TOKEN_LEN &&
+                 session->status >= ACTIVO && session->status <= INACTIVO &&
+                 session->replay_first > 0 && session->replay_first <= session->next_sequence &&
+                 load_replay(cl, session->replay, session->replay_len, session->next_sequence - session->replay_first);
+    bool adopted = false;
+    lock_clients();
+    int slot = -1;
+    for (int i = 0; valid && i < MAX_CLIENTS; i++) {
+        if (clients[i] && strcmp(clients[i]->name, session->username) == 0) {
+            valid = false;
+        } else if (!clients[i] && slot < 0) {
+            slot = i;
+        }
+    }
+    if (valid && slot >= 0) {
+        snprintf(cl->name, sizeof(cl->name), "%s", session->username);
+        cl->uid = uid++;
+        cl->status = session->status;
+        cl->resumable = true;
+        snprintf(cl->session_token, sizeof(cl->session_token), "%s", session->session_token);
+        cl->next_sequence = session->next_sequence;
+        cl->replay_first = session->replay_first;
+        cl->last_active = cl->detached_at = time(NULL);
+        account_client(cl);
+        clients[slot] = cl;
+        federation_user_joined(cl->name, cl->status);
+        adopted = true;
+        printf("\033[32m\n(*) Session of %s migrated here, %lu messages waiting\n\033[0m",
+               cl->name, (unsigned long)(cl->next_sequence - cl->replay_first));
+    }
+    pthread_mutex_unlock(&clients_mutex);
+    if (!adopted) {
+        printf("\033[31m\n(!) Migrated session of %.32s rejected\n\033[0m", session->username);
+        release_client(cl);
+    }
+}
+
+static const char *snapshot_path = NULL;  // --snapshot
+static unsigned snapshot_interval = SNAPSHOT_INTERVAL;
+
+/*
+Funcion que guarda en snapshot_path las sesiones reanudables y el siguiente uid.
+Las ventanas se copian con clients_mutex bloqueado; el archivo se escribe después, sin bloquear a nadie.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escribir
+*/
+static int save_snapshot(void) {
+    snapshot_t snap;
+    lock_clients();
+    snapshot_begin(&snap, uid);
+    int rc = 0;
+    for (int i = 0; i < MAX_CLIENTS && rc == 0; i++) {
+        client_t *cl = clients[i];
+        if (!cl || !cl->resumable) continue;
+        snapshot_session_t rec = {
+            .uid = cl->uid,
+            .status = cl->status,
+            .last_active = cl->last_active,
+            .detached_at = cl->detached_at,
+            .next_sequence = cl->next_sequence,
+            .replay_first = cl->replay_first,
+            .flags = cl->sockfd < 0 ? SNAPSHOT_SESSION_DETACHED : 0
+        };
+        memcpy(rec.name, cl->name, sizeof(cl->name));
+        memcpy(rec.session_token, cl->session_token, sizeof(cl->session_token));
+        rc = snapshot_add(&snap, &rec, cl->replay.data + cl->replay.start, cl->replay.len - cl->replay.start);
+    }
+    pthread_mutex_unlock(&clients_mutex);
+    if (rc != 0) {
+        snapshot_discard(&snap);
+        return -1;
+    }
+    return snapshot_commit(&snap, snapshot_path);
+}
+
+/*
+Thread que toma un snapshot cada snapshot_interval segundos.
+*/
+static void *snapshot_writer(void *arg) {
+    (void)arg;
+    affinity_pin(AFFINITY_LOGGER, -1);
+    bool failing = false;
+    while (1) {
+        sleep(snapshot_interval);
+        bool failed = save_snapshot() != 0;
+        if (failed && !failing) {
+            printf("\033[31m\n(!) Snapshot: can't write %s: %s\n\033[0m", snapshot_path, strerror(errno));
+        }
+        failing = failed;
+    }
+    return NULL;
+}
+
+/*
+Funcion que carga el snapshot al arrancar en frío, antes de crear cualquier thread. Cada sesión vuelve sin conexión,
+como si el cliente se hubiera desconectado cuando se tomó el snapshot (o antes, si ya estaba desconectado), y expira
+igual que siempre si no se reanuda en SESSION_RESUME_TIMEOUT.
+*/
+static void restore_snapshot(void) {
+    uint64_t started = metrics_now();
+    snapshot_map_t map;
+    if (snapshot_open(snapshot_path, &map) != 0) {
+        if (errno == ENOENT) {
+            printf("\033[33mSnapshot: %s not found, starting empty\n\033[0m", snapshot_path);
+        } else {
+            printf("\033[31m(!) Snapshot: %s is not valid (%s), starting empty\n\033[0m", snapshot_path, strerror(errno));
+        }
+        return;
+    }
+    time_t now = time(NULL);
+    int restored = 0;
+    int expired = 0;
+    int slot = 0;
+    for (uint32_t i = 0; i < map.header->n_sessions && slot < MAX_CLIENTS; i++) {
+        const snapshot_session_t *rec = &map.sessions[i];
+        time_t detached_at = rec->flags & SNAPSHOT_SESSION_DETACHED ? rec->detached_at : map.header->created_at;
+        if (difftime(now, detached_at) > SESSION_RESUME_TIMEOUT) {
+            expired++;
+            continue;
+        }
+        client_t *cli = new_client(-1);
+        bool valid = memchr(rec->name, '\0', sizeof(cli->name)) && rec->name[0] &&
+                     strnlen(rec->session_token, sizeof(rec->session_token)) == SESSION_TOKEN_LEN &&
+                     rec->status >= ACTIVO && rec->status <= INACTIVO && rec->uid >= 0 &&
+                     rec->replay_first > 0 && rec->replay_first <= rec->next_sequence &&
+                     load_replay(cli, snapshot_replay(&map, rec), rec->replay_len, rec->next_sequence - rec->replay_first);
+        if (!valid) {
+            release_client(cli);
+            continue;
+        }
+        memcpy(cli->name, rec->name, sizeof(cli->name));
+        memcpy(cli->session_token, rec->session_token, SESSION_TOKEN_LEN);
+        cli->uid = rec->uid;
+        cli->status = rec->status;
+        cli->last_active = rec->last_active;
+        cli->resumable = true;
+        cli->next_sequence = rec->next_sequence;
+        cli->replay_first = rec->replay_first;
+        cli->detached_at = detached_at;
+        account_client(cli);
+        clients[slot++] = cli;
+        restored++;
+    }
+    if (map.header->next_uid > uid) uid = map.header->next_uid;
+    snapshot_close(&map);
+    printf("\033[32mSnapshot: restored %d sessions (%d expired) from %s in %.2f ms\n\033[0m",
+           restored, expired, snapshot_path, (metrics_now() - started) / 1e6);
+}
+
+static sigset_t stop_signals;  // SIGTERM y SIGINT, bloqueadas en todos los threads si hay que hacer algo antes de salir
+
+/*
+Funcion del thread que espera SIGTERM o SIGINT: un nodo federado deja la federación entregando sus sesiones,
+con --snapshot se guarda un último snapshot y con --capture se escribe lo que queda de la captura antes de terminar.
+*/
+static void *stop_on_signal(void *arg) {
+    (void)arg;
+    int sig;
+    sigwait(&stop_signals, &sig);
+    if (federation_node_id > 0) {
+        printf("\033[33m\n(*) Federation: node %u leaving, handing over sessions\n\033[0m", federation_node_id);
+        federation_leave();
+    }
+    if (snapshot_path && save_snapshot() != 0) {
+        printf("\033[31m\n(!) Snapshot: can't write %s: %s\n\033[0m", snapshot_path, strerror(errno));
+    }
+    capture_flush();
+    exit(0);
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s <port> [--stats-port <port>] [--stats-socket <path>] [--codec native|protobuf-c] [--coalesce-us <us>] [--coalesce-max-us <us>] [--unix <path|@name>] [--upgrade-socket <path|@name>] [--takeover <path|@name>] [--rate-limit <kind>=<per second>[/<burst>]]... [--memory-budget <MB>] [--node-id <id> --node-port <port> [--peer <id>@<IP>:<port>]...] [--snapshot <path> [--snapshot-interval <s>]] [--capture <path>] [--compress-min <bytes>] [--workers <n>] [--no-offload] [--affinity <workers|io|timer|logger>=<cpus>]...\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int port = atoi(argv[1]);
+    int stats_port = 0;
+    const char *stats_socket = NULL;
+    const char *unix_path = NULL;
+    const char *upgrade_path = NULL;
+    const char *takeover_path = NULL;
+    const char *capture_path = NULL;
+    int node_port = 0;
+    int n_peers = 0;
+
+    static struct option long_options[] = {
+        {"stats-port", required_argument, NULL, 'm'},
+        {"stats-socket", required_argument, NULL, 'M'},
+        {"codec", required_argument, NULL, 'c'},
+        {"coalesce-us", required_argument, NULL, 'w'},
+        {"coalesce-max-us", required_argument, NULL, 'W'},
+        {"unix", required_argument, NULL, 'u'},
+        {"upgrade-socket", required_argument, NULL, 'g'},
+        {"takeover", required_argument, NULL, 't'},
+        {"rate-limit", required_argument, NULL, 'r'},
+        {"memory-budget", required_argument, NULL, 'b'},
+        {"node-id", required_argument, NULL, 'n'},
+        {"node-port", required_argument, NULL, 'N'},
+        {"peer", required_argument, NULL, 'p'},
+        {"snapshot", required_argument, NULL, 's'},
+        {"snapshot-interval", required_argument, NULL, 'S'},
+        {"capture", required_argument, NULL, 'C'},
+        {"compress-min", required_argument, NULL, 'z'},
+        {"workers", required_argument, NULL, 'k'},
+        {"no-offload", no_argument, NULL, 'O'},
+        {"affinity", required_argument, NULL, 'a'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt_char;
+    optind = 2;
+    while ((opt_char = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt_char) {
+            case 'm': stats_port = atoi(optarg); break;
+            case 'M': stats_socket = optarg; break;
+            case 'c':
+                if (codec_kind_parse(optarg, &server_codec) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'w': coalesce_window_us = strtoul(optarg, NULL, 10); break;
+            case 'W': coalesce_max_delay_us = strtoul(optarg, NULL, 10); break;
+            case 'u': unix_path = optarg; break;
+            case 'g': upgrade_path = optarg; break;
+            case 'b': mem_budget = strtoull(optarg, NULL, 10) * 1024 * 1024; break;
+            case 'r':
+                if (rate_limit_parse(optarg) != 0) {
+                    fprintf(stderr, "Invalid rate limit '%s' (use <broadcast|direct|status|users|batch|multicast>=<per second>[/<burst>])\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't': takeover_path = optarg; break;
+            case 'n': federation_node_id = strtoul(optarg, NULL, 10); break;
+            case 'N': node_port = atoi(optarg); break;
+            case 'p':
+                if (federation_add_peer(optarg) != 0) {
+                    fprintf(stderr, "Invalid peer '%s' (use <node id>@<IPv4>:<node port>, at most %d)\n", optarg, FEDERATION_MAX_PEERS);
+                    return 1;
+                }
+                n_peers++;
+                break;
+            case 's': snapshot_path = optarg; break;
+            case 'S': snapshot_interval = strtoul(optarg, NULL, 10); break;
+            case 'C': capture_path = optarg; break;
+            case 'z': compress_min_bytes = strtoul(optarg, NULL, 10); break;
+            case 'k': handler_workers = atoi(optarg); break;
+            case 'O': offload_requests = false; break;
+            case 'a':
+                if (affinity_parse(optarg) != 0) {
+                    fprintf(stderr, "Invalid affinity '%s' (use <workers|io|timer|logger>=<cpu>[-<cpu>][,...])\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((n_peers > 0 || node_port > 0 || federation_node_id > 0) && (federation_node_id == 0 || node_port <= 0)) {
+        fprintf(stderr, "Federation needs both --node-id (1 or more, unique in the cluster) and --node-port\n");
+        return 1;
+    }
+    if (snapshot_path && snapshot_interval == 0) {
+        fprintf(stderr, "--snapshot-interval must be at least 1 second\n");
+        return 1;
+    }
+    if (federation_node_id > 0 || snapshot_path || capture_path) {
+        // Antes de crear cualquier thread, para que solo stop_on_signal reciba estas señales
+        sigemptyset(&stop_signals);
+        sigaddset(&stop_signals, SIGTERM);
+        sigaddset(&stop_signals, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    }
+    if (coalesce_window_us > 0 && coalesce_max_delay_us == 0) {
+        coalesce_max_delay_us = 4 * coalesce_window_us;
+    }
+
+    for (int role = 0; role < AFFINITY_ROLES; role++) {
+        // Antes de crear los threads: un worker fijo en un CPU que no existe correría en cualquiera sin avisar
+        int cpu = affinity_unavailable(role);
+        if (cpu >= 0) {
+            fprintf(stderr, "Can't pin %s threads to CPU %d (not available to this process)\n", affinity_role_name(role), cpu);
+            return 1;
+        }
+    }
+
+    // Los threads de otros módulos heredan la máscara del rol con el que se crean
+    affinity_enter(AFFINITY_LOGGER);
+    if (capture_path && capture_start(capture_path) != 0) {
+        perror("Server: can't create capture file");
+        exit(1);
+    }
+    affinity_leave();
+    // Las tablas indexadas por socket cubren todo descriptor que el proceso pueda abrir
+    size_t fd_limit = transport_fd_limit(FD_TABLE_MAX);
+    shm_conns = calloc(fd_limit, sizeof(shm_conn_t *));
+    compressed_conns = calloc(fd_limit, sizeof(bool));
+    if (!shm_conns || !compressed_conns) {
+        perror("Server: can't allocate the connection tables");
+        exit(1);
+    }
+    fd_table_size = fd_limit;
+    // Sin el flusher las conexiones no tienen colas por prioridad y escriben bloqueando
+    affinity_enter(AFFINITY_IO);
+    if (lanes_start(fd_limit) != 0) {
+        perror("Server: can't start the output lanes");
+        handler_workers = 0;  // Sin colas un envío bloquea, y en una corrutina bloquearía a todo su worker
+    }
+    affinity_leave();
+    // Los handlers de los clientes corren como corrutinas sobre unos pocos workers; sin ellos, un thread por conexión.
+    // Con CPUs para los workers, por defecto hay uno en cada uno, y cada worker queda fijo en el suyo
+    if (handler_workers < 0) {
+        handler_workers = affinity_cpus(AFFINITY_WORKERS) > 0 ? affinity_cpus(AFFINITY_WORKERS) : sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    coro_worker_start = pin_worker;
+    if (handler_workers > 0) {
+        if (coro_start(handler_workers) == 0) {
+            frame_wait = coro_poll;
+        } else {
+            perror("Server: can't start the coroutine workers");
+        }
+    }
+
+    // Reinicio en caliente: los sockets que escuchan y los clientes vienen del proceso en ejecución
+    int listenfd = -1;
+    int unixfd = -1;
+    int handoff_fd = -1;
+    if (takeover_path && (handoff_fd = take_over(takeover_path, &listenfd, &unixfd)) < 0) {
+        perror("Server: hot restart failed");
+        exit(1);
+    }
+    // Arranque en frío: las sesiones vuelven del último snapshot (en un reinicio en caliente ya llegaron con el traspaso)
+    if (snapshot_path && handoff_fd < 0) {
+        restore_snapshot();
+    }
+
+    if (listenfd < 0) {
+        listenfd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in serv_addr = {0};
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_addr.s_addr = INADDR_ANY;
+        serv_addr.sin_port = htons(port);
+
+        int opt = 1;
+        // Configuración para reutilizar la dirección IP y puerto
+        setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        bind(listenfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+
+        // Agregamos la llamada a listen()
+        if (listen(listenfd, SOMAXCONN) < 0) {
+            perror("Server: can't listen on port");
+            exit(1);
+        }
+    }
+
+    // Socket Unix adicional para gateways y bots en la misma máquina
+    if (unix_path && unixfd < 0 && (unixfd = transport_listen_unix(unix_path, SOMAXCONN)) < 0) {
+        perror("Server: can't listen on unix socket");
+        exit(1);
+    }
+    if (upgrade_path && controlfd < 0 && (controlfd = transport_listen_unix(upgrade_path, 1)) < 0) {
+        perror("Server: can't listen on upgrade socket");
+        exit(1);
+    }
+    if (controlfd >= 0) {
+        // Sin SA_RESTART, para que la señal corte los recv y accept bloqueantes
+        struct sigaction sa = {0};
+        sa.sa_handler = handoff_signal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(HANDOFF_SIGNAL, &sa, NULL);
+    }
+
+    printf("\033[32mServer started on port %d (codec: %s)\n\033[0m", port, codec_kind_name(server_codec)); 
+    if (coro_workers() > 0) {
+        printf("\033[32mClient handlers: coroutines on %d workers, %d KB stacks\n\033[0m", coro_workers(), CORO_STACK_SIZE / 1024);
+    } else {
+        printf("\033[32mClient handlers: one thread per connection\n\033[0m");
+    }
+    for (int role = 0; role < AFFINITY_ROLES; role++) {
+        char cpus[256];
+        affinity_describe(role, cpus, sizeof(cpus));
+        if (cpus[0]) printf("\033[32mCPU affinity %s: %s\n\033[0m", affinity_role_name(role), cpus);
+    }
+    if (unixfd >= 0) {
+        printf("\033[32mListening on unix socket %s (shared-memory rings with shm:)\n\033[0m", unix_path ? unix_path : "(inherited)");
+    }
+    if (mem_budget > 0) {
+        printf("\033[32mMemory budget: %llu MB (registrations stop at %d%%, broadcasts at %d%%)\n\033[0m",
+               (unsigned long long)(mem_budget >> 20), MEM_ADMIT_PERCENT, MEM_SHED_PERCENT);
+    }
+    for (int kind = 0; kind < RATE_KINDS; kind++) {
+        if (rate_limits[kind].rate > 0) {
+            printf("\033[32mRate limit %s: %g/s, burst %g\n\033[0m", rate_kind_name(kind), rate_limits[kind].rate, rate_limits[kind].burst);
+        }
+    }
+    if (handoff_fd >= 0) {
+        int restored = 0;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (!clients[i]) continue;
+            restored++;
+            if (clients[i]->sockfd < 0) continue;  // La sesión espera a que el cliente la reanude
+            start_client(clients[i]);
+        }
+        printf("\033[32mHot restart: took over %d clients from %s\n\033[0m", restored, takeover_path);
+        // Los puertos de métricas se liberan cuando el proceso anterior termina (cierra la conexión de control)
+        struct pollfd pfd = { .fd = handoff_fd, .events = POLLIN };
+        poll(&pfd, 1, HANDOFF_TIMEOUT_MS);
+        close(handoff_fd);
+    }
+    affinity_enter(AFFINITY_LOGGER);
+    if (metrics_start_server(stats_port, stats_socket) != 0) {
+        exit(1);
+    }
+    affinity_leave();
+    if (stats_port > 0) {
+        printf("\033[32mMetrics available on http://127.0.0.1:%d/metrics\n\033[0m", stats_port);
+    }
+    if (stats_socket) {
+        printf("\033[32mMetrics available on unix socket %s\n\033[0m", stats_socket);
+    }
+    pthread_t tid_inactivity;
+    pthread_create(&tid_inactivity, NULL, &check_inactivity, NULL); 
+    if (coalesce_window_us > 0) {
+        printf("\033[32mBroadcast coalescing: %u us window, %u us max delay\n\033[0m", coalesce_window_us, coalesce_max_delay_us);
+        pthread_t tid_coalesce;
+        pthread_create(&tid_coalesce, NULL, &coalesce_flusher, NULL);
+    }
+
+    acceptors[0].listenfd = listenfd;
+    acceptors[0].thread = pthread_self();
+    if (unixfd >= 0) {
+        acceptors[1].listenfd = unixfd;
+        pthread_create(&acceptors[1].thread, NULL, &accept_clients, &acceptors[1]);
+    } else if (acceptors[1].registering) {
+        close_connection(acceptors[1].registering->sockfd);
+        free(acceptors[1].registering);
+        acceptors[1].registering = NULL;
+    }
+    if (federation_node_id > 0) {
+        federation_callbacks_t callbacks = {
+            .deliver_broadcast = federation_deliver_broadcast,
+            .deliver_direct = federation_deliver_direct,
+            .local_users = federation_local_users,
+            .rebalance = federation_rebalance,
+            .adopt_session = federation_adopt_session
+        };
+        affinity_enter(AFFINITY_IO);
+        if (federation_start(node_port, port, &callbacks) != 0) {
+            perror("Server: can't listen on node port");
+            exit(1);
+        }
+        affinity_leave();
+        printf("\033[32mFederation: node %u, links on port %d, %d peers\n\033[0m", federation_node_id, node_port, n_peers);
+    }
+    if (capture_path) {
+        printf("\033[32mCapturing inbound requests to %s\n\033[0m", capture_path);
+    }
+    if (snapshot_path) {
+        printf("\033[32mSnapshots: %s every %u s\n\033[0m", snapshot_path, snapshot_interval);
+        pthread_t tid_snapshot;
+        pthread_create(&tid_snapshot, NULL, &snapshot_writer, NULL);
+    }
+    if (federation_node_id > 0 || snapshot_path || capture_path) {
+        pthread_t tid_stop;
+        pthread_create(&tid_stop, NULL, &stop_on_signal, NULL);
+    }
+    if (controlfd >= 0) {
+        printf("\033[32mHot restart enabled: start the new binary with --takeover %s\n\033[0m", upgrade_path ? upgrade_path : "(inherited)");
+        pthread_t tid_handoff;
+        pthread_create(&tid_handoff, NULL, &serve_handoffs, NULL);
     }
+    accept_clients(&acceptors[0]);
 
     return 0;
 }
+#endif
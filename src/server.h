@@ -0,0 +1,124 @@
+/*
+    * server.h
+    * Shared declarations of the chat server: client registry, status names and the request handlers.
+    * Lets benchmarks and other server modules reuse the same client_t and functions as server.c.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include "chat.pb-c.h"
+#include "codec.h"
+#include "frame.h"
+#include "ratelimit.h"
+#include "lanes.h"
+#include "coro.h"
+
+#ifndef MAX_CLIENTS
+#define MAX_CLIENTS 100
+#endif
+#define INACTIVITY_TIMEOUT 300
+#define PACK_STACK_SIZE 512  // Mensajes que el codec nativo empaqueta sin reservar memoria
+#define BATCH_MAX_MESSAGES 8192  // Mensajes por SEND_MESSAGE_BATCH
+#define MULTICAST_MAX_RECIPIENTS 4096  // Destinatarios por SEND_MESSAGE_MULTICAST
+#define FD_TABLE_MAX (1 << 24)  // Tope de las tablas indexadas por socket si RLIMIT_NOFILE es infinito o mayor
+#define COALESCE_FLUSH_BYTES (64 * 1024)  // Broadcasts pendientes de un cliente que se envían sin esperar la ventana
+#define SESSION_TOKEN_LEN 32  // Caracteres hexadecimales del token de una sesión reanudable
+#define SESSION_RESUME_TIMEOUT 120  // Segundos que una sesión sin conexión espera a que el cliente la reanude
+#define SESSION_REPLAY_MESSAGES 1024  // Mensajes que guarda la ventana de reenvío de una sesión
+#define SESSION_REPLAY_BYTES (256 * 1024)  // Bytes que guarda la ventana de reenvío de una sesión
+#define STREAM_MAX_OPEN 8  // Streams que un cliente puede tener abiertos a la vez
+#define STREAM_CHUNK_MAX_BYTES (16 * 1024)  // Datos por chunk, lo mismo que las colas de salida toman de una clase
+#define STREAM_BACKLOG_BYTES (256 * 1024)  // Cola de un destinatario sobre la que el emisor de un stream espera
+#define STREAM_STALL_MS 2000  // Un destinatario cuyo socket no acepta nada por este tiempo ya no frena al stream
+#define MEM_LOG_INTERVAL 60  // Segundos entre los reportes de memoria en el log (con --memory-budget)
+
+typedef enum {
+    ACTIVO = 0,   // En línea y disponible para recibir mensajes
+    OCUPADO = 1,  // En línea pero marcado como ocupado, puede no responder de inmediato
+    INACTIVO = 2  // Desconectado y no puede recibir mensajes
+} ClientStatus;
+
+// Stream abierto por un cliente con SEND_STREAM: el servidor solo recuerda a quién van sus chunks, no su contenido
+typedef struct {
+    bool open;
+    uint32_t id;
+    char recipient[32];  // Vacío para todos los usuarios en línea
+    uint64_t offset;     // Bytes ya reenviados: el siguiente chunk tiene que empezar aquí
+} open_stream_t;
+
+typedef struct {
+    struct sockaddr_in address;
+    int sockfd;
+    int uid;
+    char name[32];
+    time_t last_active;
+    ClientStatus status;
+    frame_out_t coalesced;  // Broadcasts esperando la ventana de coalescencia (protegido por clients_mutex)
+    uint32_t conn_id;  // Id de la conexión en la captura de tráfico (--capture)
+    pthread_t thread;  // Thread que atiende al cliente, para detenerlo en un reinicio en caliente
+    coro_t *coro;      // Corrutina que atiende al cliente (NULL si tiene un thread propio)
+    bool started;      // thread y coro ya son válidos (protegido por handoff_mutex)
+    bool parked;       // Detenido entre dos frames esperando el traspaso (protegido por handoff_mutex)
+
+    // Sesión reanudable, solo si el cliente la pidió al registrarse (protegido por clients_mutex)
+    bool resumable;
+    char session_token[SESSION_TOKEN_LEN + 1];
+    uint64_t next_sequence;  // Número del próximo INCOMING_MESSAGE
+    uint64_t replay_first;   // Número del mensaje más antiguo en replay
+    frame_buffer_t replay;   // Últimos INCOMING_MESSAGE numerados, con sus headers, para reenviarlos al reanudar
+    time_t detached_at;      // Desde cuándo la sesión está sin conexión (sockfd es -1 mientras tanto)
+    bool migrated;           // La sesión pasó a otro nodo de la federación; su conexión se cierra sin conservarla
+
+    rate_bucket_t rate_buckets[RATE_KINDS];  // Solo los usa el handler del cliente
+    open_stream_t streams[STREAM_MAX_OPEN];  // Solo los usa el handler del cliente
+
+    // Lo registrado en el presupuesto de memoria por coalesced y replay (protegido por clients_mutex)
+    size_t mem_queues;
+    size_t mem_history;
+} client_t;
+
+extern client_t *clients[MAX_CLIENTS];
+extern int uid;
+extern pthread_mutex_t clients_mutex;
+extern codec_kind_t server_codec;
+extern unsigned coalesce_window_us;
+extern unsigned coalesce_max_delay_us;
+extern size_t compress_min_bytes;
+
+void lock_clients(void);
+int send_packed(int sockfd, const uint8_t *buffer, size_t len);
+int send_packed_lane(int sockfd, lane_t lane, const uint8_t *buffer, size_t len);
+int send_packed_frames(int sockfd, lane_t lane, const frame_out_t *out);
+const char* get_status_name(ClientStatus status);
+const char *client_host(const client_t *cl);
+void close_connection(int sockfd);
+bool attach_shm(int sockfd, const int *fds, int n_fds);
+bool username_exists(const char* username);
+void send_response(int sockfd, Chat__StatusCode status_code, const char *message);
+void add_client(client_t *cl);
+void remove_client(int uid);
+void release_client(client_t *cl);
+void send_user_list(int sockfd, Chat__UserListRequest *request);
+void send_memory_usage(int sockfd);
+uint8_t *pack_incoming_message(const codec_incoming_message_t *msg, uint8_t *local, size_t local_size, size_t *len);
+void broadcast_message(const char *sender_name, codec_str_t message_content);
+void flush_coalesced(client_t *cl);
+void flush_coalesced_broadcasts(void);
+void *coalesce_flusher(void *arg);
+void send_direct_message_to_client(client_t *cli, codec_str_t recipient, codec_str_t message_content);
+void send_delivery_report(int sockfd, Chat__Operation operation, Chat__StatusCode status_code, const char *message,
+                          const uint8_t *bitmap, size_t count, uint32_t delivered);
+void send_message_batch(client_t *cli, const codec_send_message_t *messages, size_t count);
+void send_multicast_message(client_t *cli, const codec_str_t *recipients, size_t count, codec_str_t message_content);
+void relay_stream_chunk(client_t *cli, const Chat__StreamChunk *chunk);
+void abort_streams(client_t *cli, const char *reason);
+void* check_inactivity(void* arg);
+void *handle_client(void *arg);
+
+#endif
@@ -0,0 +1,457 @@
+/*
+    * shm_ring.c
+    * Implementation of the shared-memory rings: memfd layout, the lock-free SPSC read/write, doorbells and the
+    * blocking helpers used by the server.
+    * Every position read from the shared memory is validated, since the other process can write anything there.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include "shm_ring.h"
+
+#define SHM_HEADER_SIZE 4096             // Encabezado y control de los dos rings; los datos empiezan en la página siguiente
+#define SHM_RING_MAX_CAPACITY (64 << 20)
+
+struct shm_ring_ctrl {
+    _Alignas(64) _Atomic uint64_t head;  // Bytes escritos desde el inicio (solo lo avanza el productor)
+    _Atomic uint32_t consumer_sleeping;  // El consumidor va a dormir: el productor debe tocar data_fd
+    _Alignas(64) _Atomic uint64_t tail;  // Bytes leídos desde el inicio (solo lo avanza el consumidor)
+    _Atomic uint32_t producer_sleeping;  // El productor espera espacio: el consumidor debe tocar space_fd
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t reserved;
+    _Alignas(64) struct shm_ring_ctrl rings[2];  // 0: requests, 1: responses
+} shm_header_t;
+
+_Static_assert(sizeof(shm_header_t) <= SHM_HEADER_SIZE, "shm header does not fit in its page");
+
+static void doorbell(int fd) {
+    uint64_t one = 1;
+    ssize_t rc = write(fd, &one, sizeof(one));
+    (void)rc;
+}
+
+static void doorbell_clear(int fd) {
+    uint64_t count;
+    ssize_t rc = read(fd, &count, sizeof(count));
+    (void)rc;
+}
+
+/*
+Funcion que arma los dos rings sobre el memfd ya mapeado.
+Orden de los descriptores: memfd, data/space de requests, data/space de responses.
+*/
+static shm_conn_t *conn_setup(void *map, size_t map_len, size_t capacity, const int fds[SHM_RING_FDS]) {
+    shm_conn_t *conn = calloc(1, sizeof(shm_conn_t));
+    shm_header_t *header = map;
+    conn->map = map;
+    conn->map_len = map_len;
+    memcpy(conn->fds, fds, sizeof(conn->fds));
+
+    shm_ring_t *rings[2] = { &conn->requests, &conn->responses };
+    for (int i = 0; i < 2; i++) {
+        rings[i]->ctrl = &header->rings[i];
+        rings[i]->data = (uint8_t *)map + SHM_HEADER_SIZE + i * capacity;
+        rings[i]->capacity = capacity;
+        rings[i]->data_fd = fds[1 + 2 * i];
+        rings[i]->space_fd = fds[2 + 2 * i];
+    }
+    pthread_mutex_init(&conn->send_lock, NULL);
+    return conn;
+}
+
+static void close_fds(const int fds[SHM_RING_FDS]) {
+    for (int i = 0; i < SHM_RING_FDS; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+}
+
+/*
+Funcion que crea el memfd y los eventfd de una conexión nueva (lado del cliente).
+El memfd queda sellado contra cambios de tamaño, así el servidor puede mapearlo sin riesgo de SIGBUS.
+Retornos:
+    * shm_conn_t *: conexión lista para enviar sus fds al servidor, NULL si falló
+*/
+shm_conn_t *shm_conn_create(void) {
+    int fds[SHM_RING_FDS];
+    size_t map_len = SHM_HEADER_SIZE + 2 * (size_t)SHM_RING_CAPACITY;
+
+    fds[0] = memfd_create("chat-shm-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    for (int i = 1; i < SHM_RING_FDS; i++) {
+        fds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    for (int i = 0; i < SHM_RING_FDS; i++) {
+        if (fds[i] < 0) {
+            close_fds(fds);
+            return NULL;
+        }
+    }
+    if (ftruncate(fds[0], map_len) != 0 ||
+        fcntl(fds[0], F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        close_fds(fds);
+        return NULL;
+    }
+    void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if (map == MAP_FAILED) {
+        close_fds(fds);
+        return NULL;
+    }
+
+    // El memfd empieza en ceros: head, tail y los flags de los dos rings ya están en 0
+    shm_header_t *header = map;
+    header->magic = SHM_RING_MAGIC;
+    header->version = SHM_RING_VERSION;
+    header->capacity = SHM_RING_CAPACITY;
+    return conn_setup(map, map_len, SHM_RING_CAPACITY, fds);
+}
+
+/*
+Funcion que valida y mapea los descriptores recibidos de un cliente (lado del servidor).
+Toma posesión de los descriptores: si falla los cierra.
+Retornos:
+    * shm_conn_t *: conexión lista, NULL si el memfd no tiene el formato esperado
+*/
+shm_conn_t *shm_conn_attach(const int fds[SHM_RING_FDS]) {
+    struct stat st;
+    int seals = fcntl(fds[0], F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK) || fstat(fds[0], &st) != 0 || (size_t)st.st_size < SHM_HEADER_SIZE) {
+        close_fds(fds);
+        return NULL;
+    }
+
+    shm_header_t header;
+    if (pread(fds[0], &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        close_fds(fds);
+        return NULL;
+    }
+    size_t capacity = header.capacity;
+    size_t map_len = SHM_HEADER_SIZE + 2 * capacity;
+    bool valid = header.magic == SHM_RING_MAGIC && header.version == SHM_RING_VERSION &&
+                 capacity >= FRAME_HEADER_SIZE + FRAME_MAX_SIZE && capacity <= SHM_RING_MAX_CAPACITY &&
+                 (capacity & (capacity - 1)) == 0 && (size_t)st.st_size == map_len;
+    if (!valid) {
+        close_fds(fds);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if (map == MAP_FAILED) {
+        close_fds(fds);
+        return NULL;
+    }
+    // Las escrituras a los doorbells del cliente nunca deben bloquear al servidor
+    for (int i = 1; i < SHM_RING_FDS; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    }
+    return conn_setup(map, map_len, capacity, fds);
+}
+
+void shm_conn_close(shm_conn_t *conn) {
+    munmap(conn->map, conn->map_len);
+    close_fds(conn->fds);
+    pthread_mutex_destroy(&conn->send_lock);
+    free(conn);
+}
+
+/*
+Funcion que escribe en el ring todo lo que quepa, sin bloquear. Solo la llama el productor del ring.
+Si el consumidor estaba por dormir, lo despierta.
+Retornos:
+    * ssize_t: bytes escritos (0 si el ring está lleno) y -1 si las posiciones compartidas son inválidas
+*/
+ssize_t shm_ring_write(shm_ring_t *ring, const uint8_t *data, size_t len) {
+    uint64_t head = atomic_load_explicit(&ring->ctrl->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->ctrl->tail, memory_order_acquire);
+    if (head - tail > ring->capacity) {
+        errno = EPROTO;
+        return -1;
+    }
+    size_t free_space = ring->capacity - (head - tail);
+    size_t n = len < free_space ? len : free_space;
+    if (n == 0) return 0;
+
+    size_t pos = head & (ring->capacity - 1);
+    size_t first = n < ring->capacity - pos ? n : ring->capacity - pos;
+    memcpy(ring->data + pos, data, first);
+    memcpy(ring->data, data + first, n - first);
+    atomic_store_explicit(&ring->ctrl->head, head + n, memory_order_release);
+
+    // Publicar head antes de leer el flag; el consumidor hace lo inverso en shm_ring_arm_read
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->ctrl->consumer_sleeping, memory_order_relaxed) &&
+        atomic_exchange(&ring->ctrl->consumer_sleeping, 0)) {
+        doorbell(ring->data_fd);
+    }
+    return n;
+}
+
+/*
+Funcion que lee del ring lo que haya disponible, hasta len bytes, sin bloquear. Solo la llama el consumidor.
+Si el productor esperaba espacio, lo despierta.
+Retornos:
+    * ssize_t: bytes leídos (0 si el ring está vacío) y -1 si las posiciones compartidas son inválidas
+*/
+ssize_t shm_ring_read(shm_ring_t *ring, uint8_t *out, size_t len) {
+    uint64_t tail = atomic_load_explicit(&ring->ctrl->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->ctrl->head, memory_order_acquire);
+    if (head - tail > ring->capacity) {
+        errno = EPROTO;
+        return -1;
+    }
+    size_t available = head - tail;
+    size_t n = len < available ? len : available;
+    if (n == 0) return 0;
+
+    size_t pos = tail & (ring->capacity - 1);
+    size_t first = n < ring->capacity - pos ? n : ring->capacity - pos;
+    memcpy(out, ring->data + pos, first);
+    memcpy(out + first, ring->data, n - first);
+    atomic_store_explicit(&ring->ctrl->tail, tail + n, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->ctrl->producer_sleeping, memory_order_relaxed) &&
+        atomic_exchange(&ring->ctrl->producer_sleeping, 0)) {
+        doorbell(ring->space_fd);
+    }
+    return n;
+}
+
+/*
+Funcion que pasa todo lo disponible en el ring al buffer de lectura, igual que frame_buffer_fill con un socket.
+Retornos:
+    * ssize_t: bytes leídos, -2 si el ring estaba vacío y -1 si las posiciones compartidas son inválidas
+*/
+ssize_t shm_ring_fill(shm_ring_t *ring, frame_buffer_t *fb) {
+    if (fb->start > 0) {
+        memmove(fb->data, fb->data + fb->start, fb->len - fb->start);
+        fb->len -= fb->start;
+        fb->start = 0;
+    }
+    ssize_t total = 0;
+    while (1) {
+        if (fb->cap - fb->len < 4096) {
+            size_t cap = fb->cap ? fb->cap * 2 : 16384;
+            uint8_t *grown = realloc(fb->data, cap);
+            if (!grown) return -1;
+            fb->data = grown;
+            fb->cap = cap;
+        }
+        ssize_t n = shm_ring_read(ring, fb->data + fb->len, fb->cap - fb->len);
+        if (n < 0) return -1;
+        if (n == 0) return total > 0 ? total : -2;
+        fb->len += n;
+        total += n;
+    }
+}
+
+/*
+Funcion que prepara al consumidor para dormir en data_fd.
+Retornos:
+    * bool: true si el ring sigue vacío y se puede esperar a data_fd; false si llegaron datos (no dormir)
+*/
+bool shm_ring_arm_read(shm_ring_t *ring) {
+    atomic_store(&ring->ctrl->consumer_sleeping, 1);
+    uint64_t tail = atomic_load_explicit(&ring->ctrl->tail, memory_order_relaxed);
+    if (atomic_load(&ring->ctrl->head) != tail) {
+        atomic_store(&ring->ctrl->consumer_sleeping, 0);
+        return false;
+    }
+    return true;
+}
+
+/*
+Funcion que prepara al productor para dormir en space_fd.
+Retornos:
+    * bool: true si el ring sigue lleno y se puede esperar a space_fd; false si ya hay espacio
+*/
+bool shm_ring_arm_write(shm_ring_t *ring) {
+    atomic_store(&ring->ctrl->producer_sleeping, 1);
+    uint64_t head = atomic_load_explicit(&ring->ctrl->head, memory_order_relaxed);
+    if (head - atomic_load(&ring->ctrl->tail) < ring->capacity) {
+        atomic_store(&ring->ctrl->producer_sleeping, 0);
+        return false;
+    }
+    return true;
+}
+
+/*
+Funcion que espera un doorbell o a que el otro proceso cierre su socket.
+Parametros:
+    * int (*wait)(...): poll, o frame_wait para las lecturas (en el servidor suspende solo a la corrutina)
+Retornos:
+    * int: 0 si sonó el doorbell, 1 si el otro extremo cerró, 2 si una señal interrumpió la espera y -1 para errores
+*/
+static int wait_doorbell(int fd, int peer_fd, int (*wait)(struct pollfd *, nfds_t, int)) {
+    struct pollfd pfds[2] = {
+        { .fd = fd, .events = POLLIN },
+        { .fd = peer_fd, .events = POLLIN }  // Después del registro el socket solo se lee para ver si se cerró
+    };
+    if (wait(pfds, 2, -1) < 0) return errno == EINTR ? 2 : -1;
+    if (pfds[0].revents & POLLIN) doorbell_clear(fd);
+    return pfds[1].revents ? 1 : 0;
+}
+
+static int write_all(shm_ring_t *ring, const uint8_t *data, size_t len, int peer_fd) {
+    while (len > 0) {
+        ssize_t n = shm_ring_write(ring, data, len);
+        if (n < 0) return -1;
+        data += n;
+        len -= n;
+        if (len > 0 && shm_ring_arm_write(ring)) {
+            // Solo sin colas de salida (bench, o si no arrancó su flusher): ahí se escribe bloqueando, como en un socket
+            int rc = wait_doorbell(ring->space_fd, peer_fd, poll);
+            if (rc == 1 || rc < 0) {
+                atomic_store(&ring->ctrl->producer_sleeping, 0);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+Funcion que lee exactamente len bytes, esperando al productor si hace falta.
+Con interruptible, una señal antes del primer byte retorna -1 con errno EINTR (como recv_frame).
+Retornos:
+    * int: 1 para exito, 0 si el otro extremo cerró y el ring quedó vacío, -1 para errores
+*/
+static int read_all(shm_ring_t *ring, uint8_t *out, size_t len, int peer_fd, bool interruptible) {
+    size_t total = len;
+    while (len > 0) {
+        ssize_t n = shm_ring_read(ring, out, len);
+        if (n < 0) return -1;
+        out += n;
+        len -= n;
+        if (len > 0 && shm_ring_arm_read(ring)) {
+            int rc = wait_doorbell(ring->data_fd, peer_fd, frame_wait);
+            if (rc == 2) {
+                if (!interruptible || len != total) continue;
+                atomic_store(&ring->ctrl->consumer_sleeping, 0);
+                errno = EINTR;
+                return -1;
+            }
+            if (rc != 0) {
+                atomic_store(&ring->ctrl->consumer_sleeping, 0);
+                // Lo que el otro proceso dejó escrito antes de cerrar todavía se entrega
+                uint64_t tail = atomic_load_explicit(&ring->ctrl->tail, memory_order_relaxed);
+                if (atomic_load(&ring->ctrl->head) != tail) continue;
+                return rc > 0 ? 0 : -1;
+            }
+        }
+    }
+    return 1;
+}
+
+static int send_locked(shm_conn_t *conn, const uint8_t *header, const uint8_t *data, size_t len, int peer_fd) {
+    pthread_mutex_lock(&conn->send_lock);
+    int rc = 0;
+    if (header) rc = write_all(&conn->responses, header, FRAME_HEADER_SIZE, peer_fd);
+    if (rc == 0) rc = write_all(&conn->responses, data, len, peer_fd);
+    pthread_mutex_unlock(&conn->send_lock);
+    return rc;
+}
+
+/*
+Funcion que escribe un frame en el ring de respuestas, esperando espacio si está lleno (lado del servidor).
+Parametros:
+    * int peer_fd: socket Unix del cliente, para dejar de esperar si se desconecta
+Retornos:
+    * int: 0 para exito y -1 si el cliente se fue o el ring es inválido
+*/
+int shm_conn_send(shm_conn_t *conn, const uint8_t *payload, size_t len, int peer_fd) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    frame_write_header(header, len);
+    return send_locked(conn, header, payload, len, peer_fd);
+}
+
+/*
+Funcion que escribe varios frames ya armados (con sus headers) en el ring de respuestas.
+*/
+int shm_conn_send_frames(shm_conn_t *conn, const uint8_t *frames, size_t len, int peer_fd) {
+    return send_locked(conn, NULL, frames, len, peer_fd);
+}
+
+/*
+Funcion que escribe en el ring de respuestas lo que quepa, sin esperar (lane_write_fn de las conexiones locales).
+Si no cupo todo deja al productor esperando espacio, así que el cliente toca space_fd cuando lea: las colas de salida
+guardan el resto y su flusher espera ese doorbell como esperaría EPOLLOUT en un socket.
+Parametros:
+    * const uint8_t *header: header del frame si data es un mensaje, NULL si data son frames completos
+Retornos:
+    * ssize_t: bytes escritos, contando el header (0 si el ring está lleno), y -1 si el ring es inválido
+*/
+ssize_t shm_conn_try_send(shm_conn_t *conn, const uint8_t *header, const uint8_t *data, size_t len) {
+    shm_ring_t *ring = &conn->responses;
+    size_t header_len = header ? FRAME_HEADER_SIZE : 0;
+    size_t total = header_len + len;
+    size_t done = 0;
+    pthread_mutex_lock(&conn->send_lock);
+    while (1) {
+        while (done < total) {
+            const uint8_t *from = done < header_len ? header + done : data + (done - header_len);
+            size_t left = done < header_len ? header_len - done : total - done;
+            ssize_t n = shm_ring_write(ring, from, left);
+            if (n < 0) {
+                pthread_mutex_unlock(&conn->send_lock);
+                return -1;
+            }
+            if (n == 0) break;
+            done += n;
+        }
+        if (done == total) break;
+        // Un aviso viejo despertaría al flusher sin espacio; después de armar, cualquier aviso es nuevo
+        doorbell_clear(ring->space_fd);
+        if (shm_ring_arm_write(ring)) break;
+    }
+    pthread_mutex_unlock(&conn->send_lock);
+    return done;
+}
+
+/*
+Funcion que recibe un frame completo de un ring, bloqueando como recv_frame.
+Parametros:
+    * shm_ring_t *ring: ring del que se consume (requests en el servidor, responses en el cliente)
+    * uint8_t **buffer: buffer del llamador (puede empezar en NULL)
+    * size_t *capacity: capacidad actual del buffer
+    * int peer_fd: socket Unix del otro proceso, para detectar que se fue
+Retornos:
+    * ssize_t: longitud del mensaje, 0 si el otro extremo cerró y -1 para errores o frames inválidos
+*/
+ssize_t shm_ring_recv_frame(shm_ring_t *ring, uint8_t **buffer, size_t *capacity, int peer_fd) {
+    while (1) {
+        uint8_t header[FRAME_HEADER_SIZE];
+        int rc = read_all(ring, header, sizeof(header), peer_fd, true);
+        if (rc <= 0) return rc;
+
+        size_t len = frame_read_header(header);
+        if (len > FRAME_MAX_SIZE) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        if (len == 0) continue;  // Mensaje vacío, igual que en recv_frame
+        if (*capacity < len) {
+            uint8_t *grown = realloc(*buffer, len);
+            if (!grown) return -1;
+            *buffer = grown;
+            *capacity = len;
+        }
+        rc = read_all(ring, *buffer, len, peer_fd, false);
+        if (rc <= 0) return rc < 0 ? -1 : 0;
+        return len;
+    }
+}
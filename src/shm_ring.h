@@ -0,0 +1,59 @@
+/*
+    * shm_ring.h
+    * Shared-memory transport for clients on the same machine: two single-producer/single-consumer byte rings in one
+    * memfd (requests client -> server, responses server -> client) with eventfd doorbells. The rings carry exactly the
+    * same length-prefixed frames as the socket, so the server dispatch does not change.
+    * The client creates the memfd and the eventfds and hands them to the server with SCM_RIGHTS on the registration
+    * frame, over the server's Unix socket; after that the socket only tells each side when the other one is gone.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "frame.h"
+
+#define SHM_RING_MAGIC 0x43485452u  // "CHTR"
+#define SHM_RING_VERSION 1
+#define SHM_RING_CAPACITY (2 << 20)  // Bytes por dirección: potencia de 2 y mayor que un frame máximo
+#define SHM_RING_FDS 5               // memfd + data/space de requests + data/space de responses
+
+typedef struct shm_ring_ctrl shm_ring_ctrl_t;
+
+typedef struct {
+    shm_ring_ctrl_t *ctrl;
+    uint8_t *data;
+    size_t capacity;
+    int data_fd;   // eventfd: el productor avisa que escribió bytes nuevos
+    int space_fd;  // eventfd: el consumidor avisa que liberó espacio
+} shm_ring_t;
+
+typedef struct {
+    void *map;
+    size_t map_len;
+    int fds[SHM_RING_FDS];
+    shm_ring_t requests;        // Cliente -> servidor
+    shm_ring_t responses;       // Servidor -> cliente
+    pthread_mutex_t send_lock;  // En el servidor varios threads escriben en responses
+} shm_conn_t;
+
+shm_conn_t *shm_conn_create(void);
+shm_conn_t *shm_conn_attach(const int fds[SHM_RING_FDS]);
+void shm_conn_close(shm_conn_t *conn);
+int shm_conn_send(shm_conn_t *conn, const uint8_t *payload, size_t len, int peer_fd);
+int shm_conn_send_frames(shm_conn_t *conn, const uint8_t *frames, size_t len, int peer_fd);
+ssize_t shm_conn_try_send(shm_conn_t *conn, const uint8_t *header, const uint8_t *data, size_t len);
+
+ssize_t shm_ring_write(shm_ring_t *ring, const uint8_t *data, size_t len);
+ssize_t shm_ring_read(shm_ring_t *ring, uint8_t *out, size_t len);
+ssize_t shm_ring_fill(shm_ring_t *ring, frame_buffer_t *fb);
+bool shm_ring_arm_read(shm_ring_t *ring);
+bool shm_ring_arm_write(shm_ring_t *ring);
+ssize_t shm_ring_recv_frame(shm_ring_t *ring, uint8_t **buffer, size_t *capacity, int peer_fd);
+
+#endif
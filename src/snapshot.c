@@ -0,0 +1,175 @@
+/*
+    * snapshot.c
+    * Writing and mmap loading of the server state snapshots.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+static uint64_t checksum_update(uint64_t hash, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#define CHECKSUM_SEED 14695981039346656037ull
+
+void snapshot_begin(snapshot_t *snap, int32_t next_uid) {
+    memset(snap, 0, sizeof(*snap));
+    snap->header.magic = SNAPSHOT_MAGIC;
+    snap->header.version = SNAPSHOT_VERSION;
+    snap->header.record_size = sizeof(snapshot_session_t);
+    snap->header.created_at = time(NULL);
+    snap->header.next_uid = next_uid;
+}
+
+/*
+Funcion que agrega una sesión al snapshot y copia su ventana de reenvío.
+Parametros:
+    * const snapshot_session_t *session: registro de la sesión (replay_offset y replay_len se calculan aquí)
+    * const uint8_t *replay: ventana de reenvío, INCOMING_MESSAGE numerados con sus headers de frame
+Retornos:
+    * int: 0 para exito y -1 si no hubo memoria
+*/
+int snapshot_add(snapshot_t *snap, const snapshot_session_t *session, const uint8_t *replay, size_t replay_len) {
+    if (replay_len > UINT32_MAX) return -1;
+    if (snap->header.n_sessions == snap->cap_sessions) {
+        size_t cap = snap->cap_sessions ? snap->cap_sessions * 2 : 64;
+        snapshot_session_t *sessions = realloc(snap->sessions, cap * sizeof(*sessions));
+        if (!sessions) return -1;
+        snap->sessions = sessions;
+        snap->cap_sessions = cap;
+    }
+    if (snap->replays_len + replay_len > snap->cap_replays) {
+        size_t cap = snap->cap_replays ? snap->cap_replays : 64 * 1024;
+        while (cap < snap->replays_len + replay_len) cap *= 2;
+        uint8_t *replays = realloc(snap->replays, cap);
+        if (!replays) return -1;
+        snap->replays = replays;
+        snap->cap_replays = cap;
+    }
+    snapshot_session_t *rec = &snap->sessions[snap->header.n_sessions++];
+    *rec = *session;
+    rec->replay_offset = snap->replays_len;  // Relativo a las ventanas hasta snapshot_commit
+    rec->replay_len = replay_len;
+    if (replay_len > 0) memcpy(snap->replays + snap->replays_len, replay, replay_len);
+    snap->replays_len += replay_len;
+    return 0;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+Funcion que escribe el snapshot en path (a través de path.tmp y rename) y libera su memoria.
+Retornos:
+    * int: 0 para exito y -1 si no se pudo escribir (el snapshot anterior queda intacto)
+*/
+int snapshot_commit(snapshot_t *snap, const char *path) {
+    size_t records_len = (size_t)snap->header.n_sessions * sizeof(snapshot_session_t);
+    uint64_t base = sizeof(snapshot_header_t) + records_len;
+    for (uint32_t i = 0; i < snap->header.n_sessions; i++) {
+        snap->sessions[i].replay_offset += base;
+    }
+    snap->header.file_len = base + snap->replays_len;
+    uint64_t checksum = checksum_update(CHECKSUM_SEED, (const uint8_t *)snap->sessions, records_len);
+    snap->header.checksum = checksum_update(checksum, snap->replays, snap->replays_len);
+
+    char tmp_path[4096];
+    int rc = -1;
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) < (int)sizeof(tmp_path)) {
+        int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd >= 0) {
+            rc = write_all(fd, &snap->header, sizeof(snap->header)) == 0 &&
+                 write_all(fd, snap->sessions, records_len) == 0 &&
+                 write_all(fd, snap->replays, snap->replays_len) == 0 &&
+                 fsync(fd) == 0 ? 0 : -1;
+            if (close(fd) != 0) rc = -1;
+            if (rc == 0) rc = rename(tmp_path, path);
+            if (rc != 0) unlink(tmp_path);
+        }
+    }
+    snapshot_discard(snap);
+    return rc;
+}
+
+void snapshot_discard(snapshot_t *snap) {
+    free(snap->sessions);
+    free(snap->replays);
+    snap->sessions = NULL;
+    snap->replays = NULL;
+}
+
+/*
+Funcion que abre un snapshot con mmap y valida el header, el checksum y que cada ventana esté dentro del archivo.
+Retornos:
+    * int: 0 para exito, -1 si no existe (errno ENOENT) o no es válido (errno EPROTO)
+*/
+int snapshot_open(const char *path, snapshot_map_t *map) {
+    memset(map, 0, sizeof(*map));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snapshot_header_t)) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    map->map = data;
+    map->map_len = st.st_size;
+    map->header = data;
+    map->sessions = (const snapshot_session_t *)((const uint8_t *)data + sizeof(snapshot_header_t));
+
+    const snapshot_header_t *h = map->header;
+    bool valid = h->magic == SNAPSHOT_MAGIC && h->version == SNAPSHOT_VERSION &&
+                 h->record_size == sizeof(snapshot_session_t) && h->file_len == map->map_len &&
+                 h->n_sessions <= (map->map_len - sizeof(snapshot_header_t)) / sizeof(snapshot_session_t);
+    if (valid) {
+        const uint8_t *rest = (const uint8_t *)data + sizeof(snapshot_header_t);
+        valid = checksum_update(CHECKSUM_SEED, rest, map->map_len - sizeof(snapshot_header_t)) == h->checksum;
+    }
+    uint64_t base = sizeof(snapshot_header_t) + (uint64_t)h->n_sessions * sizeof(snapshot_session_t);
+    for (uint32_t i = 0; valid && i < h->n_sessions; i++) {
+        const snapshot_session_t *s = &map->sessions[i];
+        valid = s->replay_offset >= base && s->replay_offset <= map->map_len &&
+                s->replay_len <= map->map_len - s->replay_offset;
+    }
+    if (!valid) {
+        snapshot_close(map);
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+const uint8_t *snapshot_replay(const snapshot_map_t *map, const snapshot_session_t *session) {
+    return (const uint8_t *)map->map + session->replay_offset;
+}
+
+void snapshot_close(snapshot_map_t *map) {
+    if (map->map) munmap(map->map, map->map_len);
+    memset(map, 0, sizeof(*map));
+}
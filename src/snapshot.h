@@ -0,0 +1,76 @@
+/*
+    * snapshot.h
+    * Periodic snapshots of the server state on disk, loaded on a cold start in one pass over an mmap of the file.
+    * Only what can outlive the connections is saved: the resumable sessions (name, status, token, sequence numbers
+    * and replay window) and the next uid. A client whose session is in the snapshot resumes it after the restart
+    * and gets the messages it had not received, as after a dropped connection.
+    * Layout (little endian, same machine and build): header, n_sessions fixed-size records, then the replay windows
+    * that the records point to. The file is written to <path>.tmp and renamed, so a crash never leaves half a snapshot.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SNAPSHOT_MAGIC 0x43485350u  // "CHSP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_INTERVAL 30  // Segundos entre snapshots si no se indica --snapshot-interval
+
+#define SNAPSHOT_SESSION_DETACHED 0x1  // La sesión ya no tenía conexión cuando se tomó el snapshot
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;  // sizeof(snapshot_session_t), para no leer registros de otro build
+    int64_t created_at;
+    int32_t next_uid;
+    uint32_t n_sessions;
+    uint64_t file_len;
+    uint64_t checksum;  // FNV-1a de todo lo que sigue al header
+} snapshot_header_t;
+
+typedef struct {
+    int32_t uid;
+    int32_t status;        // ClientStatus
+    int64_t last_active;
+    int64_t detached_at;   // Solo con SNAPSHOT_SESSION_DETACHED
+    uint64_t next_sequence;
+    uint64_t replay_first;
+    uint64_t replay_offset;  // Desde el inicio del archivo
+    uint32_t replay_len;
+    uint32_t flags;
+    char name[32];
+    char session_token[40];
+} snapshot_session_t;
+
+// Snapshot que se está armando en memoria
+typedef struct {
+    snapshot_header_t header;
+    snapshot_session_t *sessions;
+    size_t cap_sessions;
+    uint8_t *replays;
+    size_t replays_len;
+    size_t cap_replays;
+} snapshot_t;
+
+// Snapshot abierto para leer; los punteros apuntan al mmap del archivo
+typedef struct {
+    const snapshot_header_t *header;
+    const snapshot_session_t *sessions;
+    void *map;
+    size_t map_len;
+} snapshot_map_t;
+
+void snapshot_begin(snapshot_t *snap, int32_t next_uid);
+int snapshot_add(snapshot_t *snap, const snapshot_session_t *session, const uint8_t *replay, size_t replay_len);
+int snapshot_commit(snapshot_t *snap, const char *path);
+void snapshot_discard(snapshot_t *snap);
+int snapshot_open(const char *path, snapshot_map_t *map);
+const uint8_t *snapshot_replay(const snapshot_map_t *map, const snapshot_session_t *session);
+void snapshot_close(snapshot_map_t *map);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+    * transport.c
+    * Implementation of the TCP and Unix domain socket helpers.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include "transport.h"
+
+bool transport_is_unix(const char *address) {
+    return strncmp(address, TRANSPORT_UNIX_PREFIX, strlen(TRANSPORT_UNIX_PREFIX)) == 0;
+}
+
+bool transport_is_shm(const char *address) {
+    return strncmp(address, TRANSPORT_SHM_PREFIX, strlen(TRANSPORT_SHM_PREFIX)) == 0;
+}
+
+/*
+Funcion que arma la dirección de un socket Unix.
+Parametros:
+    * const char *path: ruta del socket, o '@' seguido del nombre para el namespace abstracto
+    * struct sockaddr_un *addr: dirección resultante
+    * socklen_t *len: largo de la dirección (en el namespace abstracto el nombre no termina en '\0')
+Retornos:
+    * int: 0 para exito y -1 si la ruta está vacía o no cabe en sun_path
+*/
+static int unix_address(const char *path, struct sockaddr_un *addr, socklen_t *len) {
+    size_t path_len = strlen(path);
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (path_len == 0 || path_len >= sizeof(addr->sun_path)) {
+        errno = path_len == 0 ? EINVAL : ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(addr->sun_path, path, path_len);
+    if (path[0] == '@') {
+        addr->sun_path[0] = '\0';
+        *len = offsetof(struct sockaddr_un, sun_path) + path_len;
+    } else {
+        *len = offsetof(struct sockaddr_un, sun_path) + path_len + 1;
+    }
+    return 0;
+}
+
+/*
+Funcion que abre una conexión con el servidor.
+Parametros:
+    * const char *address: IPv4 del servidor, o "unix:"/"shm:" seguido de la ruta o del @nombre abstracto
+    * int port: puerto TCP (se ignora con un socket Unix)
+Retornos:
+    * int: socket conectado, -1 si falló (errno es EINVAL si la dirección no es válida)
+*/
+int transport_connect(const char *address, int port) {
+    int sockfd;
+    if (transport_is_unix(address) || transport_is_shm(address)) {
+        struct sockaddr_un addr;
+        socklen_t len;
+        const char *path = strchr(address, ':') + 1;
+        if (unix_address(path, &addr, &len) != 0) return -1;
+        sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sockfd < 0) return -1;
+        if (connect(sockfd, (struct sockaddr *)&addr, len) == 0) return sockfd;
+    } else {
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+            errno = EINVAL;
+            return -1;
+        }
+        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0) return -1;
+        if (connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == 0) return sockfd;
+    }
+    int saved = errno;
+    close(sockfd);
+    errno = saved;
+    return -1;
+}
+
+/*
+Funcion que crea un socket Unix que escucha conexiones.
+Si la ruta es un archivo, el socket que haya quedado de una ejecución anterior se reemplaza.
+Parametros:
+    * const char *path: ruta del socket, o '@' seguido del nombre para el namespace abstracto
+    * int backlog: conexiones pendientes que acepta listen
+Retornos:
+    * int: socket que escucha, -1 si falló
+*/
+int transport_listen_unix(const char *path, int backlog) {
+    struct sockaddr_un addr;
+    socklen_t len;
+    if (unix_address(path, &addr, &len) != 0) return -1;
+    if (path[0] != '@') unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *)&addr, len) < 0 || listen(fd, backlog) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/*
+Funcion que crea un socket TCP que escucha conexiones en todas las interfaces.
+Parametros:
+    * int port: puerto TCP
+    * int backlog: conexiones pendientes que acepta listen
+Retornos:
+    * int: socket que escucha, -1 si falló
+*/
+int transport_listen_tcp(int port, int backlog) {
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/*
+Funcion que retorna cuántos descriptores puede tener abiertos el proceso (RLIMIT_NOFILE), para dimensionar las
+tablas indexadas por descriptor: ningún descriptor que se abra después llega a ese número.
+Parametros:
+    * size_t cap: tope, para un límite infinito o demasiado grande
+Retornos:
+    * size_t: el límite, o cap si no se pudo leer o lo supera
+*/
+size_t transport_fd_limit(size_t cap) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > cap) return cap;
+    return (size_t)limit.rlim_cur;
+}
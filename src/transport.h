@@ -0,0 +1,26 @@
+/*
+    * transport.h
+    * Socket setup shared by the server, the client library and loadgen: TCP over IPv4 or Unix domain sockets.
+    * A Unix address is written "unix:/path/to/socket", or "unix:@name" for a socket in the Linux abstract
+    * namespace (no file on disk, it goes away with the last descriptor). "shm:" instead of "unix:" connects to the
+    * same socket but asks for the shared-memory rings of shm_ring.h.
+    * @autors: Melissa Pérez, Fernanda Esquivel
+*/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TRANSPORT_UNIX_PREFIX "unix:"
+#define TRANSPORT_SHM_PREFIX "shm:"
+
+bool transport_is_unix(const char *address);
+bool transport_is_shm(const char *address);
+int transport_connect(const char *address, int port);
+int transport_listen_unix(const char *path, int backlog);
+int transport_listen_tcp(int port, int backlog);
+size_t transport_fd_limit(size_t cap);
+
+#endif